@@ -0,0 +1,429 @@
+/*
+ * Microbenchmarks for the command dispatcher and its parsers.
+ *
+ * The dispatcher's helpers are static, so this file includes
+ * command_processor.c itself. Every benchmark runs its function over a
+ * corpus of realistic phrases; the harness calibrates the iteration count
+ * so one sample takes at least --min-time, discards --warmup samples, then
+ * reports the median and the median absolute deviation (MAD) of --reps
+ * samples in nanoseconds per call.
+ *
+ *   bench [--only a,b] [--reps N] [--warmup N] [--min-time MS]
+ *         [--json FILE] [--baseline FILE] [--threshold PERCENT]
+ *
+ * With --baseline, each median is compared with the stored one. A benchmark
+ * regresses when it is more than --threshold percent (default 10) slower
+ * and the difference is larger than three MADs, so noise alone does not
+ * fail the gate; any regression makes the exit status 1.
+ */
+
+#include "../src/command_processor.c"
+#include "../include/json.h"
+#include <dirent.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_SCHEMA "jarvis-bench 1"
+#define BENCH_MAX_REPS 1000
+
+/* ── Stubbed side effects ─────────────────────────────────────────────────
+ * Defined in the program, these take the place of the C library's for every
+ * module linked in: browser launches and app openers do nothing, and shell
+ * captures read a canned line like the real tool would print.
+ */
+
+int system(const char* command) {
+    (void)command;
+    return 0;
+}
+
+FILE* popen(const char* command, const char* mode) {
+    static const char* const uname_output = "Linux 6.1.0 x86_64\n";
+    static const char* const weather_output = "London: +12C, partly cloudy\n";
+    static const char* const git_output = "## main...origin/main\n M src/command_processor.c\n";
+    static const char* const default_output = "ok\n";
+    const char* text = default_output;
+    if (strstr(command, "uname")) text = uname_output;
+    else if (strstr(command, "wttr") || strstr(command, "curl")) text = weather_output;
+    else if (strstr(command, "git")) text = git_output;
+    return fmemopen((void*)text, strlen(text), mode);
+}
+
+int pclose(FILE* stream) {
+    return stream && fclose(stream) == 0 ? 0 : -1;
+}
+
+/* ── Corpus ───────────────────────────────────────────────────────────── */
+
+/* Utterances as speech recognition hands them over */
+static const char* const g_phrases[] = {
+    "Hello Jarvis",
+    "What time is it",
+    "Help",
+    "Tell me a joke",
+    "System info",
+    "Open YouTube",
+    "Play lofi hip hop on YouTube",
+    "Search for rust borrow checker errors",
+    "Google best pizza near me",
+    "What is a mutex",
+    "How to reverse a linked list in C",
+    "Who is Alan Turing",
+    "What's the weather like today",
+    "Git status",
+    "Daily status",
+    "Open VS Code",
+    "Open website github.com",
+    "Open Stack Overflow",
+    "Performance report",
+    "Where am I",
+    "List files",
+    "Lock screen",
+    "python kya hai",
+    "youtube pe lofi music chalao",
+    "Can you look for the release notes of gcc 14",
+    "Show me pictures of the northern lights",
+};
+
+static const char* const g_keywords[] = {
+    "tell me a joke", "time", "hello", "help", "system info", "open project", "youtube", "open website",
+    "build project", "check warnings", "daily status", "git", "weather", "search", "what is", "how to",
+};
+
+static const char* const g_words[] = { "hi", "time", "help", "open", "joke", "git" };
+
+static const char* const g_queries[] = {
+    "search for rust borrow checker errors",
+    "google best pizza near me",
+    "what is a mutex",
+    "how to reverse a linked list in c",
+    "look for the release notes of gcc 14",
+    "python kya hai",
+    "search karo linux kernel scheduler",
+    "tell me about the james webb telescope",
+};
+
+static const char* const g_paths[] = {
+    "src/main.c",
+    "  notes/today.md  ",
+    "../../etc/passwd",
+    "projects/weather bot/README.md",
+    "/absolute/path/file.txt",
+    "a/b/c/d/e/f/g/h.c",
+};
+
+static const char* const g_project_commands[] = {
+    "create a python project called weather bot",
+    "make a project named inventory tracker in c",
+    "new project todo api",
+    "create project called jarvis-plugins",
+    "start project for the robotics club",
+};
+
+#define COUNT(array) ((long)(sizeof(array) / sizeof((array)[0])))
+
+/* Results land here so the compiler cannot drop the calls */
+static volatile size_t g_sink;
+
+static char** g_lower_phrases;
+
+/* ── Benchmarks ───────────────────────────────────────────────────────── */
+
+static void bench_to_lowercase(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        char* lower = to_lowercase(g_phrases[i % COUNT(g_phrases)]);
+        g_sink += (size_t)lower[0];
+        free(lower);
+    }
+}
+
+static void bench_command_contains(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        g_sink += (size_t)command_contains(g_lower_phrases[i % COUNT(g_phrases)], g_keywords[i % COUNT(g_keywords)]);
+    }
+}
+
+static void bench_contains_word(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        g_sink += (size_t)contains_word(g_lower_phrases[i % COUNT(g_phrases)], g_words[i % COUNT(g_words)]);
+    }
+}
+
+static void bench_extract_search_query(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        const char* query = extract_search_query(g_queries[i % COUNT(g_queries)]);
+        g_sink += query ? (size_t)query[0] : 0;
+    }
+}
+
+static void bench_sanitize_relative_path(long iterations) {
+    char output[512];
+    for (long i = 0; i < iterations; i++) {
+        g_sink += (size_t)sanitize_relative_path(g_paths[i % COUNT(g_paths)], output, sizeof(output));
+    }
+}
+
+static void bench_extract_project_name(long iterations) {
+    char name[256];
+    for (long i = 0; i < iterations; i++) {
+        g_sink += (size_t)extract_project_name_from_command(g_project_commands[i % COUNT(g_project_commands)], name,
+                                                            sizeof(name));
+    }
+}
+
+static void bench_process_command(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        char* response = process_command(g_phrases[i % COUNT(g_phrases)]);
+        if (response) g_sink += strlen(response);
+        free(response);
+    }
+}
+
+typedef struct {
+    const char* name;
+    void (*run)(long iterations);
+} Benchmark;
+
+static const Benchmark g_benchmarks[] = {
+    { "to_lowercase", bench_to_lowercase },
+    { "command_contains", bench_command_contains },
+    { "contains_word", bench_contains_word },
+    { "extract_search_query", bench_extract_search_query },
+    { "sanitize_relative_path", bench_sanitize_relative_path },
+    { "extract_project_name_from_command", bench_extract_project_name },
+    { "process_command", bench_process_command },
+};
+
+/* ── Harness ──────────────────────────────────────────────────────────── */
+
+typedef struct {
+    double median_ns;    /* per call */
+    double mad_ns;
+    long   iterations;   /* calls per sample */
+    int    samples;
+    int    measured;     /* 0 if not run */
+    double baseline_ns;  /* 0 if no baseline */
+    double baseline_mad_ns;
+} BenchResult;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double time_sample(const Benchmark* bench, long iterations) {
+    long long start = now_ns();
+    bench->run(iterations);
+    return (double)(now_ns() - start);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* values, int count) {
+    qsort(values, (size_t)count, sizeof(double), compare_doubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+static void measure(const Benchmark* bench, int reps, int warmup, double min_sample_ns, BenchResult* result) {
+    /* Grow the sample until it is long enough to time reliably; this doubles as warmup */
+    long iterations = 1;
+    for (;;) {
+        double elapsed = time_sample(bench, iterations);
+        if (elapsed >= min_sample_ns || iterations >= (1L << 30)) break;
+        double scale = elapsed > 0 ? min_sample_ns / elapsed * 1.2 : 16;
+        iterations = (long)(iterations * (scale < 2 ? 2 : scale > 16 ? 16 : scale));
+    }
+    for (int i = 0; i < warmup; i++) time_sample(bench, iterations);
+
+    double samples[BENCH_MAX_REPS], deviations[BENCH_MAX_REPS];
+    for (int i = 0; i < reps; i++) samples[i] = time_sample(bench, iterations) / (double)iterations;
+    result->median_ns = median(samples, reps);
+    for (int i = 0; i < reps; i++) deviations[i] = fabs(samples[i] - result->median_ns);
+    result->mad_ns = median(deviations, reps);
+    result->iterations = iterations;
+    result->samples = reps;
+    result->measured = 1;
+}
+
+static int selected(const char* name, const char* only) {
+    if (!only || !only[0]) return 1;
+    char words[1024];
+    snprintf(words, sizeof(words), "%s", only);
+    for (char* word = strtok(words, ", "); word; word = strtok(NULL, ", ")) {
+        if (strstr(name, word)) return 1;
+    }
+    return 0;
+}
+
+static char* read_text(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return NULL;
+    size_t cap = 8192, len = 0, got;
+    char* text = malloc(cap);
+    while (text && (got = fread(text + len, 1, cap - len - 1, file)) > 0) {
+        len += got;
+        if (len + 1 == cap) {
+            char* grown = realloc(text, cap * 2);
+            if (!grown) break;
+            text = grown;
+            cap *= 2;
+        }
+    }
+    fclose(file);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+/* Baseline format is the JSON this program writes: one member per benchmark */
+static int load_baseline(const char* path, BenchResult* results, int count) {
+    char* json = read_text(path);
+    if (!json) return 0;
+    char schema[64] = "";
+    if (!json_get_string(json, "schema", schema, sizeof(schema)) || strcmp(schema, BENCH_SCHEMA) != 0) {
+        fprintf(stderr, "%s is not a %s baseline\n", path, BENCH_SCHEMA);
+        free(json);
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        char entry[512], number[64];
+        if (!json_get_raw(json, g_benchmarks[i].name, entry, sizeof(entry))) continue;
+        if (json_get_raw(entry, "median_ns", number, sizeof(number))) results[i].baseline_ns = strtod(number, NULL);
+        if (json_get_raw(entry, "mad_ns", number, sizeof(number))) results[i].baseline_mad_ns = strtod(number, NULL);
+    }
+    free(json);
+    return 1;
+}
+
+static int write_results(const char* path, const BenchResult* results, int count) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return 0;
+    }
+    fprintf(out, "{\n  \"schema\": \"%s\"", BENCH_SCHEMA);
+    for (int i = 0; i < count; i++) {
+        if (!results[i].measured) continue;
+        fprintf(out, ",\n  ");
+        json_write_string(out, g_benchmarks[i].name);
+        fprintf(out, ": {\"median_ns\": %.2f, \"mad_ns\": %.2f, \"iterations\": %ld, \"samples\": %d}",
+                results[i].median_ns, results[i].mad_ns, results[i].iterations, results[i].samples);
+    }
+    fprintf(out, "\n}\n");
+    return fclose(out) == 0;
+}
+
+static void format_ns(double ns, char* out, size_t out_size) {
+    if (ns >= 1e6) snprintf(out, out_size, "%.2f ms", ns / 1e6);
+    else if (ns >= 1e3) snprintf(out, out_size, "%.2f us", ns / 1e3);
+    else snprintf(out, out_size, "%.1f ns", ns);
+}
+
+/* rm -rf without following symlinks */
+static void remove_tree(const char* path) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return;
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path);
+        if (dir) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+                char child[PATH_MAX];
+                int len = snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+                if (len > 0 && (size_t)len < sizeof(child)) remove_tree(child);
+            }
+            closedir(dir);
+        }
+        rmdir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+int main(int argc, char** argv) {
+    int reps = 15, warmup = 3;
+    double min_time_ms = 10, threshold = 10;
+    const char* only = NULL;
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) only = argv[++i];
+        else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) min_time_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+        else {
+            printf("Usage: %s [--only a,b] [--reps N] [--warmup N] [--min-time MS] [--json FILE] "
+                   "[--baseline FILE] [--threshold PERCENT]\n", argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 2;
+        }
+    }
+    if (reps < 1) reps = 1;
+    if (reps > BENCH_MAX_REPS) reps = BENCH_MAX_REPS;
+    if (warmup < 0) warmup = 0;
+
+    int count = (int)COUNT(g_benchmarks);
+    BenchResult results[COUNT(g_benchmarks)];
+    memset(results, 0, sizeof(results));
+    int have_baseline = 0;
+    if (baseline_path) {
+        have_baseline = load_baseline(baseline_path, results, count);
+        if (!have_baseline) printf("No baseline at %s (make bench-baseline records one)\n\n", baseline_path);
+    }
+
+    /* Commands run in a scratch directory and HOME, quietly, without a GUI */
+    char start_dir[PATH_MAX];
+    char scratch_template[] = "/tmp/jarvis_bench_XXXXXX";
+    char* scratch = mkdtemp(scratch_template);
+    if (!getcwd(start_dir, sizeof(start_dir)) || !scratch || chdir(scratch) != 0) {
+        perror("bench setup");
+        return 2;
+    }
+    setenv("HOME", scratch, 1);
+    setenv("JARVIS_NO_GUI", "1", 1);
+    setenv("JARVIS_LOG_LEVEL", "error", 0);
+    g_lower_phrases = calloc((size_t)COUNT(g_phrases), sizeof(char*));
+    for (long i = 0; g_lower_phrases && i < COUNT(g_phrases); i++) g_lower_phrases[i] = to_lowercase(g_phrases[i]);
+
+    printf("%-36s %12s %10s %12s %9s\n", "benchmark", "median", "MAD", "baseline", "change");
+    int regressions = 0;
+    for (int i = 0; i < count && g_lower_phrases; i++) {
+        if (!selected(g_benchmarks[i].name, only)) continue;
+        BenchResult* result = &results[i];
+        measure(&g_benchmarks[i], reps, warmup, min_time_ms * 1e6, result);
+
+        char median_text[32], mad_text[32], baseline_text[32] = "-", change_text[48] = "";
+        format_ns(result->median_ns, median_text, sizeof(median_text));
+        format_ns(result->mad_ns, mad_text, sizeof(mad_text));
+        if (result->baseline_ns > 0) {
+            double change = (result->median_ns - result->baseline_ns) / result->baseline_ns * 100;
+            double noise = 3 * fmax(result->mad_ns, result->baseline_mad_ns);
+            int regressed = change > threshold && result->median_ns - result->baseline_ns > noise;
+            regressions += regressed;
+            format_ns(result->baseline_ns, baseline_text, sizeof(baseline_text));
+            snprintf(change_text, sizeof(change_text), "%+.1f%%%s", change, regressed ? "  REGRESSION" : "");
+        }
+        printf("%-36s %12s %10s %12s %9s\n", g_benchmarks[i].name, median_text, mad_text, baseline_text, change_text);
+        fflush(stdout);
+    }
+
+    for (long i = 0; g_lower_phrases && i < COUNT(g_phrases); i++) free(g_lower_phrases[i]);
+    free(g_lower_phrases);
+    if (chdir(start_dir) != 0) perror("chdir");
+    remove_tree(scratch);
+
+    int written = !json_path || write_results(json_path, results, count);
+    if (json_path && written) printf("\nResults written to %s\n", json_path);
+    if (have_baseline) {
+        if (regressions) printf("%d benchmark%s regressed by more than %.0f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+        else printf("No regressions beyond %.0f%% of the baseline\n", threshold);
+    }
+    return regressions == 0 && written ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+/**
+ * Runs commands back to back without the recognizer, TTS or banners.
+ * Writes one JSON object per command to out:
+ * {"command":...,"intent":...,"response":...,"status":N,"elapsed_us":N}
+ * Blank lines and lines starting with '#' are skipped. A line longer than
+ * SESSION_COMMAND_MAX is refused whole with intent "too_long" and status -1.
+ * @param in Stream of newline-separated commands
+ * @param out Destination for JSON lines
+ * @return Number of commands that failed to produce a response
+ */
+int batch_run(FILE* in, FILE* out);
+
+/**
+ * Entry point for `jarvis --batch [FILE]`.
+ * Keeps the original stdout for JSON results and redirects handler chatter
+ * (printf from actions) to stderr so the output stays machine-readable.
+ * @param input_path Command file, or NULL / "-" for stdin
+ * @return Process exit code
+ */
+int batch_main(const char* input_path);
+
+#endif // BATCH_H
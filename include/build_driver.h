@@ -0,0 +1,41 @@
+#ifndef BUILD_DRIVER_H
+#define BUILD_DRIVER_H
+
+#include "diagnostics.h"
+
+/**
+ * Parallel compile step behind "build project". The compile units come from
+ * build_plan; a unit is stale when its object is missing, older than its
+ * source or any header listed in its depfile, or was built with a different
+ * command line. Stale units are compiled across all cores; the driver is a
+ * GNU make jobserver (a pipe of tokens advertised through MAKEFLAGS), so
+ * recursive makes and -flto=jobserver inside a compile share the same job
+ * budget instead of multiplying it. Each compile writes <object>.d with
+ * -MMD -MP, the same depfile the Makefile's -include reads, and its output
+ * goes through the diagnostic parser. With the compile cache enabled, each
+ * stale unit is preprocessed first and restored from the cache when an
+ * identical compile is already there. Linking and any other recipes are left
+ * to make.
+ */
+
+typedef struct {
+    int units;             /* compile units in the plan */
+    int stale;             /* units that needed compiling */
+    int compiled;          /* units compiled successfully */
+    int cached;            /* units restored from the compile cache instead */
+    int failed;            /* units whose compile failed */
+    int jobs;              /* parallel jobs used */
+} build_stats;
+
+/**
+ * Brings every object of a project up to date
+ * @param dir Project directory containing the Makefile
+ * @param force Non-zero to compile every unit (rebuild)
+ * @param diagnostics Optional: receives the compilers' diagnostics (already initialised)
+ * @param stats Optional: receives counts
+ * @return 1 if the plan was found (check stats->failed), 0 if the Makefile has
+ *         no per-file compile steps and the caller should run make directly
+ */
+int build_driver_compile(const char* dir, int force, diag_summary* diagnostics, build_stats* stats);
+
+#endif // BUILD_DRIVER_H
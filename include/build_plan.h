@@ -0,0 +1,58 @@
+#ifndef BUILD_PLAN_H
+#define BUILD_PLAN_H
+
+/**
+ * The compile steps of a Makefile project, discovered from a dry run
+ * (make -nB) instead of by building. Each step that compiles exactly one
+ * source with -c becomes a unit; linking, mkdir, echo and other recipe lines
+ * are ignored. "cd X &&" prefixes and recursive make's "Entering directory"
+ * lines are followed so every unit knows where it runs.
+ */
+
+typedef struct {
+    char   directory[512];   /* where the command runs, "." for the project root */
+    char   source[512];      /* as written in the command */
+    char   output[512];      /* -o argument, "" if the compiler picks it */
+    char** argv;             /* NULL-terminated */
+    int    argc;
+} build_unit;
+
+typedef struct {
+    build_unit* units;
+    int         count;
+} build_plan;
+
+/**
+ * Lists the compile units of the default make target
+ * @param dir Project directory containing the Makefile
+ * @param plan Receives the units; release with build_plan_free()
+ * @return 1 if at least one compile unit was found, 0 otherwise
+ */
+int build_plan_load(const char* dir, build_plan* plan);
+
+/**
+ * Releases the units of a plan
+ */
+void build_plan_free(build_plan* plan);
+
+/**
+ * @return Parallel compile jobs: JARVIS_BUILD_JOBS, default the number of online CPUs
+ */
+int build_plan_jobs(void);
+
+/**
+ * Reads the prerequisites of the first rule in a depfile written by -MD/-MMD
+ * @param path Depfile
+ * @param directory Directory the compile ran in; relative prerequisites are joined to it
+ * @param deps Receives the paths; release with build_plan_free_deps()
+ * @param count Receives the number of paths
+ * @return 1 if at least one prerequisite was read, 0 otherwise
+ */
+int build_plan_read_depfile(const char* path, const char* directory, char*** deps, int* count);
+
+/**
+ * Releases paths returned by build_plan_read_depfile()
+ */
+void build_plan_free_deps(char** deps, int count);
+
+#endif // BUILD_PLAN_H
@@ -0,0 +1,16 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+/**
+ * Entry point for `jarvis -c "command"`: forwards one command to the resident
+ * daemon (see server.h) together with the current working directory, prints
+ * the response and exits. If nothing is
+ * listening on the socket, starts `program --serve` in the background first
+ * (set JARVIS_NO_AUTOSTART=1 to disable) and retries with backoff.
+ * @param program Path used to launch this binary (argv[0]), for auto-start
+ * @param command The command text
+ * @return The action's exit status, or EXIT_FAILURE if the daemon is unreachable
+ */
+int client_main(const char* program, const char* command);
+
+#endif // CLIENT_H
@@ -0,0 +1,43 @@
+#ifndef CODE_SEARCH_H
+#define CODE_SEARCH_H
+
+/**
+ * In-process grep over a source tree. Files are found with the parallel
+ * walker (honouring .gitignore, skipping hidden directories and binary
+ * files), memory-mapped and scanned by the walker's threads. Patterns with a
+ * literal part are prefiltered with a vectorised search on the literal's
+ * rarest byte; only candidate lines are run through the matcher.
+ *
+ * Patterns are literal text unless they use the simple regex syntax:
+ *   .  *  +  ?  [a-z] [^...]  ^  $  a|b  \b \d \w \s  and \ to escape.
+ * Parentheses and braces are always literal, so "foo(" works as typed.
+ */
+
+#define CODE_SEARCH_DEFAULT_MAX 200
+
+typedef struct {
+    int ignore_case;
+    int max_per_file;      /* matches kept per file (0 = unlimited) */
+    int threads;           /* 0 = dir_walk_threads() */
+} code_search_options;
+
+typedef struct {
+    char path[512];        /* relative to the root */
+    int  line;             /* 1-based */
+    char text[200];        /* the line, trimmed */
+} code_match;
+
+/**
+ * Searches every text file under root
+ * @param root Directory to search
+ * @param pattern Literal or simple regex
+ * @param options Optional (NULL = case-sensitive, no per-file cap)
+ * @param out Matches sorted by path and line
+ * @param max Capacity of out; the search stops once it is full
+ * @param truncated Optional: set to 1 if more matches existed than were returned
+ * @return Number of matches stored, -1 if the pattern is invalid
+ */
+int code_search(const char* root, const char* pattern, const code_search_options* options,
+                code_match* out, int max, int* truncated);
+
+#endif // CODE_SEARCH_H
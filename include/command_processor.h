@@ -4,6 +4,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * Outcome details reported by process_command_ex
+ */
+typedef struct {
+    const char* intent;  /* routed intent name, e.g. "time", "search", "build" (static string) */
+    int status;          /* exit status of the action's child process, 0 if none ran */
+} command_result;
+
 /**
  * Processes a voice command and executes appropriate action
  * @param command The voice command string
@@ -11,6 +19,14 @@
  */
 char* process_command(const char* command);
 
+/**
+ * Processes a voice command and reports how it was routed
+ * @param command The voice command string
+ * @param result Receives the matched intent and action exit status (may be NULL)
+ * @return Response message to be spoken to the user
+ */
+char* process_command_ex(const char* command, command_result* result);
+
 /**
  * Converts command string to lowercase for case-insensitive matching
  * @param str String to convert
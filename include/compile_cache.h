@@ -0,0 +1,101 @@
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include <stddef.h>
+
+/**
+ * Content-addressed object cache shared by every project the build driver
+ * compiles. An entry is keyed by the preprocessed source, the compiler
+ * binary and the flags, so a clean build or a rebuild of unchanged code
+ * restores objects instead of compiling them again, even in another copy of
+ * the tree. Entries live in $XDG_CACHE_HOME/jarvis/objects (JARVIS_COMPILE_CACHE
+ * names another directory, or "0" turns the cache off). Restores reflink the
+ * object where the filesystem supports it and otherwise copy it. Setting
+ * JARVIS_COMPILE_CACHE_HARDLINK hard-links instead; the object then shares
+ * its inode with the entry, so the build driver unlinks objects before
+ * compiling over them, and a plain make that writes objects in place would
+ * change the cached copy too. The least recently used entries are evicted
+ * once the cache outgrows JARVIS_COMPILE_CACHE_SIZE (e.g. "512M", "2G"; a
+ * bare number is megabytes; default 1G).
+ */
+
+#define COMPILE_CACHE_KEY_SIZE 33   /* 32 hex digits and the terminator */
+
+typedef struct {
+    unsigned long long hits;      /* objects restored */
+    unsigned long long misses;    /* lookups that had to compile */
+    unsigned long long stored;    /* objects added */
+    unsigned long long evicted;   /* objects removed to stay under the limit */
+    long long          size;      /* bytes in the cache */
+    long long          limit;     /* size cap in bytes */
+} compile_cache_stats;
+
+/**
+ * @return 1 unless JARVIS_COMPILE_CACHE is "0" or the cache directory cannot be created
+ */
+int compile_cache_enabled(void);
+
+/**
+ * Names a scratch file inside the cache, e.g. for preprocessor output
+ * @param out Receives the path
+ * @param out_size Size of out
+ * @param slot Distinguishes files created by the same process
+ * @return 1 on success, 0 on failure
+ */
+int compile_cache_scratch(char* out, size_t out_size, int slot);
+
+/**
+ * Computes the key of a compile
+ * @param argv Compile command (NULL-terminated); -o, -MF, -MT and -MQ
+ *             arguments and dependency flags do not affect the key
+ * @param directory Absolute directory the compile runs in (part of the key only with -g)
+ * @param preprocessed Path of the source preprocessed with the same flags
+ * @param key Receives COMPILE_CACHE_KEY_SIZE characters
+ * @return 1 on success, 0 if the compiler or the preprocessed file cannot be read
+ */
+int compile_cache_key(char* const* argv, const char* directory, const char* preprocessed, char* key);
+
+/**
+ * Restores a cached object
+ * @param key Key from compile_cache_key()
+ * @param object Path the object is written to
+ * @param output Optional: receives what the compiler printed (malloc'd, may be NULL if it printed nothing)
+ * @param output_len Optional: receives the length of output
+ * @return 1 on a hit, 0 on a miss
+ */
+int compile_cache_fetch(const char* key, const char* object, char** output, size_t* output_len);
+
+/**
+ * Adds a freshly compiled object
+ * @param key Key from compile_cache_key()
+ * @param object Path of the compiled object
+ * @param output What the compiler printed
+ * @param output_len Length of output
+ * @return Bytes added to the cache, 0 on failure
+ */
+long long compile_cache_store(const char* key, const char* object, const char* output, size_t output_len);
+
+/**
+ * Adds one build's lookups to the statistics and evicts least recently used
+ * entries if the cache is over its size limit
+ * @param hits Objects restored
+ * @param misses Objects compiled
+ * @param stored Objects added
+ * @param added Bytes added
+ */
+void compile_cache_record(int hits, int misses, int stored, long long added);
+
+/**
+ * Reads the statistics
+ * @param stats Receives the counts
+ * @return 1 if the cache is enabled, 0 otherwise
+ */
+int compile_cache_get_stats(compile_cache_stats* stats);
+
+/**
+ * Removes every entry and resets the statistics
+ * @return Number of objects removed
+ */
+int compile_cache_clear(void);
+
+#endif // COMPILE_CACHE_H
@@ -0,0 +1,94 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stddef.h>
+
+/**
+ * Streaming parser for GCC/Clang diagnostics. Build output is fed in chunks
+ * of any size; each "file:line:col: severity: message [-Wflag]" line becomes
+ * a diagnostic, notes are attached to the diagnostic before them, linker
+ * "undefined reference" lines count as errors, and source excerpts, carets,
+ * make chatter and colour codes are skipped. A diagnostic repeated by every
+ * unit that includes the same header is counted once. Nothing is buffered
+ * beyond the current line, so a log of any length reduces to counts per file
+ * and per flag plus the first few errors and warnings.
+ */
+
+#define DIAG_KEPT   5      /* errors and warnings kept verbatim */
+#define DIAG_GROUPS 24     /* distinct files and flags counted */
+#define DIAG_SEEN   512    /* diagnostics remembered to drop repeats */
+
+typedef enum {
+    DIAG_NOTE,
+    DIAG_WARNING,
+    DIAG_ERROR             /* includes fatal errors and linker errors */
+} diag_severity;
+
+typedef struct {
+    char          file[256];
+    int           line;       /* 0 if unknown */
+    int           column;     /* 0 if unknown */
+    diag_severity severity;
+    char          flag[64];   /* e.g. "-Wunused-variable", "" if none */
+    char          message[256];
+    char          function[96];  /* from "In function 'x':", "" if none */
+    int           notes;      /* notes that followed it */
+} diagnostic;
+
+typedef struct {
+    char name[256];
+    int  errors;
+    int  warnings;
+} diag_group;
+
+typedef struct {
+    int        errors;
+    int        warnings;
+    int        notes;
+    diagnostic first_errors[DIAG_KEPT];
+    int        error_count;      /* entries in first_errors */
+    diagnostic first_warnings[DIAG_KEPT];
+    int        warning_count;    /* entries in first_warnings */
+    diag_group files[DIAG_GROUPS];
+    int        file_count;
+    diag_group flags[DIAG_GROUPS];
+    int        flag_count;
+
+    /* Parser state */
+    char        partial[1024];   /* start of a line split across chunks */
+    size_t      partial_len;
+    char        function[96];    /* current "In function" context */
+    char        function_file[256];
+    diagnostic* last;            /* where the next note attaches, NULL if not kept */
+    unsigned    seen[DIAG_SEEN]; /* hashes of recorded diagnostics */
+} diag_summary;
+
+/**
+ * Resets a summary before feeding a new log
+ */
+void diagnostics_init(diag_summary* summary);
+
+/**
+ * Parses the next chunk of build output
+ * @param summary Summary being built
+ * @param data Output bytes (need not end at a line boundary)
+ * @param len Number of bytes
+ */
+void diagnostics_feed(diag_summary* summary, const char* data, size_t len);
+
+/**
+ * Parses any final line that had no trailing newline
+ */
+void diagnostics_finish(diag_summary* summary);
+
+/**
+ * Writes a short, speakable summary, e.g. "Build failed with 2 errors and
+ * 1 warning. First error: parser.c line 12: 'x' undeclared, in parse_expr."
+ * @param summary Finished summary
+ * @param out Output buffer
+ * @param out_size Size of out
+ * @return 1 if there were errors or warnings to report, 0 otherwise
+ */
+int diagnostics_format(const diag_summary* summary, char* out, size_t out_size);
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,54 @@
+#ifndef DIR_WALK_H
+#define DIR_WALK_H
+
+#include <stddef.h>
+
+/**
+ * Parallel directory walker. Each worker thread owns a deque of directories:
+ * it pops its own work depth-first and steals the oldest (shallowest) entries
+ * from other workers when it runs dry. Directories are read with getdents64
+ * on Linux and never followed through symlinks.
+ */
+typedef struct {
+    /**
+     * Called for every regular file that passes the name filter, concurrently
+     * from several workers. Return 0 to stop the whole walk.
+     * @param path Absolute path (only valid during the call)
+     * @param name_offset Start of the file name within path
+     * @param worker Index of the calling worker, in [0, threads)
+     */
+    int  (*visit_file)(const char* path, size_t name_offset, int worker, void* ctx);
+    /** Optional: called once per directory before it is read */
+    void (*visit_dir)(const char* path, int worker, void* ctx);
+    /** Optional: return 0 to skip a subdirectory and everything below it (e.g. .gitignore'd) */
+    int  (*accept_dir)(const char* path, size_t name_offset, void* ctx);
+    void* ctx;
+    /** Name filter: a glob if it contains * ? or [, otherwise a substring; case-insensitive. NULL = all files */
+    const char* name_pattern;
+    /** Stop after this many files passed the filter (0 = no limit) */
+    long max_matches;
+    /** Worker threads, including the caller (0 = dir_walk_threads()) */
+    int threads;
+    /** Stop at this CLOCK_MONOTONIC time in microseconds (0 = no limit) */
+    long long deadline_us;
+    /** Descend into directories whose names start with '.' */
+    int include_hidden;
+    /** Optional NULL-terminated list of directory names never descended into (e.g. "node_modules") */
+    const char* const* skip_dirs;
+} dir_walk_options;
+
+/**
+ * @return Default worker count: JARVIS_WALK_THREADS, else the online CPU count (max 64)
+ */
+int dir_walk_threads(void);
+
+/**
+ * Walks the roots in parallel and returns when every worker has finished
+ * @param roots Directories to walk
+ * @param root_count Number of roots
+ * @param options Callbacks, filter and limits
+ * @return 1 if the whole tree was visited, 0 if it stopped early
+ */
+int dir_walk(const char* const* roots, int root_count, const dir_walk_options* options);
+
+#endif // DIR_WALK_H
@@ -0,0 +1,111 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <sys/types.h>
+
+/**
+ * Callback invoked when a registered file descriptor becomes readable
+ * (or reaches end-of-file / error)
+ * @param fd The ready file descriptor
+ * @param userdata Pointer passed at registration
+ */
+typedef void (*event_fd_handler)(int fd, void* userdata);
+
+/**
+ * Callback invoked when a timer expires
+ * @param timer_id Identifier returned by event_loop_add_timer
+ * @param userdata Pointer passed at registration
+ */
+typedef void (*event_timer_handler)(int timer_id, void* userdata);
+
+/**
+ * Callback invoked after a watched child process has been reaped
+ * @param pid The child process id
+ * @param status Raw wait status (use WIFEXITED/WEXITSTATUS)
+ * @param userdata Pointer passed at registration
+ */
+typedef void (*event_child_handler)(pid_t pid, int status, void* userdata);
+
+/**
+ * Initializes the reactor (epoll + signalfd on Linux, poll + self-pipe elsewhere).
+ * Call before creating threads: SIGCHLD is blocked so that it can be read
+ * through the signal descriptor.
+ * @return 1 on success, 0 on failure
+ */
+int event_loop_init(void);
+
+/**
+ * Releases all reactor resources and restores SIGCHLD delivery
+ */
+void event_loop_shutdown(void);
+
+/**
+ * Registers a readable handler for a file descriptor.
+ * Regular files (which epoll rejects) are treated as always ready.
+ * @return 1 on success, 0 on failure
+ */
+int event_loop_add_fd(int fd, event_fd_handler on_readable, void* userdata);
+
+/**
+ * Unregisters a file descriptor (does not close it)
+ */
+void event_loop_remove_fd(int fd);
+
+/**
+ * Schedules a one-shot or repeating timer (timerfd on Linux)
+ * @param interval_ms Delay before the first expiry and between repeats
+ * @param repeat Non-zero for a repeating timer
+ * @return Timer id (> 0) on success, 0 on failure
+ */
+int event_loop_add_timer(int interval_ms, int repeat, event_timer_handler on_expire, void* userdata);
+
+/**
+ * Cancels a pending timer; unknown ids are ignored
+ */
+void event_loop_cancel_timer(int timer_id);
+
+/**
+ * Reaps the given child when it exits and invokes the handler
+ * @return 1 on success, 0 if the watch table is full
+ */
+int event_loop_watch_child(pid_t pid, event_child_handler on_exit, void* userdata);
+
+/**
+ * Spawns a child process without a shell and without waiting for it.
+ * The child's stderr goes to /dev/null and its signal mask is reset.
+ * @param argv NULL-terminated argument vector; argv[0] is looked up on PATH
+ * @param stdin_text Text written to the child's stdin, or NULL for /dev/null
+ * @param stdout_fd If non-NULL, receives a non-blocking read end of the
+ *                  child's stdout; otherwise stdout goes to /dev/null
+ * @return Child pid, or -1 on failure
+ */
+pid_t event_loop_spawn(char* const argv[], const char* stdin_text, int* stdout_fd);
+
+/**
+ * Waits for events and dispatches every ready handler once
+ * @param timeout_ms Maximum wait in milliseconds (-1 = no limit)
+ * @return Number of handlers dispatched, or -1 on error
+ */
+int event_loop_run_once(int timeout_ms);
+
+/**
+ * Dispatches events until event_loop_stop() is called
+ */
+void event_loop_run(void);
+
+/**
+ * Makes event_loop_run() return after the current dispatch round
+ */
+void event_loop_stop(void);
+
+/**
+ * Lets synchronous code (popen/system) on the calling thread spawn and reap
+ * its own children with normal SIGCHLD semantics; worker threads that run
+ * commands off the loop wrap them in this. Pair with
+ * event_loop_leave_foreign(); watched children that exit meanwhile are
+ * reaped on the next dispatch round.
+ */
+void event_loop_enter_foreign(void);
+void event_loop_leave_foreign(void);
+
+#endif // EVENT_LOOP_H
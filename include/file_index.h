@@ -0,0 +1,53 @@
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+/**
+ * Background file-name index. A thread crawls the configured roots once into
+ * a sorted path table with a trigram index over file names, then keeps it
+ * current from inotify events, so file searches never walk the disk.
+ *
+ * Environment:
+ *   JARVIS_INDEX_ROOTS  colon-separated directories to index (default $HOME)
+ *   JARVIS_INDEX=0      disable the index; searches scan the roots live
+ *
+ * Hidden directories (".git", ".cache", ...) are not indexed.
+ */
+
+/**
+ * Starts the indexer thread if it is not already running. Safe to call more
+ * than once and from any thread.
+ * @return 1 if the index is running or ready, 0 if disabled or it failed to start
+ */
+int file_index_start(void);
+
+/**
+ * Waits for the initial crawl to finish
+ * @param timeout_ms Longest time to wait
+ * @return 1 if the index is ready, 0 on timeout or when the index is disabled
+ */
+int file_index_wait_ready(int timeout_ms);
+
+/**
+ * Finds files whose names contain every word of the query (case-insensitive),
+ * best matches first: exact name, then name prefix, then word match, with
+ * shallower paths ahead of deeper ones. Scans the roots live (bounded) while
+ * the index is still being built.
+ * @param query Search words, e.g. "budget 2024"
+ * @param paths Receives up to max_paths malloc'd absolute paths; caller frees
+ * @param max_paths Capacity of paths
+ * @return Number of paths stored
+ */
+int file_index_find(const char* query, char** paths, int max_paths);
+
+/**
+ * Like file_index_find, limited to one directory. Directories outside the
+ * indexed roots are scanned live with the parallel walker (dir_walk.h).
+ * @param directory Absolute directory, or NULL for every indexed root
+ * @param query Search words
+ * @param paths Receives up to max_paths malloc'd absolute paths; caller frees
+ * @param max_paths Capacity of paths
+ * @return Number of paths stored
+ */
+int file_index_find_under(const char* directory, const char* query, char** paths, int max_paths);
+
+#endif // FILE_INDEX_H
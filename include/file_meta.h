@@ -0,0 +1,46 @@
+#ifndef FILE_META_H
+#define FILE_META_H
+
+/**
+ * Batched metadata lookup for file-search results. On Linux every path's
+ * statx is queued on one io_uring and collected in a single submit-and-wait;
+ * where io_uring is unavailable (old kernels, seccomp, JARVIS_NO_IO_URING=1)
+ * a small thread pool stats the paths in parallel instead.
+ */
+
+typedef struct {
+    int       ok;      /* 1 if the metadata below was read */
+    long long size;    /* bytes */
+    long long mtime;   /* last modification, seconds since the epoch */
+} file_meta;
+
+typedef enum {
+    FILE_SORT_NEWEST,
+    FILE_SORT_LARGEST
+} file_sort;
+
+/**
+ * Reads size and modification time for every path
+ * @param paths Absolute paths
+ * @param count Number of paths
+ * @param out Receives one entry per path (ok = 0 for paths that could not be read)
+ * @return Number of paths whose metadata was read
+ */
+int file_meta_collect(const char* const* paths, int count, file_meta* out);
+
+/**
+ * Sorts paths together with their metadata; unreadable entries go last and
+ * ties keep their original (relevance) order
+ * @param paths Paths to reorder
+ * @param meta Metadata from file_meta_collect, reordered alongside
+ * @param count Number of entries
+ * @param order Newest first or largest first
+ */
+void file_meta_sort(char** paths, file_meta* meta, int count, file_sort order);
+
+/**
+ * @return "io_uring" or "threads": the backend used by the last collection
+ */
+const char* file_meta_backend(void);
+
+#endif // FILE_META_H
@@ -0,0 +1,159 @@
+#ifndef GIT_REPO_H
+#define GIT_REPO_H
+
+#include <stddef.h>
+
+/**
+ * Read-only access to a git repository without running git: discovery,
+ * config, refs (loose and packed-refs), and commits and trees from loose
+ * objects or packs (pack index v2, offset and ref deltas). Only the SHA-1
+ * object format and the files ref backend are understood; git_repo_open()
+ * refuses anything else so callers fall back to the git command.
+ */
+
+#define GIT_OID_RAWSZ 20
+#define GIT_OID_HEXSZ 41           /* 40 hex digits and the terminator */
+#define GIT_COMMIT_MAX_PARENTS 16
+
+typedef enum {
+    GIT_OBJ_COMMIT = 1,
+    GIT_OBJ_TREE = 2,
+    GIT_OBJ_BLOB = 3,
+    GIT_OBJ_TAG = 4
+} git_object_type;
+
+typedef struct git_repo git_repo;
+
+typedef struct {
+    unsigned char tree[GIT_OID_RAWSZ];
+    unsigned char parents[GIT_COMMIT_MAX_PARENTS][GIT_OID_RAWSZ];
+    int           parent_count;
+    long long     time;            /* committer timestamp */
+    char          subject[256];    /* first line of the message */
+} git_commit;
+
+typedef struct {
+    const char*          name;     /* not terminated; see name_len */
+    size_t               name_len;
+    unsigned int         mode;     /* e.g. 0100644, 040000 */
+    const unsigned char* oid;
+} git_tree_entry;
+
+typedef struct {
+    unsigned int  state[5];
+    unsigned long long length;
+    unsigned char block[64];
+} git_sha1_ctx;
+
+/* Streaming SHA-1, as git names objects */
+void git_sha1_init(git_sha1_ctx* ctx);
+void git_sha1_update(git_sha1_ctx* ctx, const void* data, size_t len);
+void git_sha1_final(git_sha1_ctx* ctx, unsigned char out[GIT_OID_RAWSZ]);
+
+/**
+ * @param hex 40 hex digits (further characters are ignored)
+ * @param oid Receives the raw id
+ * @return 1 on success, 0 if hex is not an object id
+ */
+int git_oid_parse(const char* hex, unsigned char* oid);
+
+/**
+ * @param oid Raw id
+ * @param hex Receives GIT_OID_HEXSZ characters
+ */
+void git_oid_format(const unsigned char* oid, char* hex);
+
+/**
+ * Finds the repository containing a directory, honouring .git files
+ * (linked worktrees, submodules) and commondir
+ * @param path Directory to start from; parents are searched up to /
+ * @param found Optional: receives 1 if a repository was found, even one this
+ *              reader cannot handle
+ * @return Repository, NULL if there is none or it needs git itself to read
+ *         (bare, SHA-256, reftable, GIT_DIR set)
+ */
+git_repo* git_repo_open(const char* path, int* found);
+
+void git_repo_close(git_repo* repo);
+
+/** @return Absolute path of the work tree */
+const char* git_repo_workdir(const git_repo* repo);
+
+/** @return Absolute path of the git directory (per-worktree files: HEAD, index) */
+const char* git_repo_gitdir(const git_repo* repo);
+
+/**
+ * Looks up a config value from the system, global and repository files
+ * @param repo Repository
+ * @param key "section.key" or "section.subsection.key"; section and key are case-insensitive
+ * @return Value of the last definition, "true" for a bare key, NULL if unset
+ */
+const char* git_repo_config(const git_repo* repo, const char* key);
+
+/**
+ * Resolves a ref, following symbolic refs
+ * @param repo Repository
+ * @param name "HEAD" or a full name such as "refs/heads/main"
+ * @param oid Receives the object id
+ * @return 1 on success, 0 if the ref does not exist
+ */
+int git_repo_resolve(git_repo* repo, const char* name, unsigned char* oid);
+
+/**
+ * Reads HEAD
+ * @param repo Repository
+ * @param branch Receives the branch name without refs/heads/ ("" when detached)
+ * @param branch_size Size of branch
+ * @param oid Receives the commit HEAD points at
+ * @return 1 if HEAD points at a commit, 0 on an unborn branch, -1 if HEAD is unreadable
+ */
+int git_repo_head(git_repo* repo, char* branch, size_t branch_size, unsigned char* oid);
+
+/**
+ * Finds the remote-tracking ref a branch follows (branch.<name>.remote and .merge)
+ * @param repo Repository
+ * @param branch Branch name without refs/heads/
+ * @param out Receives e.g. "refs/remotes/origin/main"
+ * @param out_size Size of out
+ * @return 1 if an upstream is configured, 0 otherwise
+ */
+int git_repo_upstream(const git_repo* repo, const char* branch, char* out, size_t out_size);
+
+/**
+ * Reads an object
+ * @param repo Repository
+ * @param oid Object id
+ * @param type Receives the object type
+ * @param data Receives the content (malloc'd, terminated for convenience)
+ * @param len Receives the content length
+ * @return 1 on success, 0 if the object is missing or cannot be decoded
+ */
+int git_repo_read(git_repo* repo, const unsigned char* oid, git_object_type* type, char** data, size_t* len);
+
+/**
+ * Reads and parses a commit
+ * @return 1 on success, 0 if it is missing or not a commit
+ */
+int git_repo_commit(git_repo* repo, const unsigned char* oid, git_commit* commit);
+
+/**
+ * Iterates a tree read with git_repo_read()
+ * @param cursor Position in the tree data; start at the data and pass it back unchanged
+ * @param end End of the tree data
+ * @param entry Receives the next entry (pointing into the tree data)
+ * @return 1 if an entry was read, 0 at the end or on malformed data
+ */
+int git_tree_next(const char** cursor, const char* end, git_tree_entry* entry);
+
+/**
+ * Counts commits on each side of two histories, like git rev-list --left-right --count a...b
+ * @param repo Repository
+ * @param a Left commit (e.g. the branch)
+ * @param b Right commit (e.g. its upstream)
+ * @param ahead Receives commits reachable only from a
+ * @param behind Receives commits reachable only from b
+ * @return 1 on success, 0 if a commit could not be read or the walk was too long
+ */
+int git_repo_ahead_behind(git_repo* repo, const unsigned char* a, const unsigned char* b, int* ahead, int* behind);
+
+#endif // GIT_REPO_H
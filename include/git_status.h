@@ -0,0 +1,57 @@
+#ifndef GIT_STATUS_H
+#define GIT_STATUS_H
+
+#include "git_repo.h"
+
+/**
+ * git status without running git. The index is mapped and parsed in place
+ * (versions 2 to 4); each entry's cached stat data is compared against the
+ * work tree, and only files whose stat changed but whose size did not (or
+ * that changed within the index's own timestamp) are hashed. Staged changes
+ * come from comparing the index with HEAD's tree, skipping every directory
+ * whose cache-tree id still matches. Untracked files are found with the
+ * parallel directory walker and the .gitignore rules, listed the way
+ * git status --short lists them (an untracked directory is one entry).
+ *
+ * Anything the reader does not model makes git_status_read() return 0 so the
+ * caller can run git instead: conflicts, submodules, sparse checkouts, split
+ * indexes, intent-to-add entries, or content that differs only through
+ * .gitattributes/autocrlf conversion.
+ */
+
+#define GIT_STATUS_LISTED 16
+
+typedef struct {
+    char path[256];
+    char index;                    /* git status --short columns: ' ', 'M', 'A', 'D', 'T' or '?' */
+    char worktree;
+} git_status_entry;
+
+typedef struct {
+    char             branch[256];          /* "" when HEAD is detached */
+    char             head[GIT_OID_HEXSZ];  /* "" on an unborn branch */
+    char             subject[256];         /* HEAD's subject */
+    char             upstream[256];        /* e.g. "origin/main", "" when none is configured */
+    int              upstream_gone;        /* configured but the remote-tracking ref is missing */
+    int              ahead;                /* commits on the branch but not its upstream */
+    int              behind;
+    int              tracked;              /* index entries */
+    int              staged;               /* paths whose index entry differs from HEAD */
+    int              modified;             /* tracked files changed in the work tree */
+    int              deleted;              /* tracked files missing from the work tree */
+    int              untracked;            /* untracked files and directories */
+    int              changed;              /* paths git status --short would list */
+    git_status_entry entries[GIT_STATUS_LISTED];   /* the first of them, in git's order */
+    int              listed;
+} git_status;
+
+/**
+ * Reads the status of the work tree containing a directory
+ * @param path Directory inside the work tree
+ * @param threads Directory walker threads for untracked files (0 = dir_walk_threads())
+ * @param status Receives the status
+ * @return 1 on success, 0 if git itself should be asked, -1 if path is not in a work tree
+ */
+int git_status_read(const char* path, int threads, git_status* status);
+
+#endif // GIT_STATUS_H
@@ -0,0 +1,51 @@
+#ifndef GITIGNORE_H
+#define GITIGNORE_H
+
+/**
+ * .gitignore rules for a tree: the root .gitignore, .git/info/exclude and
+ * any nested .gitignore files added while walking. Supports comments,
+ * negation (!), directory-only patterns (trailing /), anchored patterns
+ * (containing /), *, ?, [...] and **. Safe to query from several threads
+ * while directories are being added.
+ */
+typedef struct gitignore gitignore;
+
+/**
+ * Loads the rules at the root of a tree
+ * @param root Tree root
+ * @return Rule set (possibly empty), NULL on allocation failure
+ */
+gitignore* gitignore_load(const char* root);
+
+/**
+ * Adds <root>/<relative_dir>/.gitignore if it exists. Call for a directory
+ * before testing its entries; its rules apply only below it.
+ * @param rules Rule set
+ * @param relative_dir Directory relative to the root ("" for the root itself)
+ */
+void gitignore_add_dir(gitignore* rules, const char* relative_dir);
+
+/**
+ * Adds a file of patterns for the whole tree with the lowest precedence, the
+ * way git treats core.excludesFile
+ * @param rules Rule set
+ * @param path Patterns file; a missing file adds nothing
+ */
+void gitignore_add_excludes(gitignore* rules, const char* path);
+
+/**
+ * Tests one path. Parents are not re-checked: walkers skip ignored
+ * directories instead of descending into them.
+ * @param rules Rule set
+ * @param relative_path Path relative to the root, '/'-separated
+ * @param is_dir Non-zero for directories
+ * @return 1 if ignored, 0 otherwise
+ */
+int gitignore_ignored(gitignore* rules, const char* relative_path, int is_dir);
+
+/**
+ * Releases a rule set
+ */
+void gitignore_free(gitignore* rules);
+
+#endif // GITIGNORE_H
@@ -18,6 +18,15 @@ char* get_current_time(void);
  */
 char* get_system_info(void);
 
+/**
+ * Configures startup behaviour; call before jarvis_init.
+ * JARVIS_FAST_BOOT and JARVIS_BOOT_TIMELINE enable the same options from the environment.
+ * @param fast_boot Non-zero to skip cosmetic delays, probe capabilities in parallel
+ *                  and defer the UI launch and notification until the first prompt
+ * @param show_timeline Non-zero to print a microsecond boot timeline at the first prompt
+ */
+void jarvis_configure_boot(int fast_boot, int show_timeline);
+
 /**
  * Initializes the JARVIS voice assistant
  * @return 1 on success, 0 on failure
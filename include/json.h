@@ -0,0 +1,40 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Writes a string as a quoted, escaped JSON string literal
+ * @param out Destination stream
+ * @param text String to write (NULL is written as null)
+ */
+void json_write_string(FILE* out, const char* text);
+
+/**
+ * Escapes a string for embedding inside a JSON string literal (no quotes added)
+ * @param text Input string
+ * @param out Output buffer (always NUL-terminated; truncated on overflow)
+ * @param out_size Size of the output buffer
+ * @return Length of the escaped string written to out
+ */
+size_t json_escape(const char* text, char* out, size_t out_size);
+
+/**
+ * Reads a top-level string member of a JSON object, decoding escapes
+ * @param json NUL-terminated JSON object text
+ * @param key Member name
+ * @param out Output buffer (truncated on overflow)
+ * @param out_size Size of the output buffer
+ * @return 1 if the member exists and is a string, 0 otherwise
+ */
+int json_get_string(const char* json, const char* key, char* out, size_t out_size);
+
+/**
+ * Copies the raw JSON text of a top-level member (number, string with quotes,
+ * object, ...) so it can be echoed back verbatim
+ * @return 1 on success, 0 if missing, malformed or larger than out_size
+ */
+int json_get_raw(const char* json, const char* key, char* out, size_t out_size);
+
+#endif // JSON_H
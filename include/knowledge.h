@@ -0,0 +1,48 @@
+#ifndef KNOWLEDGE_H
+#define KNOWLEDGE_H
+
+#include <stddef.h>
+
+/**
+ * Offline full-text search over local Markdown and text files. Documents are
+ * split into sections, tokenized and written to a memory-mapped segment
+ * (inverted index + section table) that is rebuilt only when the corpus
+ * changes. Queries are ranked with BM25 and answered with a snippet read
+ * from the source file.
+ *
+ * Environment:
+ *   JARVIS_KNOWLEDGE_DIRS       colon-separated directories searched recursively
+ *                               (default: *.md / *.txt in the working directory
+ *                               plus ~/.jarvis/knowledge)
+ *   JARVIS_KNOWLEDGE_INDEX      segment file (default $XDG_CACHE_HOME/jarvis/knowledge.seg)
+ *   JARVIS_KNOWLEDGE_MIN_SCORE  BM25 score needed to answer locally (default 4.0)
+ */
+
+typedef struct {
+    char   source[512];    /* file the section came from */
+    char   title[128];     /* nearest heading, or the file name */
+    char   snippet[400];   /* best-matching window of the section */
+    double score;          /* BM25 */
+    int    matched_terms;  /* distinct query terms found in the section */
+    int    query_terms;    /* distinct indexable terms in the query */
+} knowledge_hit;
+
+/**
+ * Ranks local sections for a query
+ * @param query Free text, e.g. "voice recognition setup"
+ * @param hits Output array, best first
+ * @param max_hits Capacity of hits
+ * @return Number of hits stored (0 if nothing matched or no corpus exists)
+ */
+int knowledge_search(const char* query, knowledge_hit* hits, int max_hits);
+
+/**
+ * Answers a question from local knowledge when the best hit is confident
+ * @param query The question with its lead-in removed ("search modes")
+ * @param response Output buffer for a spoken-style answer
+ * @param response_size Size of the output buffer
+ * @return 1 if answered locally, 0 if the caller should fall back to the web
+ */
+int knowledge_answer(const char* query, char* response, size_t response_size);
+
+#endif // KNOWLEDGE_H
@@ -0,0 +1,60 @@
+#ifndef LOG_H
+#define LOG_H
+
+/**
+ * Buffered logger. Callers format a record and push it onto a lock-free
+ * queue; a background thread renders timestamps (cached per second) and
+ * writes to the terminal and/or a rotating log file, so callers never block
+ * on terminal I/O.
+ *
+ * Environment:
+ *   JARVIS_LOG_LEVEL     debug | info | warn | error        (default info)
+ *   JARVIS_LOG_FORMAT    text | kv                          (default text on a tty, kv otherwise)
+ *   JARVIS_LOG_TERMINAL  0 to keep log records off the terminal
+ *   JARVIS_LOG_FILE      append key=value records to this file
+ *   JARVIS_LOG_MAX_BYTES rotate the file beyond this size   (default 5 MiB, keeps .1 .. .3)
+ */
+
+typedef enum {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR
+} log_level;
+
+/**
+ * Reads the environment and starts the flusher thread. Before this (and
+ * after log_shutdown) records are written synchronously.
+ */
+void log_init(void);
+
+/**
+ * Drains the queue, stops the flusher thread and closes the log file
+ */
+void log_shutdown(void);
+
+/**
+ * Blocks until everything logged so far has reached the terminal and file.
+ * Call before prompting for input or handing the terminal to other code.
+ */
+void log_flush(void);
+
+/**
+ * Logs a status record: "[HH:MM:SS] tag message" on the terminal, or
+ * ts=... level=... tag=... msg="..." in key/value mode
+ * @param level Severity; records below JARVIS_LOG_LEVEL are dropped
+ * @param colour ANSI colour for the tag in text mode (may be NULL)
+ * @param tag Short label such as "[BOOT]" or "🎤"
+ * @param fmt printf-style message
+ */
+void log_message(log_level level, const char* colour, const char* tag, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * Queues free-form terminal text (banners, prompts, replies) in order with
+ * the log records. Not written to the log file; in key/value mode each
+ * non-empty line becomes a msg record with colours stripped.
+ */
+void log_console(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif // LOG_H
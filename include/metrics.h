@@ -0,0 +1,65 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+/**
+ * Process-wide counters
+ */
+typedef enum {
+    METRIC_CHILDREN_SPAWNED,   /* child processes started by actions, TTS and notifications */
+    METRIC_BYTES_CAPTURED,     /* bytes read from action output pipes */
+    METRIC_CACHE_HITS,         /* answers served from a cache */
+    METRIC_CACHE_MISSES,       /* cache lookups that had to do the work */
+    METRIC_COUNTER_COUNT
+} metrics_counter;
+
+/**
+ * Adds to a counter (thread-safe, lock-free)
+ */
+void metrics_count(metrics_counter counter, unsigned long long amount);
+
+/**
+ * Records a latency sample in the histogram of a routed intent
+ * @param intent Intent name from command_result (a static string)
+ * @param micros Latency in microseconds
+ */
+void metrics_observe_intent(const char* intent, long long micros);
+
+/**
+ * Records a latency sample in the histogram of a pipeline stage
+ * @param stage Stage name, e.g. "speak" (a static string)
+ * @param micros Latency in microseconds
+ */
+void metrics_observe_stage(const char* stage, long long micros);
+
+/**
+ * Looks up a latency percentile
+ * @param intent Intent name
+ * @param percentile Percentile in [0, 100]
+ * @return Latency in microseconds (HDR bucket upper bound, ~6% precision), or -1 if no samples
+ */
+long long metrics_intent_percentile(const char* intent, double percentile);
+
+/**
+ * Formats a human-readable p50/p99 report of intents and stages
+ * @param out Output buffer
+ * @param out_size Size of the output buffer
+ */
+void metrics_format_report(char* out, size_t out_size);
+
+/**
+ * Rewrites a Prometheus text-format file (via temp file + rename) for the
+ * node exporter textfile collector
+ * @param path Output path, or NULL for $JARVIS_METRICS_FILE
+ * @return 1 on success, 0 on failure or when no path is configured
+ */
+int metrics_write_prometheus(const char* path);
+
+/**
+ * @return Export period from JARVIS_METRICS_INTERVAL (seconds, default 15) in
+ *         milliseconds, or 0 when JARVIS_METRICS_FILE is not set
+ */
+int metrics_export_interval_ms(void);
+
+#endif // METRICS_H
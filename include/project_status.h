@@ -0,0 +1,75 @@
+#ifndef PROJECT_STATUS_H
+#define PROJECT_STATUS_H
+
+#include "git_status.h"
+#include <limits.h>
+
+/**
+ * Status of every repository under a set of project roots, read by a bounded
+ * pool of worker threads. Each repository is read with git_status_read();
+ * the ones it hands back are asked through git status --porcelain -b. The
+ * result is ranked so repositories needing attention come first: unreadable
+ * or conflicted, then uncommitted changes, unpushed commits, a vanished
+ * upstream, commits to pull, a detached HEAD and finally untracked files.
+ */
+
+#define PROJECT_STATUS_MAX_REPOS 512
+
+typedef struct {
+    char       path[PATH_MAX];     /* work tree */
+    const char* name;              /* last component of path */
+    int        readable;           /* 0 if neither the reader nor git could read it */
+    int        native;             /* read without starting git */
+    int        conflicts;          /* unmerged paths */
+    int        attention;          /* ranking score; 0 = clean and in sync */
+    git_status status;
+} project_repo;
+
+typedef struct {
+    project_repo* repos;           /* most attention first */
+    int           count;
+    int           needing_attention;
+    int           jobs;            /* workers used */
+    long long     elapsed_us;
+} project_report;
+
+/**
+ * Lists the roots to scan: JARVIS_PROJECT_ROOTS (colon-separated) or, by
+ * default, the current directory, ai_workspace/projects below it and the
+ * directory holding the current repository (its sibling checkouts)
+ * @param roots Receives up to max absolute paths, without duplicates
+ * @param max Capacity of roots
+ * @return Number of roots
+ */
+int project_status_roots(char roots[][PATH_MAX], int max);
+
+/**
+ * @return Worker count: JARVIS_STATUS_JOBS, else 8 (the work is mostly waiting on the disk)
+ */
+int project_status_jobs(void);
+
+/**
+ * Finds the repositories under the roots (a root itself, or a directory up
+ * to two levels below it that holds .git) and reads their status in parallel
+ * @param roots Directories to search
+ * @param root_count Number of roots
+ * @param jobs Worker threads (0 = project_status_jobs())
+ * @param report Receives the ranked repositories; release with project_status_free()
+ * @return 1 on success, 0 on allocation failure
+ */
+int project_status_scan(const char* const* roots, int root_count, int jobs, project_report* report);
+
+/**
+ * Describes one repository's state, e.g. "3 modified, 1 untracked, 2 ahead"
+ * @param repo Repository from a report
+ * @param out Receives the description ("clean" when there is nothing to say)
+ * @param out_size Size of out
+ */
+void project_status_describe(const project_repo* repo, char* out, size_t out_size);
+
+/**
+ * Releases a report
+ */
+void project_status_free(project_report* report);
+
+#endif // PROJECT_STATUS_H
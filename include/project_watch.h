@@ -0,0 +1,92 @@
+#ifndef PROJECT_WATCH_H
+#define PROJECT_WATCH_H
+
+#include <stddef.h>
+
+/**
+ * Watch mode: a background thread that follows a project's sources with
+ * inotify (or, where inotify is unavailable, by polling their timestamps),
+ * waits for a burst of saves to settle, then runs one build-and-test cycle
+ * with only the tests the changed files affect. The result is announced only
+ * when it flips between green and red; the interactive loop reads the
+ * announcements from project_watch_announce_fd().
+ *
+ * Watched files are C/C++ sources and headers, Makefiles and *.mk files
+ * outside hidden and .gitignore'd directories. JARVIS_WATCH_DEBOUNCE_MS sets
+ * the quiet period (default 300), JARVIS_WATCH_POLL=1 forces polling and
+ * JARVIS_WATCH_POLL_MS its interval (default 1000).
+ */
+
+typedef enum {
+    PROJECT_WATCH_UNKNOWN,          /* no cycle has finished yet */
+    PROJECT_WATCH_GREEN,
+    PROJECT_WATCH_RED
+} project_watch_state;
+
+/**
+ * Runs one build-and-test cycle; called on the watcher thread
+ * @param dir Project directory
+ * @param only Tests to run as a --only list, NULL for every test, "" for none
+ * @param summary Receives a one-line result (first error, test verdict)
+ * @param summary_size Size of summary
+ * @param context Value passed to project_watch_start()
+ * @return 1 if the build and tests passed, 0 otherwise
+ */
+typedef int (*project_watch_cycle_fn)(const char* dir, const char* only, char* summary, size_t summary_size,
+                                      void* context);
+
+/**
+ * Starts watching a project; the first cycle runs at once and sets the baseline
+ * @param dir Project directory
+ * @param cycle Runs a cycle
+ * @param context Passed to cycle
+ * @return 1 on success, 0 if the directory cannot be watched, -1 if a project is
+ *         already watched or a stopped watch is still finishing its cycle
+ */
+int project_watch_start(const char* dir, project_watch_cycle_fn cycle, void* context);
+
+/**
+ * Stops watching. A cycle already running finishes in the background,
+ * unannounced; until it has, project_watch_start() reports the watch busy.
+ * @return 1 if a project was being watched, 0 otherwise (or if already stopping)
+ */
+int project_watch_stop(void);
+
+/**
+ * Describes the watch: directory, backend, state and the last cycle's summary
+ * @param out Receives the description
+ * @param out_size Size of out
+ * @return 1 if a project is being watched, 0 otherwise (out says so, or that
+ *         a stopped watch is still finishing)
+ */
+int project_watch_status(char* out, size_t out_size);
+
+/**
+ * @return Read end of a pipe that becomes readable when an announcement is
+ *         waiting (the same descriptor for the whole process), -1 on failure
+ */
+int project_watch_announce_fd(void);
+
+/**
+ * Takes the waiting announcement, draining the descriptor
+ * @param out Receives e.g. "Build is red: ..." or "Back to green: ..."
+ * @param out_size Size of out
+ * @return 1 if there was one, 0 otherwise
+ */
+int project_watch_take_announcement(char* out, size_t out_size);
+
+/**
+ * Chooses the tests affected by changed files: the test functions in the .c
+ * files under <dir>/tests whose bodies mention a changed file's name
+ * (src/foo.c and include/foo.h select the tests that call foo_read())
+ * @param dir Project directory
+ * @param changed Changed paths relative to dir
+ * @param count Number of changed paths
+ * @param only Receives the comma-separated test names
+ * @param only_size Size of only
+ * @return Number of tests chosen, or -1 if every test should run (a test file,
+ *         Makefile or unmapped file changed, or the list does not fit)
+ */
+int project_watch_affected_tests(const char* dir, const char* const* changed, int count, char* only, size_t only_size);
+
+#endif // PROJECT_WATCH_H
@@ -0,0 +1,54 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+
+/**
+ * Keyed cache for answers that come from outside the process (weather, web
+ * search, ...). Each source has its own TTL, failures are remembered for a
+ * shorter negative TTL, and sources can ask to be refreshed in the
+ * background shortly before they expire so the next answer is instant.
+ *
+ * Environment:
+ *   JARVIS_CACHE_TTL_<SOURCE>  override a source's TTL in seconds (e.g. JARVIS_CACHE_TTL_WEATHER=300)
+ *   JARVIS_CACHE_FILE          persist entries across restarts (JSON lines)
+ *
+ * Hits and misses are counted in METRIC_CACHE_HITS / METRIC_CACHE_MISSES.
+ */
+
+typedef struct {
+    const char* source;              /* namespace and TTL override name, e.g. "weather" */
+    int         ttl_seconds;         /* successful answers stay fresh this long */
+    int         negative_ttl_seconds;/* failures are remembered this long (0 = not cached) */
+    int         refresh_ahead_seconds;/* refresh in the background this close to expiry (0 = off) */
+} result_cache_policy;
+
+/**
+ * Produces a fresh answer. Called without any cache lock held, possibly from
+ * the background refresher thread.
+ * @param key Lookup key
+ * @param out Output buffer for the answer
+ * @param out_size Size of the output buffer
+ * @return 1 on success, 0 on failure
+ */
+typedef int (*result_cache_fetch_fn)(const char* key, char* out, size_t out_size);
+
+/**
+ * Returns a cached answer or fetches and caches a new one
+ * @param policy Source policy; must outlive the process (a static)
+ * @param key Lookup key ("" is fine for single-answer sources)
+ * @param out Receives the answer (empty for a failure)
+ * @param out_size Size of the output buffer
+ * @param fetch Function that produces the answer on a miss
+ * @param cached Optional: set to 1 if the answer came from the cache
+ * @return 1 if the answer is a success, 0 if the fetch failed (now or within the negative TTL)
+ */
+int result_cache_get(const result_cache_policy* policy, const char* key, char* out, size_t out_size,
+                     result_cache_fetch_fn fetch, int* cached);
+
+/**
+ * Drops every entry (and the persisted copy)
+ */
+void result_cache_clear(void);
+
+#endif // RESULT_CACHE_H
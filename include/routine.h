@@ -0,0 +1,120 @@
+#ifndef ROUTINE_H
+#define ROUTINE_H
+
+#include <stddef.h>
+
+/**
+ * Routines: named workflows whose steps are ordinary commands ("git pull",
+ * "build project", "run tests") declared as a dependency graph. Steps whose
+ * dependencies have finished run at once, in parallel; a failed step skips
+ * everything downstream of it. A routine therefore takes about as long as
+ * its critical path instead of the sum of its steps.
+ *
+ * Routines are read from JARVIS_ROUTINES (default
+ * $XDG_CONFIG_HOME/jarvis/routines, else ~/.config/jarvis/routines):
+ *
+ *     [morning]
+ *     pull: git pull
+ *     projects: status of all projects
+ *     build (after pull): build project
+ *     tests (after build): run tests
+ *
+ * A routine defined there replaces the built-in one of the same name.
+ */
+
+#define ROUTINE_MAX_STEPS   32
+#define ROUTINE_NAME_MAX    32
+#define ROUTINE_COMMAND_MAX 256
+
+typedef enum {
+    ROUTINE_PENDING,
+    ROUTINE_RUNNING,
+    ROUTINE_OK,
+    ROUTINE_FAILED,
+    ROUTINE_SKIPPED                 /* a dependency failed or was skipped */
+} routine_step_state;
+
+typedef struct {
+    char               name[ROUTINE_NAME_MAX];
+    char               command[ROUTINE_COMMAND_MAX];
+    int                deps[ROUTINE_MAX_STEPS];   /* indexes of the steps this one waits for */
+    int                dep_count;
+    routine_step_state state;
+    long long          start_us;    /* offset from the start of the run */
+    long long          elapsed_us;
+    char*              output;      /* the command's response (malloc'd), NULL if it did not run */
+} routine_step;
+
+typedef struct {
+    char         name[ROUTINE_NAME_MAX];
+    routine_step steps[ROUTINE_MAX_STEPS];
+    int          step_count;
+    int          ok, failed, skipped;
+    long long    elapsed_us;        /* wall time of the run */
+    long long    critical_us;       /* longest chain of dependent step times */
+} routine;
+
+/**
+ * Runs one step
+ * @param command The step's command
+ * @param output Receives the response (malloc'd; may be left NULL)
+ * @param context Value passed to routine_run()
+ * @return 1 if the step succeeded, 0 if it failed
+ */
+typedef int (*routine_step_fn)(const char* command, char** output, void* context);
+
+/**
+ * Parses one routine out of routine definitions
+ * @param text Definitions in the format above
+ * @param name Routine to extract (case-insensitive)
+ * @param out Receives the routine
+ * @param error Receives why it was rejected (unknown dependency, cycle, ...)
+ * @param error_size Size of error
+ * @return 1 on success, 0 if text does not define name, -1 if the definition is invalid
+ */
+int routine_parse(const char* text, const char* name, routine* out, char* error, size_t error_size);
+
+/**
+ * Loads a routine from the routines file, falling back to the built-in ones
+ * @return As routine_parse()
+ */
+int routine_load(const char* name, routine* out, char* error, size_t error_size);
+
+/**
+ * Lists the names of the routines that routine_load() can find
+ * @param names Receives up to max names, file definitions first
+ * @param max Capacity of names
+ * @return Number of names
+ */
+int routine_list(char names[][ROUTINE_NAME_MAX], int max);
+
+/**
+ * @return Steps run at once: JARVIS_ROUTINE_JOBS, else as many as are ready
+ */
+int routine_jobs(void);
+
+/**
+ * Runs a routine's steps in dependency order on a pool of threads
+ * @param routine Routine from routine_parse()/routine_load(); receives states,
+ *                timings and outputs (release with routine_release())
+ * @param jobs Steps run at once (0 = routine_jobs())
+ * @param run Runs one step; called from worker threads
+ * @param context Passed to run
+ * @return 1 if every step succeeded, 0 otherwise
+ */
+int routine_run(routine* routine, int jobs, routine_step_fn run, void* context);
+
+/**
+ * Summarises a run: a totals line, then each step's state, time and the start of its output
+ * @param routine Routine after routine_run()
+ * @param out Receives the report
+ * @param out_size Size of out
+ */
+void routine_format_report(const routine* routine, char* out, size_t out_size);
+
+/**
+ * Releases the step outputs of a run
+ */
+void routine_release(routine* routine);
+
+#endif // ROUTINE_H
@@ -0,0 +1,31 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+/**
+ * Computes the default daemon socket path: $JARVIS_SOCKET, else
+ * $XDG_RUNTIME_DIR/jarvis.sock, else /tmp/jarvis-<uid>.sock
+ * @param out Output buffer
+ * @param out_size Size of the output buffer
+ */
+void server_default_socket_path(char* out, size_t out_size);
+
+/**
+ * Runs JARVIS as a resident daemon on a Unix stream socket (`jarvis --serve`).
+ * Each connection is a session with its own context memory. Requests are
+ * newline-delimited: either a JSON object {"id": ..., "command": "...",
+ * "cwd": "/abs/dir"} or a bare command line. A cwd sets the directory that
+ * connection's commands run in (the daemon's own until one is sent); each
+ * worker thread has a private working directory for this where the kernel
+ * supports it. Every request gets one JSON line back:
+ * {"id":...,"command":...,"intent":...,"response":...,"status":N,"elapsed_us":N}
+ * Requests are dispatched to a worker pool (JARVIS_SERVE_WORKERS, default
+ * one per CPU, 2..16); requests from the same client are answered in order.
+ * Stops on SIGINT/SIGTERM.
+ * @param socket_path Socket to listen on, or NULL for the default path
+ * @return Process exit code
+ */
+int server_main(const char* socket_path);
+
+#endif // SERVER_H
@@ -0,0 +1,68 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "command_processor.h"
+#include <limits.h>
+
+#define SESSION_MEMORY_SIZE 5
+#define SESSION_TEXT_MAX    512
+#define SESSION_COMMAND_MAX (SESSION_TEXT_MAX - 1)  /* longest command a session accepts */
+
+/**
+ * Per-client conversation state. The interactive assistant uses a single
+ * process-wide default session; the socket server gives every client its own.
+ */
+typedef struct jarvis_session {
+    char memory[SESSION_MEMORY_SIZE][SESSION_TEXT_MAX]; /* last commands, oldest first */
+    int  memory_count;
+    char tts_engine[32];                  /* "" = detected default, "none" = text only */
+    char query_buffer[SESSION_TEXT_MAX];  /* backing store for extract_search_query() */
+    int  last_action_status;              /* exit status of the last action's child */
+    char cwd[PATH_MAX];                   /* directory its commands run in, "" = the process's */
+} jarvis_session;
+
+/**
+ * Allocates a new, empty session
+ * @return Session to release with session_destroy(), or NULL on allocation failure
+ */
+jarvis_session* session_create(void);
+
+/**
+ * Releases a session created with session_create()
+ */
+void session_destroy(jarvis_session* session);
+
+/**
+ * Returns the session bound to the calling thread, or the process default
+ * @return Never NULL
+ */
+jarvis_session* session_current(void);
+
+/**
+ * Binds a session to the calling thread (NULL restores the process default)
+ */
+void session_bind(jarvis_session* session);
+
+/**
+ * Appends a command to the session's context memory, dropping the oldest
+ */
+void session_memory_push(jarvis_session* session, const char* command);
+
+/**
+ * @return Most recent remembered command, or NULL if memory is empty
+ */
+const char* session_memory_last(const jarvis_session* session);
+
+/**
+ * Handles a command on behalf of a session: answers the memory recall
+ * commands ("repeat last command", "what did I say") from the session's
+ * history, remembers everything else and routes it through process_command_ex.
+ * The session is bound to the calling thread for the duration of the call.
+ * @param session Session whose context is used
+ * @param command The command text
+ * @param result Receives intent and status (may be NULL)
+ * @return Dynamically allocated response, or NULL on failure
+ */
+char* session_respond(jarvis_session* session, const char* command, command_result* result);
+
+#endif // SESSION_H
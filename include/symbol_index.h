@@ -0,0 +1,57 @@
+#ifndef SYMBOL_INDEX_H
+#define SYMBOL_INDEX_H
+
+#include <stddef.h>
+
+/**
+ * Code symbol index for a project tree. C/C++ and Python sources are scanned
+ * by a small tokenizer (no compiler, no ripgrep) for function, struct/class,
+ * enum, typedef and macro definitions plus every identifier reference, tagged
+ * with the enclosing function. The result is kept in memory and persisted to
+ * <root>/.jarvis/symbols.idx; on each query only files whose size or mtime
+ * changed are re-read, and only those whose content hash changed are
+ * re-scanned.
+ */
+
+typedef enum {
+    SYMBOL_QUERY_DEFINITIONS,   /* definitions, or declarations if nothing defines it */
+    SYMBOL_QUERY_CALLERS,       /* call sites, with the calling function */
+    SYMBOL_QUERY_REFERENCES     /* every occurrence, definitions first */
+} symbol_query;
+
+typedef struct {
+    char path[512];        /* relative to the project root */
+    int  line;             /* 1-based */
+    char kind[16];         /* "function", "declaration", "struct", "class", "enum", "typedef", "macro", "call", "reference" */
+    char context[128];     /* enclosing function, "" at file scope */
+    char text[160];        /* the source line, trimmed */
+} symbol_location;
+
+typedef struct {
+    int files;             /* source files in the index */
+    int rescanned;         /* files scanned by this update */
+    int symbols;           /* definitions and references in the index */
+} symbol_index_stats;
+
+/**
+ * Brings the index for a tree up to date (queries do this themselves)
+ * @param root Project root
+ * @param stats Optional: receives counts
+ * @return 1 on success, 0 if the root cannot be read
+ */
+int symbol_index_update(const char* root, symbol_index_stats* stats);
+
+/**
+ * Looks a symbol up, updating the index first
+ * @param root Project root
+ * @param name Identifier, e.g. "process_command"
+ * @param query What to return
+ * @param out Output array, best first
+ * @param max Capacity of out
+ * @param total Optional: receives the number of matches before truncation to max
+ * @return Number of locations stored
+ */
+int symbol_index_lookup(const char* root, const char* name, symbol_query query,
+                        symbol_location* out, int max, int* total);
+
+#endif // SYMBOL_INDEX_H
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Span tracing into per-thread lock-free ring buffers, exported as Chrome
+ * trace-event JSON (load in chrome://tracing or Perfetto).
+ * Enabled by setting JARVIS_TRACE=<output path>. Every span also feeds the
+ * per-stage latency histogram (metrics.h), so when tracing is disabled a
+ * span costs two monotonic clock reads and a relaxed atomic load.
+ */
+
+/**
+ * Reads JARVIS_TRACE and, if set, enables tracing and dumps at exit.
+ * Safe to call more than once.
+ */
+void trace_init(void);
+
+/**
+ * @return 1 if spans are being recorded, 0 otherwise
+ */
+int trace_enabled(void);
+
+/**
+ * @return Output path from JARVIS_TRACE ("" when tracing is disabled)
+ */
+const char* trace_output_path(void);
+
+/**
+ * Starts a span
+ * @return Monotonic start time in microseconds
+ */
+long long trace_begin(void);
+
+/**
+ * Finishes a span: records its latency for the stage and, when tracing,
+ * appends it to the calling thread's ring buffer
+ * @param name Span name; must be a string literal (stored by pointer)
+ * @param start Value returned by trace_begin()
+ * @param detail Optional argument shown with the span (copied, truncated), or NULL
+ * @return Span duration in microseconds (0 if start is 0)
+ */
+long long trace_end(const char* name, long long start, const char* detail);
+
+/**
+ * Writes all recorded spans as Chrome trace-event JSON. Safe while other
+ * threads keep tracing; spans their rings overwrite during the dump are left out.
+ * @param path Output file, or NULL for the JARVIS_TRACE path
+ * @return Number of events written, or -1 on failure
+ */
+int trace_dump(const char* path);
+
+#endif // TRACE_H
@@ -10,6 +10,22 @@
  */
 char* capture_voice_input(void);
 
+/**
+ * Identifies the current speaker when JARVIS_VERIFY_SPEAKER is enabled.
+ * Blocks until the recognizer answers; the interactive loop runs the same
+ * script through event_loop_spawn() instead.
+ * @param speaker Buffer receiving the speaker name, or "UNKNOWN"
+ * @param speaker_size Size of the speaker buffer
+ */
+void voice_input_identify_speaker(char* speaker, size_t speaker_size);
+
+/**
+ * Checks whether the Python speech recognizer can be launched.
+ * The result is cached; safe to call from a worker thread at startup.
+ * @return 1 if python3 and src/speech_recognizer.py are available, 0 otherwise
+ */
+int voice_input_probe(void);
+
 /**
  * Records audio to a temporary file
  * @param filename Path to save the audio file
@@ -2,6 +2,7 @@
 #define VOICE_OUTPUT_H
 
 #include <stdlib.h>
+#include <sys/types.h>
 
 /**
  * Speaks out the given text using text-to-speech
@@ -11,6 +12,33 @@
 int speak(const char* text);
 int notify_desktop(const char* title, const char* message);
 
+/**
+ * Starts speaking the given text without waiting for the TTS engine
+ * @param text The text to be spoken
+ * @return TTS child pid to reap (e.g. with event_loop_watch_child), or 0 in text-only mode
+ */
+pid_t speak_async(const char* text);
+
+/**
+ * Posts a desktop notification without waiting for the notifier
+ * @return Notifier child pid to reap, or 0 if notifications are unavailable/disabled
+ */
+pid_t notify_desktop_async(const char* title, const char* message);
+
+/**
+ * Checks whether a program is on PATH without starting a shell
+ * @param cmd Program name
+ * @return 1 if an executable of that name is found on PATH, 0 otherwise
+ */
+int command_exists(const char* cmd);
+
+/**
+ * Probes the TTS engine and desktop notifier without printing anything.
+ * Safe to call from a worker thread before voice_output_init().
+ * @return 1 if a TTS engine is available, 0 otherwise
+ */
+int voice_output_probe(void);
+
 /**
  * Initialize voice output system
  * @return 1 on success, 0 on failure
@@ -0,0 +1,34 @@
+#ifndef WARNING_CACHE_H
+#define WARNING_CACHE_H
+
+#include <stddef.h>
+
+/**
+ * Incremental compiler-warning check for a Makefile project. The compile
+ * units come from build_plan; each unit's compiler output is cached in
+ * <dir>/.jarvis/warnings.cache, keyed by a hash of its command line and the
+ * content hashes of its source and every header it included (from -MD).
+ * A check recompiles only units whose key changed, with -o /dev/null so the
+ * real build outputs are left alone, and merges their output with the cached
+ * output of the others.
+ */
+
+typedef struct {
+    int units;             /* compile units in the plan */
+    int recompiled;        /* units compiled by this check */
+    int failed;            /* units that did not compile (not cached) */
+    int warnings;          /* distinct warning lines found */
+} warning_stats;
+
+/**
+ * Collects the compiler warnings of a project
+ * @param dir Project directory containing the Makefile
+ * @param out Receives the distinct warning lines, newline-separated, in build order
+ * @param out_size Size of out
+ * @param stats Optional: receives counts
+ * @return 1 on success, 0 if no compile units were found (the caller should
+ *         fall back to a full build)
+ */
+int warning_cache_check(const char* dir, char* out, size_t out_size, warning_stats* stats);
+
+#endif // WARNING_CACHE_H
@@ -0,0 +1,105 @@
+#include "../include/batch.h"
+#include "../include/command_processor.h"
+#include "../include/session.h"
+#include "../include/json.h"
+#include "../include/metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void trim_line(char* line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                       line[len - 1] == ' '  || line[len - 1] == '\t')) {
+        line[--len] = '\0';
+    }
+}
+
+int batch_run(FILE* in, FILE* out) {
+    if (!in || !out) return 1;
+
+    /* getline reads whole lines, so an overlong one is refused as a unit
+       instead of running its tail as a separate command */
+    char* line = NULL;
+    size_t capacity = 0;
+    int failures = 0;
+
+    while (getline(&line, &capacity, in) != -1) {
+        trim_line(line);
+        const char* command = line;
+        while (*command == ' ' || *command == '\t') command++;
+        if (*command == '\0' || *command == '#') continue;
+
+        command_result result = { "error", 0 };
+        long long start = monotonic_us();
+        /* Sessions keep commands in SESSION_TEXT_MAX buffers: refuse, rather than cut, longer ones */
+        int too_long = strlen(command) > SESSION_COMMAND_MAX;
+        char* response = too_long ? strdup("Command too long.") : process_command_ex(command, &result);
+        long long elapsed = monotonic_us() - start;
+        if (too_long) {
+            failures++;
+            result.intent = "too_long";
+            result.status = -1;
+        }
+
+        if (!response) {
+            failures++;
+            result.intent = "error";
+            result.status = -1;
+        }
+
+        fputs("{\"command\":", out);
+        json_write_string(out, command);
+        fputs(",\"intent\":", out);
+        json_write_string(out, result.intent);
+        fputs(",\"response\":", out);
+        json_write_string(out, response);
+        fprintf(out, ",\"status\":%d,\"elapsed_us\":%lld}\n", result.status, elapsed);
+
+        free(response);
+    }
+
+    free(line);
+    fflush(out);
+    return failures;
+}
+
+int batch_main(const char* input_path) {
+    FILE* in = stdin;
+    if (input_path && strcmp(input_path, "-") != 0) {
+        in = fopen(input_path, "r");
+        if (!in) {
+            fprintf(stderr, "Cannot open batch file: %s\n", input_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Headless by default: actions must not pop up windows */
+    setenv("JARVIS_NO_GUI", "1", 0);
+
+    /* Results keep the real stdout; anything handlers print goes to stderr */
+    fflush(stdout);
+    int result_fd = dup(STDOUT_FILENO);
+    FILE* out = result_fd >= 0 ? fdopen(result_fd, "w") : NULL;
+    if (!out) {
+        if (in != stdin) fclose(in);
+        fprintf(stderr, "Cannot set up batch output\n");
+        return EXIT_FAILURE;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 16);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    int failures = batch_run(in, out);
+    metrics_write_prometheus(NULL);
+
+    fclose(out);
+    if (in != stdin) fclose(in);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
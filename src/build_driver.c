@@ -0,0 +1,601 @@
+#include "../include/build_driver.h"
+#include "../include/build_plan.h"
+#include "../include/compile_cache.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BUILD_STATE_DIR   ".jarvis"
+#define BUILD_STATE_FILE  "build.state"
+#define BUILD_STATE_MAGIC "JBLD 1"
+#define BUILD_MAX_OUTPUT  (256 * 1024)
+
+extern char** environ;
+
+/* Command-line hash each object was last built with */
+typedef struct {
+    char*    object;
+    uint64_t command;
+} StateEntry;
+
+typedef struct {
+    StateEntry* entries;   /* sorted by object */
+    size_t      count;
+    size_t      cap;
+} BuildState;
+
+typedef struct {
+    const build_unit* unit;
+    char              object[PATH_MAX];    /* relative to the root */
+    char              depfile[PATH_MAX];   /* relative to the root */
+    char              target[512];         /* the object as the command names it */
+    uint64_t          command;
+    uint64_t          recorded;            /* hash to save: command once built, else the previous one */
+    int               stale;
+    int               phase;               /* JOB_PREPROCESS or JOB_COMPILE while running */
+    char              key[COMPILE_CACHE_KEY_SIZE];   /* compile cache key, "" if none */
+    pid_t             pid;
+    int               output_fd;
+    int               holds_token;         /* started with a jobserver token */
+    char*             output;
+    size_t            output_len;
+    size_t            output_cap;
+} CompileJob;
+
+enum { JOB_PREPROCESS = 1, JOB_COMPILE = 2 };
+
+/* Compile cache traffic of one build */
+typedef struct {
+    int       enabled;
+    int       misses;
+    int       stored;
+    long long added;
+} CacheUse;
+
+/* Only one build per project at a time; server sessions may ask together */
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int join(char* out, size_t out_size, const char* dir, const char* path) {
+    int len = (path[0] == '/' || strcmp(dir, ".") == 0) ? snprintf(out, out_size, "%s", path)
+                                                        : snprintf(out, out_size, "%s/%s", dir, path);
+    return len >= 0 && (size_t)len < out_size;
+}
+
+/* ── Build state ────────────────────────────────────────────────────────── */
+
+static int compare_entries(const void* a, const void* b) {
+    return strcmp(((const StateEntry*)a)->object, ((const StateEntry*)b)->object);
+}
+
+static StateEntry* state_find(BuildState* state, const char* object) {
+    StateEntry probe = { .object = (char*)object };
+    return state->count ? bsearch(&probe, state->entries, state->count, sizeof(StateEntry), compare_entries) : NULL;
+}
+
+static void state_push(BuildState* state, const char* object, uint64_t command) {
+    if (state->count == state->cap) {
+        size_t cap = state->cap ? state->cap * 2 : 64;
+        StateEntry* grown = realloc(state->entries, cap * sizeof(StateEntry));
+        if (!grown) return;
+        state->entries = grown;
+        state->cap = cap;
+    }
+    char* copy = strdup(object);
+    if (!copy) return;
+    state->entries[state->count].object = copy;
+    state->entries[state->count].command = command;
+    state->count++;
+}
+
+static void state_free(BuildState* state) {
+    for (size_t i = 0; i < state->count; i++) free(state->entries[i].object);
+    free(state->entries);
+    memset(state, 0, sizeof(*state));
+}
+
+/* Format: "JBLD 1" then "<command hash>\t<object>" per line */
+static void state_load(BuildState* state, const char* path) {
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+    char line[PATH_MAX + 32];
+    if (fgets(line, sizeof(line), in) && strcmp(line, BUILD_STATE_MAGIC "\n") == 0) {
+        while (fgets(line, sizeof(line), in)) {
+            line[strcspn(line, "\n")] = '\0';
+            char* tab = strchr(line, '\t');
+            unsigned long long command;
+            if (tab && sscanf(line, "%llx", &command) == 1) state_push(state, tab + 1, command);
+        }
+    }
+    fclose(in);
+    qsort(state->entries, state->count, sizeof(StateEntry), compare_entries);
+}
+
+static void state_save(const CompileJob* jobs, int count, const char* dir, const char* path) {
+    mkdir(dir, 0755);
+    char tmp_path[PATH_MAX + 64];
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) return;
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) return;
+    fprintf(out, "%s\n", BUILD_STATE_MAGIC);
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].recorded) fprintf(out, "%llx\t%s\n", (unsigned long long)jobs[i].recorded, jobs[i].object);
+    }
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) unlink(tmp_path);
+}
+
+/* ── Staleness ──────────────────────────────────────────────────────────── */
+
+/* mtime of each file, looked up at most once per build */
+typedef struct {
+    char**     paths;
+    long long* mtimes;     /* -1 = missing */
+    size_t     cap;
+    size_t     count;
+} MtimeTable;
+
+static long long file_mtime(const char* root, const char* path) {
+    char full[PATH_MAX];
+    struct stat st;
+    if (!join(full, sizeof(full), root, path) || stat(full, &st) != 0) return -1;
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+static long long cached_mtime(MtimeTable* table, const char* root, const char* path) {
+    if (table->count * 2 >= table->cap) {
+        size_t cap = table->cap ? table->cap * 2 : 256;
+        char** paths = calloc(cap, sizeof(char*));
+        long long* mtimes = calloc(cap, sizeof(long long));
+        if (!paths || !mtimes) {
+            free(paths);
+            free(mtimes);
+            return file_mtime(root, path);
+        }
+        for (size_t i = 0; i < table->cap; i++) {
+            if (!table->paths[i]) continue;
+            size_t j = hash_bytes(1469598103934665603ULL, table->paths[i], strlen(table->paths[i])) & (cap - 1);
+            while (paths[j]) j = (j + 1) & (cap - 1);
+            paths[j] = table->paths[i];
+            mtimes[j] = table->mtimes[i];
+        }
+        free(table->paths);
+        free(table->mtimes);
+        table->paths = paths;
+        table->mtimes = mtimes;
+        table->cap = cap;
+    }
+    size_t i = hash_bytes(1469598103934665603ULL, path, strlen(path)) & (table->cap - 1);
+    while (table->paths[i]) {
+        if (strcmp(table->paths[i], path) == 0) return table->mtimes[i];
+        i = (i + 1) & (table->cap - 1);
+    }
+    long long mtime = file_mtime(root, path);
+    table->paths[i] = strdup(path);
+    if (table->paths[i]) {
+        table->mtimes[i] = mtime;
+        table->count++;
+    }
+    return mtime;
+}
+
+static void mtimes_free(MtimeTable* table) {
+    for (size_t i = 0; i < table->cap; i++) free(table->paths[i]);
+    free(table->paths);
+    free(table->mtimes);
+}
+
+/* Stale: no object, no depfile (headers unknown), a prerequisite newer than
+   the object, or a different command line than the last build. Objects the
+   driver has not built before are adopted with their current command. */
+static int job_is_stale(CompileJob* job, BuildState* state, MtimeTable* mtimes, const char* root) {
+    StateEntry* previous = state_find(state, job->object);
+    job->recorded = previous ? previous->command : job->command;
+    if (previous && previous->command != job->command) return 1;
+
+    long long built = file_mtime(root, job->object);
+    if (built < 0) return 1;
+
+    char depfile[PATH_MAX];
+    char** deps = NULL;
+    int count = 0;
+    if (!join(depfile, sizeof(depfile), root, job->depfile) ||
+        !build_plan_read_depfile(depfile, job->unit->directory, &deps, &count)) return 1;
+    int stale = 0;
+    for (int i = 0; i < count && !stale; i++) {
+        long long mtime = cached_mtime(mtimes, root, deps[i]);
+        stale = mtime < 0 || mtime > built;
+    }
+    build_plan_free_deps(deps, count);
+    return stale;
+}
+
+/* ── Compiling ──────────────────────────────────────────────────────────── */
+
+/* The unit's command with the driver's depfile flags. Given a preprocessed
+   path, the command runs the preprocessor only and writes there instead;
+   it still writes the depfile, naming the object as its target. */
+static char** compile_argv(const CompileJob* job, const char* depfile, const char* preprocessed) {
+    const build_unit* unit = job->unit;
+    char** argv = calloc((size_t)unit->argc + 9, sizeof(char*));
+    if (!argv) return NULL;
+    int n = 0, has_output = 0;
+    for (int i = 0; i < unit->argc; i++) {
+        const char* arg = unit->argv[i];
+        if (strcmp(arg, "-MF") == 0 || strcmp(arg, "-MT") == 0 || strcmp(arg, "-MQ") == 0) {
+            i++;
+            continue;
+        }
+        if (strcmp(arg, "-MD") == 0 || strcmp(arg, "-MMD") == 0 || strcmp(arg, "-MP") == 0) continue;
+        if (preprocessed && strcmp(arg, "-c") == 0) {
+            argv[n++] = "-E";
+            continue;
+        }
+        if (preprocessed && strcmp(arg, "-o") == 0 && i + 1 < unit->argc) {
+            argv[n++] = "-o";
+            argv[n++] = (char*)preprocessed;
+            has_output = 1;
+            i++;
+            continue;
+        }
+        argv[n++] = unit->argv[i];
+    }
+    if (preprocessed) {
+        if (!has_output) {
+            argv[n++] = "-o";
+            argv[n++] = (char*)preprocessed;
+        }
+        argv[n++] = "-MQ";
+        argv[n++] = (char*)job->target;
+    }
+    argv[n++] = "-MMD";
+    argv[n++] = "-MP";
+    argv[n++] = "-MF";
+    argv[n++] = (char*)depfile;
+    argv[n] = NULL;
+    return argv;
+}
+
+/* environ plus MAKEFLAGS advertising the jobserver, built before fork so the
+   child only has to exec */
+static char** jobserver_environ(const int jobserver[2], int jobs, char* makeflags, size_t makeflags_size) {
+    snprintf(makeflags, makeflags_size, "MAKEFLAGS= -j%d --jobserver-auth=%d,%d --jobserver-fds=%d,%d",
+             jobs, jobserver[0], jobserver[1], jobserver[0], jobserver[1]);
+    size_t count = 0;
+    while (environ[count]) count++;
+    char** env = calloc(count + 2, sizeof(char*));
+    if (!env) return NULL;
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(environ[i], "MAKEFLAGS=", 10) != 0 && strncmp(environ[i], "MFLAGS=", 7) != 0) env[n++] = environ[i];
+    }
+    env[n++] = makeflags;
+    env[n] = NULL;
+    return env;
+}
+
+static void make_parent_dirs(const char* root, const char* path) {
+    char full[PATH_MAX];
+    if (!join(full, sizeof(full), root, path)) return;
+    for (char* slash = strchr(full + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(full, 0755);
+        *slash = '/';
+    }
+}
+
+static int job_start(CompileJob* job, const char* root, char** env, int phase, const char* preprocessed) {
+    char depfile[PATH_MAX];
+    if (!join(depfile, sizeof(depfile), root, job->depfile)) return 0;
+    char** argv = compile_argv(job, depfile, phase == JOB_PREPROCESS ? preprocessed : NULL);
+    int out[2];
+    if (!argv || pipe(out) != 0) {
+        free(argv);
+        return 0;
+    }
+    fcntl(out[0], F_SETFD, FD_CLOEXEC);
+    fcntl(out[1], F_SETFD, FD_CLOEXEC);
+    make_parent_dirs(root, job->object);
+    /* A restored object may be a hard link into the cache: never write through it */
+    char object[PATH_MAX];
+    if (phase == JOB_COMPILE && preprocessed && join(object, sizeof(object), root, job->object)) unlink(object);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(out[1], STDOUT_FILENO);
+        dup2(out[1], STDERR_FILENO);
+        if (chdir(root) != 0 || chdir(job->unit->directory) != 0) _exit(127);
+        if (env) environ = env;
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    free(argv);
+    close(out[1]);
+    if (pid < 0) {
+        close(out[0]);
+        return 0;
+    }
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+    job->pid = pid;
+    job->output_fd = out[0];
+    job->phase = phase;
+    job->output_len = 0;
+    return 1;
+}
+
+/* Drains the job's pipe; returns 1 once it reached EOF */
+static int job_read(CompileJob* job) {
+    char buffer[4096];
+    for (;;) {
+        ssize_t got = read(job->output_fd, buffer, sizeof(buffer));
+        if (got == 0) return 1;
+        if (got < 0) return errno == EAGAIN || errno == EINTR ? 0 : 1;
+        metrics_count(METRIC_BYTES_CAPTURED, (unsigned long long)got);
+        if (job->output_len + (size_t)got > BUILD_MAX_OUTPUT) continue;
+        if (job->output_len + (size_t)got > job->output_cap) {
+            size_t cap = job->output_cap ? job->output_cap * 2 : 8192;
+            while (cap < job->output_len + (size_t)got) cap *= 2;
+            char* grown = realloc(job->output, cap);
+            if (!grown) continue;
+            job->output = grown;
+            job->output_cap = cap;
+        }
+        memcpy(job->output + job->output_len, buffer, (size_t)got);
+        job->output_len += (size_t)got;
+    }
+}
+
+/* After a successful preprocess: keys the compile and restores the object if
+   the cache has it, replacing the job's output with the compiler's saved one */
+static int job_restore(CompileJob* job, const char* root, const char* preprocessed) {
+    char depfile[PATH_MAX], directory[PATH_MAX], object[PATH_MAX];
+    char** argv = NULL;
+    int hit = 0;
+    if (join(depfile, sizeof(depfile), root, job->depfile) && join(directory, sizeof(directory), root, job->unit->directory) &&
+        join(object, sizeof(object), root, job->object) && (argv = compile_argv(job, depfile, NULL)) != NULL &&
+        compile_cache_key(argv, directory, preprocessed, job->key)) {
+        char* output = NULL;
+        size_t output_len = 0;
+        hit = compile_cache_fetch(job->key, object, &output, &output_len);
+        if (hit) {
+            free(job->output);
+            job->output = output;
+            job->output_len = output_len;
+            job->output_cap = output_len;
+        }
+    }
+    free(argv);
+    return hit;
+}
+
+static int take_token(int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    char token;
+    return poll(&pfd, 1, 0) == 1 && read(fd, &token, 1) == 1;
+}
+
+static void give_token(int fd) {
+    char token = '+';
+    while (write(fd, &token, 1) < 0 && errno == EINTR) {}
+}
+
+/* Runs the stale jobs. The first runs on the driver's own implicit token;
+   every further one needs a token from the jobserver pipe. */
+static void run_jobs(CompileJob* jobs, int count, const char* root, int job_limit,
+                     diag_summary* diagnostics, build_stats* stats) {
+    CacheUse cache = { .enabled = compile_cache_enabled() };
+    int jobserver[2] = { -1, -1 };
+    if (job_limit > 1 && pipe(jobserver) == 0) {
+        for (int i = 1; i < job_limit; i++) give_token(jobserver[1]);
+    } else {
+        job_limit = 1;
+    }
+    char makeflags[128];
+    char** env = job_limit > 1 ? jobserver_environ(jobserver, job_limit, makeflags, sizeof(makeflags)) : NULL;
+
+    struct pollfd* fds = calloc((size_t)count + 1, sizeof(struct pollfd));
+    CompileJob** polled = calloc((size_t)count + 1, sizeof(CompileJob*));
+    int next = 0, running = 0, stop = 0;
+    while (fds && polled) {
+        while (!stop && next < count) {
+            CompileJob* job = &jobs[next];
+            if (!job->stale) {
+                next++;
+                continue;
+            }
+            int token = 0;
+            if (running > 0) {
+                if (job_limit == 1 || !take_token(jobserver[0])) break;
+                token = 1;
+            }
+            next++;
+            char preprocessed[PATH_MAX];
+            int phase = cache.enabled && compile_cache_scratch(preprocessed, sizeof(preprocessed), (int)(job - jobs))
+                            ? JOB_PREPROCESS : JOB_COMPILE;
+            if (!job_start(job, root, env, phase, phase == JOB_PREPROCESS ? preprocessed : NULL)) {
+                if (token) give_token(jobserver[1]);
+                stats->failed++;
+                stop = 1;
+                continue;
+            }
+            job->holds_token = token;
+            running++;
+        }
+        if (running == 0) break;
+
+        int nfds = 0;
+        for (int i = 0; i < next; i++) {
+            if (jobs[i].pid <= 0) continue;
+            fds[nfds] = (struct pollfd){ .fd = jobs[i].output_fd, .events = POLLIN };
+            polled[nfds++] = &jobs[i];
+        }
+        /* Tokens handed back by compilers' own sub-jobs wake us too */
+        int waiting_for_token = !stop && next < count && job_limit > 1;
+        if (waiting_for_token) fds[nfds] = (struct pollfd){ .fd = jobserver[0], .events = POLLIN };
+        if (poll(fds, (nfds_t)(nfds + waiting_for_token), -1) < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < nfds; i++) {
+            CompileJob* job = polled[i];
+            if (!fds[i].revents || !job_read(job)) continue;
+
+            close(job->output_fd);
+            int status = 0;
+            while (waitpid(job->pid, &status, 0) < 0 && errno == EINTR) {}
+            job->pid = 0;
+            int succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+            /* Preprocessed: restore from the cache, or compile on the same token.
+               A failed preprocess compiles too, so its errors come from the compiler. */
+            int cached = 0, skipped = 0;
+            if (job->phase == JOB_PREPROCESS) {
+                char preprocessed[PATH_MAX];
+                compile_cache_scratch(preprocessed, sizeof(preprocessed), (int)(job - jobs));
+                cached = succeeded && job_restore(job, root, preprocessed);
+                unlink(preprocessed);
+                if (!cached) {
+                    if (stop) {
+                        skipped = 1;   /* another unit failed meanwhile */
+                        job->output_len = 0;
+                    } else if (job_start(job, root, env, JOB_COMPILE, preprocessed)) {
+                        cache.misses++;
+                        continue;
+                    }
+                    succeeded = 0;
+                }
+            }
+            running--;
+            if (job->holds_token) give_token(jobserver[1]);
+            if (diagnostics && job->output_len > 0) {
+                diagnostics_feed(diagnostics, job->output, job->output_len);
+                diagnostics_finish(diagnostics);
+            }
+            if (skipped) {
+                continue;
+            } else if (succeeded && cached) {
+                job->recorded = job->command;
+                stats->cached++;
+            } else if (succeeded) {
+                job->recorded = job->command;
+                stats->compiled++;
+                if (job->key[0]) {
+                    char object[PATH_MAX];
+                    long long added = join(object, sizeof(object), root, job->object)
+                                          ? compile_cache_store(job->key, object, job->output, job->output_len) : 0;
+                    cache.stored += added > 0;
+                    cache.added += added;
+                }
+            } else {
+                stats->failed++;
+                stop = 1;   /* like make without -k: finish what runs, start nothing new */
+            }
+        }
+    }
+
+    if (cache.enabled) compile_cache_record(stats->cached, cache.misses, cache.stored, cache.added);
+    free(fds);
+    free(polled);
+    free(env);
+    if (jobserver[0] >= 0) {
+        close(jobserver[0]);
+        close(jobserver[1]);
+    }
+    stats->jobs = job_limit;
+}
+
+/* ── Public API ─────────────────────────────────────────────────────────── */
+
+int build_driver_compile(const char* dir, int force, diag_summary* diagnostics, build_stats* stats) {
+    build_stats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (!dir) dir = ".";
+
+    build_plan plan;
+    if (!build_plan_load(dir, &plan)) return 0;
+    char root[PATH_MAX];
+    CompileJob* jobs = calloc((size_t)plan.count, sizeof(CompileJob));
+    if (!realpath(dir, root) || !jobs) {
+        free(jobs);
+        build_plan_free(&plan);
+        return 0;
+    }
+    char state_dir[PATH_MAX], state_path[PATH_MAX + 32];
+    int len = snprintf(state_dir, sizeof(state_dir), "%s/%s", root, BUILD_STATE_DIR);
+    if (len < 0 || (size_t)len >= sizeof(state_dir)) {
+        free(jobs);
+        build_plan_free(&plan);
+        return 0;
+    }
+    snprintf(state_path, sizeof(state_path), "%s/%s", state_dir, BUILD_STATE_FILE);
+
+    long long start = trace_begin();
+    pthread_mutex_lock(&g_lock);
+    BuildState state = { 0 };
+    state_load(&state, state_path);
+    MtimeTable mtimes = { 0 };
+
+    for (int i = 0; i < plan.count; i++) {
+        CompileJob* job = &jobs[i];
+        const build_unit* unit = &plan.units[i];
+        job->unit = unit;
+        job->output_fd = -1;
+
+        /* cc -c x.c without -o writes x.o next to where it runs */
+        char object[512];
+        if (unit->output[0]) {
+            snprintf(object, sizeof(object), "%s", unit->output);
+        } else {
+            const char* name = strrchr(unit->source, '/');
+            name = name ? name + 1 : unit->source;
+            snprintf(object, sizeof(object), "%.*s.o", (int)(strrchr(name, '.') - name), name);
+        }
+        snprintf(job->target, sizeof(job->target), "%s", object);
+        if (!join(job->object, sizeof(job->object), unit->directory, object)) continue;
+        /* Same name the compiler gives -MMD output: build/x.o → build/x.d */
+        const char* dot = strrchr(job->object, '.');
+        const char* slash = strrchr(job->object, '/');
+        size_t stem = dot && (!slash || dot > slash) ? (size_t)(dot - job->object) : strlen(job->object);
+        snprintf(job->depfile, sizeof(job->depfile), "%.*s.d", (int)stem, job->object);
+
+        job->command = 1469598103934665603ULL;
+        for (int j = 0; j < unit->argc; j++) job->command = hash_bytes(job->command, unit->argv[j], strlen(unit->argv[j]) + 1);
+        job->stale = job_is_stale(job, &state, &mtimes, root) || force;
+        stats->stale += job->stale;
+    }
+    stats->units = plan.count;
+    stats->jobs = build_plan_jobs();
+    mtimes_free(&mtimes);
+    state_free(&state);
+
+    if (stats->stale > 0) run_jobs(jobs, plan.count, root, stats->jobs, diagnostics, stats);
+    state_save(jobs, plan.count, state_dir, state_path);
+    pthread_mutex_unlock(&g_lock);
+
+    for (int i = 0; i < plan.count; i++) free(jobs[i].output);
+    free(jobs);
+    build_plan_free(&plan);
+
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%d/%d compiled, %d cached", stats->compiled, stats->units, stats->cached);
+    trace_end("build_driver.compile", start, detail);
+    return 1;
+}
@@ -0,0 +1,408 @@
+#include "../include/build_plan.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define PLAN_MAX_WORDS 512
+#define PLAN_MAX_DEPTH 16
+
+typedef struct {
+    char* words[PLAN_MAX_WORDS];
+    int   count;
+} WordList;
+
+static void words_clear(WordList* list) {
+    for (int i = 0; i < list->count; i++) free(list->words[i]);
+    list->count = 0;
+}
+
+/* ── Shell words ────────────────────────────────────────────────────────── */
+
+/* Splits one command line into words with sh quoting rules. Separators
+   (&&, ||, ;, |, &) become the word "\x01" so segments can be told apart;
+   redirections are dropped together with their target. */
+static void split_words(const char* line, WordList* list) {
+    const char* p = line;
+    char word[4096];
+    while (*p && list->count < PLAN_MAX_WORDS) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0') break;
+
+        if (*p == ';' || *p == '|' || *p == '&') {
+            p += (p[1] == p[0] && *p != ';') ? 2 : 1;
+            list->words[list->count++] = strdup("\x01");
+            continue;
+        }
+        const char* redirect = p;
+        while (*redirect >= '0' && *redirect <= '9') redirect++;
+        if (*redirect == '>' || *redirect == '<') {
+            p = redirect + 1;
+            if (*p == '>') p++;
+            if (*p == '&') {
+                p++;
+                while (*p && *p != ' ' && *p != '\t') p++;
+                continue;
+            }
+            while (*p == ' ' || *p == '\t') p++;
+            while (*p && *p != ' ' && *p != '\t' && *p != ';' && *p != '&' && *p != '|') p++;
+            continue;
+        }
+
+        size_t len = 0;
+        while (*p && *p != ' ' && *p != '\t' && *p != ';' && *p != '&' && *p != '|') {
+            char c = *p++;
+            if (c == '\'') {
+                while (*p && *p != '\'') {
+                    if (len + 1 < sizeof(word)) word[len++] = *p;
+                    p++;
+                }
+                if (*p) p++;
+            } else if (c == '"') {
+                while (*p && *p != '"') {
+                    if (*p == '\\' && p[1] && strchr("\"\\$`", p[1])) p++;
+                    if (len + 1 < sizeof(word)) word[len++] = *p;
+                    p++;
+                }
+                if (*p) p++;
+            } else {
+                if (c == '\\' && *p) c = *p++;
+                if (len + 1 < sizeof(word)) word[len++] = c;
+            }
+        }
+        word[len] = '\0';
+        list->words[list->count++] = strdup(word);
+    }
+}
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/* gcc, cc, clang, g++, c++, clang++ with optional cross prefix
+   (x86_64-linux-gnu-gcc) and version suffix (gcc-12) */
+static int is_compiler(const char* word) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s", base_name(word));
+    char* dash = strrchr(name, '-');
+    if (dash && dash[1] && strspn(dash + 1, "0123456789.") == strlen(dash + 1)) *dash = '\0';
+
+    static const char* compilers[] = { "cc", "gcc", "clang", "c++", "g++", "clang++", NULL };
+    size_t len = strlen(name);
+    for (int i = 0; compilers[i]; i++) {
+        size_t clen = strlen(compilers[i]);
+        if (strcmp(name, compilers[i]) == 0) return 1;
+        if (len > clen + 1 && name[len - clen - 1] == '-' && strcmp(name + len - clen, compilers[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int is_launcher(const char* word) {
+    const char* name = base_name(word);
+    return strcmp(name, "ccache") == 0 || strcmp(name, "sccache") == 0 || strcmp(name, "distcc") == 0;
+}
+
+static int is_source(const char* word) {
+    const char* dot = strrchr(word, '.');
+    if (!dot || strchr(dot, '/')) return 0;
+    static const char* extensions[] = { ".c", ".cc", ".cpp", ".cxx", ".c++", ".C", ".m", ".mm", NULL };
+    for (int i = 0; extensions[i]; i++) {
+        if (strcmp(dot, extensions[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Options whose value is the next word */
+static int takes_value(const char* option) {
+    static const char* options[] = {
+        "-o", "-I", "-D", "-U", "-include", "-imacros", "-isystem", "-iquote", "-idirafter",
+        "-MF", "-MT", "-MQ", "-x", "-Xpreprocessor", "-Xassembler", "-Xlinker", "-L", "-arch",
+        "-isysroot", "-target", NULL
+    };
+    for (int i = 0; options[i]; i++) {
+        if (strcmp(option, options[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* ── Plan ───────────────────────────────────────────────────────────────── */
+
+static int join_path(char* out, size_t out_size, const char* dir, const char* path) {
+    int len = (path[0] == '/' || strcmp(dir, ".") == 0) ? snprintf(out, out_size, "%s", path)
+                                                        : snprintf(out, out_size, "%s/%s", dir, path);
+    return len >= 0 && (size_t)len < out_size;
+}
+
+static void plan_add(build_plan* plan, int* cap, const char* directory, char** words, int count) {
+    int first = 0;
+    while (first < count && is_launcher(words[first])) first++;
+    if (first >= count || !is_compiler(words[first])) return;
+
+    int compile_only = 0;
+    int sources = 0;
+    const char* source = NULL;
+    const char* output = "";
+    for (int i = first + 1; i < count; i++) {
+        if (strcmp(words[i], "-c") == 0) {
+            compile_only = 1;
+        } else if (strcmp(words[i], "-o") == 0 && i + 1 < count) {
+            output = words[++i];
+        } else if (takes_value(words[i])) {
+            i++;
+        } else if (words[i][0] != '-' && is_source(words[i])) {
+            source = words[i];
+            sources++;
+        }
+    }
+    if (!compile_only || sources != 1) return;
+
+    if (plan->count == *cap) {
+        int grown_cap = *cap ? *cap * 2 : 32;
+        build_unit* grown = realloc(plan->units, (size_t)grown_cap * sizeof(build_unit));
+        if (!grown) return;
+        plan->units = grown;
+        *cap = grown_cap;
+    }
+    build_unit* unit = &plan->units[plan->count];
+    memset(unit, 0, sizeof(*unit));
+    unit->argv = calloc((size_t)count + 1, sizeof(char*));
+    if (!unit->argv) return;
+    for (int i = 0; i < count; i++) {
+        unit->argv[i] = strdup(words[i]);
+        if (!unit->argv[i]) {
+            while (i-- > 0) free(unit->argv[i]);
+            free(unit->argv);
+            return;
+        }
+    }
+    unit->argc = count;
+    snprintf(unit->directory, sizeof(unit->directory), "%s", directory);
+    snprintf(unit->source, sizeof(unit->source), "%s", source);
+    snprintf(unit->output, sizeof(unit->output), "%s", output);
+    plan->count++;
+}
+
+/* "make[1]: Entering directory '/abs/path'" → /abs/path */
+static int directory_message(const char* line, const char* verb, char* out, size_t out_size) {
+    if (strncmp(line, "make", 4) != 0) return 0;
+    const char* found = strstr(line, verb);
+    if (!found) return 0;
+    const char* start = strpbrk(found, "'`");
+    if (!start) return 0;
+    start++;
+    const char* end = strrchr(start, '\'');
+    if (!end) return 0;
+    snprintf(out, out_size, "%.*s", (int)(end - start), start);
+    return 1;
+}
+
+/* Absolute directories from make become relative to the project root */
+static int relative_to(const char* root, const char* path, char* out, size_t out_size) {
+    size_t len = strlen(root);
+    if (strncmp(path, root, len) == 0 && path[len] == '/') path += len + 1;
+    else if (strcmp(path, root) == 0) path = ".";
+    int written = snprintf(out, out_size, "%s", path);
+    return written >= 0 && (size_t)written < out_size;
+}
+
+int build_plan_load(const char* dir, build_plan* plan) {
+    if (!plan) return 0;
+    plan->units = NULL;
+    plan->count = 0;
+    if (!dir) dir = ".";
+
+    char root[PATH_MAX];
+    if (!realpath(dir, root)) return 0;
+
+    /* Single-quote the directory for the shell */
+    char quoted[PATH_MAX * 2];
+    size_t q = 0;
+    quoted[q++] = '\'';
+    for (const char* c = root; *c && q + 5 < sizeof(quoted); c++) {
+        if (*c == '\'') {
+            memcpy(quoted + q, "'\\''", 4);
+            q += 4;
+        } else {
+            quoted[q++] = *c;
+        }
+    }
+    quoted[q++] = '\'';
+    quoted[q] = '\0';
+
+    char command[PATH_MAX * 2 + 64];
+    snprintf(command, sizeof(command), "make -nB -C %s 2>/dev/null", quoted);
+
+    long long start = trace_begin();
+    FILE* pipe = popen(command, "r");
+    if (!pipe) {
+        trace_end("build_plan.load", start, root);
+        return 0;
+    }
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+
+    char stack[PLAN_MAX_DEPTH][512];
+    int depth = 0;
+    snprintf(stack[0], sizeof(stack[0]), ".");
+
+    int cap = 0;
+    char* line = NULL;
+    size_t line_cap = 0;
+    char* joined = NULL;
+    size_t joined_len = 0;
+    ssize_t read;
+    while ((read = getline(&line, &line_cap, pipe)) != -1) {
+        while (read > 0 && (line[read - 1] == '\n' || line[read - 1] == '\r')) line[--read] = '\0';
+
+        /* Recipes continued with a trailing backslash arrive on several lines */
+        char* grown = realloc(joined, joined_len + (size_t)read + 2);
+        if (!grown) break;
+        joined = grown;
+        memcpy(joined + joined_len, line, (size_t)read + 1);
+        joined_len += (size_t)read;
+        if (joined_len > 0 && joined[joined_len - 1] == '\\') {
+            joined[joined_len - 1] = ' ';
+            continue;
+        }
+        joined_len = 0;
+
+        char message[PATH_MAX];
+        if (directory_message(joined, "Entering directory", message, sizeof(message))) {
+            if (depth + 1 < PLAN_MAX_DEPTH && relative_to(root, message, stack[depth + 1], sizeof(stack[depth + 1]))) {
+                depth++;
+            }
+            continue;
+        }
+        if (directory_message(joined, "Leaving directory", message, sizeof(message))) {
+            if (depth > 0) depth--;
+            continue;
+        }
+
+        WordList words = { .count = 0 };
+        split_words(joined, &words);
+        char directory[512];
+        snprintf(directory, sizeof(directory), "%s", stack[depth]);
+        int segment = 0;
+        for (int i = 0; i <= words.count; i++) {
+            if (i < words.count && strcmp(words.words[i], "\x01") != 0) continue;
+            int count = i - segment;
+            if (count >= 2 && strcmp(words.words[segment], "cd") == 0) {
+                char next[512];
+                if (join_path(next, sizeof(next), directory, words.words[segment + 1])) {
+                    memcpy(directory, next, sizeof(directory));
+                }
+            } else if (count > 0) {
+                plan_add(plan, &cap, directory, words.words + segment, count);
+            }
+            segment = i + 1;
+        }
+        words_clear(&words);
+    }
+    free(line);
+    free(joined);
+    pclose(pipe);
+
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%d units", plan->count);
+    trace_end("build_plan.load", start, detail);
+    return plan->count > 0;
+}
+
+int build_plan_jobs(void) {
+    const char* configured = getenv("JARVIS_BUILD_JOBS");
+    long jobs = configured ? strtol(configured, NULL, 10) : 0;
+    if (jobs <= 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs <= 0) jobs = 1;
+    return jobs > 64 ? 64 : (int)jobs;
+}
+
+/* ── Depfiles ───────────────────────────────────────────────────────────── */
+
+int build_plan_read_depfile(const char* path, const char* directory, char*** deps, int* count) {
+    *deps = NULL;
+    *count = 0;
+    FILE* in = fopen(path, "r");
+    if (!in) return 0;
+    int cap = 16;
+    *deps = calloc((size_t)cap, sizeof(char*));
+    if (!*deps) {
+        fclose(in);
+        return 0;
+    }
+
+    /* Only the first rule: -MP adds empty "header:" rules after it */
+    int in_prereqs = 0, ok = 1;
+    char word[PATH_MAX];
+    size_t len = 0;
+    while (ok) {
+        int c = fgetc(in);
+        if (c == '\\') {
+            int escaped = fgetc(in);
+            if (escaped == '\n' || escaped == EOF) c = ' ';
+            else if (escaped == ' ' || escaped == '#' || escaped == '\\') c = escaped | 0x100;
+            else ungetc(escaped, in);
+        } else if (c == '$') {
+            int next = fgetc(in);
+            if (next != '$') ungetc(next, in);
+        }
+        int separator = c == EOF || c == ' ' || c == '\t' || c == '\n';
+        if (!in_prereqs) {
+            if (c == ':') in_prereqs = 1;
+            if (c == EOF) break;
+            continue;
+        }
+        if (!separator) {
+            if (len + 1 < sizeof(word)) word[len++] = (char)(c & 0xff);
+            continue;
+        }
+        if (len > 0) {
+            word[len] = '\0';
+            len = 0;
+            if (*count == cap) {
+                char** grown = realloc(*deps, (size_t)cap * 2 * sizeof(char*));
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                *deps = grown;
+                cap *= 2;
+            }
+            char joined[PATH_MAX];
+            if (!join_path(joined, sizeof(joined), directory ? directory : ".", word) ||
+                ((*deps)[*count] = strdup(joined)) == NULL) {
+                ok = 0;
+                break;
+            }
+            (*count)++;
+        }
+        if (c == EOF || c == '\n') break;
+    }
+    fclose(in);
+    if (!ok || *count == 0) {
+        build_plan_free_deps(*deps, *count);
+        *deps = NULL;
+        *count = 0;
+        return 0;
+    }
+    return 1;
+}
+
+void build_plan_free_deps(char** deps, int count) {
+    if (!deps) return;
+    for (int i = 0; i < count; i++) free(deps[i]);
+    free(deps);
+}
+
+void build_plan_free(build_plan* plan) {
+    if (!plan) return;
+    for (int i = 0; i < plan->count; i++) {
+        for (int j = 0; j < plan->units[i].argc; j++) free(plan->units[i].argv[j]);
+        free(plan->units[i].argv);
+    }
+    free(plan->units);
+    plan->units = NULL;
+    plan->count = 0;
+}
@@ -0,0 +1,228 @@
+#include "../include/client.h"
+#include "../include/server.h"
+#include "../include/json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define CLIENT_CONNECT_TIMEOUT_MS 3000
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+/* Returns a connected socket, or -1 with errno from connect() */
+static int connect_socket(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+static int daemon_missing(int err) {
+    return err == ENOENT || err == ECONNREFUSED;
+}
+
+/* Resolves the running binary so the daemon is the same build as the client */
+static void self_executable(const char* program, char* out, size_t out_size) {
+#ifdef __linux__
+    ssize_t len = readlink("/proc/self/exe", out, out_size - 1);
+    if (len > 0) {
+        out[len] = '\0';
+        return;
+    }
+#endif
+    snprintf(out, out_size, "%s", program);
+}
+
+/* Double-forks a detached `program --serve path` */
+static int spawn_daemon(const char* program, const char* path) {
+    char exe[PATH_MAX];
+    self_executable(program, exe, sizeof(exe));
+
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        setsid();
+        if (fork() != 0) _exit(0);
+
+        int devnull = open("/dev/null", O_RDWR);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            if (devnull > STDERR_FILENO) close(devnull);
+        }
+        execl(exe, exe, "--serve", path, (char*)NULL);
+        _exit(127);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return 1;
+}
+
+/* Connects, starting the daemon on first use; serialised by a lock file so
+   concurrent clients don't race to start several daemons */
+static int connect_or_start(const char* program, const char* path) {
+    int fd = connect_socket(path);
+    if (fd >= 0 || !daemon_missing(errno)) return fd;
+
+    const char* no_autostart = getenv("JARVIS_NO_AUTOSTART");
+    if (no_autostart && strcmp(no_autostart, "1") == 0) return -1;
+
+    char lock_path[PATH_MAX];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    int lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd >= 0) flock(lock_fd, LOCK_EX);
+
+    fd = connect_socket(path);
+    if (fd < 0 && daemon_missing(errno) && spawn_daemon(program, path)) {
+        int waited = 0;
+        int delay = 5;
+        while (fd < 0 && waited < CLIENT_CONNECT_TIMEOUT_MS) {
+            sleep_ms(delay);
+            waited += delay;
+            if (delay < 200) delay *= 2;
+            fd = connect_socket(path);
+        }
+    }
+
+    if (lock_fd >= 0) {
+        flock(lock_fd, LOCK_UN);
+        close(lock_fd);
+    }
+    return fd;
+}
+
+/* Sends the command with the client's working directory, so builds, git and
+   file commands act on the project the user is in rather than the daemon's */
+static int send_request(int fd, const char* command) {
+    char* frame = NULL;
+    size_t frame_len = 0;
+    FILE* out = open_memstream(&frame, &frame_len);
+    if (!out) return 0;
+
+    char cwd[PATH_MAX];
+    fputs("{\"command\":", out);
+    json_write_string(out, command);
+    if (getcwd(cwd, sizeof(cwd))) {
+        fputs(",\"cwd\":", out);
+        json_write_string(out, cwd);
+    }
+    fputs("}\n", out);
+    fclose(out);
+    if (!frame) return 0;
+
+    const char* p = frame;
+    size_t left = frame_len;
+    while (left > 0) {
+        ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            free(frame);
+            return 0;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    free(frame);
+    shutdown(fd, SHUT_WR);
+    return 1;
+}
+
+/* Reads the single reply line; returns a malloc'd string or NULL */
+static char* read_reply(int fd) {
+    size_t cap = 4096;
+    size_t len = 0;
+    char* reply = malloc(cap);
+    if (!reply) return NULL;
+
+    while (1) {
+        if (len + 1 >= cap) {
+            char* grown = realloc(reply, cap * 2);
+            if (!grown) break;
+            reply = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, reply + len, cap - len - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += (size_t)n;
+        if (memchr(reply + len - n, '\n', (size_t)n)) break;
+    }
+
+    reply[len] = '\0';
+    if (len == 0) {
+        free(reply);
+        return NULL;
+    }
+    return reply;
+}
+
+int client_main(const char* program, const char* command) {
+    if (!command || command[0] == '\0') {
+        fprintf(stderr, "Usage: %s -c \"command\"\n", program);
+        return EXIT_FAILURE;
+    }
+
+    char path[256];
+    server_default_socket_path(path, sizeof(path));
+
+    int fd = connect_or_start(program, path);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot reach the JARVIS daemon at %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char* reply = NULL;
+    if (send_request(fd, command)) reply = read_reply(fd);
+    close(fd);
+    if (!reply) {
+        fprintf(stderr, "No reply from the JARVIS daemon\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t text_size = strlen(reply) + 1;
+    char* text = malloc(text_size);
+    char status_raw[32];
+    int exit_code = EXIT_FAILURE;
+
+    if (text && json_get_string(reply, "response", text, text_size)) {
+        printf("%s\n", text);
+        exit_code = json_get_raw(reply, "status", status_raw, sizeof(status_raw))
+                    ? atoi(status_raw) & 0xFF : EXIT_SUCCESS;
+    } else if (text && json_get_string(reply, "error", text, text_size)) {
+        fprintf(stderr, "JARVIS daemon error: %s\n", text);
+    } else {
+        fprintf(stderr, "Malformed reply from the JARVIS daemon\n");
+    }
+
+    free(text);
+    free(reply);
+    return exit_code;
+}
@@ -0,0 +1,544 @@
+#include "../include/code_search.h"
+#include "../include/dir_walk.h"
+#include "../include/gitignore.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SEARCH_MAX_ALTERNATIVES 16
+#define SEARCH_MAX_NODES        128
+#define SEARCH_LITERAL_MAX      64
+#define SEARCH_MAX_FILE_BYTES   (64LL * 1024 * 1024)
+#define SEARCH_BINARY_PROBE     8192
+
+/* ── Pattern compiler ───────────────────────────────────────────────────── */
+
+typedef enum { NODE_CHAR, NODE_ANY, NODE_CLASS, NODE_BOL, NODE_EOL, NODE_WORD_BOUNDARY } NodeType;
+
+typedef struct {
+    NodeType      type;
+    char          quantifier;    /* 0, '*', '+' or '?' */
+    unsigned char c;             /* NODE_CHAR, lowercased when ignoring case */
+    unsigned char set[32];       /* NODE_CLASS bitmap */
+} Node;
+
+typedef struct {
+    Node   nodes[SEARCH_MAX_NODES];
+    int    count;
+    char   literal[SEARCH_LITERAL_MAX];   /* longest run every match must contain */
+    size_t literal_len;
+    size_t rare;                          /* index of the rarest byte of the literal */
+} Alternative;
+
+typedef struct {
+    Alternative alts[SEARCH_MAX_ALTERNATIVES];
+    int         count;
+    int         ignore_case;
+    int         prefilter;                /* every alternative has a literal */
+    int         pure_literal;             /* a literal hit is a match */
+} Pattern;
+
+static void set_bit(unsigned char* set, unsigned char c) {
+    set[c >> 3] |= (unsigned char)(1u << (c & 7));
+}
+
+static int has_bit(const unsigned char* set, unsigned char c) {
+    return (set[c >> 3] >> (c & 7)) & 1;
+}
+
+static void fill_class(unsigned char* set, char kind) {
+    for (int c = 0; c < 256; c++) {
+        int in = (kind == 'd' && isdigit(c)) || (kind == 'w' && (isalnum(c) || c == '_')) || (kind == 's' && isspace(c));
+        if (in) set_bit(set, (unsigned char)c);
+    }
+}
+
+static void invert_class(unsigned char* set) {
+    for (int i = 0; i < 32; i++) set[i] = (unsigned char)~set[i];
+}
+
+/* Parses [...] at *p into node; returns 0 if unterminated */
+static int parse_class(const char** p, Node* node) {
+    const char* s = *p + 1;
+    int negate = *s == '^';
+    if (negate) s++;
+    node->type = NODE_CLASS;
+    memset(node->set, 0, sizeof(node->set));
+
+    int first = 1;
+    while (*s && (*s != ']' || first)) {
+        first = 0;
+        if (*s == '\\' && s[1]) {
+            char e = s[1];
+            if (e == 'd' || e == 'w' || e == 's') fill_class(node->set, e);
+            else set_bit(node->set, (unsigned char)e);
+            s += 2;
+            continue;
+        }
+        unsigned char low = (unsigned char)*s;
+        unsigned char high = low;
+        if (s[1] == '-' && s[2] && s[2] != ']') {
+            high = (unsigned char)s[2];
+            s += 2;
+        }
+        for (int c = low; c <= high; c++) set_bit(node->set, (unsigned char)c);
+        s++;
+    }
+    if (*s != ']') return 0;
+    if (negate) invert_class(node->set);
+    *p = s + 1;
+    return 1;
+}
+
+static void parse_escape(char e, Node* node) {
+    switch (e) {
+        case 'b':
+            node->type = NODE_WORD_BOUNDARY;
+            break;
+        case 'd': case 'w': case 's': case 'D': case 'W': case 'S':
+            node->type = NODE_CLASS;
+            memset(node->set, 0, sizeof(node->set));
+            fill_class(node->set, (char)tolower((unsigned char)e));
+            if (isupper((unsigned char)e)) invert_class(node->set);
+            break;
+        case 't':
+            node->type = NODE_CHAR;
+            node->c = '\t';
+            break;
+        default:
+            node->type = NODE_CHAR;
+            node->c = (unsigned char)e;
+            break;
+    }
+}
+
+/* How common a byte is in source code; lower is rarer */
+static int byte_frequency(unsigned char c) {
+    static const char common[] = "etaoinsrlcdupmhfgbyvwkxqjz";
+    if (c == ' ' || c == '\t' || c == '\n') return 255;
+    if (islower(c)) return 200 - (int)(strchr(common, c) - common) * 4;
+    if (strchr("(){};,=*_.->\"'/", c)) return 120;
+    if (isdigit(c)) return 80;
+    if (isupper(c)) return 60;
+    return 20;
+}
+
+static void choose_literal(Alternative* alt) {
+    size_t best_start = 0, best_len = 0, run_start = 0, run_len = 0;
+    for (int i = 0; i <= alt->count; i++) {
+        const Node* node = i < alt->count ? &alt->nodes[i] : NULL;
+        int extends = node && node->type == NODE_CHAR && (node->quantifier == 0 || node->quantifier == '+');
+        if (extends) {
+            if (run_len == 0) run_start = (size_t)i;
+            run_len++;
+        }
+        /* a+ contributes its first 'a' but the run cannot continue past it */
+        if (!extends || node->quantifier == '+') {
+            if (run_len > best_len) {
+                best_start = run_start;
+                best_len = run_len;
+            }
+            run_len = 0;
+        }
+    }
+    if (best_len > SEARCH_LITERAL_MAX) best_len = SEARCH_LITERAL_MAX;
+
+    alt->literal_len = best_len;
+    alt->rare = 0;
+    for (size_t i = 0; i < best_len; i++) {
+        alt->literal[i] = (char)alt->nodes[best_start + i].c;
+        if (byte_frequency((unsigned char)alt->literal[i]) < byte_frequency((unsigned char)alt->literal[alt->rare])) alt->rare = i;
+    }
+}
+
+static int compile_pattern(const char* text, int ignore_case, Pattern* pattern) {
+    memset(pattern, 0, sizeof(*pattern));
+    pattern->ignore_case = ignore_case;
+    pattern->count = 1;
+    Alternative* alt = &pattern->alts[0];
+
+    for (const char* p = text; *p;) {
+        if (*p == '|') {
+            if (pattern->count == SEARCH_MAX_ALTERNATIVES) return 0;
+            alt = &pattern->alts[pattern->count++];
+            p++;
+            continue;
+        }
+        if (*p == '*' || *p == '+' || *p == '?') {
+            Node* previous = alt->count > 0 ? &alt->nodes[alt->count - 1] : NULL;
+            if (previous && previous->quantifier == 0 &&
+                (previous->type == NODE_CHAR || previous->type == NODE_ANY || previous->type == NODE_CLASS)) {
+                previous->quantifier = *p++;
+                continue;
+            }
+            /* nothing to repeat: take it literally */
+        }
+        if (alt->count == SEARCH_MAX_NODES) return 0;
+
+        Node* node = &alt->nodes[alt->count];
+        memset(node, 0, sizeof(*node));
+        if (*p == '.') {
+            node->type = NODE_ANY;
+            p++;
+        } else if (*p == '^') {
+            node->type = NODE_BOL;
+            p++;
+        } else if (*p == '$') {
+            node->type = NODE_EOL;
+            p++;
+        } else if (*p == '[') {
+            if (!parse_class(&p, node)) return 0;
+        } else if (*p == '\\') {
+            if (p[1] == '\0') return 0;
+            parse_escape(p[1], node);
+            p += 2;
+        } else {
+            node->type = NODE_CHAR;
+            node->c = (unsigned char)*p++;
+        }
+
+        if (ignore_case && node->type == NODE_CHAR) node->c = (unsigned char)tolower(node->c);
+        if (ignore_case && node->type == NODE_CLASS) {
+            for (int c = 0; c < 256; c++) {
+                if (has_bit(node->set, (unsigned char)c)) {
+                    set_bit(node->set, (unsigned char)tolower(c));
+                    set_bit(node->set, (unsigned char)toupper(c));
+                }
+            }
+        }
+        alt->count++;
+    }
+
+    pattern->prefilter = 1;
+    for (int i = 0; i < pattern->count; i++) {
+        choose_literal(&pattern->alts[i]);
+        if (pattern->alts[i].literal_len == 0) pattern->prefilter = 0;
+    }
+
+    const Alternative* only = &pattern->alts[0];
+    pattern->pure_literal = pattern->count == 1 && only->count > 0 && (size_t)only->count == only->literal_len;
+    for (int i = 0; pattern->pure_literal && i < only->count; i++) {
+        pattern->pure_literal = only->nodes[i].type == NODE_CHAR && only->nodes[i].quantifier == 0;
+    }
+    return only->count > 0 || pattern->count > 1;
+}
+
+/* ── Matcher (backtracking, one line at a time) ─────────────────────────── */
+
+static int is_word_byte(unsigned char c) {
+    return isalnum(c) || c == '_';
+}
+
+static int node_matches(const Node* node, unsigned char c, int ignore_case) {
+    switch (node->type) {
+        case NODE_CHAR:  return (ignore_case ? (unsigned char)tolower(c) : c) == node->c;
+        case NODE_ANY:   return 1;
+        case NODE_CLASS: return has_bit(node->set, c);
+        default:         return 0;
+    }
+}
+
+static int match_here(const Node* nodes, int count, int ignore_case, const char* line, const char* s, const char* end) {
+    if (count == 0) return 1;
+    const Node* node = nodes;
+
+    switch (node->type) {
+        case NODE_BOL:
+            return s == line && match_here(nodes + 1, count - 1, ignore_case, line, s, end);
+        case NODE_EOL:
+            return s == end && match_here(nodes + 1, count - 1, ignore_case, line, s, end);
+        case NODE_WORD_BOUNDARY: {
+            int before = s > line && is_word_byte((unsigned char)s[-1]);
+            int after = s < end && is_word_byte((unsigned char)*s);
+            return before != after && match_here(nodes + 1, count - 1, ignore_case, line, s, end);
+        }
+        default:
+            break;
+    }
+
+    if (node->quantifier == 0) {
+        return s < end && node_matches(node, (unsigned char)*s, ignore_case) &&
+               match_here(nodes + 1, count - 1, ignore_case, line, s + 1, end);
+    }
+    if (node->quantifier == '?') {
+        if (s < end && node_matches(node, (unsigned char)*s, ignore_case) &&
+            match_here(nodes + 1, count - 1, ignore_case, line, s + 1, end)) return 1;
+        return match_here(nodes + 1, count - 1, ignore_case, line, s, end);
+    }
+
+    /* '*' and '+': greedy, then give back */
+    size_t run = 0;
+    while (s + run < end && node_matches(node, (unsigned char)s[run], ignore_case)) run++;
+    size_t min = node->quantifier == '+' ? 1 : 0;
+    for (size_t take = run + 1; take-- > min;) {
+        if (match_here(nodes + 1, count - 1, ignore_case, line, s + take, end)) return 1;
+    }
+    return 0;
+}
+
+static int line_matches(const Pattern* pattern, const char* line, const char* end) {
+    for (int i = 0; i < pattern->count; i++) {
+        const Alternative* alt = &pattern->alts[i];
+        int anchored = alt->count > 0 && alt->nodes[0].type == NODE_BOL;
+        for (const char* s = line; s <= end; s++) {
+            if (match_here(alt->nodes, alt->count, pattern->ignore_case, line, s, end)) return 1;
+            if (anchored) break;
+        }
+    }
+    return 0;
+}
+
+/* ── Literal prefilter ──────────────────────────────────────────────────── */
+
+static int literal_at(const char* at, const Alternative* alt, int ignore_case) {
+    for (size_t i = 0; i < alt->literal_len; i++) {
+        unsigned char c = (unsigned char)at[i];
+        if ((ignore_case ? (unsigned char)tolower(c) : c) != (unsigned char)alt->literal[i]) return 0;
+    }
+    return 1;
+}
+
+/* First occurrence of the alternative's literal in [hay, end). Candidates
+   must match both the first byte and the rarest byte, sixteen starting
+   positions at a time. */
+static const char* find_literal(const char* hay, const char* end, const Alternative* alt, int ignore_case) {
+    size_t len = alt->literal_len;
+    if ((size_t)(end - hay) < len) return NULL;
+    const char* last = end - len;
+    unsigned char first = (unsigned char)alt->literal[0];
+    unsigned char rare = (unsigned char)alt->literal[alt->rare];
+    unsigned char first_other = ignore_case ? (unsigned char)toupper(first) : first;
+    unsigned char rare_other = ignore_case ? (unsigned char)toupper(rare) : rare;
+
+#ifdef __SSE2__
+    const __m128i first_lo = _mm_set1_epi8((char)first);
+    const __m128i first_up = _mm_set1_epi8((char)first_other);
+    const __m128i rare_lo = _mm_set1_epi8((char)rare);
+    const __m128i rare_up = _mm_set1_epi8((char)rare_other);
+    while (last - hay >= 15) {
+        __m128i a = _mm_loadu_si128((const __m128i*)hay);
+        __m128i b = _mm_loadu_si128((const __m128i*)(hay + alt->rare));
+        __m128i hits = _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi8(a, first_lo), _mm_cmpeq_epi8(a, first_up)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(b, rare_lo), _mm_cmpeq_epi8(b, rare_up)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        while (mask) {
+            const char* candidate = hay + __builtin_ctz(mask);
+            if (literal_at(candidate, alt, ignore_case)) return candidate;
+            mask &= mask - 1;
+        }
+        hay += 16;
+    }
+#endif
+
+    if (!ignore_case) {
+        /* memchr on the rare byte, then verify */
+        for (const char* p = hay + alt->rare; p < end;) {
+            p = memchr(p, rare, (size_t)(end - p));
+            if (!p) return NULL;
+            const char* candidate = p - alt->rare;
+            if (candidate > last) return NULL;
+            if (literal_at(candidate, alt, 0)) return candidate;
+            p++;
+        }
+        return NULL;
+    }
+    for (; hay <= last; hay++) {
+        if (literal_at(hay, alt, 1)) return hay;
+    }
+    return NULL;
+}
+
+/* ── Tree search ────────────────────────────────────────────────────────── */
+
+typedef struct {
+    const Pattern*             pattern;
+    const code_search_options* options;
+    gitignore*                 ignore;
+    size_t                     root_len;
+    code_match*                out;
+    int                        max;
+    int                        count;
+    int                        truncated;
+    pthread_mutex_t            lock;
+} SearchState;
+
+static const char* relative_path(const SearchState* state, const char* path) {
+    const char* relative = path + state->root_len;
+    return *relative == '/' ? relative + 1 : relative;
+}
+
+/* Stores one match; returns 0 once the output is full */
+static int record_match(SearchState* state, const char* relative, int line, const char* start, const char* end) {
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+
+    pthread_mutex_lock(&state->lock);
+    int stored = state->count < state->max;
+    if (stored) {
+        code_match* match = &state->out[state->count++];
+        snprintf(match->path, sizeof(match->path), "%s", relative);
+        match->line = line;
+        size_t len = (size_t)(end - start) < sizeof(match->text) - 1 ? (size_t)(end - start) : sizeof(match->text) - 1;
+        memcpy(match->text, start, len);
+        match->text[len] = '\0';
+    } else {
+        state->truncated = 1;
+    }
+    pthread_mutex_unlock(&state->lock);
+    return stored;
+}
+
+static int count_newlines(const char* start, const char* end) {
+    int lines = 0;
+    while (start < end && (start = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        lines++;
+        start++;
+    }
+    return lines;
+}
+
+/* Scans one file; returns 0 when the whole search should stop */
+static int search_buffer(SearchState* state, const char* relative, const char* data, size_t size) {
+    size_t probe = size < SEARCH_BINARY_PROBE ? size : SEARCH_BINARY_PROBE;
+    if (memchr(data, '\0', probe)) return 1;
+
+    const Pattern* pattern = state->pattern;
+    const char* end = data + size;
+    const char* pos = data;              /* always a line start */
+    int line = 1;
+    int kept = 0;
+    int per_file = state->options ? state->options->max_per_file : 0;
+    const char* next_hit[SEARCH_MAX_ALTERNATIVES] = { 0 };
+
+    while (pos < end) {
+        const char* line_start = pos;
+        const char* line_end;
+
+        if (pattern->prefilter) {
+            /* Jump to the line holding the earliest literal hit of any alternative */
+            const char* hit = NULL;
+            for (int i = 0; i < pattern->count; i++) {
+                if (next_hit[i] != end && (!next_hit[i] || next_hit[i] < pos)) {
+                    next_hit[i] = find_literal(pos, end, &pattern->alts[i], pattern->ignore_case);
+                    if (!next_hit[i]) next_hit[i] = end;
+                }
+                if (next_hit[i] != end && (!hit || next_hit[i] < hit)) hit = next_hit[i];
+            }
+            if (!hit) break;
+            line_start = hit;
+            while (line_start > pos && line_start[-1] != '\n') line_start--;
+            line += count_newlines(pos, line_start);
+        }
+        line_end = memchr(line_start, '\n', (size_t)(end - line_start));
+        if (!line_end) line_end = end;
+
+        if (pattern->pure_literal || line_matches(pattern, line_start, line_end)) {
+            if (per_file > 0 && kept == per_file) {
+                pthread_mutex_lock(&state->lock);
+                state->truncated = 1;
+                pthread_mutex_unlock(&state->lock);
+                return 1;
+            }
+            if (!record_match(state, relative, line, line_start, line_end)) return 0;
+            kept++;
+        }
+        pos = line_end + 1;
+        line++;
+    }
+    return 1;
+}
+
+static int search_file(const char* path, size_t name_offset, int worker, void* ctx) {
+    (void)name_offset;
+    (void)worker;
+    SearchState* state = ctx;
+    const char* relative = relative_path(state, path);
+    if (gitignore_ignored(state->ignore, relative, 0)) return 1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > SEARCH_MAX_FILE_BYTES) {
+        close(fd);
+        return 1;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 1;
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    int keep_going = search_buffer(state, relative, data, (size_t)st.st_size);
+    munmap(data, (size_t)st.st_size);
+    return keep_going;
+}
+
+static void load_dir_rules(const char* path, int worker, void* ctx) {
+    (void)worker;
+    SearchState* state = ctx;
+    const char* relative = relative_path(state, path);
+    if (relative[0] != '\0') gitignore_add_dir(state->ignore, relative);
+}
+
+static int accept_dir(const char* path, size_t name_offset, void* ctx) {
+    (void)name_offset;
+    SearchState* state = ctx;
+    return !gitignore_ignored(state->ignore, relative_path(state, path), 1);
+}
+
+static int compare_matches(const void* a, const void* b) {
+    const code_match* x = a;
+    const code_match* y = b;
+    int cmp = strcmp(x->path, y->path);
+    return cmp != 0 ? cmp : x->line - y->line;
+}
+
+int code_search(const char* root, const char* pattern_text, const code_search_options* options,
+                code_match* out, int max, int* truncated) {
+    if (truncated) *truncated = 0;
+    if (!root || !pattern_text || !out || max <= 0) return 0;
+
+    Pattern* pattern = malloc(sizeof(Pattern));
+    if (!pattern) return 0;
+    if (!compile_pattern(pattern_text, options && options->ignore_case, pattern)) {
+        free(pattern);
+        return -1;
+    }
+
+    char resolved[PATH_MAX];
+    if (!realpath(root, resolved)) {
+        free(pattern);
+        return 0;
+    }
+
+    long long start = trace_begin();
+    SearchState state = { pattern, options, gitignore_load(resolved), strlen(resolved), out, max, 0, 0,
+                          PTHREAD_MUTEX_INITIALIZER };
+    dir_walk_options walk = { 0 };
+    walk.visit_file = search_file;
+    walk.visit_dir = load_dir_rules;
+    walk.accept_dir = accept_dir;
+    walk.ctx = &state;
+    walk.threads = options ? options->threads : 0;
+    const char* roots[1] = { resolved };
+    dir_walk(roots, 1, &walk);
+
+    qsort(out, (size_t)state.count, sizeof(code_match), compare_matches);
+    if (truncated) *truncated = state.truncated;
+    trace_end("code_search", start, pattern_text);
+
+    gitignore_free(state.ignore);
+    free(pattern);
+    return state.count;
+}
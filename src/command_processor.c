@@ -1,5 +1,21 @@
 #include "../include/command_processor.h"
 #include "../include/search.h"
+#include "../include/session.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include "../include/result_cache.h"
+#include "../include/knowledge.h"
+#include "../include/symbol_index.h"
+#include "../include/code_search.h"
+#include "../include/warning_cache.h"
+#include "../include/diagnostics.h"
+#include "../include/build_plan.h"
+#include "../include/build_driver.h"
+#include "../include/compile_cache.h"
+#include "../include/git_status.h"
+#include "../include/project_status.h"
+#include "../include/routine.h"
+#include "../include/project_watch.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,6 +24,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 // Forward declarations for new developer tools
 void execute_dev_command(const char* command, char* response, int response_size);
@@ -15,9 +32,18 @@ void execute_dev_search(const char* command, char* response, int response_size);
 void execute_project_management(const char* command, char* response, int response_size);
 
 static int run_command_capture(const char* shell_cmd, char* response, int response_size, int max_lines);
+static int run_build_capture(const char* shell_cmd, char* response, int response_size, int tail_lines,
+                             diag_summary* carried);
+static void execute_build_command(int force, char* response, int response_size);
 static void execute_daily_workflow_command(const char* command, char* response, int response_size);
+static void execute_project_dashboard_command(char* response, int response_size);
+static int is_routine_request(const char* lower_cmd);
+static void execute_routine_command(const char* command, char* response, int response_size);
+static void execute_watch_command(const char* command, char* response, int response_size);
 static void execute_c_workflow_command(const char* command, char* response, int response_size);
-static void execute_code_navigation_command(const char* command, char* response, int response_size);
+static int is_code_navigation_request(const char* lower_cmd);
+static void execute_code_search(const char* pattern, const char* label, char* response, int response_size);
+static void execute_code_navigation_command(const char* command, const char* lower_cmd, char* response, int response_size);
 static int extract_identifier_after_keyword(const char* command, const char* keyword, char* out, size_t out_size);
 static int create_c_module_scaffold(const char* module_name, char* response, int response_size);
 static int update_makefile_for_module(const char* module_name, char* error_message, int error_message_size);
@@ -49,13 +75,58 @@ static void launch_jarvis_ui_command(char* response, int response_size);
 static int is_ai_brain_request(const char* command);
 static void execute_ai_brain_command(const char* command, char* response, int response_size);
 
+static const result_cache_policy g_weather_cache = { "weather", 600, 60, 60 };
+
+/* One-line summary from wttr.in (JARVIS_WEATHER_URL points elsewhere, e.g. a test stub) */
+static int fetch_weather(const char* key, char* out, size_t out_size) {
+    (void)key;
+    const char* url = getenv("JARVIS_WEATHER_URL");
+    if (!url || url[0] == '\0') url = "wttr.in/?format=3";
+    if (strchr(url, '\'')) return 0;
+
+    char command[600];
+    snprintf(command, sizeof(command), "curl -s --max-time 5 '%s' 2>/dev/null", url);
+    FILE* wfp = popen(command, "r");
+    if (!wfp) return 0;
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+
+    out[0] = '\0';
+    if (fgets(out, (int)out_size, wfp) != NULL) out[strcspn(out, "\n")] = '\0';
+    pclose(wfp);
+    return strlen(out) > 4;
+}
+
+static const char* c_workflow_intent(const char* command) {
+    if (strstr(command, "create c module") || strstr(command, "scaffold module")) return "module_scaffold";
+    if (strstr(command, "run tests") || strstr(command, "test project")) return "test";
+    if (strstr(command, "warnings")) return "warnings";
+    if (strstr(command, "build cache")) return "build_cache";
+    return "build";
+}
+
 /**
  * Processes a voice command and executes appropriate action
  */
 char* process_command(const char* command) {
+    return process_command_ex(command, NULL);
+}
+
+/**
+ * Processes a voice command and reports the routed intent and action status
+ */
+char* process_command_ex(const char* command, command_result* result) {
+    long long span = trace_begin();
+    const char* intent = "unknown";
+    session_current()->last_action_status = 0;
+    if (result) {
+        result->intent = "empty";
+        result->status = 0;
+    }
+
     if (!command || strlen(command) == 0) {
         char* response = (char*)malloc(256);
-        strcpy(response, "I didn't catch that. Please say it again.");
+        if (response) strcpy(response, "I didn't catch that. Please say it again.");
+        trace_end("process_command", span, "empty");
         return response;
     }
 
@@ -96,19 +167,61 @@ char* process_command(const char* command) {
         }
     }
 
+    // Tracing: write the span buffers now instead of waiting for exit
+    if (command_contains(lower_cmd, "save trace") || command_contains(lower_cmd, "dump trace")) {
+        intent = "trace";
+        if (!trace_enabled()) {
+            strcpy(response, "Tracing is off. Start me with JARVIS_TRACE set to an output file.");
+        } else {
+            int events = trace_dump(NULL);
+            if (events < 0)
+                snprintf(response, response_size, "I couldn't write the trace file %s.", trace_output_path());
+            else
+                snprintf(response, response_size, "Saved %d trace events to %s.", events, trace_output_path());
+        }
+    }
+    // Latency percentiles recorded so far
+    else if (command_contains(lower_cmd, "performance report") ||
+             command_contains(lower_cmd, "latency report")) {
+        intent = "metrics";
+        metrics_format_report(response, response_size);
+        if (response[0] == '\0') strcpy(response, "No commands measured yet.");
+    }
+    // Routines (before "time"/"build" so routine names can't misroute it)
+    else if (is_routine_request(lower_cmd)) {
+        intent = "routine";
+        execute_routine_command(lower_cmd, response, response_size);
+    }
+    // Watch mode (before the YouTube branch claims "watch")
+    else if (command_contains(lower_cmd, "watch project") ||
+             command_contains(lower_cmd, "watch mode") ||
+             command_contains(lower_cmd, "watch status") ||
+             command_contains(lower_cmd, "stop watching")) {
+        intent = "watch";
+        execute_watch_command(lower_cmd, response, response_size);
+    }
+    // Code navigation and coding support (before "time"/"hi" so symbol names can't misroute it)
+    else if (is_code_navigation_request(lower_cmd)) {
+        intent = "code_navigation";
+        execute_code_navigation_command(command, lower_cmd, response, response_size);
+    }
     // Time-related commands
-    if (command_contains(lower_cmd, "time")) {
+    else if (command_contains(lower_cmd, "time")) {
+        intent = "time";
         time_t now = time(NULL);
-        struct tm* timeinfo = localtime(&now);
-        strftime(response, response_size, "The current time is %I:%M %p", timeinfo);
+        struct tm timeinfo;
+        localtime_r(&now, &timeinfo);
+        strftime(response, response_size, "The current time is %I:%M %p", &timeinfo);
     }
     // Greeting commands
     else if (command_contains(lower_cmd, "hello") ||
              command_contains(lower_cmd, "hi") ||
              command_contains(lower_cmd, "hey")) {
+        intent = "greeting";
         time_t now = time(NULL);
-        struct tm* t = localtime(&now);
-        int hour = t->tm_hour;
+        struct tm t;
+        localtime_r(&now, &t);
+        int hour = t.tm_hour;
         const char* greeting = (hour < 12) ? "Good morning" :
                                (hour < 17) ? "Good afternoon" : "Good evening";
         snprintf(response, response_size,
@@ -117,13 +230,14 @@ char* process_command(const char* command) {
     }
     // Help command
     else if (command_contains(lower_cmd, "help")) {
+        intent = "help";
         strcpy(response,
                "Of course. I can handle: time, joke, hello, help, system info, weather, "
                "open google, daily C development tasks, build project, run tests, check warnings, find symbol <name>, "
                "create c module <name>, create project <name> in python, "
                "open project <name>, open last project, create folder <name>, "
                "open file <path>, create file <name>, generate code file <name> for <task>, "
-               "git status/pull/push, AI summary, AI ideas, AI plan mode, "
+               "git status/pull/push, status of all projects, morning sync, run routine <name>, watch project, stop watching, AI summary, AI ideas, AI plan mode, "
                "AI brain (website/app/legal/problem), search for <topic>, "
                "repeat last command, what did I say, and exit.");
     }
@@ -132,6 +246,7 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "system status") ||
              command_contains(lower_cmd, "system information") ||
              strcmp(lower_cmd, "info") == 0) {
+        intent = "system_info";
         char hostname[128] = "unknown";
         FILE* fp = popen("uname -srm 2>/dev/null", "r");
         if (fp) { fgets(hostname, sizeof(hostname), fp); hostname[strcspn(hostname, "\n")] = '\0'; pclose(fp); }
@@ -141,35 +256,42 @@ char* process_command(const char* command) {
     }
     // AI-like project setup (create project and open in VS Code)
     else if (is_project_creation_request(lower_cmd)) {
+        intent = "project_create";
         execute_ai_project_setup_command(lower_cmd, response, response_size);
     }
     // Open an existing project in VS Code
     else if (command_contains(lower_cmd, "open project")) {
+        intent = "project_open";
         execute_open_project_command(lower_cmd, response, response_size);
     }
     // Open last created project in VS Code
     else if (command_contains(lower_cmd, "open last project") ||
              command_contains(lower_cmd, "open recent project")) {
+        intent = "project_open_last";
         execute_open_last_project_command(response, response_size);
     }
     // Open file in VS Code
     else if (command_contains(lower_cmd, "open file")) {
+        intent = "file_open";
         execute_project_management(lower_cmd, response, response_size);
     }
     // YouTube search commands
     else if (command_contains(lower_cmd, "youtube") ||
              command_contains(lower_cmd, "video") ||
              command_contains(lower_cmd, "watch")) {
+        intent = "youtube";
         execute_youtube_command(lower_cmd, response, response_size);
     }
     // Web page opening commands
     else if (command_contains(lower_cmd, "open website") ||
              (command_contains(lower_cmd, "go to") && !command_contains(lower_cmd, "folder")) ||
              command_contains(lower_cmd, "visit")) {
+        intent = "webpage";
         execute_webpage_command(lower_cmd, response, response_size);
     }
     // Open Google
     else if (command_contains(lower_cmd, "open google")) {
+        intent = "open_google";
         system("open 'https://www.google.com' &");
         strcpy(response, "Opening Google in your browser.");
     }
@@ -178,10 +300,12 @@ char* process_command(const char* command) {
              (command_contains(lower_cmd, "jarvis ui") ||
               command_contains(lower_cmd, "ai ui") ||
               command_contains(lower_cmd, "ai window"))) {
+        intent = "open_ui";
         launch_jarvis_ui_command(response, response_size);
     }
     // Open application commands
     else if (command_contains(lower_cmd, "open")) {
+        intent = "open_app";
         execute_open_command(lower_cmd, response, response_size);
     }
     // C development workflow commands
@@ -193,32 +317,34 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "test project") ||
              command_contains(lower_cmd, "check warnings") ||
              command_contains(lower_cmd, "show warnings") ||
+             command_contains(lower_cmd, "build cache") ||
              command_contains(lower_cmd, "create c module") ||
              command_contains(lower_cmd, "scaffold module")) {
+        intent = c_workflow_intent(lower_cmd);
         execute_c_workflow_command(lower_cmd, response, response_size);
     }
-    // Code navigation and coding support
-    else if (command_contains(lower_cmd, "find symbol") ||
-             command_contains(lower_cmd, "find function") ||
-             command_contains(lower_cmd, "where is function") ||
-             command_contains(lower_cmd, "search code") ||
-             command_contains(lower_cmd, "show todo") ||
-             command_contains(lower_cmd, "list todo") ||
-             command_contains(lower_cmd, "fixme")) {
-        execute_code_navigation_command(lower_cmd, response, response_size);
-    }
     // AI Brain task orchestration
     else if (is_ai_brain_request(lower_cmd)) {
+        intent = "ai_brain";
         execute_ai_brain_command(command, response, response_size);
     }
+    // Status of every repository under the project roots
+    else if (command_contains(lower_cmd, "project dashboard") ||
+             (command_contains(lower_cmd, "status") &&
+              (command_contains(lower_cmd, "all projects") ||
+               command_contains(lower_cmd, "all repos") ||
+               command_contains(lower_cmd, "all repositories")))) {
+        intent = "project_dashboard";
+        execute_project_dashboard_command(response, response_size);
+    }
     // Daily workflow automation
     else if (command_contains(lower_cmd, "daily workflow") ||
              command_contains(lower_cmd, "daily status") ||
-             command_contains(lower_cmd, "morning sync") ||
              command_contains(lower_cmd, "review changes") ||
              command_contains(lower_cmd, "git status") ||
              command_contains(lower_cmd, "git pull") ||
              command_contains(lower_cmd, "git push")) {
+        intent = "daily_workflow";
         execute_daily_workflow_command(lower_cmd, response, response_size);
     }
     // Developer Workflow Automation
@@ -226,12 +352,14 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "build") ||
              command_contains(lower_cmd, "deploy") ||
              command_contains(lower_cmd, "make")) {
+        intent = "dev_command";
         execute_dev_command(lower_cmd, response, response_size);
     }
     // AI code generation directly into file
     else if (command_contains(lower_cmd, "generate code file") ||
              command_contains(lower_cmd, "create code file") ||
              command_contains(lower_cmd, "write code file")) {
+        intent = "ai_code_file";
         execute_ai_code_file_command(lower_cmd, response, response_size);
     }
     // Project Navigation & Management
@@ -244,20 +372,24 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "create file") ||
              command_contains(lower_cmd, "new file") ||
              command_contains(lower_cmd, "open file")) {
+        intent = "project_management";
         execute_project_management(lower_cmd, response, response_size);
     }
     // Developer Search (Stack Overflow/GitHub)
     else if (command_contains(lower_cmd, "stack overflow") ||
              command_contains(lower_cmd, "github")) {
+        intent = "dev_search";
         execute_dev_search(lower_cmd, response, response_size);
     }
     // System Control
     else if (command_contains(lower_cmd, "lock screen")) {
+        intent = "lock_screen";
         system("pmset displaysleepnow");
         strcpy(response, "Locking screen.");
     }
     // Joke command
     else if (command_contains(lower_cmd, "joke")) {
+        intent = "joke";
         const char* jokes[] = {
             "Here's one for you... Why do programmers prefer dark mode? Because light attracts bugs!",
             "Here's a good one... A SQL query walks into a bar, walks up to two tables and asks: Can I join you?",
@@ -269,15 +401,10 @@ char* process_command(const char* command) {
     }
     // Weather command
     else if (command_contains(lower_cmd, "weather")) {
-        /* Try wttr.in for a one-line weather summary */
+        intent = "weather";
+        /* Cached for ten minutes and refreshed in the background before it expires */
         char weather_buf[256] = "";
-        FILE* wfp = popen("curl -s 'wttr.in/?format=3' 2>/dev/null", "r");
-        if (wfp) {
-            if (fgets(weather_buf, sizeof(weather_buf), wfp) != NULL)
-                weather_buf[strcspn(weather_buf, "\n")] = '\0';
-            pclose(wfp);
-        }
-        if (strlen(weather_buf) > 4)
+        if (result_cache_get(&g_weather_cache, "", weather_buf, sizeof(weather_buf), fetch_weather, NULL))
             snprintf(response, response_size, "Current weather: %s", weather_buf);
         else
             strcpy(response, "I couldn't fetch live weather right now. "
@@ -287,6 +414,7 @@ char* process_command(const char* command) {
     else if (command_contains(lower_cmd, "shutdown") || 
              command_contains(lower_cmd, "exit") ||
              command_contains(lower_cmd, "quit")) {
+        intent = "shutdown";
         strcpy(response, "Shutting down. Goodbye sir.");
     }
     // Search commands - only if explicitly asked
@@ -299,21 +427,30 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "who is") ||
              command_contains(lower_cmd, "how to") ||
              command_contains(lower_cmd, "how do i")) {
+        intent = "search";
         const char* query = extract_search_query(command);
-        char* search_result = general_search(query);
-        
-        if (search_result) {
-            strncpy(response, search_result, (size_t)response_size - 1);
-            response[response_size - 1] = '\0';
-            free(search_result);
-        } else {
-            strcpy(response, "Search query processed. Please try a different search term.");
+        int question = command_contains(lower_cmd, "what is") || command_contains(lower_cmd, "tell me about") ||
+                       command_contains(lower_cmd, "who is") || command_contains(lower_cmd, "how to") ||
+                       command_contains(lower_cmd, "how do i");
+
+        // Questions are answered from local notes when they match well; the web is the fallback
+        if (!question || !knowledge_answer(query, response, (size_t)response_size)) {
+            char* search_result = general_search(query);
+
+            if (search_result) {
+                strncpy(response, search_result, (size_t)response_size - 1);
+                response[response_size - 1] = '\0';
+                free(search_result);
+            } else {
+                strcpy(response, "Search query processed. Please try a different search term.");
+            }
         }
     }
     // Reset AI Memory
     else if (command_contains(lower_cmd, "reset ai") || 
              command_contains(lower_cmd, "clear memory") ||
              command_contains(lower_cmd, "forget everything")) {
+        intent = "reset_ai";
         if (remove("src/chat_history.json") == 0) {
             strcpy(response, "AI memory has been wiped. I'm ready for a fresh start.");
         } else {
@@ -331,6 +468,7 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "ceo mode") ||
              command_contains(lower_cmd, "research mode") ||
              command_contains(lower_cmd, "security mode")) {
+        intent = "set_mode";
         
         const char* mode = "default";
         if (command_contains(lower_cmd, "sarcastic")) mode = "sarcastic";
@@ -362,6 +500,7 @@ char* process_command(const char* command) {
              command_contains(lower_cmd, "ideas") ||
              command_contains(lower_cmd, "plan") ||
              command_contains(lower_cmd, "roadmap")) {
+        intent = "ai_chat";
         const char* ai_mode = "chat";
         if (command_contains(lower_cmd, "summarize") || command_contains(lower_cmd, "summary")) {
             ai_mode = "summary";
@@ -374,6 +513,7 @@ char* process_command(const char* command) {
     }
     // Default response - ask for clarification instead of searching
     else {
+        intent = "unknown";
         snprintf(response, response_size, "I didn't understand '%s'. Try: build project, run tests, "
                 "check warnings, find function <name>, create project <name>, open project <name>, "
                 "open last project, create folder <name>, open file <path>, create file <name>, "
@@ -382,6 +522,11 @@ char* process_command(const char* command) {
     }
 
     free(lower_cmd);
+    if (result) {
+        result->intent = intent;
+        result->status = session_current()->last_action_status;
+    }
+    metrics_observe_intent(intent, trace_end("process_command", span, intent));
     return response;
 }
 
@@ -1216,17 +1361,21 @@ static int run_command_capture(const char* shell_cmd, char* response, int respon
         return -1;
     }
 
+    long long span = trace_begin();
     FILE* fp = popen(shell_cmd, "r");
     if (!fp) {
         snprintf(response, response_size, "Failed to execute command.");
+        trace_end("run_command_capture", span, shell_cmd);
         return -1;
     }
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
 
     response[0] = '\0';
     char buffer[256];
     int lines = 0;
 
     while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        metrics_count(METRIC_BYTES_CAPTURED, strlen(buffer));
         if (max_lines > 0 && lines >= max_lines) {
             break;
         }
@@ -1246,6 +1395,10 @@ static int run_command_capture(const char* shell_cmd, char* response, int respon
     }
 
     int status = pclose(fp);
+    if (status != -1) {
+        session_current()->last_action_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    trace_end("run_command_capture", span, shell_cmd);
     size_t len = strlen(response);
     if (len > 0 && response[len - 1] == '\n') {
         response[len - 1] = '\0';
@@ -1262,6 +1415,155 @@ static int run_command_capture(const char* shell_cmd, char* response, int respon
     return status;
 }
 
+#define BUILD_TAIL_MAX 8
+
+/* Runs a build or test command, reading the whole log through the
+   diagnostic parser (carried, if given, already holds earlier diagnostics).
+   Reports the diagnostic summary when there are errors, otherwise the last
+   tail_lines lines (where make and test runners put their verdict). */
+static int run_build_capture(const char* shell_cmd, char* response, int response_size, int tail_lines,
+                             diag_summary* carried) {
+    if (!shell_cmd || !response || response_size <= 0) {
+        return -1;
+    }
+    if (tail_lines < 1) tail_lines = 1;
+    if (tail_lines > BUILD_TAIL_MAX) tail_lines = BUILD_TAIL_MAX;
+
+    long long span = trace_begin();
+    FILE* fp = popen(shell_cmd, "r");
+    if (!fp) {
+        snprintf(response, response_size, "Failed to execute command.");
+        trace_end("run_build_capture", span, shell_cmd);
+        return -1;
+    }
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+
+    diag_summary* summary = carried ? carried : malloc(sizeof(diag_summary));
+    if (summary && !carried) diagnostics_init(summary);
+
+    /* Ring of the last non-empty lines */
+    char tail[BUILD_TAIL_MAX][256];
+    int tail_count = 0;
+    char line[256];
+    size_t line_len = 0;
+    char buffer[4096];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        metrics_count(METRIC_BYTES_CAPTURED, got);
+        if (summary) diagnostics_feed(summary, buffer, got);
+        for (size_t i = 0; i < got; i++) {
+            if (buffer[i] != '\n') {
+                if (line_len + 1 < sizeof(line)) line[line_len++] = buffer[i];
+                continue;
+            }
+            line[line_len] = '\0';
+            if (line_len > 0) memcpy(tail[tail_count++ % BUILD_TAIL_MAX], line, line_len + 1);
+            line_len = 0;
+        }
+    }
+    if (line_len > 0) {
+        line[line_len] = '\0';
+        memcpy(tail[tail_count++ % BUILD_TAIL_MAX], line, line_len + 1);
+    }
+    if (summary) diagnostics_finish(summary);
+
+    int status = pclose(fp);
+    if (status != -1) {
+        session_current()->last_action_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    trace_end("run_build_capture", span, shell_cmd);
+
+    /* Errors replace the log; warnings are added after the verdict */
+    if (summary && summary->errors > 0 && diagnostics_format(summary, response, (size_t)response_size)) {
+        if (!carried) free(summary);
+        return status;
+    }
+
+    response[0] = '\0';
+    int first = tail_count > tail_lines ? tail_count - tail_lines : 0;
+    size_t used = 0;
+    for (int i = first; i < tail_count && used + 2 < (size_t)response_size; i++) {
+        int written = snprintf(response + used, (size_t)response_size - used, "%s%s",
+                               used > 0 ? "\n" : "", tail[i % BUILD_TAIL_MAX]);
+        if (written < 0) break;
+        used += (size_t)written;
+    }
+    if (used == 0) {
+        used = (size_t)snprintf(response, response_size, status == 0 ? "Command finished with no output."
+                                                                     : "Command failed with no readable output.");
+    }
+    if (summary && used + 2 < (size_t)response_size) {
+        response[used] = '\n';
+        if (!diagnostics_format(summary, response + used + 1, (size_t)response_size - used - 1)) response[used] = '\0';
+    }
+    if (!carried) free(summary);
+    return status;
+}
+
+/* Compiles the stale objects across all cores, then lets make link */
+static void execute_build_command(int force, char* response, int response_size) {
+    diag_summary* diagnostics = malloc(sizeof(diag_summary));
+    build_stats stats;
+    if (diagnostics) diagnostics_init(diagnostics);
+    if (!diagnostics || !build_driver_compile(".", force, diagnostics, &stats)) {
+        /* No per-file compile steps to drive: make does everything */
+        char command[64];
+        snprintf(command, sizeof(command), force ? "make rebuild 2>&1" : "make -j%d 2>&1", build_plan_jobs());
+        run_build_capture(command, response, response_size, 1, NULL);
+        free(diagnostics);
+        return;
+    }
+
+    if (stats.failed > 0) {
+        if (!diagnostics_format(diagnostics, response, (size_t)response_size)) {
+            snprintf(response, response_size, "Build failed: %d of %d files did not compile.", stats.failed, stats.stale);
+        }
+        session_current()->last_action_status = 2;
+        free(diagnostics);
+        return;
+    }
+
+    char command[64];
+    snprintf(command, sizeof(command), "make -j%d 2>&1", stats.jobs);
+    run_build_capture(command, response, response_size, 1, diagnostics);
+    free(diagnostics);
+
+    size_t used = strlen(response);
+    if (used + 2 < (size_t)response_size) {
+        if (stats.stale > 0 && stats.cached > 0) {
+            snprintf(response + used, (size_t)response_size - used,
+                     "\n(%d of %d files rebuilt: %d compiled, %d restored from the build cache, %d job%s)",
+                     stats.compiled + stats.cached, stats.units, stats.compiled, stats.cached, stats.jobs,
+                     stats.jobs == 1 ? "" : "s");
+        } else if (stats.stale > 0) {
+            snprintf(response + used, (size_t)response_size - used, "\n(compiled %d of %d files with %d job%s)",
+                     stats.compiled, stats.units, stats.jobs, stats.jobs == 1 ? "" : "s");
+        } else {
+            snprintf(response + used, (size_t)response_size - used, "\n(all %d objects up to date)", stats.units);
+        }
+    }
+}
+
+/* "build cache status" / "clear build cache" */
+static void execute_build_cache_command(const char* command, char* response, int response_size) {
+    compile_cache_stats stats;
+    if (!compile_cache_get_stats(&stats)) {
+        snprintf(response, response_size, "The build cache is off. Unset JARVIS_COMPILE_CACHE to turn it on.");
+        return;
+    }
+    if (strstr(command, "clear") || strstr(command, "empty") || strstr(command, "reset")) {
+        int removed = compile_cache_clear();
+        snprintf(response, response_size, "Cleared the build cache (%d object%s removed).", removed, removed == 1 ? "" : "s");
+        return;
+    }
+    unsigned long long lookups = stats.hits + stats.misses;
+    snprintf(response, response_size,
+             "Build cache: %llu hit%s and %llu miss%s (%llu%% restored), %.1f of %.0f MB used, %llu object%s evicted.",
+             stats.hits, stats.hits == 1 ? "" : "s", stats.misses, stats.misses == 1 ? "" : "es",
+             lookups ? stats.hits * 100 / lookups : 0, stats.size / (1024.0 * 1024.0), stats.limit / (1024.0 * 1024.0),
+             stats.evicted, stats.evicted == 1 ? "" : "s");
+}
+
 static int contains_word(const char* text, const char* word) {
     if (!text || !word || strlen(word) == 0) {
         return 0;
@@ -1827,6 +2129,83 @@ static int create_c_module_scaffold(const char* module_name, char* response, int
     return 1;
 }
 
+/* Appends one line to a response, dropping it if it does not fit */
+static void append_response_line(char* response, int response_size, const char* line) {
+    size_t len = strlen(response);
+    if (len + strlen(line) + 2 > (size_t)response_size) return;
+    snprintf(response + len, (size_t)response_size - len, "%s%s", len > 0 ? "\n" : "", line);
+}
+
+static void append_git_changes(const git_status* status, int max_lines, char* response, int response_size) {
+    for (int i = 0; i < status->listed && i < max_lines; i++) {
+        char line[300];
+        snprintf(line, sizeof(line), "%c%c %s", status->entries[i].index, status->entries[i].worktree,
+                 status->entries[i].path);
+        append_response_line(response, response_size, line);
+    }
+    int shown = status->listed < max_lines ? status->listed : max_lines;
+    if (status->changed > shown) {
+        char more[64];
+        snprintf(more, sizeof(more), "... and %d more", status->changed - shown);
+        append_response_line(response, response_size, more);
+    }
+}
+
+/* The same lines as git status --short -b */
+static void format_git_status_short(const git_status* status, char* response, int response_size, int max_lines) {
+    char line[700];
+    if (status->head[0] == '\0') {
+        snprintf(line, sizeof(line), "## No commits yet on %s", status->branch);
+    } else if (status->branch[0] == '\0') {
+        snprintf(line, sizeof(line), "## HEAD (no branch)");
+    } else if (status->upstream[0] == '\0') {
+        snprintf(line, sizeof(line), "## %s", status->branch);
+    } else if (status->upstream_gone) {
+        snprintf(line, sizeof(line), "## %s...%s [gone]", status->branch, status->upstream);
+    } else {
+        char counts[64] = "";
+        if (status->ahead > 0 && status->behind > 0) {
+            snprintf(counts, sizeof(counts), " [ahead %d, behind %d]", status->ahead, status->behind);
+        } else if (status->ahead > 0) {
+            snprintf(counts, sizeof(counts), " [ahead %d]", status->ahead);
+        } else if (status->behind > 0) {
+            snprintf(counts, sizeof(counts), " [behind %d]", status->behind);
+        }
+        snprintf(line, sizeof(line), "## %s...%s%s", status->branch, status->upstream, counts);
+    }
+    response[0] = '\0';
+    append_response_line(response, response_size, line);
+    append_git_changes(status, max_lines - 1, response, response_size);
+}
+
+static void format_git_daily_status(const git_status* status, char* response, int response_size) {
+    char line[300];
+    response[0] = '\0';
+    append_response_line(response, response_size, "Branch:");
+    append_response_line(response, response_size, status->branch[0] ? status->branch : "(detached HEAD)");
+
+    const char* names[4] = { "staged", "modified", "deleted", "untracked" };
+    int counts[4] = { status->staged, status->modified, status->deleted, status->untracked };
+    size_t len = (size_t)snprintf(line, sizeof(line), "Changes:");
+    for (int i = 0; i < 4; i++) {
+        if (counts[i] > 0 && len < sizeof(line)) {
+            len += (size_t)snprintf(line + len, sizeof(line) - len, "%s %d %s",
+                                    len > strlen("Changes:") ? "," : "", counts[i], names[i]);
+        }
+    }
+    if (status->changed == 0) snprintf(line, sizeof(line), "Changes: none");
+    append_response_line(response, response_size, line);
+    append_git_changes(status, 8, response, response_size);
+
+    append_response_line(response, response_size, "Last commit:");
+    if (status->head[0] == '\0') {
+        append_response_line(response, response_size, "(no commits yet)");
+    } else {
+        snprintf(line, sizeof(line), "%.7s %s", status->head, status->subject);
+        append_response_line(response, response_size, line);
+    }
+}
+
 static void execute_daily_workflow_command(const char* command, char* response, int response_size) {
     if (strstr(command, "git pull")) {
         run_command_capture("git pull 2>&1", response, response_size, 12);
@@ -1838,11 +2217,27 @@ static void execute_daily_workflow_command(const char* command, char* response,
         return;
     }
 
+    git_status* status = malloc(sizeof(git_status));
+    int native = status ? git_status_read(".", 0, status) : 0;
+    if (native < 0) {
+        snprintf(response, response_size, "Not a git repository.");
+        free(status);
+        return;
+    }
+
     if (strstr(command, "git status") || strstr(command, "review changes")) {
-        run_command_capture("git status --short -b 2>&1", response, response_size, 12);
+        if (native) format_git_status_short(status, response, response_size, 12);
+        else run_command_capture("git status --short -b 2>&1", response, response_size, 12);
+        free(status);
         return;
     }
 
+    if (native) {
+        format_git_daily_status(status, response, response_size);
+        free(status);
+        return;
+    }
+    free(status);
     run_command_capture(
         "git rev-parse --is-inside-work-tree >/dev/null 2>&1 && "
         "{ echo \"Branch:\"; git branch --show-current; "
@@ -1853,6 +2248,205 @@ static void execute_daily_workflow_command(const char* command, char* response,
     );
 }
 
+static void execute_project_dashboard_command(char* response, int response_size) {
+    char roots[8][PATH_MAX];
+    const char* root_list[8];
+    int root_count = project_status_roots(roots, 8);
+    for (int i = 0; i < root_count; i++) root_list[i] = roots[i];
+
+    project_report report;
+    if (!project_status_scan(root_list, root_count, 0, &report)) {
+        snprintf(response, response_size, "Could not read the project repositories.");
+        return;
+    }
+    if (report.count == 0) {
+        snprintf(response, response_size,
+                 "No git repositories found. Set JARVIS_PROJECT_ROOTS to the directories holding your projects.");
+        project_status_free(&report);
+        return;
+    }
+
+    char line[600];
+    response[0] = '\0';
+    snprintf(line, sizeof(line), "%d %s scanned in %lld ms: %d %s attention, %d clean.",
+             report.count, report.count == 1 ? "repository" : "repositories",
+             report.elapsed_us / 1000, report.needing_attention,
+             report.needing_attention == 1 ? "needs" : "need", report.count - report.needing_attention);
+    append_response_line(response, response_size, line);
+
+    int shown = 0;
+    for (int i = 0; i < report.needing_attention; i++) {
+        const project_repo* repo = &report.repos[i];
+        char summary[256];
+        project_status_describe(repo, summary, sizeof(summary));
+        snprintf(line, sizeof(line), "%d. %s (%s): %s", i + 1, repo->name,
+                 repo->status.branch[0] ? repo->status.branch : "no branch", summary);
+        /* Keep room for the "... and N more" line */
+        if (strlen(response) + strlen(line) + 32 > (size_t)response_size) break;
+        append_response_line(response, response_size, line);
+        shown++;
+    }
+    if (shown < report.needing_attention) {
+        snprintf(line, sizeof(line), "... and %d more", report.needing_attention - shown);
+        append_response_line(response, response_size, line);
+    }
+    project_status_free(&report);
+}
+
+/* Only explicit phrasings: "find function routine_run" or "what is a routine" must route elsewhere */
+static int is_routine_request(const char* lower_cmd) {
+    return command_contains(lower_cmd, "run routine") || command_contains(lower_cmd, "start routine") ||
+           command_contains(lower_cmd, "list routines") || command_contains(lower_cmd, "show routines") ||
+           command_contains(lower_cmd, "morning sync");
+}
+
+/* Runs one routine step on its worker thread, under a session of its own */
+static int run_routine_step(const char* command, char** output, void* context) {
+    (void)context;
+    char* lower = to_lowercase(command);
+    int nested = !lower || is_routine_request(lower);
+    free(lower);
+    if (nested) {
+        *output = strdup("A routine step cannot start a routine.");
+        return 0;
+    }
+
+    jarvis_session* session = session_create();
+    session_bind(session);
+    command_result result;
+    *output = process_command_ex(command, &result);
+    session_bind(NULL);
+    session_destroy(session);
+    return *output && result.status == 0 && strcmp(result.intent, "unknown") != 0;
+}
+
+static void execute_routine_command(const char* command, char* response, int response_size) {
+    if (strstr(command, "list routines") || strstr(command, "show routines")) {
+        char names[16][ROUTINE_NAME_MAX];
+        int count = routine_list(names, 16);
+        size_t used = (size_t)snprintf(response, response_size, "Routines:");
+        for (int i = 0; i < count && used < (size_t)response_size; i++) {
+            used += (size_t)snprintf(response + used, response_size - used, "%s %s", i ? "," : "", names[i]);
+        }
+        return;
+    }
+
+    char name[ROUTINE_NAME_MAX] = "morning";
+    if (!strstr(command, "morning sync") &&
+        !extract_identifier_after_keyword(command, "routine", name, sizeof(name))) {
+        snprintf(response, response_size, "Please say: run routine <name>, or list routines.");
+        return;
+    }
+
+    routine* steps = malloc(sizeof(routine));
+    char error[256];
+    int loaded = steps ? routine_load(name, steps, error, sizeof(error)) : 0;
+    if (loaded <= 0) {
+        if (loaded < 0) snprintf(response, response_size, "Routine %s is invalid: %s", name, error);
+        else snprintf(response, response_size, "I don't know a routine named %s. Say list routines to see them.", name);
+        free(steps);
+        return;
+    }
+
+    if (!routine_run(steps, 0, run_routine_step, NULL)) session_current()->last_action_status = 1;
+    routine_format_report(steps, response, (size_t)response_size);
+    routine_release(steps);
+    free(steps);
+}
+
+/* One watch-mode cycle on the watcher thread: incremental build, then the affected tests */
+static int run_watch_cycle(const char* dir, const char* only, char* summary, size_t summary_size, void* context) {
+    (void)context;
+    jarvis_session* session = session_create();
+    session_bind(session);
+
+    char output[1024] = "";
+    char command[PATH_MAX + 128];
+    diag_summary* diagnostics = malloc(sizeof(diag_summary));
+    build_stats stats;
+    if (diagnostics) diagnostics_init(diagnostics);
+    int planned = diagnostics && build_driver_compile(dir, 0, diagnostics, &stats);
+    int green;
+    if (planned && stats.failed > 0) {
+        if (!diagnostics_format(diagnostics, output, sizeof(output))) {
+            snprintf(output, sizeof(output), "Build failed: %d of %d files did not compile.", stats.failed,
+                     stats.stale);
+        }
+        green = 0;
+    } else {
+        snprintf(command, sizeof(command), "make --no-print-directory -C '%s' -j%d 2>&1", dir,
+                 planned ? stats.jobs : build_plan_jobs());
+        green = run_build_capture(command, output, (int)sizeof(output), 1, planned ? diagnostics : NULL) == 0;
+    }
+    free(diagnostics);
+
+    if (!green) {
+        snprintf(summary, summary_size, "%s", output);
+    } else if (only && only[0] == '\0') {
+        snprintf(summary, summary_size, "Build succeeded; no tests affected.");
+    } else {
+        /* TEST_ARGS reaches this repository's runner; other test targets ignore it */
+        if (only) {
+            snprintf(command, sizeof(command), "make --no-print-directory -C '%s' test TEST_ARGS='--only %s' 2>&1",
+                     dir, only);
+        } else {
+            snprintf(command, sizeof(command), "make --no-print-directory -C '%s' test 2>&1", dir);
+        }
+        /* Two lines: a failing run ends with the runner's verdict, then make's error */
+        green = run_build_capture(command, output, (int)sizeof(output), 2, NULL) == 0;
+        const char* verdict = output;
+        while (isspace((unsigned char)*verdict)) verdict++;
+        if (strstr(output, "No rule to make target")) {
+            green = 1;
+            snprintf(summary, summary_size, "Build succeeded; no test target.");
+        } else {
+            snprintf(summary, summary_size, "%s%s", green ? "Build succeeded; " : "", verdict);
+        }
+    }
+
+    session_bind(NULL);
+    session_destroy(session);
+    return green;
+}
+
+/* Longest project path quoted back in a watch reply (the reply buffer is 1024 bytes) */
+#define WATCH_PATH_SHOWN 512
+
+static void execute_watch_command(const char* command, char* response, int response_size) {
+    if (strstr(command, "stop watching")) {
+        snprintf(response, response_size, project_watch_stop() ? "Stopped watching the project."
+                                                                : "I'm not watching a project.");
+        return;
+    }
+    if (strstr(command, "watch status")) {
+        project_watch_status(response, (size_t)response_size);
+        return;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd)) || strchr(cwd, '\'')) {
+        snprintf(response, response_size, "I can't watch this directory.");
+        return;
+    }
+    if (access("Makefile", F_OK) != 0 && access("makefile", F_OK) != 0) {
+        snprintf(response, response_size, "There's no Makefile here to build, so there is nothing to watch.");
+        return;
+    }
+
+    int started = project_watch_start(cwd, run_watch_cycle, NULL);
+    if (started < 0 && project_watch_status(response, (size_t)response_size)) {
+        snprintf(response, response_size, "I'm already watching a project. Say stop watching first.");
+    } else if (started < 0) {
+        snprintf(response, response_size, "The last watch is still finishing a build. Try again in a moment.");
+    } else if (!started) {
+        snprintf(response, response_size, "I couldn't watch %.*s.", WATCH_PATH_SHOWN, cwd);
+    } else {
+        snprintf(response, response_size,
+                 "Watching %.*s. I'll rebuild and rerun the affected tests after every save, and tell you "
+                 "when the build goes red or back to green. Say stop watching to end it.", WATCH_PATH_SHOWN, cwd);
+    }
+}
+
 static void execute_c_workflow_command(const char* command, char* response, int response_size) {
     if (strstr(command, "create c module") || strstr(command, "scaffold module")) {
         char module_name[128] = {0};
@@ -1869,13 +2463,18 @@ static void execute_c_workflow_command(const char* command, char* response, int
         return;
     }
 
+    if (strstr(command, "build cache")) {
+        execute_build_cache_command(command, response, response_size);
+        return;
+    }
+
     if (strstr(command, "rebuild project") || strstr(command, "clean build")) {
-        run_command_capture("make rebuild 2>&1", response, response_size, 12);
+        execute_build_command(1, response, response_size);
         return;
     }
 
     if (strstr(command, "run tests") || strstr(command, "test project") || strstr(command, "make test")) {
-        run_command_capture("make test 2>&1", response, response_size, 12);
+        run_build_capture("make test 2>&1", response, response_size, 4, NULL);
         if (strstr(response, "No rule to make target") != NULL) {
             snprintf(response, response_size, "No test target found. Add a 'test' target to the Makefile.");
         }
@@ -1884,6 +2483,30 @@ static void execute_c_workflow_command(const char* command, char* response, int
 
     if (strstr(command, "check warnings") || strstr(command, "show warnings")) {
         char warning_output[1024] = {0};
+        warning_stats stats;
+        if (warning_cache_check(".", warning_output, sizeof(warning_output), &stats)) {
+            char summary[128];
+            snprintf(summary, sizeof(summary), "%d of %d files recompiled%s", stats.recompiled, stats.units,
+                     stats.failed > 0 ? ", some failed to compile" : "");
+            if (stats.warnings == 0) {
+                snprintf(response, response_size, "Build completed with no compiler warnings (%s).", summary);
+                return;
+            }
+
+            diag_summary* diagnostics = malloc(sizeof(diag_summary));
+            char spoken[512] = "";
+            if (diagnostics) {
+                diagnostics_init(diagnostics);
+                diagnostics_feed(diagnostics, warning_output, strlen(warning_output));
+                diagnostics_finish(diagnostics);
+                diagnostics_format(diagnostics, spoken, sizeof(spoken));
+                free(diagnostics);
+            }
+            snprintf(response, response_size, "Compiler warnings: %s\n%s\n(%s)", spoken, warning_output, summary);
+            return;
+        }
+
+        /* Not a plain compile-per-file Makefile: fall back to a full rebuild */
         run_command_capture("(make clean && make 2>&1) | grep -i 'warning:' || true",
                             warning_output, sizeof(warning_output), 10);
 
@@ -1895,43 +2518,138 @@ static void execute_c_workflow_command(const char* command, char* response, int
         return;
     }
 
-    run_command_capture("make 2>&1", response, response_size, 12);
+    execute_build_command(0, response, response_size);
 }
 
-static void execute_code_navigation_command(const char* command, char* response, int response_size) {
-    if (strstr(command, "todo") || strstr(command, "fixme")) {
-        run_command_capture("rg -n \"TODO|FIXME\" src include 2>/dev/null | head -8",
-                            response, response_size, 10);
-        if (strcmp(response, "Command finished with no output.") == 0) {
-            snprintf(response, response_size, "No TODO/FIXME items found in src/ or include/.");
-        }
+static int is_code_navigation_request(const char* lower_cmd) {
+    return command_contains(lower_cmd, "find symbol") ||
+           command_contains(lower_cmd, "find function") ||
+           command_contains(lower_cmd, "where is function") ||
+           (command_contains(lower_cmd, "where is") && command_contains(lower_cmd, " defined")) ||
+           command_contains(lower_cmd, "who calls") ||
+           command_contains(lower_cmd, "find references") ||
+           command_contains(lower_cmd, "search code") ||
+           command_contains(lower_cmd, "show todo") ||
+           command_contains(lower_cmd, "list todo") ||
+           command_contains(lower_cmd, "fixme");
+}
+
+/* Greps the working tree in-process and lists the first matches */
+static void execute_code_search(const char* pattern, const char* label, char* response, int response_size) {
+    code_match matches[8];
+    int truncated = 0;
+    code_search_options options = { 0 };
+    options.max_per_file = 3;
+    int found = code_search(".", pattern, &options, matches, 8, &truncated);
+    if (found < 0) {
+        snprintf(response, response_size, "I couldn't understand the pattern '%s'.", pattern);
+        return;
+    }
+    if (found == 0) {
+        snprintf(response, response_size, "No %s found in this project.", label);
         return;
     }
 
-    char symbol[128] = {0};
-    int parsed = extract_identifier_after_keyword(command, "find symbol", symbol, sizeof(symbol));
-    if (!parsed) {
-        parsed = extract_identifier_after_keyword(command, "find function", symbol, sizeof(symbol));
+    int used = snprintf(response, response_size, "%d %s%s:", found, label, truncated ? " (there are more)" : "");
+    for (int i = 0; i < found && used > 0 && used < response_size; i++) {
+        used += snprintf(response + used, (size_t)(response_size - used), "\n%s:%d: %s",
+                         matches[i].path, matches[i].line, matches[i].text);
     }
-    if (!parsed) {
-        parsed = extract_identifier_after_keyword(command, "where is function", symbol, sizeof(symbol));
+}
+
+/* Symbols were parsed from the lowercased command; take their spelling from the original */
+static void restore_identifier_case(const char* command, const char* lower_cmd, char* symbol) {
+    if (strlen(command) != strlen(lower_cmd)) return;
+    const char* found = NULL;
+    for (const char* at = strstr(lower_cmd, symbol); at; at = strstr(at + 1, symbol)) found = at;
+    if (found) memcpy(symbol, command + (found - lower_cmd), strlen(symbol));
+}
+
+static void execute_code_navigation_command(const char* command, const char* lower_cmd, char* response, int response_size) {
+    if (strstr(lower_cmd, "search code")) {
+        // Grep the rest of the command as typed: case matters here
+        size_t offset = (size_t)(strstr(lower_cmd, "search code") - lower_cmd) + strlen("search code");
+        const char* pattern = (strlen(command) == strlen(lower_cmd) ? command : lower_cmd) + offset;
+        while (*pattern && isspace((unsigned char)*pattern)) pattern++;
+        if (strncmp(pattern, "for ", 4) == 0) pattern += 4;
+        if (*pattern == '\0') {
+            snprintf(response, response_size, "Please specify what to search for. Example: search code process_command.");
+            return;
+        }
+        char label[160];
+        snprintf(label, sizeof(label), "matches for '%s'", pattern);
+        execute_code_search(pattern, label, response, response_size);
+        return;
     }
-    if (!parsed) {
-        parsed = extract_identifier_after_keyword(command, "search code", symbol, sizeof(symbol));
+    if (strstr(lower_cmd, "todo") || strstr(lower_cmd, "fixme")) {
+        execute_code_search("TODO|FIXME", "TODO/FIXME items", response, response_size);
+        return;
+    }
+
+    symbol_query query = SYMBOL_QUERY_DEFINITIONS;
+    char symbol[128] = {0};
+    int parsed = 0;
+    if (strstr(lower_cmd, "who calls")) {
+        query = SYMBOL_QUERY_CALLERS;
+        parsed = extract_identifier_after_keyword(lower_cmd, "who calls", symbol, sizeof(symbol));
+    } else if (strstr(lower_cmd, "find references")) {
+        query = SYMBOL_QUERY_REFERENCES;
+        parsed = extract_identifier_after_keyword(lower_cmd, "find references", symbol, sizeof(symbol));
+        if (parsed && strcmp(symbol, "to") == 0) {
+            parsed = extract_identifier_after_keyword(lower_cmd, "find references to", symbol, sizeof(symbol));
+        }
+    } else {
+        parsed = extract_identifier_after_keyword(lower_cmd, "find symbol", symbol, sizeof(symbol));
+        if (!parsed) {
+            parsed = extract_identifier_after_keyword(lower_cmd, "find function", symbol, sizeof(symbol));
+        }
+        if (!parsed) {
+            parsed = extract_identifier_after_keyword(lower_cmd, "where is function", symbol, sizeof(symbol));
+        }
+        if (!parsed) {
+            parsed = extract_identifier_after_keyword(lower_cmd, "where is", symbol, sizeof(symbol));
+        }
     }
 
     if (!parsed) {
         snprintf(response, response_size, "Please specify a symbol. Example: find function process_command.");
         return;
     }
+    restore_identifier_case(command, lower_cmd, symbol);
+
+    symbol_location locations[8];
+    int total = 0;
+    int found = symbol_index_lookup(".", symbol, query, locations, 8, &total);
+    if (found == 0) {
+        snprintf(response, response_size, "No %s found for '%s' in this project.",
+                 query == SYMBOL_QUERY_CALLERS ? "callers" : query == SYMBOL_QUERY_REFERENCES ? "references" : "definition",
+                 symbol);
+        return;
+    }
 
-    char search_cmd[512];
-    snprintf(search_cmd, sizeof(search_cmd),
-             "rg -n \"\\b%s\\b\" src include 2>/dev/null | head -8", symbol);
-    run_command_capture(search_cmd, response, response_size, 10);
+    int used;
+    if (query == SYMBOL_QUERY_CALLERS) {
+        used = snprintf(response, response_size, "%s is called from %d place%s:", symbol, total, total == 1 ? "" : "s");
+    } else if (query == SYMBOL_QUERY_REFERENCES) {
+        used = snprintf(response, response_size, "%d reference%s to %s:", total, total == 1 ? "" : "s", symbol);
+    } else if (strcmp(locations[0].kind, "declaration") == 0) {
+        used = snprintf(response, response_size, "%s is declared but not defined in this project:", symbol);
+    } else {
+        used = snprintf(response, response_size, "%s (%s) is defined at:", symbol, locations[0].kind);
+    }
 
-    if (strcmp(response, "Command finished with no output.") == 0) {
-        snprintf(response, response_size, "No matches found for '%s' in src/ or include/.", symbol);
+    for (int i = 0; i < found && used > 0 && used < response_size; i++) {
+        const symbol_location* location = &locations[i];
+        if (query == SYMBOL_QUERY_CALLERS) {
+            used += snprintf(response + used, (size_t)(response_size - used), "\n%s:%d in %s: %s", location->path,
+                             location->line, location->context[0] ? location->context : "file scope", location->text);
+        } else {
+            used += snprintf(response + used, (size_t)(response_size - used), "\n%s:%d: %s",
+                             location->path, location->line, location->text);
+        }
+    }
+    if (total > found && used > 0 && used < response_size) {
+        snprintf(response + used, (size_t)(response_size - used), "\n...and %d more.", total - found);
     }
 }
 
@@ -1949,7 +2667,7 @@ void execute_dev_command(const char* command, char* response, int response_size)
         run_command_capture("git push 2>&1", response, response_size, 12);
     }
     else if (strstr(command, "build") || strstr(command, "make") || strstr(command, "compile")) {
-        run_command_capture("make 2>&1", response, response_size, 12);
+        execute_build_command(0, response, response_size);
     }
     else {
         snprintf(response, response_size, "I can help with git status, pull, push, build project, and run tests.");
@@ -0,0 +1,504 @@
+#include "../include/compile_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+#define CACHE_STATS_MAGIC   "JCCS 1"
+#define CACHE_KEY_VERSION   "jarvis-cc 1"
+#define CACHE_DEFAULT_LIMIT (1024LL * 1024 * 1024)
+
+typedef struct {
+    char*     path;        /* the entry's .o */
+    long long mtime;       /* last stored or restored */
+    long long size;        /* object plus saved output */
+} CacheEntry;
+
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Two FNV-1a streams from different offsets make a 128-bit key */
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} KeyHash;
+
+static void key_feed(KeyHash* key, const void* data, size_t len) {
+    key->low = hash_bytes(key->low, data, len);
+    key->high = hash_bytes(key->high, data, len);
+}
+
+static int env_disabled(const char* value) {
+    return value && (strcmp(value, "0") == 0 || strcasecmp(value, "off") == 0 ||
+                     strcasecmp(value, "false") == 0 || strcasecmp(value, "no") == 0);
+}
+
+static void make_dirs(const char* path) {
+    char partial[PATH_MAX];
+    snprintf(partial, sizeof(partial), "%s", path);
+    for (char* slash = strchr(partial + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(partial, 0700);
+        *slash = '/';
+    }
+    mkdir(partial, 0700);
+}
+
+static int cache_dir(char* out, size_t out_size) {
+    const char* configured = getenv("JARVIS_COMPILE_CACHE");
+    if (env_disabled(configured)) return 0;
+    int len;
+    if (configured && configured[0] == '/') {
+        len = snprintf(out, out_size, "%s", configured);
+    } else {
+        const char* cache = getenv("XDG_CACHE_HOME");
+        const char* home = getenv("HOME");
+        if (cache && cache[0] == '/') len = snprintf(out, out_size, "%s/jarvis/objects", cache);
+        else len = snprintf(out, out_size, "%s/.cache/jarvis/objects", home ? home : "/tmp");
+    }
+    if (len < 0 || (size_t)len >= out_size) return 0;
+    struct stat st;
+    if (stat(out, &st) != 0) make_dirs(out);
+    return stat(out, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static long long cache_limit(void) {
+    const char* configured = getenv("JARVIS_COMPILE_CACHE_SIZE");
+    if (!configured || !configured[0]) return CACHE_DEFAULT_LIMIT;
+    char* end = NULL;
+    double value = strtod(configured, &end);
+    if (end == configured || value <= 0) return CACHE_DEFAULT_LIMIT;
+    switch (toupper((unsigned char)*end)) {
+        case 'K': return (long long)(value * 1024);
+        case 'G': return (long long)(value * 1024 * 1024 * 1024);
+        default:  return (long long)(value * 1024 * 1024);   /* "M" or a bare number */
+    }
+}
+
+static int hardlinks_enabled(void) {
+    const char* configured = getenv("JARVIS_COMPILE_CACHE_HARDLINK");
+    return configured && configured[0] && !env_disabled(configured);
+}
+
+/* <cache>/ab/abcdef….o and its saved compiler output, ….out */
+static int entry_path(char* out, size_t out_size, const char* key, const char* suffix) {
+    char dir[PATH_MAX - 64];
+    if (!cache_dir(dir, sizeof(dir)) || strlen(key) != COMPILE_CACHE_KEY_SIZE - 1) return 0;
+    int len = snprintf(out, out_size, "%s/%.2s/%s%s", dir, key, key, suffix);
+    return len >= 0 && (size_t)len < out_size;
+}
+
+/* Reflinks src to a new file dst where the filesystem can share extents,
+   otherwise copies it. Returns bytes written, -1 on failure. */
+static long long clone_file(const char* src, const char* dst) {
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return -1;
+    int out = open(dst, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+    long long total = -1;
+#ifdef FICLONE
+    struct stat st;
+    if (fstat(in, &st) == 0 && ioctl(out, FICLONE, in) == 0) total = (long long)st.st_size;
+#endif
+    if (total < 0) {
+        char buffer[65536];
+        ssize_t got;
+        total = 0;
+        while ((got = read(in, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t done = 0; done < got;) {
+                ssize_t wrote = write(out, buffer + done, (size_t)(got - done));
+                if (wrote < 0 && errno == EINTR) continue;
+                if (wrote <= 0) {
+                    got = -1;
+                    break;
+                }
+                done += wrote;
+            }
+            if (got < 0) break;
+            total += got;
+        }
+        if (got < 0) total = -1;
+    }
+    close(in);
+    if (close(out) != 0) total = -1;
+    if (total < 0) unlink(dst);
+    return total;
+}
+
+/* Puts src at dst atomically: hard link or clone into a temporary, then rename */
+static long long place_file(const char* src, const char* dst, int hardlink) {
+    char tmp_path[PATH_MAX + 32];
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", dst, (int)getpid());
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) return -1;
+    unlink(tmp_path);
+    long long size = -1;
+    struct stat st;
+    if (hardlink && link(src, tmp_path) == 0 && stat(tmp_path, &st) == 0) size = (long long)st.st_size;
+    if (size < 0) {
+        unlink(tmp_path);
+        size = clone_file(src, tmp_path);
+    }
+    if (size < 0) return -1;
+    int renamed = rename(tmp_path, dst) == 0;
+    /* Renaming onto another link to the same inode succeeds but leaves both names */
+    unlink(tmp_path);
+    return renamed ? size : -1;
+}
+
+static int write_file(const char* path, const char* data, size_t len) {
+    char tmp_path[PATH_MAX + 32];
+    int n = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    if (n < 0 || (size_t)n >= sizeof(tmp_path)) return 0;
+    FILE* out = fopen(tmp_path, "wb");
+    if (!out) return 0;
+    int ok = fwrite(data, 1, len, out) == len;
+    if (fclose(out) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+static char* read_file(const char* path, size_t* len) {
+    FILE* in = fopen(path, "rb");
+    if (!in) return NULL;
+    char* data = NULL;
+    size_t size = 0, cap = 0, got;
+    char buffer[8192];
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (size + got > cap) {
+            cap = cap ? cap * 2 : sizeof(buffer);
+            while (cap < size + got) cap *= 2;
+            char* grown = realloc(data, cap);
+            if (!grown) break;
+            data = grown;
+        }
+        memcpy(data + size, buffer, got);
+        size += got;
+    }
+    fclose(in);
+    *len = size;
+    return data;
+}
+
+/* ── Keys ───────────────────────────────────────────────────────────────── */
+
+/* The compiler binary as found on PATH; its path, size and mtime identify it */
+static int compiler_identity(const char* program, const char* directory, KeyHash* key) {
+    char path[PATH_MAX];
+    struct stat st;
+    int found = 0;
+    if (strchr(program, '/')) {
+        int len = program[0] == '/' ? snprintf(path, sizeof(path), "%s", program)
+                                    : snprintf(path, sizeof(path), "%s/%s", directory, program);
+        found = len >= 0 && (size_t)len < sizeof(path) && stat(path, &st) == 0;
+    } else {
+        const char* search = getenv("PATH");
+        if (!search || !search[0]) search = "/usr/local/bin:/usr/bin:/bin";
+        while (!found && *search) {
+            size_t span = strcspn(search, ":");
+            int len = snprintf(path, sizeof(path), "%.*s/%s", (int)span, span ? search : ".", program);
+            found = len >= 0 && (size_t)len < sizeof(path) && stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+                    access(path, X_OK) == 0;
+            search += span + (search[span] == ':');
+        }
+    }
+    if (!found) return 0;
+    char resolved[PATH_MAX];
+    if (realpath(path, resolved)) snprintf(path, sizeof(path), "%s", resolved);
+    long long identity[2] = { (long long)st.st_size, (long long)st.st_mtime };
+    key_feed(key, path, strlen(path) + 1);
+    key_feed(key, identity, sizeof(identity));
+    return 1;
+}
+
+int compile_cache_key(char* const* argv, const char* directory, const char* preprocessed, char* key) {
+    if (!argv || !argv[0] || !directory || !preprocessed || !key) return 0;
+    KeyHash hash = { 1469598103934665603ULL, 0x6c62272e07bb0142ULL };
+    key_feed(&hash, CACHE_KEY_VERSION, sizeof(CACHE_KEY_VERSION));
+    if (!compiler_identity(argv[0], directory, &hash)) return 0;
+
+    int debug_info = 0;
+    for (int i = 1; argv[i]; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "-o") == 0 || strcmp(arg, "-MF") == 0 || strcmp(arg, "-MT") == 0 || strcmp(arg, "-MQ") == 0) {
+            if (argv[i + 1]) i++;
+            continue;
+        }
+        if (strcmp(arg, "-MD") == 0 || strcmp(arg, "-MMD") == 0 || strcmp(arg, "-MP") == 0) continue;
+        if (strncmp(arg, "-g", 2) == 0 && strcmp(arg, "-g0") != 0) debug_info = 1;
+        key_feed(&hash, arg, strlen(arg) + 1);
+    }
+    /* Debug info records the compile directory */
+    if (debug_info) key_feed(&hash, directory, strlen(directory) + 1);
+
+    int fd = open(preprocessed, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    char buffer[65536];
+    ssize_t got;
+    while ((got = read(fd, buffer, sizeof(buffer))) > 0) key_feed(&hash, buffer, (size_t)got);
+    close(fd);
+    if (got < 0) return 0;
+
+    snprintf(key, COMPILE_CACHE_KEY_SIZE, "%016llx%016llx", (unsigned long long)hash.high, (unsigned long long)hash.low);
+    return 1;
+}
+
+/* ── Entries ────────────────────────────────────────────────────────────── */
+
+int compile_cache_enabled(void) {
+    char dir[PATH_MAX];
+    return cache_dir(dir, sizeof(dir));
+}
+
+int compile_cache_scratch(char* out, size_t out_size, int slot) {
+    char dir[PATH_MAX - 64];
+    if (!out || !cache_dir(dir, sizeof(dir))) return 0;
+    char scratch[PATH_MAX];
+    snprintf(scratch, sizeof(scratch), "%s/tmp", dir);
+    mkdir(scratch, 0700);
+    int len = snprintf(out, out_size, "%s/%d.%d.i", scratch, (int)getpid(), slot);
+    return len >= 0 && (size_t)len < out_size;
+}
+
+int compile_cache_fetch(const char* key, const char* object, char** output, size_t* output_len) {
+    if (output) *output = NULL;
+    if (output_len) *output_len = 0;
+    char entry[PATH_MAX];
+    if (!key || !object || !entry_path(entry, sizeof(entry), key, ".o")) return 0;
+    /* Marks the entry recently used; with hard links this is also the
+       restored object's mtime, which has to be newer than its sources */
+    if (utimensat(AT_FDCWD, entry, NULL, 0) != 0) return 0;
+    if (place_file(entry, object, hardlinks_enabled()) < 0) return 0;
+
+    char saved[PATH_MAX];
+    if (output && entry_path(saved, sizeof(saved), key, ".out")) {
+        size_t len = 0;
+        *output = read_file(saved, &len);
+        if (output_len) *output_len = *output ? len : 0;
+    }
+    return 1;
+}
+
+long long compile_cache_store(const char* key, const char* object, const char* output, size_t output_len) {
+    char entry[PATH_MAX], saved[PATH_MAX];
+    if (!key || !object || !entry_path(entry, sizeof(entry), key, ".o") ||
+        !entry_path(saved, sizeof(saved), key, ".out")) return 0;
+    char* slash = strrchr(entry, '/');
+    *slash = '\0';
+    mkdir(entry, 0700);
+    *slash = '/';
+
+    /* The output goes first: an entry exists once its .o does */
+    long long added = 0;
+    if (output_len > 0) {
+        if (!write_file(saved, output, output_len)) return 0;
+        added += (long long)output_len;
+    } else {
+        unlink(saved);
+    }
+    long long size = place_file(object, entry, hardlinks_enabled());
+    if (size < 0) {
+        unlink(saved);
+        return 0;
+    }
+    return added + size;
+}
+
+/* ── Statistics and eviction ────────────────────────────────────────────── */
+
+static int lock_cache(const char* dir) {
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/stats.lock", dir);
+    if (len < 0 || (size_t)len >= sizeof(path)) return -1;
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void unlock_cache(int fd) {
+    if (fd < 0) return;
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+/* Format: "JCCS 1" then "<name> <value>" per line */
+static void stats_load(const char* dir, compile_cache_stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/stats", dir);
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+    char line[128];
+    if (fgets(line, sizeof(line), in) && strcmp(line, CACHE_STATS_MAGIC "\n") == 0) {
+        char name[32];
+        unsigned long long value;
+        while (fgets(line, sizeof(line), in)) {
+            if (sscanf(line, "%31s %llu", name, &value) != 2) continue;
+            if (strcmp(name, "hits") == 0) stats->hits = value;
+            else if (strcmp(name, "misses") == 0) stats->misses = value;
+            else if (strcmp(name, "stored") == 0) stats->stored = value;
+            else if (strcmp(name, "evicted") == 0) stats->evicted = value;
+            else if (strcmp(name, "size") == 0) stats->size = (long long)value;
+        }
+    }
+    fclose(in);
+}
+
+static void stats_save(const char* dir, const compile_cache_stats* stats) {
+    char path[PATH_MAX], text[256];
+    snprintf(path, sizeof(path), "%s/stats", dir);
+    int len = snprintf(text, sizeof(text), "%s\nhits %llu\nmisses %llu\nstored %llu\nevicted %llu\nsize %lld\n",
+                       CACHE_STATS_MAGIC, stats->hits, stats->misses, stats->stored, stats->evicted, stats->size);
+    if (len > 0 && (size_t)len < sizeof(text)) write_file(path, text, (size_t)len);
+}
+
+static int compare_age(const void* a, const void* b) {
+    long long x = ((const CacheEntry*)a)->mtime, y = ((const CacheEntry*)b)->mtime;
+    return (x > y) - (x < y);
+}
+
+/* Lists every entry in the 256 key-prefix directories */
+static CacheEntry* list_entries(const char* dir, size_t* count, long long* total) {
+    CacheEntry* entries = NULL;
+    size_t cap = 0;
+    *count = 0;
+    *total = 0;
+    for (int prefix = 0; prefix < 256; prefix++) {
+        char sub[PATH_MAX];
+        snprintf(sub, sizeof(sub), "%s/%02x", dir, prefix);
+        DIR* listing = opendir(sub);
+        if (!listing) continue;
+        struct dirent* item;
+        while ((item = readdir(listing)) != NULL) {
+            size_t len = strlen(item->d_name);
+            if (len != COMPILE_CACHE_KEY_SIZE + 1 || strcmp(item->d_name + len - 2, ".o") != 0) continue;
+            char path[PATH_MAX], saved[PATH_MAX];
+            struct stat st, output;
+            int n = snprintf(path, sizeof(path), "%s/%s", sub, item->d_name);
+            if (n < 0 || (size_t)n >= sizeof(path) || stat(path, &st) != 0) continue;
+            long long size = (long long)st.st_size;
+            snprintf(saved, sizeof(saved), "%.*sout", (int)strlen(path) - 1, path);
+            if (stat(saved, &output) == 0) size += (long long)output.st_size;
+            if (*count == cap) {
+                cap = cap ? cap * 2 : 256;
+                CacheEntry* grown = realloc(entries, cap * sizeof(CacheEntry));
+                if (!grown) break;
+                entries = grown;
+            }
+            entries[*count].path = strdup(path);
+            if (!entries[*count].path) continue;
+            entries[*count].mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+            entries[*count].size = size;
+            *total += size;
+            (*count)++;
+        }
+        closedir(listing);
+    }
+    return entries;
+}
+
+static void remove_entry(const char* path) {
+    char saved[PATH_MAX];
+    snprintf(saved, sizeof(saved), "%.*sout", (int)strlen(path) - 1, path);
+    unlink(saved);
+    unlink(path);
+}
+
+/* Removes least recently used entries until the cache holds at most target
+   bytes; returns the objects removed and leaves the real size in stats */
+static int evict(const char* dir, long long target, compile_cache_stats* stats) {
+    size_t count = 0;
+    long long total = 0;
+    CacheEntry* entries = list_entries(dir, &count, &total);
+    qsort(entries, count, sizeof(CacheEntry), compare_age);
+    int removed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (total > target) {
+            remove_entry(entries[i].path);
+            total -= entries[i].size;
+            removed++;
+        }
+        free(entries[i].path);
+    }
+    free(entries);
+    stats->size = total;
+    stats->evicted += (unsigned long long)removed;
+    return removed;
+}
+
+void compile_cache_record(int hits, int misses, int stored, long long added) {
+    char dir[PATH_MAX];
+    if (!cache_dir(dir, sizeof(dir))) return;
+    int lock = lock_cache(dir);
+    compile_cache_stats stats;
+    stats_load(dir, &stats);
+    stats.hits += (unsigned long long)(hits > 0 ? hits : 0);
+    stats.misses += (unsigned long long)(misses > 0 ? misses : 0);
+    stats.stored += (unsigned long long)(stored > 0 ? stored : 0);
+    stats.size += added;
+    /* The running size is an estimate (replaced entries count twice); the
+       walk that evicts also corrects it. Trimming to 90% leaves headroom so
+       the next few builds do not walk the cache again. */
+    long long limit = cache_limit();
+    if (stats.size > limit) evict(dir, limit - limit / 10, &stats);
+    stats_save(dir, &stats);
+    unlock_cache(lock);
+}
+
+int compile_cache_get_stats(compile_cache_stats* stats) {
+    char dir[PATH_MAX];
+    if (!stats) return 0;
+    memset(stats, 0, sizeof(*stats));
+    if (!cache_dir(dir, sizeof(dir))) return 0;
+    int lock = lock_cache(dir);
+    stats_load(dir, stats);
+    unlock_cache(lock);
+    stats->limit = cache_limit();
+    return 1;
+}
+
+int compile_cache_clear(void) {
+    char dir[PATH_MAX];
+    if (!cache_dir(dir, sizeof(dir))) return 0;
+    int lock = lock_cache(dir);
+    size_t count = 0;
+    long long total = 0;
+    CacheEntry* entries = list_entries(dir, &count, &total);
+    for (size_t i = 0; i < count; i++) {
+        remove_entry(entries[i].path);
+        free(entries[i].path);
+    }
+    free(entries);
+    compile_cache_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats_save(dir, &stats);
+    unlock_cache(lock);
+    return (int)count;
+}
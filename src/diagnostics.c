@@ -0,0 +1,359 @@
+#include "../include/diagnostics.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+void diagnostics_init(diag_summary* summary) {
+    if (summary) memset(summary, 0, sizeof(*summary));
+}
+
+/* ── Groups ─────────────────────────────────────────────────────────────── */
+
+static void group_count(diag_group* groups, int* count, const char* name, diag_severity severity) {
+    if (!name[0]) return;
+    int i = 0;
+    while (i < *count && strcmp(groups[i].name, name) != 0) i++;
+    if (i == *count) {
+        if (*count == DIAG_GROUPS) return;
+        snprintf(groups[i].name, sizeof(groups[i].name), "%s", name);
+        (*count)++;
+    }
+    if (severity == DIAG_ERROR) groups[i].errors++;
+    else groups[i].warnings++;
+}
+
+static void record(diag_summary* summary, const diagnostic* diag) {
+    if (diag->severity == DIAG_NOTE) {
+        summary->notes++;
+        if (summary->last) summary->last->notes++;
+        return;
+    }
+
+    /* Warnings from a shared header repeat once per unit that includes it */
+    unsigned hash = 2166136261u;
+    const char* parts[] = { diag->file, diag->message };
+    for (int p = 0; p < 2; p++) {
+        for (const char* c = parts[p]; *c; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    hash = ((hash ^ (unsigned)diag->line) * 16777619u ^ (unsigned)diag->column) | 1;
+    size_t slot = hash % DIAG_SEEN;
+    for (size_t probe = 0; probe < DIAG_SEEN && summary->seen[slot]; probe++) {
+        if (summary->seen[slot] == hash) {
+            summary->last = NULL;
+            return;
+        }
+        slot = (slot + 1) % DIAG_SEEN;
+    }
+    if (!summary->seen[slot]) summary->seen[slot] = hash;
+
+    group_count(summary->files, &summary->file_count, diag->file, diag->severity);
+    group_count(summary->flags, &summary->flag_count, diag->flag, diag->severity);
+    summary->last = NULL;
+    if (diag->severity == DIAG_ERROR) {
+        summary->errors++;
+        if (summary->error_count < DIAG_KEPT) {
+            summary->last = &summary->first_errors[summary->error_count++];
+            *summary->last = *diag;
+        }
+    } else {
+        summary->warnings++;
+        if (summary->warning_count < DIAG_KEPT) {
+            summary->last = &summary->first_warnings[summary->warning_count++];
+            *summary->last = *diag;
+        }
+    }
+}
+
+/* ── Line parsing ───────────────────────────────────────────────────────── */
+
+/* Drops "\033[...m" colour sequences in place */
+static void strip_colour(char* line) {
+    char* out = line;
+    for (const char* in = line; *in;) {
+        if (in[0] == '\033' && in[1] == '[') {
+            in += 2;
+            while (*in && !isalpha((unsigned char)*in)) in++;
+            if (*in) in++;
+            continue;
+        }
+        *out++ = *in++;
+    }
+    *out = '\0';
+}
+
+/* Text between the first pair of quotes: 'x', `x' or the UTF-8 ‘x’ */
+static void quoted_name(const char* text, char* out, size_t out_size) {
+    out[0] = '\0';
+    const char* start = strpbrk(text, "'`\xe2");
+    if (!start) return;
+    start += (unsigned char)*start == 0xe2 ? 3 : 1;
+    size_t len = strcspn(start, "'\xe2");
+    snprintf(out, out_size, "%.*s", (int)len, start);
+}
+
+/* "[-Wunused-variable]", "[-Werror=unused-variable]" or clang's
+   "[-Werror,-Wunused-variable]" at the end of a message */
+static void take_flag(char* message, char* flag, size_t flag_size) {
+    flag[0] = '\0';
+    size_t len = strlen(message);
+    if (len < 4 || message[len - 1] != ']') return;
+    char* open = strrchr(message, '[');
+    if (!open || open == message || open[-1] != ' ' || (open[1] != '-')) return;
+
+    char inner[sizeof(((diagnostic*)0)->flag)];
+    snprintf(inner, sizeof(inner), "%.*s", (int)(message + len - 1 - open - 1), open + 1);
+    char* pick = inner;
+    char* save = NULL;
+    /* strtok_r: daemon workers, routine steps and the watch thread parse logs at once */
+    for (char* part = strtok_r(inner, ",", &save); part; part = strtok_r(NULL, ",", &save)) {
+        if (strcmp(part, "-Werror") != 0) {
+            pick = part;
+            break;
+        }
+    }
+    if (strncmp(pick, "-Werror=", 8) == 0) {
+        pick += 6;
+        pick[0] = '-';
+        pick[1] = 'W';
+    }
+    snprintf(flag, flag_size, "%s", pick);
+    /* gcc spells options that take a level as "-Wformat-truncation=" */
+    size_t flag_len = strlen(flag);
+    if (flag_len > 0 && flag[flag_len - 1] == '=') flag[flag_len - 1] = '\0';
+    open[-1] = '\0';
+}
+
+/* "src/a.c:12:5" → file, line, column */
+static void split_location(const char* text, size_t len, diagnostic* diag) {
+    char location[sizeof(diag->file)];
+    snprintf(location, sizeof(location), "%.*s", (int)len, text);
+    for (int part = 0; part < 2; part++) {
+        char* colon = strrchr(location, ':');
+        if (!colon || !colon[1] || strspn(colon + 1, "0123456789") != strlen(colon + 1)) break;
+        int value = atoi(colon + 1);
+        *colon = '\0';
+        diag->column = diag->line;
+        diag->line = value;
+    }
+    if (diag->line == 0) diag->column = 0;
+    memcpy(diag->file, location, sizeof(diag->file));
+}
+
+static int is_linker(const char* tool, size_t len) {
+    while (len > 0 && tool[len - 1] == ' ') len--;
+    const char* name = tool;
+    for (size_t i = 0; i < len; i++) {
+        if (tool[i] == '/') name = tool + i + 1;
+    }
+    size_t name_len = (size_t)(tool + len - name);
+    return (name_len == 2 && strncmp(name, "ld", 2) == 0) || (name_len > 3 && strncmp(name, "ld.", 3) == 0) ||
+           (name_len == 4 && strncmp(name, "mold", 4) == 0);
+}
+
+/* Lines from ld itself: "/usr/bin/ld: x.o: in function `main':",
+   "/usr/bin/ld: x.c:(.text+0x1a): undefined reference to `f'",
+   "/usr/bin/ld: cannot find -lfoo" */
+static int parse_linker_line(diag_summary* summary, const char* line) {
+    const char* rest = line;
+    const char* colon = strstr(line, ": ");
+    if (colon && is_linker(line, (size_t)(colon - line))) rest = colon + 2;
+    else if (!strstr(line, "undefined reference to ") && !strstr(line, "multiple definition of ")) return 0;
+
+    const char* in_function = strstr(rest, ": in function ");
+    if (in_function || strncmp(rest, "in function ", 12) == 0) {
+        quoted_name(in_function ? in_function : rest, summary->function, sizeof(summary->function));
+        return 1;
+    }
+    if (strstr(rest, "warning: ")) return 0;
+
+    diagnostic diag = { 0 };
+    diag.severity = DIAG_ERROR;
+    const char* section = strstr(rest, ":(");
+    const char* message = section ? strstr(section, "): ") : NULL;
+    if (section && message) {
+        snprintf(diag.file, sizeof(diag.file), "%.*s", (int)(section - rest), rest);
+        message += 3;
+    } else {
+        message = rest;
+    }
+    snprintf(diag.message, sizeof(diag.message), "%s", message);
+    snprintf(diag.function, sizeof(diag.function), "%s", summary->function);
+    record(summary, &diag);
+    return 1;
+}
+
+static const struct {
+    const char*   marker;
+    diag_severity severity;
+} g_markers[] = {
+    { "fatal error: ", DIAG_ERROR },
+    { "error: ",       DIAG_ERROR },
+    { "warning: ",     DIAG_WARNING },
+    { "note: ",        DIAG_NOTE },
+};
+
+static void parse_line(diag_summary* summary, char* line) {
+    strip_colour(line);
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) line[--len] = '\0';
+    /* Source excerpts, carets and "   from x.h:3" continuations are indented */
+    if (len == 0 || isspace((unsigned char)line[0])) return;
+    if (strncmp(line, "make", 4) == 0 && (line[4] == ':' || line[4] == '[')) return;
+
+    /* "a.c: In function 'main':" / "a.c: At top level:" */
+    const char* context = strstr(line, ": In function ");
+    if (!context) context = strstr(line, ": In member function ");
+    if (context) {
+        quoted_name(context, summary->function, sizeof(summary->function));
+        snprintf(summary->function_file, sizeof(summary->function_file), "%.*s", (int)(context - line), line);
+        return;
+    }
+    if (strstr(line, ": At top level:")) {
+        summary->function[0] = '\0';
+        return;
+    }
+    if (parse_linker_line(summary, line)) return;
+
+    /* The earliest "<severity>: " at the start or after ": " */
+    const char* found = NULL;
+    size_t marker_len = 0;
+    diag_severity severity = DIAG_NOTE;
+    for (size_t i = 0; i < sizeof(g_markers) / sizeof(g_markers[0]); i++) {
+        size_t mlen = strlen(g_markers[i].marker);
+        const char* at = strncmp(line, g_markers[i].marker, mlen) == 0 ? line : NULL;
+        for (const char* p = line; !at && (p = strstr(p, g_markers[i].marker)) != NULL; p++) {
+            if (p >= line + 2 && p[-1] == ' ' && p[-2] == ':') at = p;
+        }
+        if (at && (!found || at < found)) {
+            found = at;
+            marker_len = mlen;
+            severity = g_markers[i].severity;
+        }
+    }
+    if (!found) return;
+
+    diagnostic diag = { 0 };
+    diag.severity = severity;
+    if (found > line) split_location(line, (size_t)(found - 2 - line), &diag);
+    snprintf(diag.message, sizeof(diag.message), "%s", found + marker_len);
+    take_flag(diag.message, diag.flag, sizeof(diag.flag));
+
+    /* The driver's "ld returned 1 exit status" only repeats errors already seen */
+    if (severity == DIAG_ERROR && summary->errors > 0 &&
+        (strstr(diag.message, "ld returned") || strstr(diag.message, "linker command failed"))) return;
+    if (diag.line > 0 && strcmp(diag.file, summary->function_file) == 0) {
+        memcpy(diag.function, summary->function, sizeof(diag.function));
+    }
+    record(summary, &diag);
+}
+
+void diagnostics_feed(diag_summary* summary, const char* data, size_t len) {
+    if (!summary || !data) return;
+    while (len > 0) {
+        const char* newline = memchr(data, '\n', len);
+        size_t chunk = newline ? (size_t)(newline - data) : len;
+
+        /* Lines longer than the buffer keep their start, which holds the location */
+        size_t room = sizeof(summary->partial) - 1 - summary->partial_len;
+        size_t copy = chunk < room ? chunk : room;
+        memcpy(summary->partial + summary->partial_len, data, copy);
+        summary->partial_len += copy;
+        if (!newline) break;
+
+        summary->partial[summary->partial_len] = '\0';
+        parse_line(summary, summary->partial);
+        summary->partial_len = 0;
+        data += chunk + 1;
+        len -= chunk + 1;
+    }
+}
+
+void diagnostics_finish(diag_summary* summary) {
+    if (!summary || summary->partial_len == 0) return;
+    summary->partial[summary->partial_len] = '\0';
+    parse_line(summary, summary->partial);
+    summary->partial_len = 0;
+}
+
+/* ── Speakable summary ──────────────────────────────────────────────────── */
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+__attribute__((format(printf, 4, 5)))
+static size_t appendf(char* out, size_t out_size, size_t used, const char* format, ...) {
+    if (used >= out_size) return used;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(out + used, out_size - used, format, args);
+    va_end(args);
+    return written < 0 ? used : used + (size_t)written;
+}
+
+static size_t append_count(char* out, size_t out_size, size_t used, int count, const char* noun) {
+    return appendf(out, out_size, used, "%d %s%s", count, noun, count == 1 ? "" : "s");
+}
+
+/* "parser.c line 12: 'x' undeclared, in parse_expr." */
+static size_t append_diagnostic(char* out, size_t out_size, size_t used, const diagnostic* diag) {
+    if (diag->file[0] && diag->line > 0) used = appendf(out, out_size, used, "%s line %d: ", base_name(diag->file), diag->line);
+    else if (diag->file[0]) used = appendf(out, out_size, used, "%s: ", base_name(diag->file));
+    used = appendf(out, out_size, used, "%s", diag->message);
+    if (diag->function[0]) used = appendf(out, out_size, used, ", in %s", diag->function);
+    return appendf(out, out_size, used, ".");
+}
+
+/* The flag behind most warnings, if it covers at least half of them */
+static const diag_group* dominant_flag(const diag_summary* summary) {
+    const diag_group* best = NULL;
+    for (int i = 0; i < summary->flag_count; i++) {
+        if (!best || summary->flags[i].warnings > best->warnings) best = &summary->flags[i];
+    }
+    return best && best->warnings * 2 >= summary->warnings ? best : NULL;
+}
+
+int diagnostics_format(const diag_summary* summary, char* out, size_t out_size) {
+    if (!out || out_size == 0) return 0;
+    out[0] = '\0';
+    if (!summary || (summary->errors == 0 && summary->warnings == 0)) return 0;
+
+    size_t used = 0;
+    if (summary->errors > 0) {
+        used = appendf(out, out_size, used, "Build failed with ");
+        used = append_count(out, out_size, used, summary->errors, "error");
+        if (summary->warnings > 0) {
+            used = appendf(out, out_size, used, " and ");
+            used = append_count(out, out_size, used, summary->warnings, "warning");
+        }
+        int error_files = 0;
+        for (int i = 0; i < summary->file_count; i++) error_files += summary->files[i].errors > 0;
+        if (error_files > 1) used = appendf(out, out_size, used, " across %d files", error_files);
+        used = appendf(out, out_size, used, ". First error: ");
+        used = append_diagnostic(out, out_size, used, &summary->first_errors[0]);
+        if (summary->error_count > 1) {
+            used = appendf(out, out_size, used, " Next: ");
+            append_diagnostic(out, out_size, used, &summary->first_errors[1]);
+        }
+        return 1;
+    }
+
+    used = append_count(out, out_size, used, summary->warnings, "warning");
+    int warning_files = 0;
+    for (int i = 0; i < summary->file_count; i++) warning_files += summary->files[i].warnings > 0;
+    if (warning_files > 0) {
+        used = appendf(out, out_size, used, " in ");
+        used = append_count(out, out_size, used, warning_files, "file");
+    }
+    const diag_group* flag = dominant_flag(summary);
+    if (flag) {
+        const char* name = strncmp(flag->name, "-W", 2) == 0 ? flag->name + 2 : flag->name;
+        used = appendf(out, out_size, used, flag->warnings == summary->warnings ? ", all %s" : ", mostly %s", name);
+    }
+    used = appendf(out, out_size, used, ". First: ");
+    append_diagnostic(out, out_size, used, &summary->first_warnings[0]);
+    return 1;
+}
@@ -0,0 +1,329 @@
+#include "../include/dir_walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define WALK_MAX_THREADS   64
+#define WALK_DENTS_BUFFER  (32 * 1024)
+#define WALK_IDLE_SPINS    64
+
+/* One directory still to be read */
+typedef struct {
+    char*  path;
+    size_t len;
+} WalkItem;
+
+/* Owner pushes and pops at the tail (depth-first); thieves take from the head */
+typedef struct {
+    pthread_mutex_t lock;
+    WalkItem*       items;
+    size_t          head;
+    size_t          tail;
+    size_t          cap;
+} WalkDeque;
+
+typedef struct {
+    const dir_walk_options* options;
+    WalkDeque*  deques;
+    int         threads;
+    char        pattern[256];   /* lowercased name_pattern */
+    int         pattern_is_glob;
+    atomic_long pending;        /* queued + in-progress directories */
+    atomic_long matches;
+    atomic_int  stop;
+} WalkState;
+
+typedef struct {
+    WalkState* state;
+    int        worker;
+} WalkWorker;
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int dir_walk_threads(void) {
+    const char* configured = getenv("JARVIS_WALK_THREADS");
+    long threads = configured ? strtol(configured, NULL, 10) : 0;
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+    if (threads > WALK_MAX_THREADS) threads = WALK_MAX_THREADS;
+    return (int)threads;
+}
+
+/* ── Deques ─────────────────────────────────────────────────────────────── */
+
+static int deque_push(WalkDeque* deque, char* path, size_t len) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->cap) {
+        if (deque->head > 0) {
+            memmove(deque->items, deque->items + deque->head, (deque->tail - deque->head) * sizeof(WalkItem));
+            deque->tail -= deque->head;
+            deque->head = 0;
+        }
+        if (deque->tail == deque->cap) {
+            size_t cap = deque->cap ? deque->cap * 2 : 256;
+            WalkItem* grown = realloc(deque->items, cap * sizeof(WalkItem));
+            if (!grown) {
+                pthread_mutex_unlock(&deque->lock);
+                return 0;
+            }
+            deque->items = grown;
+            deque->cap = cap;
+        }
+    }
+    deque->items[deque->tail].path = path;
+    deque->items[deque->tail].len = len;
+    deque->tail++;
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+static int deque_pop(WalkDeque* deque, WalkItem* out) {
+    pthread_mutex_lock(&deque->lock);
+    int found = deque->tail > deque->head;
+    if (found) *out = deque->items[--deque->tail];
+    if (deque->tail == deque->head) deque->head = deque->tail = 0;
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal(WalkDeque* deque, WalkItem* out) {
+    if (pthread_mutex_trylock(&deque->lock) != 0) return 0;
+    int found = deque->tail > deque->head;
+    if (found) *out = deque->items[deque->head++];
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/* ── Per-directory work ─────────────────────────────────────────────────── */
+
+static int name_matches(const WalkState* state, const char* name) {
+    if (state->pattern[0] == '\0') return 1;
+
+    char lowered[NAME_MAX + 1];
+    size_t i = 0;
+    for (; name[i] && i < NAME_MAX; i++) lowered[i] = (char)tolower((unsigned char)name[i]);
+    lowered[i] = '\0';
+
+    if (state->pattern_is_glob) return fnmatch(state->pattern, lowered, FNM_PERIOD) == 0;
+    return strstr(lowered, state->pattern) != NULL;
+}
+
+/* Handles one entry of a directory; returns 0 to stop the walk */
+static int visit_entry(WalkState* state, int worker, char* path, size_t dir_len,
+                       const char* name, unsigned char type, int dir_fd) {
+    const dir_walk_options* options = state->options;
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) return 1;
+
+    size_t name_len = strlen(name);
+    if (dir_len + 1 + name_len >= PATH_MAX) return 1;
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+
+    if (type == DT_UNKNOWN) {
+        struct stat st;
+        if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return 1;
+        type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+    }
+
+    if (type == DT_DIR) {
+        if (name[0] == '.' && !options->include_hidden) return 1;
+        for (const char* const* skip = options->skip_dirs; skip && *skip; skip++) {
+            if (strcmp(name, *skip) == 0) return 1;
+        }
+        if (options->accept_dir && !options->accept_dir(path, dir_len + 1, options->ctx)) return 1;
+        char* child = malloc(dir_len + name_len + 2);
+        if (!child) return 1;
+        memcpy(child, path, dir_len + name_len + 2);
+        atomic_fetch_add(&state->pending, 1);
+        if (!deque_push(&state->deques[worker], child, dir_len + 1 + name_len)) {
+            atomic_fetch_sub(&state->pending, 1);
+            free(child);
+        }
+        return 1;
+    }
+
+    if (type != DT_REG || !name_matches(state, name)) return 1;
+
+    if (options->visit_file && !options->visit_file(path, dir_len + 1, worker, options->ctx)) return 0;
+    if (options->max_matches > 0 && atomic_fetch_add(&state->matches, 1) + 1 >= options->max_matches) return 0;
+    return 1;
+}
+
+#ifdef __linux__
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long          d_off;
+    unsigned short     d_reclen;
+    unsigned char      d_type;
+    char               d_name[];
+};
+#endif
+
+static void read_directory(WalkState* state, int worker, WalkItem* item) {
+    const dir_walk_options* options = state->options;
+    if (options->visit_dir) options->visit_dir(item->path, worker, options->ctx);
+
+    int fd = openat(AT_FDCWD, item->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return;
+
+    char path[PATH_MAX];
+    size_t dir_len = item->len;
+    memcpy(path, item->path, dir_len + 1);
+    if (dir_len == 1 && path[0] == '/') dir_len = 0;   /* root: avoid "//name" */
+
+#ifdef __linux__
+    char buffer[WALK_DENTS_BUFFER] __attribute__((aligned(8)));
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        for (long pos = 0; pos < n;) {
+            struct linux_dirent64* entry = (struct linux_dirent64*)(buffer + pos);
+            pos += entry->d_reclen;
+            if (!visit_entry(state, worker, path, dir_len, entry->d_name, entry->d_type, fd)) {
+                atomic_store(&state->stop, 1);
+                close(fd);
+                return;
+            }
+        }
+        if (atomic_load_explicit(&state->stop, memory_order_relaxed)) break;
+    }
+    close(fd);
+#else
+    DIR* dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!visit_entry(state, worker, path, dir_len, entry->d_name, entry->d_type, fd)) {
+            atomic_store(&state->stop, 1);
+            break;
+        }
+    }
+    closedir(dir);
+#endif
+}
+
+static int find_work(WalkState* state, int worker, WalkItem* out) {
+    if (deque_pop(&state->deques[worker], out)) return 1;
+    for (int i = 1; i < state->threads; i++) {
+        if (deque_steal(&state->deques[(worker + i) % state->threads], out)) return 1;
+    }
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    WalkWorker* self = arg;
+    WalkState* state = self->state;
+    const long long deadline = state->options->deadline_us;
+    int idle = 0;
+
+    while (!atomic_load_explicit(&state->stop, memory_order_relaxed)) {
+        WalkItem item;
+        if (!find_work(state, self->worker, &item)) {
+            if (atomic_load(&state->pending) == 0) break;
+            if (++idle < WALK_IDLE_SPINS) {
+                sched_yield();
+            } else {
+                struct timespec pause = { 0, 50 * 1000 };
+                nanosleep(&pause, NULL);
+            }
+            continue;
+        }
+        idle = 0;
+
+        if (deadline > 0 && monotonic_us() > deadline) atomic_store(&state->stop, 1);
+        else read_directory(state, self->worker, &item);
+        free(item.path);
+        atomic_fetch_sub(&state->pending, 1);
+    }
+    return NULL;
+}
+
+int dir_walk(const char* const* roots, int root_count, const dir_walk_options* options) {
+    if (!roots || root_count <= 0 || !options) return 1;
+
+    WalkState state;
+    memset(&state, 0, sizeof(state));
+    state.options = options;
+    state.threads = options->threads > 0 ? options->threads : dir_walk_threads();
+    if (state.threads > WALK_MAX_THREADS) state.threads = WALK_MAX_THREADS;
+
+    if (options->name_pattern) {
+        size_t i = 0;
+        for (; options->name_pattern[i] && i + 1 < sizeof(state.pattern); i++)
+            state.pattern[i] = (char)tolower((unsigned char)options->name_pattern[i]);
+        state.pattern[i] = '\0';
+        state.pattern_is_glob = strpbrk(state.pattern, "*?[") != NULL;
+    }
+
+    state.deques = calloc((size_t)state.threads, sizeof(WalkDeque));
+    if (!state.deques) return 0;
+    for (int i = 0; i < state.threads; i++) pthread_mutex_init(&state.deques[i].lock, NULL);
+
+    /* Roots are dealt round-robin so every worker starts with something */
+    for (int i = 0; i < root_count; i++) {
+        size_t len = strlen(roots[i]);
+        while (len > 1 && roots[i][len - 1] == '/') len--;
+        char* path = strndup(roots[i], len);
+        if (!path) continue;
+        atomic_fetch_add(&state.pending, 1);
+        if (!deque_push(&state.deques[i % state.threads], path, len)) {
+            atomic_fetch_sub(&state.pending, 1);
+            free(path);
+        }
+    }
+
+    /* Helpers block every signal; the caller's thread keeps its own mask */
+    WalkWorker workers[WALK_MAX_THREADS];
+    pthread_t threads[WALK_MAX_THREADS];
+    int started = 0;
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (int i = 1; i < state.threads; i++) {
+        workers[i].state = &state;
+        workers[i].worker = i;
+        if (pthread_create(&threads[started], NULL, worker_main, &workers[i]) == 0) started++;
+        else break;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    /* If some threads failed to start their deques are still reachable by stealing */
+    workers[0].state = &state;
+    workers[0].worker = 0;
+    worker_main(&workers[0]);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    /* Drain whatever a stop left behind */
+    int completed = !atomic_load(&state.stop);
+    for (int i = 0; i < state.threads; i++) {
+        WalkDeque* deque = &state.deques[i];
+        for (size_t k = deque->head; k < deque->tail; k++) free(deque->items[k].path);
+        free(deque->items);
+        pthread_mutex_destroy(&deque->lock);
+    }
+    free(state.deques);
+    return completed;
+}
@@ -0,0 +1,492 @@
+#include "../include/event_loop.h"
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#else
+#include <poll.h>
+#endif
+
+#define EVENT_LOOP_MAX_FDS      64
+#define EVENT_LOOP_MAX_TIMERS   16
+#define EVENT_LOOP_MAX_CHILDREN 32
+#define EVENT_LOOP_BATCH        32
+
+/* epoll tags: high 32 bits = kind, low 32 bits = slot index */
+#define TAG_FD     1ULL
+#define TAG_TIMER  2ULL
+#define TAG_SIGNAL 3ULL
+
+typedef struct {
+    int              fd;
+    int              active;
+    int              always_ready;   /* regular files: epoll refuses them */
+    event_fd_handler on_readable;
+    void*            userdata;
+} FdWatch;
+
+typedef struct {
+    int                 id;
+    int                 active;
+    int                 repeat;
+    int                 interval_ms;
+    int                 timer_fd;    /* Linux: timerfd */
+    long long           due_ms;      /* fallback: absolute monotonic deadline */
+    event_timer_handler on_expire;
+    void*               userdata;
+} TimerWatch;
+
+typedef struct {
+    pid_t               pid;
+    int                 active;
+    event_child_handler on_exit;
+    void*               userdata;
+} ChildWatch;
+
+static int        g_initialized = 0;
+static int        g_running = 0;
+static int        g_next_timer_id = 1;
+static FdWatch    g_fds[EVENT_LOOP_MAX_FDS];
+static TimerWatch g_timers[EVENT_LOOP_MAX_TIMERS];
+static ChildWatch g_children[EVENT_LOOP_MAX_CHILDREN];
+static sigset_t   g_sigchld_set;
+
+#ifdef __linux__
+static int g_epoll_fd  = -1;
+static int g_signal_fd = -1;
+#else
+static int g_sigchld_pipe[2] = {-1, -1};
+
+static void on_sigchld(int sig) {
+    (void)sig;
+    int saved = errno;
+    ssize_t ignored = write(g_sigchld_pipe[1], "c", 1);
+    (void)ignored;
+    errno = saved;
+}
+#endif
+
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void set_nonblocking_cloexec(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+int event_loop_init(void) {
+    if (g_initialized) return 1;
+
+    memset(g_fds, 0, sizeof(g_fds));
+    memset(g_timers, 0, sizeof(g_timers));
+    memset(g_children, 0, sizeof(g_children));
+
+    sigemptyset(&g_sigchld_set);
+    sigaddset(&g_sigchld_set, SIGCHLD);
+
+#ifdef __linux__
+    g_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epoll_fd < 0) return 0;
+
+    /* SIGCHLD must be blocked for signalfd to see it */
+    pthread_sigmask(SIG_BLOCK, &g_sigchld_set, NULL);
+    g_signal_fd = signalfd(-1, &g_sigchld_set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (g_signal_fd < 0) {
+        close(g_epoll_fd);
+        g_epoll_fd = -1;
+        pthread_sigmask(SIG_UNBLOCK, &g_sigchld_set, NULL);
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = TAG_SIGNAL << 32;
+    epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, g_signal_fd, &ev);
+#else
+    if (pipe(g_sigchld_pipe) != 0) return 0;
+    set_nonblocking_cloexec(g_sigchld_pipe[0]);
+    set_nonblocking_cloexec(g_sigchld_pipe[1]);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigchld;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+#endif
+
+    g_initialized = 1;
+    return 1;
+}
+
+void event_loop_shutdown(void) {
+    if (!g_initialized) return;
+
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (g_timers[i].active) event_loop_cancel_timer(g_timers[i].id);
+    }
+
+#ifdef __linux__
+    if (g_signal_fd >= 0) close(g_signal_fd);
+    if (g_epoll_fd >= 0) close(g_epoll_fd);
+    g_signal_fd = -1;
+    g_epoll_fd = -1;
+    pthread_sigmask(SIG_UNBLOCK, &g_sigchld_set, NULL);
+#else
+    signal(SIGCHLD, SIG_DFL);
+    close(g_sigchld_pipe[0]);
+    close(g_sigchld_pipe[1]);
+    g_sigchld_pipe[0] = g_sigchld_pipe[1] = -1;
+#endif
+
+    memset(g_fds, 0, sizeof(g_fds));
+    memset(g_children, 0, sizeof(g_children));
+    g_initialized = 0;
+}
+
+int event_loop_add_fd(int fd, event_fd_handler on_readable, void* userdata) {
+    if (!g_initialized || fd < 0 || !on_readable) return 0;
+
+    int slot = -1;
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (!g_fds[i].active) { slot = i; break; }
+    }
+    if (slot < 0) return 0;
+
+    g_fds[slot].fd = fd;
+    g_fds[slot].on_readable = on_readable;
+    g_fds[slot].userdata = userdata;
+    g_fds[slot].always_ready = 0;
+
+#ifdef __linux__
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (TAG_FD << 32) | (uint64_t)slot;
+    if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        if (errno != EPERM) return 0;
+        g_fds[slot].always_ready = 1;   /* regular file: reads never block */
+    }
+#endif
+
+    g_fds[slot].active = 1;
+    return 1;
+}
+
+void event_loop_remove_fd(int fd) {
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (g_fds[i].active && g_fds[i].fd == fd) {
+#ifdef __linux__
+            if (!g_fds[i].always_ready) epoll_ctl(g_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+            g_fds[i].active = 0;
+            return;
+        }
+    }
+}
+
+int event_loop_add_timer(int interval_ms, int repeat, event_timer_handler on_expire, void* userdata) {
+    if (!g_initialized || interval_ms <= 0 || !on_expire) return 0;
+
+    int slot = -1;
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (!g_timers[i].active) { slot = i; break; }
+    }
+    if (slot < 0) return 0;
+
+    TimerWatch* t = &g_timers[slot];
+    t->id = g_next_timer_id++;
+    t->repeat = repeat;
+    t->interval_ms = interval_ms;
+    t->on_expire = on_expire;
+    t->userdata = userdata;
+    t->due_ms = monotonic_ms() + interval_ms;
+    t->timer_fd = -1;
+
+#ifdef __linux__
+    t->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (t->timer_fd < 0) return 0;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = interval_ms / 1000;
+    spec.it_value.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+    if (repeat) spec.it_interval = spec.it_value;
+    timerfd_settime(t->timer_fd, 0, &spec, NULL);
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (TAG_TIMER << 32) | (uint64_t)slot;
+    if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, t->timer_fd, &ev) != 0) {
+        close(t->timer_fd);
+        return 0;
+    }
+#endif
+
+    t->active = 1;
+    return t->id;
+}
+
+void event_loop_cancel_timer(int timer_id) {
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (g_timers[i].active && g_timers[i].id == timer_id) {
+#ifdef __linux__
+            epoll_ctl(g_epoll_fd, EPOLL_CTL_DEL, g_timers[i].timer_fd, NULL);
+            close(g_timers[i].timer_fd);
+#endif
+            g_timers[i].active = 0;
+            return;
+        }
+    }
+}
+
+int event_loop_watch_child(pid_t pid, event_child_handler on_exit, void* userdata) {
+    if (!g_initialized || pid <= 0) return 0;
+    for (int i = 0; i < EVENT_LOOP_MAX_CHILDREN; i++) {
+        if (!g_children[i].active) {
+            g_children[i].pid = pid;
+            g_children[i].on_exit = on_exit;
+            g_children[i].userdata = userdata;
+            g_children[i].active = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+pid_t event_loop_spawn(char* const argv[], const char* stdin_text, int* stdout_fd) {
+    if (!argv || !argv[0]) return -1;
+
+    int in_pipe[2] = {-1, -1};
+    int out_pipe[2] = {-1, -1};
+    if (stdin_text && pipe(in_pipe) != 0) return -1;
+    if (stdout_fd && pipe(out_pipe) != 0) {
+        if (in_pipe[0] >= 0) { close(in_pipe[0]); close(in_pipe[1]); }
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        if (in_pipe[0] >= 0) { close(in_pipe[0]); close(in_pipe[1]); }
+        if (out_pipe[0] >= 0) { close(out_pipe[0]); close(out_pipe[1]); }
+        return -1;
+    }
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+
+    if (pid == 0) {
+        /* Child: default signal mask, stdio wired to the pipes or /dev/null */
+        sigset_t empty;
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, NULL);
+
+        int devnull = open("/dev/null", O_RDWR);
+        dup2(stdin_text ? in_pipe[0] : devnull, STDIN_FILENO);
+        dup2(stdout_fd ? out_pipe[1] : devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        if (in_pipe[0] >= 0) { close(in_pipe[0]); close(in_pipe[1]); }
+        if (out_pipe[0] >= 0) { close(out_pipe[0]); close(out_pipe[1]); }
+        if (devnull > STDERR_FILENO) close(devnull);
+
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    if (stdin_text) {
+        close(in_pipe[0]);
+        /* Short texts fit in the pipe buffer; never block the reactor on it */
+        set_nonblocking_cloexec(in_pipe[1]);
+        ssize_t ignored = write(in_pipe[1], stdin_text, strlen(stdin_text));
+        (void)ignored;
+        close(in_pipe[1]);
+    }
+    if (stdout_fd) {
+        close(out_pipe[1]);
+        set_nonblocking_cloexec(out_pipe[0]);
+        *stdout_fd = out_pipe[0];
+    }
+    return pid;
+}
+
+static int reap_children(void) {
+    int dispatched = 0;
+    for (int i = 0; i < EVENT_LOOP_MAX_CHILDREN; i++) {
+        if (!g_children[i].active) continue;
+        int status = 0;
+        pid_t r = waitpid(g_children[i].pid, &status, WNOHANG);
+        if (r == 0) continue;
+        if (r < 0 && errno == EINTR) continue;
+
+        /* Exited (or no longer ours to wait for): release the slot first so
+           the handler may register a new child into it */
+        ChildWatch done = g_children[i];
+        g_children[i].active = 0;
+        if (done.on_exit) done.on_exit(done.pid, r < 0 ? 0 : status, done.userdata);
+        dispatched++;
+    }
+    return dispatched;
+}
+
+static void fire_timer(int slot) {
+    TimerWatch* t = &g_timers[slot];
+    int id = t->id;
+    event_timer_handler fn = t->on_expire;
+    void* userdata = t->userdata;
+
+    if (!t->repeat) {
+        event_loop_cancel_timer(id);
+    } else {
+        t->due_ms = monotonic_ms() + t->interval_ms;
+    }
+    fn(id, userdata);
+}
+
+static int dispatch_always_ready(void) {
+    int dispatched = 0;
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (g_fds[i].active && g_fds[i].always_ready) {
+            g_fds[i].on_readable(g_fds[i].fd, g_fds[i].userdata);
+            dispatched++;
+        }
+    }
+    return dispatched;
+}
+
+static int has_always_ready(void) {
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (g_fds[i].active && g_fds[i].always_ready) return 1;
+    }
+    return 0;
+}
+
+int event_loop_run_once(int timeout_ms) {
+    if (!g_initialized) return -1;
+
+    if (has_always_ready()) timeout_ms = 0;
+    int dispatched = 0;
+
+#ifdef __linux__
+    struct epoll_event events[EVENT_LOOP_BATCH];
+    int n = epoll_wait(g_epoll_fd, events, EVENT_LOOP_BATCH, timeout_ms);
+    if (n < 0) {
+        if (errno != EINTR) return -1;
+        n = 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint64_t kind = events[i].data.u64 >> 32;
+        int slot = (int)(events[i].data.u64 & 0xffffffffULL);
+
+        if (kind == TAG_SIGNAL) {
+            struct signalfd_siginfo info;
+            while (read(g_signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+                /* drained; children are reaped below */
+            }
+        } else if (kind == TAG_TIMER) {
+            if (slot < EVENT_LOOP_MAX_TIMERS && g_timers[slot].active) {
+                uint64_t expirations = 0;
+                if (read(g_timers[slot].timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    fire_timer(slot);
+                    dispatched++;
+                }
+            }
+        } else if (kind == TAG_FD) {
+            if (slot < EVENT_LOOP_MAX_FDS && g_fds[slot].active) {
+                g_fds[slot].on_readable(g_fds[slot].fd, g_fds[slot].userdata);
+                dispatched++;
+            }
+        }
+    }
+#else
+    struct pollfd pfds[EVENT_LOOP_MAX_FDS + 1];
+    int slots[EVENT_LOOP_MAX_FDS + 1];
+    int count = 0;
+
+    pfds[count].fd = g_sigchld_pipe[0];
+    pfds[count].events = POLLIN;
+    slots[count++] = -1;
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (g_fds[i].active) {
+            pfds[count].fd = g_fds[i].fd;
+            pfds[count].events = POLLIN;
+            slots[count++] = i;
+        }
+    }
+
+    long long now = monotonic_ms();
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (!g_timers[i].active) continue;
+        long long wait = g_timers[i].due_ms - now;
+        if (wait < 0) wait = 0;
+        if (timeout_ms < 0 || wait < timeout_ms) timeout_ms = (int)wait;
+    }
+
+    int n = poll(pfds, (nfds_t)count, timeout_ms);
+    if (n < 0 && errno != EINTR) return -1;
+
+    for (int i = 0; n > 0 && i < count; i++) {
+        if (!(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+        if (slots[i] < 0) {
+            char drain[64];
+            while (read(g_sigchld_pipe[0], drain, sizeof(drain)) > 0) {}
+        } else if (g_fds[slots[i]].active && g_fds[slots[i]].fd == pfds[i].fd) {
+            g_fds[slots[i]].on_readable(pfds[i].fd, g_fds[slots[i]].userdata);
+            dispatched++;
+        }
+    }
+
+    now = monotonic_ms();
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        if (g_timers[i].active && g_timers[i].due_ms <= now) {
+            fire_timer(i);
+            dispatched++;
+        }
+    }
+#endif
+
+    dispatched += dispatch_always_ready();
+    dispatched += reap_children();
+    return dispatched;
+}
+
+void event_loop_run(void) {
+    g_running = 1;
+    while (g_running) {
+        if (event_loop_run_once(-1) < 0) break;
+    }
+}
+
+void event_loop_stop(void) {
+    g_running = 0;
+}
+
+void event_loop_enter_foreign(void) {
+#ifdef __linux__
+    if (g_initialized) pthread_sigmask(SIG_UNBLOCK, &g_sigchld_set, NULL);
+#endif
+}
+
+void event_loop_leave_foreign(void) {
+#ifdef __linux__
+    if (g_initialized) pthread_sigmask(SIG_BLOCK, &g_sigchld_set, NULL);
+#endif
+}
@@ -0,0 +1,881 @@
+#include "../include/file_index.h"
+#include "../include/log.h"
+#include "../include/trace.h"
+#include "../include/dir_walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#define CLR_CYAN   "\033[1;36m"
+#define CLR_YELLOW "\033[1;33m"
+
+#define TRIGRAM_BITS        16
+#define TRIGRAM_BUCKETS     (1u << TRIGRAM_BITS)
+#define QUERY_MAX_WORDS     8
+#define QUERY_MAX_LISTS     64
+#define INDEX_ROOTS_MAX     16
+#define OVERLAY_COMPACT_AT  4096
+#define LIVE_SCAN_BUDGET_US (3LL * 1000 * 1000)
+#define LIVE_SCAN_MAX_HITS  512
+
+enum { INDEX_IDLE, INDEX_CRAWLING, INDEX_READY, INDEX_DISABLED };
+
+/* ── Path lists (crawl output) ──────────────────────────────────────────── */
+
+typedef struct {
+    char*   arena;
+    size_t  arena_len;
+    size_t  arena_cap;
+    size_t* offsets;
+    size_t  count;
+    size_t  cap;
+} PathList;
+
+static int path_list_add(PathList* list, const char* path) {
+    size_t len = strlen(path) + 1;
+    if (list->arena_len + len > list->arena_cap) {
+        size_t cap = list->arena_cap ? list->arena_cap * 2 : 64 * 1024;
+        while (cap < list->arena_len + len) cap *= 2;
+        char* grown = realloc(list->arena, cap);
+        if (!grown) return 0;
+        list->arena = grown;
+        list->arena_cap = cap;
+    }
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 1024;
+        size_t* grown = realloc(list->offsets, cap * sizeof(size_t));
+        if (!grown) return 0;
+        list->offsets = grown;
+        list->cap = cap;
+    }
+    memcpy(list->arena + list->arena_len, path, len);
+    list->offsets[list->count++] = list->arena_len;
+    list->arena_len += len;
+    return 1;
+}
+
+static void path_list_free(PathList* list) {
+    free(list->arena);
+    free(list->offsets);
+    memset(list, 0, sizeof(*list));
+}
+
+/* ── Path table: sorted paths plus a trigram index over file names ─────── */
+
+typedef struct {
+    char*     arena;          /* NUL-terminated paths in strcmp order */
+    size_t*   offsets;        /* path id -> arena offset */
+    uint16_t* name_offsets;   /* path id -> start of the file name within the path */
+    uint8_t*  deleted;        /* tombstones set from inotify until the next compaction */
+    uint32_t  count;
+    uint32_t  deleted_count;
+    uint32_t* bucket_start;   /* TRIGRAM_BUCKETS + 1 offsets into postings */
+    uint32_t* postings;       /* ascending path ids per bucket */
+} PathTable;
+
+static uint32_t trigram_bucket(const char* s) {
+    uint32_t key = ((uint32_t)(unsigned char)tolower((unsigned char)s[0]) << 16) |
+                   ((uint32_t)(unsigned char)tolower((unsigned char)s[1]) << 8) |
+                   (uint32_t)(unsigned char)tolower((unsigned char)s[2]);
+    return (key * 2654435761u) >> (32 - TRIGRAM_BITS);
+}
+
+static const char* table_path(const PathTable* table, uint32_t id) {
+    return table->arena + table->offsets[id];
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static void table_free(PathTable* table) {
+    if (!table) return;
+    free(table->arena);
+    free(table->offsets);
+    free(table->name_offsets);
+    free(table->deleted);
+    free(table->bucket_start);
+    free(table->postings);
+    free(table);
+}
+
+/* Two passes over every file name: count distinct buckets per name, then fill.
+   Ids are visited in order, so each posting list comes out sorted. */
+static int table_build_trigrams(PathTable* table) {
+    uint32_t* last = calloc(TRIGRAM_BUCKETS, sizeof(uint32_t));
+    table->bucket_start = calloc(TRIGRAM_BUCKETS + 1, sizeof(uint32_t));
+    if (!last || !table->bucket_start) {
+        free(last);
+        return 0;
+    }
+
+    for (uint32_t id = 0; id < table->count; id++) {
+        const char* name = table_path(table, id) + table->name_offsets[id];
+        for (size_t i = 0; name[i] && name[i + 1] && name[i + 2]; i++) {
+            uint32_t bucket = trigram_bucket(name + i);
+            if (last[bucket] == id + 1) continue;
+            last[bucket] = id + 1;
+            table->bucket_start[bucket + 1]++;
+        }
+    }
+    for (uint32_t b = 0; b < TRIGRAM_BUCKETS; b++) {
+        table->bucket_start[b + 1] += table->bucket_start[b];
+    }
+
+    uint32_t* cursor = malloc(TRIGRAM_BUCKETS * sizeof(uint32_t));
+    table->postings = malloc(((size_t)table->bucket_start[TRIGRAM_BUCKETS] + 1) * sizeof(uint32_t));
+    if (!cursor || !table->postings) {
+        free(cursor);
+        free(last);
+        return 0;
+    }
+    memcpy(cursor, table->bucket_start, TRIGRAM_BUCKETS * sizeof(uint32_t));
+    memset(last, 0, TRIGRAM_BUCKETS * sizeof(uint32_t));
+
+    for (uint32_t id = 0; id < table->count; id++) {
+        const char* name = table_path(table, id) + table->name_offsets[id];
+        for (size_t i = 0; name[i] && name[i + 1] && name[i + 2]; i++) {
+            uint32_t bucket = trigram_bucket(name + i);
+            if (last[bucket] == id + 1) continue;
+            last[bucket] = id + 1;
+            table->postings[cursor[bucket]++] = id;
+        }
+    }
+
+    free(cursor);
+    free(last);
+    return 1;
+}
+
+static PathTable* table_build(const PathList* list) {
+    PathTable* table = calloc(1, sizeof(PathTable));
+    const char** sorted = malloc((list->count + 1) * sizeof(char*));
+    if (!table || !sorted) {
+        free(table);
+        free(sorted);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < list->count; i++) sorted[i] = list->arena + list->offsets[i];
+    qsort(sorted, list->count, sizeof(char*), compare_paths);
+
+    size_t unique = 0, bytes = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        if (unique > 0 && strcmp(sorted[unique - 1], sorted[i]) == 0) continue;
+        sorted[unique++] = sorted[i];
+        bytes += strlen(sorted[i]) + 1;
+    }
+
+    table->count = (uint32_t)unique;
+    table->arena = malloc(bytes + 1);
+    table->offsets = malloc((unique + 1) * sizeof(size_t));
+    table->name_offsets = malloc((unique + 1) * sizeof(uint16_t));
+    table->deleted = calloc(unique + 1, 1);
+    if (!table->arena || !table->offsets || !table->name_offsets || !table->deleted) {
+        free(sorted);
+        table_free(table);
+        return NULL;
+    }
+
+    size_t pos = 0;
+    for (size_t i = 0; i < unique; i++) {
+        size_t len = strlen(sorted[i]);
+        const char* slash = strrchr(sorted[i], '/');
+        memcpy(table->arena + pos, sorted[i], len + 1);
+        table->offsets[i] = pos;
+        table->name_offsets[i] = (uint16_t)(slash ? slash - sorted[i] + 1 : 0);
+        pos += len + 1;
+    }
+    free(sorted);
+
+    if (!table_build_trigrams(table)) {
+        table_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+/* First id whose path is >= key */
+static uint32_t table_lower_bound(const PathTable* table, const char* key) {
+    uint32_t lo = 0, hi = table->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strcmp(table_path(table, mid), key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* ── Shared state ───────────────────────────────────────────────────────── */
+
+static pthread_mutex_t  g_state_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   g_state_changed = PTHREAD_COND_INITIALIZER;
+static int              g_state = INDEX_IDLE;
+static char             g_roots[INDEX_ROOTS_MAX][PATH_MAX];
+static int              g_root_count = 0;
+
+/* Table plus an overlay of files created since it was built; only the
+   indexer thread writes, searches take the read lock */
+static pthread_rwlock_t g_index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static PathTable*       g_table = NULL;
+static char**           g_overlay = NULL;
+static size_t           g_overlay_count = 0;
+static size_t           g_overlay_cap = 0;
+
+static void load_roots(void) {
+    const char* configured = getenv("JARVIS_INDEX_ROOTS");
+    char roots[4096];
+    snprintf(roots, sizeof(roots), "%s", configured && configured[0] ? configured : (getenv("HOME") ? getenv("HOME") : ""));
+
+    g_root_count = 0;
+    char* save = NULL;
+    for (char* root = strtok_r(roots, ":", &save); root && g_root_count < INDEX_ROOTS_MAX;
+         root = strtok_r(NULL, ":", &save)) {
+        size_t len = strlen(root);
+        while (len > 1 && root[len - 1] == '/') root[--len] = '\0';
+
+        struct stat st;
+        if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+        snprintf(g_roots[g_root_count++], PATH_MAX, "%s", root);
+    }
+}
+
+static void set_state(int state) {
+    pthread_mutex_lock(&g_state_lock);
+    g_state = state;
+    pthread_cond_broadcast(&g_state_changed);
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* ── Matching and ranking ───────────────────────────────────────────────── */
+
+typedef struct {
+    char words[QUERY_MAX_WORDS][128];
+    int  count;
+    char joined[512];   /* lowercase words separated by single spaces */
+} ParsedQuery;
+
+static int parse_query(const char* query, ParsedQuery* parsed) {
+    memset(parsed, 0, sizeof(*parsed));
+    const char* p = query;
+    while (*p && parsed->count < QUERY_MAX_WORDS) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+
+        char* word = parsed->words[parsed->count];
+        size_t len = 0;
+        while (*p && !isspace((unsigned char)*p)) {
+            if (len + 1 < sizeof(parsed->words[0])) word[len++] = (char)tolower((unsigned char)*p);
+            p++;
+        }
+        word[len] = '\0';
+
+        size_t used = strlen(parsed->joined);
+        snprintf(parsed->joined + used, sizeof(parsed->joined) - used, "%s%s", used ? " " : "", word);
+        parsed->count++;
+    }
+    return parsed->count > 0;
+}
+
+/* Case-insensitive search for an already-lowercase needle */
+static const char* find_folded(const char* haystack, const char* needle) {
+    size_t n = strlen(needle);
+    for (const char* h = haystack; *h; h++) {
+        size_t i = 0;
+        while (i < n && h[i] && tolower((unsigned char)h[i]) == (unsigned char)needle[i]) i++;
+        if (i == n) return h;
+    }
+    return NULL;
+}
+
+/* Lower is better: match tier, then depth, then name length. -1 = no match. */
+static long match_score(const char* path, const ParsedQuery* query) {
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+
+    int boundary = 1;
+    for (int i = 0; i < query->count; i++) {
+        const char* word = query->words[i];
+        const char* hit = find_folded(strchr(word, '/') ? path : name, word);
+        if (!hit) return -1;
+        if (hit != name && hit != path && isalnum((unsigned char)hit[-1])) boundary = 0;
+    }
+
+    size_t name_len = strlen(name);
+    size_t joined_len = strlen(query->joined);
+    const char* dot = strrchr(name, '.');
+    size_t stem_len = dot && dot != name ? (size_t)(dot - name) : name_len;
+
+    int tier;
+    if ((name_len == joined_len || stem_len == joined_len) && strncasecmp(name, query->joined, joined_len) == 0)
+        tier = 0;
+    else if (strncasecmp(name, query->words[0], strlen(query->words[0])) == 0)
+        tier = 1;
+    else if (boundary)
+        tier = 2;
+    else
+        tier = 3;
+
+    long depth = 0;
+    for (const char* p = path; *p; p++) depth += *p == '/';
+    return (long)tier * 1000000L + depth * 1000L + (long)(name_len < 999 ? name_len : 999);
+}
+
+typedef struct {
+    char** paths;
+    long*  scores;
+    int    count;
+    int    max;
+} TopMatches;
+
+/* Keeps the best max matches in score order; ties keep the earlier path */
+static void top_offer(TopMatches* top, const char* path, long score) {
+    if (top->count == top->max && score >= top->scores[top->count - 1]) return;
+
+    char* copy = strdup(path);
+    if (!copy) return;
+
+    int pos;
+    if (top->count < top->max) {
+        pos = top->count++;
+    } else {
+        pos = top->count - 1;
+        free(top->paths[pos]);
+    }
+    while (pos > 0 && top->scores[pos - 1] > score) {
+        top->paths[pos] = top->paths[pos - 1];
+        top->scores[pos] = top->scores[pos - 1];
+        pos--;
+    }
+    top->paths[pos] = copy;
+    top->scores[pos] = score;
+}
+
+/* 1 if path is dir or lies below it */
+static int path_is_under(const char* path, const char* dir) {
+    size_t len = strlen(dir);
+    while (len > 1 && dir[len - 1] == '/') len--;
+    return strncmp(path, dir, len) == 0 && (path[len] == '\0' || path[len] == '/' || (len == 1 && dir[0] == '/'));
+}
+
+static int list_contains(const uint32_t* list, uint32_t len, uint32_t id) {
+    uint32_t lo = 0, hi = len;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (list[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < len && list[lo] == id;
+}
+
+/* Walks the shortest trigram posting list and probes the others; buckets are
+   hashed, so every candidate is verified against the real name */
+static void table_search(const PathTable* table, const ParsedQuery* query, TopMatches* top, const char* directory) {
+    const uint32_t* lists[QUERY_MAX_LISTS];
+    uint32_t lengths[QUERY_MAX_LISTS];
+    int list_count = 0;
+
+    for (int w = 0; w < query->count; w++) {
+        const char* word = query->words[w];
+        if (strchr(word, '/')) continue;
+        for (size_t i = 0; word[i] && word[i + 1] && word[i + 2] && list_count < QUERY_MAX_LISTS; i++) {
+            uint32_t bucket = trigram_bucket(word + i);
+            const uint32_t* list = table->postings + table->bucket_start[bucket];
+            uint32_t len = table->bucket_start[bucket + 1] - table->bucket_start[bucket];
+
+            int seen = 0;
+            for (int k = 0; k < list_count && !seen; k++) seen = lists[k] == list;
+            if (seen) continue;
+
+            int pos = list_count++;
+            while (pos > 0 && lengths[pos - 1] > len) {
+                lists[pos] = lists[pos - 1];
+                lengths[pos] = lengths[pos - 1];
+                pos--;
+            }
+            lists[pos] = list;
+            lengths[pos] = len;
+        }
+    }
+
+    uint32_t candidates = list_count > 0 ? lengths[0] : table->count;
+    for (uint32_t c = 0; c < candidates; c++) {
+        uint32_t id = list_count > 0 ? lists[0][c] : c;
+        if (table->deleted[id]) continue;
+        if (directory && !path_is_under(table_path(table, id), directory)) continue;
+
+        int in_all = 1;
+        for (int k = 1; k < list_count && in_all; k++) in_all = list_contains(lists[k], lengths[k], id);
+        if (!in_all) continue;
+
+        long score = match_score(table_path(table, id), query);
+        if (score >= 0) top_offer(top, table_path(table, id), score);
+    }
+}
+
+/* ── Index updates (indexer thread, write lock held) ────────────────────── */
+
+static void overlay_add(const char* path) {
+    for (size_t i = 0; i < g_overlay_count; i++) {
+        if (strcmp(g_overlay[i], path) == 0) return;
+    }
+    if (g_overlay_count == g_overlay_cap) {
+        size_t cap = g_overlay_cap ? g_overlay_cap * 2 : 64;
+        char** grown = realloc(g_overlay, cap * sizeof(char*));
+        if (!grown) return;
+        g_overlay = grown;
+        g_overlay_cap = cap;
+    }
+    char* copy = strdup(path);
+    if (copy) g_overlay[g_overlay_count++] = copy;
+}
+
+static void overlay_remove_prefix(const char* prefix, int exact) {
+    size_t len = strlen(prefix);
+    for (size_t i = 0; i < g_overlay_count;) {
+        int hit = exact ? strcmp(g_overlay[i], prefix) == 0 : strncmp(g_overlay[i], prefix, len) == 0;
+        if (hit) {
+            free(g_overlay[i]);
+            g_overlay[i] = g_overlay[--g_overlay_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+static void index_add(const char* path) {
+    if (g_table) {
+        uint32_t id = table_lower_bound(g_table, path);
+        if (id < g_table->count && strcmp(table_path(g_table, id), path) == 0) {
+            if (g_table->deleted[id]) {
+                g_table->deleted[id] = 0;
+                g_table->deleted_count--;
+            }
+            return;
+        }
+    }
+    overlay_add(path);
+}
+
+static void index_remove(const char* path, int whole_directory) {
+    char prefix[PATH_MAX + 1];
+    snprintf(prefix, sizeof(prefix), "%s%s", path, whole_directory ? "/" : "");
+    size_t len = strlen(prefix);
+
+    if (g_table) {
+        for (uint32_t id = table_lower_bound(g_table, prefix); id < g_table->count; id++) {
+            const char* candidate = table_path(g_table, id);
+            if (whole_directory ? strncmp(candidate, prefix, len) != 0 : strcmp(candidate, prefix) != 0) break;
+            if (!g_table->deleted[id]) {
+                g_table->deleted[id] = 1;
+                g_table->deleted_count++;
+            }
+        }
+    }
+    overlay_remove_prefix(prefix, !whole_directory);
+}
+
+/* ── Indexer thread ─────────────────────────────────────────────────────── */
+
+static int    g_inotify_fd = -1;
+static char** g_watch_paths = NULL;   /* watch descriptor -> directory */
+static int    g_watch_cap = 0;
+static int    g_watch_limit_warned = 0;
+static pthread_mutex_t g_watch_lock = PTHREAD_MUTEX_INITIALIZER;   /* crawl workers add watches concurrently */
+
+static void watch_directory(const char* path, int worker, void* ctx) {
+    (void)worker;
+    (void)ctx;
+#ifdef __linux__
+    if (g_inotify_fd < 0) return;
+    pthread_mutex_lock(&g_watch_lock);
+
+    int wd = inotify_add_watch(g_inotify_fd, path,
+                               IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                               IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK);
+    if (wd < 0) {
+        if (errno == ENOSPC && !g_watch_limit_warned) {
+            g_watch_limit_warned = 1;
+            log_message(LOG_WARN, CLR_YELLOW, "[INDEX]",
+                        "inotify watch limit reached; raise fs.inotify.max_user_watches to keep every directory current");
+        }
+        pthread_mutex_unlock(&g_watch_lock);
+        return;
+    }
+
+    if (wd >= g_watch_cap) {
+        int cap = g_watch_cap ? g_watch_cap : 256;
+        while (cap <= wd) cap *= 2;
+        char** grown = realloc(g_watch_paths, (size_t)cap * sizeof(char*));
+        if (!grown) {
+            pthread_mutex_unlock(&g_watch_lock);
+            return;
+        }
+        memset(grown + g_watch_cap, 0, (size_t)(cap - g_watch_cap) * sizeof(char*));
+        g_watch_paths = grown;
+        g_watch_cap = cap;
+    }
+    free(g_watch_paths[wd]);
+    g_watch_paths[wd] = strdup(path);
+    pthread_mutex_unlock(&g_watch_lock);
+#else
+    (void)path;
+#endif
+}
+
+static void forget_watch(int wd) {
+    if (wd < 0 || wd >= g_watch_cap) return;
+    free(g_watch_paths[wd]);
+    g_watch_paths[wd] = NULL;
+}
+
+/* Crawl output, one list per walker thread so workers never contend */
+typedef struct {
+    PathList* lists;
+} CrawlOutput;
+
+static int collect_file(const char* path, size_t name_offset, int worker, void* ctx) {
+    (void)name_offset;
+    path_list_add(&((CrawlOutput*)ctx)->lists[worker], path);
+    return 1;
+}
+
+/* Walks the given directories in parallel, adding watches as it goes, and
+   merges the per-thread results into one list */
+static int crawl_into(const char* const* roots, int root_count, PathList* out) {
+    int threads = dir_walk_threads();
+    CrawlOutput output = { calloc((size_t)threads, sizeof(PathList)) };
+    if (!output.lists) return 0;
+
+    dir_walk_options options = {0};
+    options.visit_file = collect_file;
+    options.visit_dir = watch_directory;
+    options.ctx = &output;
+    options.threads = threads;
+    dir_walk(roots, root_count, &options);
+
+    for (int i = 0; i < threads; i++) {
+        PathList* list = &output.lists[i];
+        for (size_t k = 0; k < list->count; k++) path_list_add(out, list->arena + list->offsets[k]);
+        path_list_free(list);
+    }
+    free(output.lists);
+    return 1;
+}
+
+static PathTable* crawl_roots(void) {
+    const char* roots[INDEX_ROOTS_MAX];
+    for (int i = 0; i < g_root_count; i++) roots[i] = g_roots[i];
+
+    PathList list = {0};
+    if (!crawl_into(roots, g_root_count, &list)) return NULL;
+    PathTable* table = table_build(&list);
+    path_list_free(&list);
+    return table;
+}
+
+static void install_table(PathTable* table) {
+    pthread_rwlock_wrlock(&g_index_lock);
+    PathTable* old = g_table;
+    g_table = table;
+    for (size_t i = 0; i < g_overlay_count; i++) free(g_overlay[i]);
+    g_overlay_count = 0;
+    pthread_rwlock_unlock(&g_index_lock);
+    table_free(old);
+}
+
+/* Folds the overlay and tombstones back into a fresh table */
+static void compact_index(void) {
+    PathList live = {0};
+    pthread_rwlock_rdlock(&g_index_lock);
+    for (uint32_t id = 0; g_table && id < g_table->count; id++) {
+        if (!g_table->deleted[id]) path_list_add(&live, table_path(g_table, id));
+    }
+    for (size_t i = 0; i < g_overlay_count; i++) path_list_add(&live, g_overlay[i]);
+    pthread_rwlock_unlock(&g_index_lock);
+
+    PathTable* table = table_build(&live);
+    path_list_free(&live);
+    if (table) install_table(table);
+}
+
+#ifdef __linux__
+static void open_inotify(void) {
+    if (g_inotify_fd >= 0) close(g_inotify_fd);
+    for (int i = 0; i < g_watch_cap; i++) forget_watch(i);
+    g_inotify_fd = inotify_init1(IN_CLOEXEC);
+}
+
+static void drop_watches_under(const char* dir) {
+    size_t len = strlen(dir);
+    for (int wd = 0; wd < g_watch_cap; wd++) {
+        const char* path = g_watch_paths[wd];
+        if (path && strncmp(path, dir, len) == 0 && (path[len] == '\0' || path[len] == '/')) {
+            inotify_rm_watch(g_inotify_fd, wd);
+            forget_watch(wd);
+        }
+    }
+}
+
+static void handle_event(const struct inotify_event* event, const char* path) {
+    int is_dir = (event->mask & IN_ISDIR) != 0;
+
+    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        if (is_dir) {
+            if (event->name[0] == '.') return;
+            PathList added = {0};
+            const char* root = path;
+            crawl_into(&root, 1, &added);
+
+            pthread_rwlock_wrlock(&g_index_lock);
+            for (size_t i = 0; i < added.count; i++) index_add(added.arena + added.offsets[i]);
+            pthread_rwlock_unlock(&g_index_lock);
+            path_list_free(&added);
+        } else {
+            struct stat st;
+            if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode)) return;
+            pthread_rwlock_wrlock(&g_index_lock);
+            index_add(path);
+            pthread_rwlock_unlock(&g_index_lock);
+        }
+    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        pthread_rwlock_wrlock(&g_index_lock);
+        index_remove(path, is_dir);
+        pthread_rwlock_unlock(&g_index_lock);
+        /* A moved directory keeps its watches under the old name; the
+           IN_MOVED_TO side re-watches it at the new one */
+        if (is_dir && (event->mask & IN_MOVED_FROM)) drop_watches_under(path);
+    }
+}
+
+static void watch_for_changes(void) {
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t n = read(g_inotify_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+
+        int overflowed = 0;
+        for (char* p = buffer; p < buffer + n;) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = 1;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                forget_watch(event->wd);
+                continue;
+            }
+            if (event->len == 0 || event->wd < 0 || event->wd >= g_watch_cap || !g_watch_paths[event->wd]) continue;
+
+            char path[PATH_MAX];
+            if ((size_t)snprintf(path, sizeof(path), "%s/%s", g_watch_paths[event->wd], event->name) >= sizeof(path))
+                continue;
+            handle_event(event, path);
+        }
+
+        if (overflowed) {
+            /* Events were lost: start over with fresh watches */
+            log_message(LOG_WARN, CLR_YELLOW, "[INDEX]", "inotify queue overflowed; re-crawling");
+            open_inotify();
+            PathTable* table = crawl_roots();
+            if (table) install_table(table);
+            if (g_inotify_fd < 0) return;
+            continue;
+        }
+
+        int compact;
+        pthread_rwlock_rdlock(&g_index_lock);
+        compact = g_overlay_count > OVERLAY_COMPACT_AT ||
+                  (g_table && g_table->deleted_count > g_table->count / 4 + 1024);
+        pthread_rwlock_unlock(&g_index_lock);
+        if (compact) compact_index();
+    }
+}
+#endif
+
+static void* indexer_main(void* arg) {
+    (void)arg;
+    /* Leave every signal to the threads that wait for them (signalfd, sigwait) */
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+#ifdef __linux__
+    open_inotify();
+#endif
+
+    long long start = trace_begin();
+    PathTable* table = crawl_roots();
+    long long elapsed = trace_end("file_index.crawl", start, NULL);
+    if (!table) {
+        log_message(LOG_WARN, CLR_YELLOW, "[INDEX]", "Could not build the file index; searches will scan live");
+        set_state(INDEX_DISABLED);
+        return NULL;
+    }
+
+    uint32_t count = table->count;
+    install_table(table);
+    set_state(INDEX_READY);
+    log_message(LOG_INFO, CLR_CYAN, "[INDEX]", "Indexed %u files under %d root(s) in %.1fs",
+                count, g_root_count, (double)elapsed / 1e6);
+
+#ifdef __linux__
+    if (g_inotify_fd >= 0) watch_for_changes();
+#endif
+    return NULL;
+}
+
+/* ── Public API ─────────────────────────────────────────────────────────── */
+
+int file_index_start(void) {
+    pthread_mutex_lock(&g_state_lock);
+    if (g_state == INDEX_IDLE) {
+        const char* flag = getenv("JARVIS_INDEX");
+        load_roots();
+        if ((flag && (strcmp(flag, "0") == 0 || strcasecmp(flag, "off") == 0 || strcasecmp(flag, "false") == 0)) ||
+            g_root_count == 0) {
+            g_state = INDEX_DISABLED;
+        } else {
+            pthread_t thread;
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+            g_state = pthread_create(&thread, &attr, indexer_main, NULL) == 0 ? INDEX_CRAWLING : INDEX_DISABLED;
+            pthread_attr_destroy(&attr);
+        }
+    }
+    int running = g_state == INDEX_CRAWLING || g_state == INDEX_READY;
+    pthread_mutex_unlock(&g_state_lock);
+    return running;
+}
+
+int file_index_wait_ready(int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_state_lock);
+    while (g_state == INDEX_CRAWLING) {
+        if (pthread_cond_timedwait(&g_state_changed, &g_state_lock, &deadline) == ETIMEDOUT) break;
+    }
+    int ready = g_state == INDEX_READY;
+    pthread_mutex_unlock(&g_state_lock);
+    return ready;
+}
+
+typedef struct {
+    const ParsedQuery* query;
+    TopMatches*        top;
+    pthread_mutex_t    lock;
+    long               hits;
+} LiveScan;
+
+static int offer_live_match(const char* path, size_t name_offset, int worker, void* ctx) {
+    (void)name_offset;
+    (void)worker;
+    LiveScan* scan = ctx;
+    long score = match_score(path, scan->query);
+    if (score < 0) return 1;
+
+    pthread_mutex_lock(&scan->lock);
+    top_offer(scan->top, path, score);
+    int more = ++scan->hits < LIVE_SCAN_MAX_HITS;
+    pthread_mutex_unlock(&scan->lock);
+    return more;
+}
+
+/* Bounded parallel scan, pre-filtered on the longest query word during the walk */
+static void live_scan(const char* const* roots, int root_count, const ParsedQuery* query, TopMatches* top) {
+    const char* filter = NULL;
+    for (int i = 0; i < query->count; i++) {
+        if (strchr(query->words[i], '/')) continue;
+        if (!filter || strlen(query->words[i]) > strlen(filter)) filter = query->words[i];
+    }
+
+    LiveScan scan = { query, top, PTHREAD_MUTEX_INITIALIZER, 0 };
+    dir_walk_options options = {0};
+    options.visit_file = offer_live_match;
+    options.ctx = &scan;
+    options.name_pattern = filter;
+    options.deadline_us = monotonic_us() + LIVE_SCAN_BUDGET_US;
+    dir_walk(roots, root_count, &options);
+    pthread_mutex_destroy(&scan.lock);
+}
+
+static int indexed_root_covers(const char* dir) {
+    for (int i = 0; i < g_root_count; i++) {
+        if (path_is_under(dir, g_roots[i])) return 1;
+    }
+    return 0;
+}
+
+int file_index_find_under(const char* directory, const char* query, char** paths, int max_paths) {
+    ParsedQuery parsed;
+    if (!query || !paths || max_paths <= 0 || !parse_query(query, &parsed)) return 0;
+
+    long* scores = malloc((size_t)max_paths * sizeof(long));
+    if (!scores) return 0;
+    TopMatches top = { paths, scores, 0, max_paths };
+    if (directory && directory[0] == '\0') directory = NULL;
+
+    file_index_start();
+    pthread_mutex_lock(&g_state_lock);
+    int use_index = g_state == INDEX_READY && (!directory || indexed_root_covers(directory));
+    pthread_mutex_unlock(&g_state_lock);
+
+    long long start = trace_begin();
+    if (use_index) {
+        pthread_rwlock_rdlock(&g_index_lock);
+        if (g_table) table_search(g_table, &parsed, &top, directory);
+        for (size_t i = 0; i < g_overlay_count; i++) {
+            if (directory && !path_is_under(g_overlay[i], directory)) continue;
+            long score = match_score(g_overlay[i], &parsed);
+            if (score >= 0) top_offer(&top, g_overlay[i], score);
+        }
+        pthread_rwlock_unlock(&g_index_lock);
+    } else if (directory) {
+        /* Outside the indexed roots (or index not ready): scan just that directory */
+        live_scan(&directory, 1, &parsed, &top);
+    } else {
+        const char* roots[INDEX_ROOTS_MAX];
+        for (int i = 0; i < g_root_count; i++) roots[i] = g_roots[i];
+        live_scan(roots, g_root_count, &parsed, &top);
+    }
+    trace_end("file_index.find", start, use_index ? "index" : "live scan");
+
+    free(scores);
+    return top.count;
+}
+
+int file_index_find(const char* query, char** paths, int max_paths) {
+    return file_index_find_under(NULL, query, paths, max_paths);
+}
@@ -0,0 +1,291 @@
+#include "../include/file_meta.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define META_RING_ENTRIES   256
+#define META_MAX_THREADS    16
+#define META_PATHS_PER_THREAD 16
+
+static _Atomic(const char*) g_backend = "threads";
+
+const char* file_meta_backend(void) {
+    return atomic_load(&g_backend);
+}
+
+/* ── Thread-pool fallback ───────────────────────────────────────────────── */
+
+typedef struct {
+    const char* const* paths;
+    file_meta*         out;
+    int                count;
+    atomic_int         next;
+} StatBatch;
+
+static void stat_one(const char* path, file_meta* meta) {
+    struct stat st;
+    memset(meta, 0, sizeof(*meta));
+    if (stat(path, &st) != 0) return;
+    meta->ok = 1;
+    meta->size = (long long)st.st_size;
+    meta->mtime = (long long)st.st_mtime;
+}
+
+static void* stat_worker(void* arg) {
+    StatBatch* batch = arg;
+    int i;
+    while ((i = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+        stat_one(batch->paths[i], &batch->out[i]);
+    }
+    return NULL;
+}
+
+static void collect_with_threads(const char* const* paths, int count, file_meta* out) {
+    StatBatch batch = { paths, out, count, 0 };
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = count / META_PATHS_PER_THREAD + 1;
+    if (threads > cores && cores > 0) threads = (int)cores;
+    if (threads > META_MAX_THREADS) threads = META_MAX_THREADS;
+
+    pthread_t workers[META_MAX_THREADS];
+    int started = 0;
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, stat_worker, &batch) == 0) started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    stat_worker(&batch);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+}
+
+/* ── io_uring (raw syscalls, no liburing) ───────────────────────────────── */
+
+#ifdef __linux__
+/* The ring lives for the whole process, so its mappings are never unmapped */
+typedef struct {
+    int                  fd;
+    unsigned*            sq_tail;
+    unsigned*            sq_mask;
+    unsigned*            sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned*            cq_head;
+    unsigned*            cq_tail;
+    unsigned*            cq_mask;
+    struct io_uring_cqe* cqes;
+} Ring;
+
+static Ring            g_ring = { .fd = -1 };
+static int             g_ring_state = 0;   /* 0 untried, 1 usable, -1 unavailable */
+static pthread_mutex_t g_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ring_setup(Ring* ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, META_RING_ENTRIES, &params);
+    if (fd < 0) return 0;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && cq_size > sq_size) sq_size = cq_size;
+
+    void* sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    void* cq = sq;
+    if (!single) {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            munmap(sq, sq_size);
+            close(fd);
+            return 0;
+        }
+    }
+    size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (!single) munmap(cq, cq_size);
+        munmap(sq, sq_size);
+        close(fd);
+        return 0;
+    }
+
+    ring->fd = fd;
+    ring->sq_tail = (unsigned*)((char*)sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)((char*)sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)((char*)sq + params.sq_off.array);
+    ring->sqes = sqes;
+    ring->cq_head = (unsigned*)((char*)cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)((char*)cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)((char*)cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)cq + params.cq_off.cqes);
+    return 1;
+}
+
+/* Queues one statx per path, submits them with a single io_uring_enter and
+   reaps every completion; paths the kernel did not take are stat()ed here.
+   Returns 0 if the ring cannot do statx. */
+static int ring_statx_batch(Ring* ring, const char* const* paths, int count, file_meta* out,
+                            struct statx* buffers) {
+    unsigned tail = *ring->sq_tail;
+    unsigned mask = *ring->sq_mask;
+    for (int i = 0; i < count; i++) {
+        unsigned slot = (tail + (unsigned)i) & mask;
+        struct io_uring_sqe* sqe = &ring->sqes[slot];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long)(uintptr_t)paths[i];
+        sqe->len = STATX_SIZE | STATX_MTIME;
+        sqe->off = (unsigned long long)(uintptr_t)&buffers[i];
+        sqe->statx_flags = 0;
+        sqe->user_data = (unsigned long long)i;
+        ring->sq_array[slot] = slot;
+    }
+    __atomic_store_n(ring->sq_tail, tail + (unsigned)count, __ATOMIC_RELEASE);
+
+    int submitted = 0;
+    while (submitted < count) {
+        int rc = (int)syscall(__NR_io_uring_enter, ring->fd, (unsigned)(count - submitted),
+                              (unsigned)(count - submitted), IORING_ENTER_GETEVENTS, NULL, 0);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) break;
+        submitted += rc;
+    }
+    /* A short submit: take back the SQEs the kernel never consumed, so the next
+       batch does not submit them, and only wait for the ones it did */
+    if (submitted < count) {
+        __atomic_store_n(ring->sq_tail, tail + (unsigned)submitted, __ATOMIC_RELEASE);
+        if (submitted == 0) return 0;
+    }
+
+    int reaped = 0, unsupported = 0;
+    while (reaped < submitted) {
+        unsigned head = *ring->cq_head;
+        unsigned ready = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == ready) {
+            if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+                return 0;
+            continue;
+        }
+        for (; head != ready; head++, reaped++) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            int i = (int)cqe->user_data;
+            if (i < 0 || i >= submitted) continue;
+            if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) unsupported = 1;
+            memset(&out[i], 0, sizeof(out[i]));
+            if (cqe->res == 0) {
+                out[i].ok = 1;
+                out[i].size = (long long)buffers[i].stx_size;
+                out[i].mtime = (long long)buffers[i].stx_mtime.tv_sec;
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    for (int i = submitted; i < count; i++) stat_one(paths[i], &out[i]);
+    return !unsupported;
+}
+
+static int collect_with_ring(const char* const* paths, int count, file_meta* out) {
+    pthread_mutex_lock(&g_ring_lock);
+    if (g_ring_state == 0) {
+        const char* disabled = getenv("JARVIS_NO_IO_URING");
+        g_ring_state = (disabled && strcmp(disabled, "0") != 0) || !ring_setup(&g_ring) ? -1 : 1;
+    }
+    if (g_ring_state < 0) {
+        pthread_mutex_unlock(&g_ring_lock);
+        return 0;
+    }
+
+    struct statx* buffers = malloc(META_RING_ENTRIES * sizeof(struct statx));
+    int ok = buffers != NULL;
+    for (int done = 0; ok && done < count; done += META_RING_ENTRIES) {
+        int batch = count - done < META_RING_ENTRIES ? count - done : META_RING_ENTRIES;
+        ok = ring_statx_batch(&g_ring, paths + done, batch, out + done, buffers);
+    }
+    free(buffers);
+    if (!ok) g_ring_state = -1;   /* e.g. a kernel without IORING_OP_STATX: use threads from now on */
+    pthread_mutex_unlock(&g_ring_lock);
+    return ok;
+}
+#endif
+
+int file_meta_collect(const char* const* paths, int count, file_meta* out) {
+    if (!paths || !out || count <= 0) return 0;
+
+    long long start = trace_begin();
+    int via_ring = 0;
+#ifdef __linux__
+    via_ring = collect_with_ring(paths, count, out);
+#endif
+    if (!via_ring) collect_with_threads(paths, count, out);
+    atomic_store(&g_backend, via_ring ? "io_uring" : "threads");
+    trace_end("file_meta.collect", start, via_ring ? "io_uring" : "threads");
+
+    int found = 0;
+    for (int i = 0; i < count; i++) found += out[i].ok;
+    return found;
+}
+
+/* ── Sorting ────────────────────────────────────────────────────────────── */
+
+typedef struct {
+    char*     path;
+    file_meta meta;
+    int       rank;
+} SortEntry;
+
+static int compare_newest(const void* a, const void* b) {
+    const SortEntry* x = a;
+    const SortEntry* y = b;
+    if (x->meta.ok != y->meta.ok) return y->meta.ok - x->meta.ok;
+    if (x->meta.mtime != y->meta.mtime) return x->meta.mtime > y->meta.mtime ? -1 : 1;
+    return x->rank - y->rank;
+}
+
+static int compare_largest(const void* a, const void* b) {
+    const SortEntry* x = a;
+    const SortEntry* y = b;
+    if (x->meta.ok != y->meta.ok) return y->meta.ok - x->meta.ok;
+    if (x->meta.size != y->meta.size) return x->meta.size > y->meta.size ? -1 : 1;
+    return x->rank - y->rank;
+}
+
+void file_meta_sort(char** paths, file_meta* meta, int count, file_sort order) {
+    if (!paths || !meta || count <= 1) return;
+
+    SortEntry* entries = malloc((size_t)count * sizeof(SortEntry));
+    if (!entries) return;
+    for (int i = 0; i < count; i++) {
+        entries[i].path = paths[i];
+        entries[i].meta = meta[i];
+        entries[i].rank = i;
+    }
+    qsort(entries, (size_t)count, sizeof(SortEntry), order == FILE_SORT_LARGEST ? compare_largest : compare_newest);
+    for (int i = 0; i < count; i++) {
+        paths[i] = entries[i].path;
+        meta[i] = entries[i].meta;
+    }
+    free(entries);
+}
@@ -0,0 +1,1275 @@
+#include "../include/git_repo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define GIT_MAX_OBJECT_SIZE (256u * 1024 * 1024)
+#define GIT_MAX_DELTA_DEPTH 64
+#define GIT_MAX_SYMREF_DEPTH 5
+#define GIT_MAX_WALK        200000
+
+typedef struct {
+    char* key;      /* "section.key" or "section.subsection.key", section and key lowercased */
+    char* value;
+} ConfigEntry;
+
+typedef struct {
+    char*         name;
+    unsigned char oid[GIT_OID_RAWSZ];
+} PackedRef;
+
+typedef struct {
+    char                 path[PATH_MAX];   /* the .pack */
+    const unsigned char* idx;
+    size_t               idx_len;
+    const unsigned char* data;             /* mapped on first use */
+    size_t               data_len;
+    uint32_t             count;
+} Pack;
+
+struct git_repo {
+    char         workdir[PATH_MAX];
+    char         gitdir[PATH_MAX];
+    char         commondir[PATH_MAX];
+    char**       object_dirs;              /* objects/ and its alternates */
+    int          object_dir_count;
+    ConfigEntry* config;
+    size_t       config_count;
+    size_t       config_cap;
+    PackedRef*   packed;
+    size_t       packed_count;
+    int          packed_loaded;
+    Pack*        packs;
+    size_t       pack_count;
+    int          packs_loaded;
+};
+
+/* ── SHA-1 ──────────────────────────────────────────────────────────────── */
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(unsigned int state[5], const unsigned char* p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = ROL32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL32(b, 30);
+        b = a;
+        a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void git_sha1_init(git_sha1_ctx* ctx) {
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+}
+
+void git_sha1_update(git_sha1_ctx* ctx, const void* data, size_t len) {
+    const unsigned char* p = data;
+    size_t used = (size_t)(ctx->length % 64);
+    ctx->length += len;
+    if (used > 0) {
+        size_t take = 64 - used < len ? 64 - used : len;
+        memcpy(ctx->block + used, p, take);
+        p += take;
+        len -= take;
+        if (used + take < 64) return;
+        sha1_block(ctx->state, ctx->block);
+    }
+    for (; len >= 64; p += 64, len -= 64) sha1_block(ctx->state, p);
+    memcpy(ctx->block, p, len);
+}
+
+void git_sha1_final(git_sha1_ctx* ctx, unsigned char out[GIT_OID_RAWSZ]) {
+    unsigned long long bits = ctx->length * 8;
+    static const unsigned char zeros[64] = { 0x80 };
+    size_t used = (size_t)(ctx->length % 64);
+    git_sha1_update(ctx, zeros, used < 56 ? 56 - used : 120 - used);
+    unsigned char length[8];
+    for (int i = 0; i < 8; i++) length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    git_sha1_update(ctx, length, sizeof(length));
+    for (int i = 0; i < 5; i++) {
+        out[4 * i] = (unsigned char)(ctx->state[i] >> 24);
+        out[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+        out[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+        out[4 * i + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+/* ── Object ids ─────────────────────────────────────────────────────────── */
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+int git_oid_parse(const char* hex, unsigned char* oid) {
+    if (!hex) return 0;
+    for (int i = 0; i < GIT_OID_RAWSZ; i++) {
+        int high = hex_value(hex[2 * i]);
+        int low = high < 0 ? -1 : hex_value(hex[2 * i + 1]);
+        if (low < 0) return 0;
+        oid[i] = (unsigned char)(high << 4 | low);
+    }
+    return 1;
+}
+
+void git_oid_format(const unsigned char* oid, char* hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < GIT_OID_RAWSZ; i++) {
+        hex[2 * i] = digits[oid[i] >> 4];
+        hex[2 * i + 1] = digits[oid[i] & 15];
+    }
+    hex[GIT_OID_HEXSZ - 1] = '\0';
+}
+
+/* ── Inflate (RFC 1950/1951) ────────────────────────────────────────────── */
+
+#define INFLATE_MAX_BITS 15
+
+typedef struct {
+    const unsigned char* in;
+    size_t               in_len;
+    size_t               in_pos;
+    unsigned int         bit_buf;
+    int                  bit_count;
+    int                  error;
+    unsigned char*       out;
+    size_t               out_len;
+    size_t               out_cap;
+} Inflater;
+
+typedef struct {
+    short count[INFLATE_MAX_BITS + 1];   /* codes of each length */
+    short symbol[288];                   /* symbols ordered by code */
+} Huffman;
+
+static unsigned int take_bits(Inflater* s, int need) {
+    unsigned long value = s->bit_buf;
+    while (s->bit_count < need) {
+        if (s->in_pos == s->in_len) {
+            s->error = 1;
+            return 0;
+        }
+        value |= (unsigned long)s->in[s->in_pos++] << s->bit_count;
+        s->bit_count += 8;
+    }
+    s->bit_buf = (unsigned int)(value >> need);
+    s->bit_count -= need;
+    return (unsigned int)(value & ((1UL << need) - 1));
+}
+
+static int reserve_output(Inflater* s, size_t extra) {
+    if (s->out_len + extra <= s->out_cap) return 1;
+    if (s->out_len + extra > GIT_MAX_OBJECT_SIZE) return 0;
+    size_t cap = s->out_cap ? s->out_cap : 4096;
+    while (cap < s->out_len + extra) cap *= 2;
+    unsigned char* grown = realloc(s->out, cap);
+    if (!grown) return 0;
+    s->out = grown;
+    s->out_cap = cap;
+    return 1;
+}
+
+static int build_huffman(Huffman* h, const short* lengths, int n) {
+    memset(h->count, 0, sizeof(h->count));
+    for (int symbol = 0; symbol < n; symbol++) h->count[lengths[symbol]]++;
+    if (h->count[0] == n) return 0;
+
+    int left = 1;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) return left;   /* over-subscribed */
+    }
+    short offsets[INFLATE_MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int len = 1; len < INFLATE_MAX_BITS; len++) offsets[len + 1] = (short)(offsets[len] + h->count[len]);
+    for (int symbol = 0; symbol < n; symbol++) {
+        if (lengths[symbol] != 0) h->symbol[offsets[lengths[symbol]]++] = (short)symbol;
+    }
+    return left;                     /* > 0: incomplete, allowed for single-code tables */
+}
+
+static int decode_symbol(Inflater* s, const Huffman* h) {
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        code |= (int)take_bits(s, 1);
+        if (s->error) return -1;
+        int count = h->count[len];
+        if (code - count < first) return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static int inflate_codes(Inflater* s, const Huffman* lengths, const Huffman* distances) {
+    static const short base_length[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const short extra_length[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const short base_distance[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+                                             385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193,
+                                             12289, 16385, 24577 };
+    static const short extra_distance[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                              7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    for (;;) {
+        int symbol = decode_symbol(s, lengths);
+        if (symbol < 0) return 0;
+        if (symbol < 256) {
+            if (!reserve_output(s, 1)) return 0;
+            s->out[s->out_len++] = (unsigned char)symbol;
+        } else if (symbol == 256) {
+            return 1;
+        } else {
+            symbol -= 257;
+            if (symbol >= 29) return 0;
+            size_t length = (size_t)base_length[symbol] + take_bits(s, extra_length[symbol]);
+            symbol = decode_symbol(s, distances);
+            if (symbol < 0 || symbol >= 30) return 0;
+            size_t distance = (size_t)base_distance[symbol] + take_bits(s, extra_distance[symbol]);
+            if (s->error || distance > s->out_len || !reserve_output(s, length)) return 0;
+            for (size_t i = 0; i < length; i++, s->out_len++) s->out[s->out_len] = s->out[s->out_len - distance];
+        }
+    }
+}
+
+static int inflate_stored(Inflater* s) {
+    s->bit_buf = 0;
+    s->bit_count = 0;
+    if (s->in_pos + 4 > s->in_len) return 0;
+    size_t length = s->in[s->in_pos] | (size_t)s->in[s->in_pos + 1] << 8;
+    size_t complement = s->in[s->in_pos + 2] | (size_t)s->in[s->in_pos + 3] << 8;
+    s->in_pos += 4;
+    if (length != (~complement & 0xffff) || s->in_pos + length > s->in_len) return 0;
+    if (!reserve_output(s, length)) return 0;
+    memcpy(s->out + s->out_len, s->in + s->in_pos, length);
+    s->out_len += length;
+    s->in_pos += length;
+    return 1;
+}
+
+static int inflate_fixed(Inflater* s) {
+    static Huffman lengths, distances;
+    static int built;
+    if (!built) {
+        short table[288];
+        int symbol = 0;
+        for (; symbol < 144; symbol++) table[symbol] = 8;
+        for (; symbol < 256; symbol++) table[symbol] = 9;
+        for (; symbol < 280; symbol++) table[symbol] = 7;
+        for (; symbol < 288; symbol++) table[symbol] = 8;
+        build_huffman(&lengths, table, 288);
+        for (symbol = 0; symbol < 30; symbol++) table[symbol] = 5;
+        build_huffman(&distances, table, 30);
+        built = 1;
+    }
+    return inflate_codes(s, &lengths, &distances);
+}
+
+static int inflate_dynamic(Inflater* s) {
+    static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    int length_count = (int)take_bits(s, 5) + 257;
+    int distance_count = (int)take_bits(s, 5) + 1;
+    int code_count = (int)take_bits(s, 4) + 4;
+    if (s->error || length_count > 286 || distance_count > 30) return 0;
+
+    short table[320];
+    int index = 0;
+    for (; index < code_count; index++) table[order[index]] = (short)take_bits(s, 3);
+    for (; index < 19; index++) table[order[index]] = 0;
+    Huffman lengths, distances;
+    if (s->error || build_huffman(&lengths, table, 19) != 0) return 0;
+
+    index = 0;
+    while (index < length_count + distance_count) {
+        int symbol = decode_symbol(s, &lengths);
+        if (symbol < 0) return 0;
+        if (symbol < 16) {
+            table[index++] = (short)symbol;
+            continue;
+        }
+        short repeat_length = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) return 0;
+            repeat_length = table[index - 1];
+            repeat = 3 + (int)take_bits(s, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + (int)take_bits(s, 3);
+        } else {
+            repeat = 11 + (int)take_bits(s, 7);
+        }
+        if (s->error || index + repeat > length_count + distance_count) return 0;
+        while (repeat--) table[index++] = repeat_length;
+    }
+    if (table[256] == 0) return 0;
+
+    int err = build_huffman(&lengths, table, length_count);
+    if (err < 0 || (err > 0 && length_count - lengths.count[0] != 1)) return 0;
+    err = build_huffman(&distances, table + length_count, distance_count);
+    if (err < 0 || (err > 0 && distance_count - distances.count[0] != 1)) return 0;
+    return inflate_codes(s, &lengths, &distances);
+}
+
+/* Inflates a zlib stream; expected is the exact output size when known (0 = unknown) */
+static int inflate_zlib(const unsigned char* in, size_t in_len, size_t expected, unsigned char** out, size_t* out_len) {
+    *out = NULL;
+    *out_len = 0;
+    if (in_len < 2 || (in[0] & 0x0f) != 8 || (in[1] & 0x20) || ((in[0] << 8) | in[1]) % 31 != 0) return 0;
+    if (expected > GIT_MAX_OBJECT_SIZE) return 0;
+
+    Inflater s = { in, in_len, 2, 0, 0, 0, NULL, 0, 0 };
+    if (!reserve_output(&s, expected + 1)) return 0;
+    int last = 0;
+    while (!last) {
+        last = (int)take_bits(&s, 1);
+        unsigned int type = take_bits(&s, 2);
+        int ok = !s.error && (type == 0 ? inflate_stored(&s) : type == 1 ? inflate_fixed(&s)
+                              : type == 2 ? inflate_dynamic(&s) : 0);
+        if (!ok || s.error) {
+            free(s.out);
+            return 0;
+        }
+    }
+    if ((expected > 0 && s.out_len != expected) || !reserve_output(&s, 1)) {
+        free(s.out);
+        return 0;
+    }
+    s.out[s.out_len] = '\0';
+    *out = s.out;
+    *out_len = s.out_len;
+    return 1;
+}
+
+/* ── Files and config ───────────────────────────────────────────────────── */
+
+static char* read_file(const char* path, size_t* len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (unsigned long long)st.st_size > GIT_MAX_OBJECT_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    char* data = malloc((size_t)st.st_size + 1);
+    size_t have = 0;
+    while (data && have < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + have, (size_t)st.st_size - have);
+        if (n <= 0) break;
+        have += (size_t)n;
+    }
+    close(fd);
+    if (!data) return NULL;
+    data[have] = '\0';
+    if (len) *len = have;
+    return data;
+}
+
+/* First line of a small file, e.g. HEAD or a loose ref */
+static int read_line(const char* path, char* out, size_t out_size) {
+    FILE* in = fopen(path, "r");
+    if (!in) return 0;
+    int ok = fgets(out, (int)out_size, in) != NULL;
+    fclose(in);
+    if (!ok) return 0;
+    out[strcspn(out, "\r\n")] = '\0';
+    return 1;
+}
+
+static void config_add(git_repo* repo, const char* section, const char* key, const char* value) {
+    if (repo->config_count == repo->config_cap) {
+        size_t cap = repo->config_cap ? repo->config_cap * 2 : 32;
+        ConfigEntry* grown = realloc(repo->config, cap * sizeof(ConfigEntry));
+        if (!grown) return;
+        repo->config = grown;
+        repo->config_cap = cap;
+    }
+    size_t len = strlen(section) + strlen(key) + 2;
+    char* full = malloc(len);
+    char* copy = strdup(value);
+    if (!full || !copy) {
+        free(full);
+        free(copy);
+        return;
+    }
+    snprintf(full, len, "%s.%s", section, key);
+    repo->config[repo->config_count].key = full;
+    repo->config[repo->config_count].value = copy;
+    repo->config_count++;
+}
+
+/* Parses a value: quotes removed, escapes applied, trailing comment and whitespace dropped */
+static void parse_config_value(const char* p, char* out, size_t out_size) {
+    size_t len = 0;
+    size_t keep = 0;            /* length without trailing unquoted whitespace */
+    int quoted = 0;
+    while (*p == ' ' || *p == '\t') p++;
+    for (; *p && *p != '\n' && *p != '\r' && len + 1 < out_size; p++) {
+        if (*p == '"') {
+            quoted = !quoted;
+            keep = len;
+            continue;
+        }
+        if (!quoted && (*p == '#' || *p == ';')) break;
+        char c = *p;
+        if (c == '\\' && p[1]) {
+            c = *++p;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+        }
+        out[len++] = c;
+        if (quoted || (c != ' ' && c != '\t')) keep = len;
+    }
+    out[keep] = '\0';
+}
+
+static void config_load(git_repo* repo, const char* path) {
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+    char line[1024];
+    char section[256] = "";
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#' || *p == ';') continue;
+
+        if (*p == '[') {
+            size_t len = 0;
+            for (p++; *p && *p != ']' && *p != ' ' && *p != '"' && len + 1 < sizeof(section); p++) {
+                section[len++] = (char)tolower((unsigned char)*p);
+            }
+            while (*p == ' ') p++;
+            if (*p == '"' && len + 1 < sizeof(section)) {
+                section[len++] = '.';
+                for (p++; *p && *p != '"' && len + 1 < sizeof(section); p++) {
+                    if (*p == '\\' && p[1]) p++;
+                    section[len++] = *p;
+                }
+            }
+            section[len] = '\0';
+            continue;
+        }
+        if (section[0] == '\0' || !isalpha((unsigned char)*p)) continue;
+
+        char key[128];
+        size_t len = 0;
+        for (; (isalnum((unsigned char)*p) || *p == '-') && len + 1 < sizeof(key); p++) {
+            key[len++] = (char)tolower((unsigned char)*p);
+        }
+        key[len] = '\0';
+        while (*p == ' ' || *p == '\t') p++;
+        char value[1024] = "true";
+        if (*p == '=') parse_config_value(p + 1, value, sizeof(value));
+        config_add(repo, section, key, value);
+    }
+    fclose(in);
+}
+
+/* "Section.Sub.Key" -> "section.Sub.key" */
+static void normalize_key(const char* key, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s", key);
+    char* first = strchr(out, '.');
+    char* last = strrchr(out, '.');
+    for (char* p = out; *p; p++) {
+        if (!first || p < first || p > last) *p = (char)tolower((unsigned char)*p);
+    }
+}
+
+const char* git_repo_config(const git_repo* repo, const char* key) {
+    if (!repo || !key) return NULL;
+    char wanted[512];
+    normalize_key(key, wanted, sizeof(wanted));
+    for (size_t i = repo->config_count; i-- > 0;) {
+        if (strcmp(repo->config[i].key, wanted) == 0) return repo->config[i].value;
+    }
+    return NULL;
+}
+
+static int config_true(const char* value) {
+    return value && (strcasecmp(value, "true") == 0 || strcasecmp(value, "yes") == 0 ||
+                     strcasecmp(value, "on") == 0 || strcmp(value, "1") == 0);
+}
+
+/* ── Discovery ──────────────────────────────────────────────────────────── */
+
+/* Resolves a path read from a file next to base ("gitdir: ..", commondir, alternates) */
+static int resolve_relative(const char* base, const char* path, char* out) {
+    char joined[PATH_MAX * 2];
+    if (path[0] == '/') snprintf(joined, sizeof(joined), "%s", path);
+    else snprintf(joined, sizeof(joined), "%s/%s", base, path);
+    return realpath(joined, out) != NULL;
+}
+
+static void add_object_dir(git_repo* repo, const char* dir, int depth) {
+    char** grown = realloc(repo->object_dirs, (size_t)(repo->object_dir_count + 1) * sizeof(char*));
+    if (!grown) return;
+    repo->object_dirs = grown;
+    char* copy = strdup(dir);
+    if (!copy) return;
+    repo->object_dirs[repo->object_dir_count++] = copy;
+
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/info/alternates", dir);
+    FILE* in = depth < 5 ? fopen(path, "r") : NULL;
+    if (!in) return;
+    char line[PATH_MAX];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char resolved[PATH_MAX];
+        if (line[0] != '\0' && line[0] != '#' && resolve_relative(dir, line, resolved)) {
+            add_object_dir(repo, resolved, depth + 1);
+        }
+    }
+    fclose(in);
+}
+
+static int is_git_dir(const char* path) {
+    char head[PATH_MAX + 16];
+    struct stat st;
+    snprintf(head, sizeof(head), "%s/HEAD", path);
+    return stat(head, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+git_repo* git_repo_open(const char* path, int* found) {
+    if (found) *found = 0;
+    if (getenv("GIT_DIR") || getenv("GIT_WORK_TREE") || getenv("GIT_INDEX_FILE") || getenv("GIT_OBJECT_DIRECTORY")) {
+        if (found) *found = 1;
+        return NULL;
+    }
+    char dir[PATH_MAX];
+    if (!realpath(path ? path : ".", dir)) return NULL;
+
+    char gitdir[PATH_MAX] = "";
+    for (;;) {
+        char candidate[PATH_MAX + 8];
+        snprintf(candidate, sizeof(candidate), "%s/.git", strcmp(dir, "/") == 0 ? "" : dir);
+        struct stat st;
+        if (lstat(candidate, &st) == 0) {
+            if (S_ISDIR(st.st_mode) && is_git_dir(candidate)) {
+                snprintf(gitdir, sizeof(gitdir), "%.*s", PATH_MAX - 1, candidate);
+            } else if (S_ISREG(st.st_mode)) {
+                char line[PATH_MAX];
+                if (read_line(candidate, line, sizeof(line)) && strncmp(line, "gitdir: ", 8) == 0 &&
+                    !resolve_relative(dir, line + 8, gitdir)) {
+                    gitdir[0] = '\0';
+                }
+            }
+            if (gitdir[0] != '\0') break;
+        }
+        if (strcmp(dir, "/") == 0) return NULL;
+        char* slash = strrchr(dir, '/');
+        if (slash == dir) slash[1] = '\0';
+        else *slash = '\0';
+    }
+    if (found) *found = 1;
+
+    /* Inside the git directory itself: git reports no work tree there */
+    char start[PATH_MAX];
+    size_t gitdir_len = strlen(gitdir);
+    if (realpath(path ? path : ".", start) && strncmp(start, gitdir, gitdir_len) == 0 &&
+        (start[gitdir_len] == '\0' || start[gitdir_len] == '/')) {
+        return NULL;
+    }
+
+    git_repo* repo = calloc(1, sizeof(git_repo));
+    if (!repo) return NULL;
+    snprintf(repo->workdir, sizeof(repo->workdir), "%s", dir);
+    snprintf(repo->gitdir, sizeof(repo->gitdir), "%s", gitdir);
+    char line[PATH_MAX];
+    char commondir_file[PATH_MAX + 16];
+    snprintf(commondir_file, sizeof(commondir_file), "%s/commondir", gitdir);
+    if (!read_line(commondir_file, line, sizeof(line)) || !resolve_relative(gitdir, line, repo->commondir)) {
+        snprintf(repo->commondir, sizeof(repo->commondir), "%s", gitdir);
+    }
+
+    const char* home = getenv("HOME");
+    const char* xdg = getenv("XDG_CONFIG_HOME");
+    char config_path[PATH_MAX + 32];
+    if (!getenv("GIT_CONFIG_NOSYSTEM")) config_load(repo, "/etc/gitconfig");
+    if (xdg && xdg[0] == '/') snprintf(config_path, sizeof(config_path), "%s/git/config", xdg);
+    else snprintf(config_path, sizeof(config_path), "%s/.config/git/config", home ? home : "/");
+    config_load(repo, config_path);
+    if (home) {
+        snprintf(config_path, sizeof(config_path), "%s/.gitconfig", home);
+        config_load(repo, config_path);
+    }
+    snprintf(config_path, sizeof(config_path), "%s/config", repo->commondir);
+    config_load(repo, config_path);
+
+    const char* format = git_repo_config(repo, "extensions.objectformat");
+    const char* refs = git_repo_config(repo, "extensions.refstorage");
+    if (config_true(git_repo_config(repo, "core.bare")) || git_repo_config(repo, "core.worktree") ||
+        (format && strcasecmp(format, "sha1") != 0) || (refs && strcasecmp(refs, "files") != 0)) {
+        git_repo_close(repo);
+        return NULL;
+    }
+
+    char objects[PATH_MAX + 16];
+    snprintf(objects, sizeof(objects), "%s/objects", repo->commondir);
+    add_object_dir(repo, objects, 0);
+    return repo;
+}
+
+void git_repo_close(git_repo* repo) {
+    if (!repo) return;
+    for (int i = 0; i < repo->object_dir_count; i++) free(repo->object_dirs[i]);
+    free(repo->object_dirs);
+    for (size_t i = 0; i < repo->config_count; i++) {
+        free(repo->config[i].key);
+        free(repo->config[i].value);
+    }
+    free(repo->config);
+    for (size_t i = 0; i < repo->packed_count; i++) free(repo->packed[i].name);
+    free(repo->packed);
+    for (size_t i = 0; i < repo->pack_count; i++) {
+        munmap((void*)repo->packs[i].idx, repo->packs[i].idx_len);
+        if (repo->packs[i].data) munmap((void*)repo->packs[i].data, repo->packs[i].data_len);
+    }
+    free(repo->packs);
+    free(repo);
+}
+
+const char* git_repo_workdir(const git_repo* repo) {
+    return repo ? repo->workdir : NULL;
+}
+
+const char* git_repo_gitdir(const git_repo* repo) {
+    return repo ? repo->gitdir : NULL;
+}
+
+/* ── Refs ───────────────────────────────────────────────────────────────── */
+
+static void load_packed_refs(git_repo* repo) {
+    repo->packed_loaded = 1;
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/packed-refs", repo->commondir);
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+    char line[1024];
+    size_t cap = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        unsigned char oid[GIT_OID_RAWSZ];
+        if (line[0] == '#' || line[0] == '^' || !git_oid_parse(line, oid) || line[GIT_OID_HEXSZ - 1] != ' ') continue;
+        if (repo->packed_count == cap) {
+            size_t grown_cap = cap ? cap * 2 : 64;
+            PackedRef* grown = realloc(repo->packed, grown_cap * sizeof(PackedRef));
+            if (!grown) break;
+            repo->packed = grown;
+            cap = grown_cap;
+        }
+        char* name = strdup(line + GIT_OID_HEXSZ);
+        if (!name) break;
+        repo->packed[repo->packed_count].name = name;
+        memcpy(repo->packed[repo->packed_count].oid, oid, GIT_OID_RAWSZ);
+        repo->packed_count++;
+    }
+    fclose(in);
+}
+
+/* HEAD, pseudo-refs and refs/worktree, refs/bisect and refs/rewritten belong to each worktree */
+static const char* ref_dir(const git_repo* repo, const char* name) {
+    if (strncmp(name, "refs/", 5) != 0 || strncmp(name, "refs/worktree/", 14) == 0 ||
+        strncmp(name, "refs/bisect/", 12) == 0 || strncmp(name, "refs/rewritten/", 15) == 0) {
+        return repo->gitdir;
+    }
+    return repo->commondir;
+}
+
+static int resolve_ref(git_repo* repo, const char* name, unsigned char* oid, int depth) {
+    if (depth > GIT_MAX_SYMREF_DEPTH || strstr(name, "..") != NULL) return 0;
+    char path[PATH_MAX * 2];
+    char line[1024];
+    snprintf(path, sizeof(path), "%s/%s", ref_dir(repo, name), name);
+    if (read_line(path, line, sizeof(line))) {
+        if (strncmp(line, "ref: ", 5) == 0) return resolve_ref(repo, line + 5, oid, depth + 1);
+        return git_oid_parse(line, oid);
+    }
+
+    if (!repo->packed_loaded) load_packed_refs(repo);
+    for (size_t i = 0; i < repo->packed_count; i++) {
+        if (strcmp(repo->packed[i].name, name) == 0) {
+            memcpy(oid, repo->packed[i].oid, GIT_OID_RAWSZ);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int git_repo_resolve(git_repo* repo, const char* name, unsigned char* oid) {
+    return repo && name && oid && resolve_ref(repo, name, oid, 0);
+}
+
+int git_repo_head(git_repo* repo, char* branch, size_t branch_size, unsigned char* oid) {
+    if (branch_size > 0) branch[0] = '\0';
+    char path[PATH_MAX + 8];
+    char line[1024];
+    snprintf(path, sizeof(path), "%s/HEAD", repo->gitdir);
+    if (!read_line(path, line, sizeof(line))) return -1;
+    if (strncmp(line, "ref: ", 5) == 0) {
+        const char* name = line + 5;
+        snprintf(branch, branch_size, "%s", strncmp(name, "refs/heads/", 11) == 0 ? name + 11 : name);
+        return resolve_ref(repo, name, oid, 1) ? 1 : 0;
+    }
+    return git_oid_parse(line, oid) ? 1 : -1;
+}
+
+int git_repo_upstream(const git_repo* repo, const char* branch, char* out, size_t out_size) {
+    char key[512];
+    snprintf(key, sizeof(key), "branch.%s.remote", branch);
+    const char* remote = git_repo_config(repo, key);
+    snprintf(key, sizeof(key), "branch.%s.merge", branch);
+    const char* merge = git_repo_config(repo, key);
+    if (!remote || !merge || branch[0] == '\0') return 0;
+
+    int len;
+    if (strcmp(remote, ".") == 0) len = snprintf(out, out_size, "%s", merge);
+    else if (strncmp(merge, "refs/heads/", 11) == 0) len = snprintf(out, out_size, "refs/remotes/%s/%s", remote, merge + 11);
+    else return 0;
+    return len > 0 && (size_t)len < out_size;
+}
+
+/* ── Objects ────────────────────────────────────────────────────────────── */
+
+static const char* const TYPE_NAMES[] = { NULL, "commit", "tree", "blob", "tag" };
+
+static int read_loose(const git_repo* repo, const unsigned char* oid, git_object_type* type, char** data, size_t* len) {
+    char hex[GIT_OID_HEXSZ];
+    git_oid_format(oid, hex);
+    for (int i = 0; i < repo->object_dir_count; i++) {
+        char path[PATH_MAX + 48];
+        snprintf(path, sizeof(path), "%s/%.2s/%s", repo->object_dirs[i], hex, hex + 2);
+        size_t raw_len;
+        char* raw = read_file(path, &raw_len);
+        if (!raw) continue;
+        unsigned char* inflated;
+        size_t inflated_len;
+        int ok = inflate_zlib((const unsigned char*)raw, raw_len, 0, &inflated, &inflated_len);
+        free(raw);
+        if (!ok) return 0;
+
+        /* "<type> <size>\0<content>" */
+        char* header_end = memchr(inflated, '\0', inflated_len);
+        char* space = header_end ? memchr(inflated, ' ', (size_t)(header_end - (char*)inflated)) : NULL;
+        int found_type = 0;
+        for (int t = GIT_OBJ_COMMIT; space && t <= GIT_OBJ_TAG; t++) {
+            size_t name_len = strlen(TYPE_NAMES[t]);
+            if ((size_t)(space - (char*)inflated) == name_len && memcmp(inflated, TYPE_NAMES[t], name_len) == 0) {
+                found_type = t;
+            }
+        }
+        size_t content_len = header_end ? inflated_len - (size_t)(header_end + 1 - (char*)inflated) : 0;
+        if (!found_type || strtoull(space + 1, NULL, 10) != content_len) {
+            free(inflated);
+            return 0;
+        }
+        memmove(inflated, header_end + 1, content_len + 1);
+        *type = (git_object_type)found_type;
+        *data = (char*)inflated;
+        *len = content_len;
+        return 1;
+    }
+    return 0;
+}
+
+static uint32_t read_be32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static const void* map_file(const char* path, size_t* len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *len = (size_t)st.st_size;
+    return data;
+}
+
+/* Maps every version 2 pack index */
+static void load_packs(git_repo* repo) {
+    repo->packs_loaded = 1;
+    for (int d = 0; d < repo->object_dir_count; d++) {
+        char dir_path[PATH_MAX + 8];
+        snprintf(dir_path, sizeof(dir_path), "%s/pack", repo->object_dirs[d]);
+        DIR* dir = opendir(dir_path);
+        if (!dir) continue;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            size_t name_len = strlen(entry->d_name);
+            if (name_len < 5 || strcmp(entry->d_name + name_len - 4, ".idx") != 0) continue;
+            char idx_path[PATH_MAX * 2];
+            snprintf(idx_path, sizeof(idx_path), "%s/%s", dir_path, entry->d_name);
+            size_t idx_len;
+            const unsigned char* idx = map_file(idx_path, &idx_len);
+            if (!idx) continue;
+            uint32_t count = idx_len >= 8 + 1024 ? read_be32(idx + 8 + 255 * 4) : 0;
+            if (idx_len < 8 + 1024 + (size_t)count * 28 + 40 || memcmp(idx, "\377tOc", 4) != 0 ||
+                read_be32(idx + 4) != 2) {
+                munmap((void*)idx, idx_len);
+                continue;
+            }
+            Pack* grown = realloc(repo->packs, (repo->pack_count + 1) * sizeof(Pack));
+            if (!grown) {
+                munmap((void*)idx, idx_len);
+                break;
+            }
+            repo->packs = grown;
+            Pack* pack = &repo->packs[repo->pack_count++];
+            memset(pack, 0, sizeof(Pack));
+            snprintf(pack->path, sizeof(pack->path), "%.*s.pack", (int)(strlen(idx_path) - 4), idx_path);
+            pack->idx = idx;
+            pack->idx_len = idx_len;
+            pack->count = count;
+        }
+        closedir(dir);
+    }
+}
+
+/* Offset of an object in a pack, or 0 if the pack does not hold it */
+static uint64_t pack_find(const Pack* pack, const unsigned char* oid) {
+    const unsigned char* fanout = pack->idx + 8;
+    uint32_t low = oid[0] == 0 ? 0 : read_be32(fanout + (oid[0] - 1) * 4);
+    uint32_t high = read_be32(fanout + oid[0] * 4);
+    const unsigned char* ids = fanout + 1024;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int cmp = memcmp(ids + (size_t)mid * GIT_OID_RAWSZ, oid, GIT_OID_RAWSZ);
+        if (cmp == 0) {
+            const unsigned char* offsets = ids + (size_t)pack->count * 24;
+            uint32_t offset = read_be32(offsets + (size_t)mid * 4);
+            if (!(offset & 0x80000000u)) return offset;
+            const unsigned char* large = offsets + (size_t)pack->count * 4 + (size_t)(offset & 0x7fffffffu) * 8;
+            if (large + 8 > pack->idx + pack->idx_len - 40) return 0;
+            return (uint64_t)read_be32(large) << 32 | read_be32(large + 4);
+        }
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return 0;
+}
+
+static int apply_delta(const unsigned char* base, size_t base_len, const unsigned char* delta, size_t delta_len,
+                       char** out, size_t* out_len) {
+    const unsigned char* p = delta;
+    const unsigned char* end = delta + delta_len;
+    size_t sizes[2] = { 0, 0 };
+    for (int i = 0; i < 2; i++) {
+        int shift = 0;
+        unsigned char c;
+        do {
+            if (p >= end || shift > 56) return 0;
+            c = *p++;
+            sizes[i] |= (size_t)(c & 0x7f) << shift;
+            shift += 7;
+        } while (c & 0x80);
+    }
+    if (sizes[0] != base_len || sizes[1] > GIT_MAX_OBJECT_SIZE) return 0;
+
+    char* result = malloc(sizes[1] + 1);
+    if (!result) return 0;
+    size_t pos = 0;
+    while (p < end) {
+        unsigned char op = *p++;
+        if (op & 0x80) {
+            size_t offset = 0, size = 0;
+            for (int i = 0; i < 4; i++) {
+                if (!(op & (1 << i))) continue;
+                if (p >= end) goto fail;
+                offset |= (size_t)*p++ << (8 * i);
+            }
+            for (int i = 0; i < 3; i++) {
+                if (!(op & (0x10 << i))) continue;
+                if (p >= end) goto fail;
+                size |= (size_t)*p++ << (8 * i);
+            }
+            if (size == 0) size = 0x10000;
+            if (offset + size > base_len || pos + size > sizes[1]) goto fail;
+            memcpy(result + pos, base + offset, size);
+            pos += size;
+        } else if (op != 0) {
+            if ((size_t)(end - p) < op || pos + op > sizes[1]) goto fail;
+            memcpy(result + pos, p, op);
+            p += op;
+            pos += op;
+        } else {
+            goto fail;
+        }
+    }
+    if (pos != sizes[1]) goto fail;
+    result[pos] = '\0';
+    *out = result;
+    *out_len = pos;
+    return 1;
+fail:
+    free(result);
+    return 0;
+}
+
+static int read_object(git_repo* repo, const unsigned char* oid, int depth,
+                       git_object_type* type, char** data, size_t* len);
+
+static int read_packed(git_repo* repo, Pack* pack, uint64_t offset, int depth,
+                       git_object_type* type, char** data, size_t* len) {
+    if (depth > GIT_MAX_DELTA_DEPTH) return 0;
+    if (!pack->data) {
+        pack->data = map_file(pack->path, &pack->data_len);
+        if (!pack->data) return 0;
+    }
+    if (pack->data_len < 32 || offset < 12 || offset >= pack->data_len - 20) return 0;
+    const unsigned char* p = pack->data + offset;
+    const unsigned char* end = pack->data + pack->data_len - 20;
+
+    unsigned char c = *p++;
+    int kind = (c >> 4) & 7;
+    uint64_t size = c & 15;
+    int shift = 4;
+    while (c & 0x80) {
+        if (p >= end || shift > 57) return 0;
+        c = *p++;
+        size |= (uint64_t)(c & 0x7f) << shift;
+        shift += 7;
+    }
+    if (size > GIT_MAX_OBJECT_SIZE) return 0;
+
+    if (kind >= GIT_OBJ_COMMIT && kind <= GIT_OBJ_TAG) {
+        unsigned char* inflated;
+        size_t inflated_len;
+        if (!inflate_zlib(p, (size_t)(end - p), (size_t)size, &inflated, &inflated_len)) return 0;
+        *type = (git_object_type)kind;
+        *data = (char*)inflated;
+        *len = inflated_len;
+        return 1;
+    }
+
+    git_object_type base_type;
+    char* base;
+    size_t base_len;
+    if (kind == 6) {              /* OFS_DELTA: base at a relative offset in this pack */
+        if (p >= end) return 0;
+        c = *p++;
+        uint64_t distance = c & 0x7f;
+        while (c & 0x80) {
+            if (p >= end || distance > (UINT64_MAX >> 8)) return 0;
+            c = *p++;
+            distance = ((distance + 1) << 7) | (c & 0x7f);
+        }
+        if (distance == 0 || distance > offset) return 0;
+        if (!read_packed(repo, pack, offset - distance, depth + 1, &base_type, &base, &base_len)) return 0;
+    } else if (kind == 7) {       /* REF_DELTA: base named by id */
+        if ((size_t)(end - p) < GIT_OID_RAWSZ) return 0;
+        const unsigned char* base_oid = p;
+        p += GIT_OID_RAWSZ;
+        if (!read_object(repo, base_oid, depth + 1, &base_type, &base, &base_len)) return 0;
+    } else {
+        return 0;
+    }
+
+    unsigned char* delta;
+    size_t delta_len;
+    int ok = inflate_zlib(p, (size_t)(end - p), (size_t)size, &delta, &delta_len) &&
+             apply_delta((const unsigned char*)base, base_len, delta, delta_len, data, len);
+    if (ok) *type = base_type;
+    free(base);
+    free(delta);
+    return ok;
+}
+
+static int read_object(git_repo* repo, const unsigned char* oid, int depth,
+                       git_object_type* type, char** data, size_t* len) {
+    if (!repo->packs_loaded) load_packs(repo);
+    for (size_t i = 0; i < repo->pack_count; i++) {
+        uint64_t offset = pack_find(&repo->packs[i], oid);
+        if (offset > 0) return read_packed(repo, &repo->packs[i], offset, depth, type, data, len);
+    }
+    return read_loose(repo, oid, type, data, len);
+}
+
+int git_repo_read(git_repo* repo, const unsigned char* oid, git_object_type* type, char** data, size_t* len) {
+    if (!repo || !oid || !type || !data || !len) return 0;
+    *data = NULL;
+    *len = 0;
+    return read_object(repo, oid, 0, type, data, len);
+}
+
+static int parse_commit(const char* data, size_t len, git_commit* commit) {
+    memset(commit, 0, sizeof(git_commit));
+    const char* p = data;
+    const char* end = data + len;
+    int have_tree = 0;
+    while (p < end && *p != '\n') {
+        const char* line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) return 0;
+        if (strncmp(p, "tree ", 5) == 0) {
+            have_tree = git_oid_parse(p + 5, commit->tree);
+        } else if (strncmp(p, "parent ", 7) == 0) {
+            if (commit->parent_count == GIT_COMMIT_MAX_PARENTS) return 0;
+            if (!git_oid_parse(p + 7, commit->parents[commit->parent_count++])) return 0;
+        } else if (strncmp(p, "committer ", 10) == 0) {
+            const char* close = p;
+            for (const char* q = p; q < line_end; q++) {
+                if (*q == '>') close = q;
+            }
+            commit->time = strtoll(close + 1, NULL, 10);
+        }
+        p = line_end + 1;
+    }
+    if (!have_tree) return 0;
+
+    /* Subject: the first paragraph of the message, lines joined by spaces */
+    size_t used = 0;
+    if (p < end) p++;
+    while (p < end && *p == '\n') p++;
+    while (p < end && *p != '\n') {
+        const char* line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) line_end = end;
+        size_t line_len = (size_t)(line_end - p);
+        if (used > 0 && used + 1 < sizeof(commit->subject)) commit->subject[used++] = ' ';
+        if (line_len > sizeof(commit->subject) - 1 - used) line_len = sizeof(commit->subject) - 1 - used;
+        memcpy(commit->subject + used, p, line_len);
+        used += line_len;
+        p = line_end < end ? line_end + 1 : end;
+    }
+    commit->subject[used] = '\0';
+    return 1;
+}
+
+int git_repo_commit(git_repo* repo, const unsigned char* oid, git_commit* commit) {
+    git_object_type type;
+    char* data;
+    size_t len;
+    if (!git_repo_read(repo, oid, &type, &data, &len)) return 0;
+    int ok = type == GIT_OBJ_COMMIT && parse_commit(data, len, commit);
+    free(data);
+    return ok;
+}
+
+int git_tree_next(const char** cursor, const char* end, git_tree_entry* entry) {
+    const char* p = *cursor;
+    unsigned int mode = 0;
+    for (; p < end && *p != ' '; p++) {
+        if (*p < '0' || *p > '7') return 0;
+        mode = mode * 8 + (unsigned int)(*p - '0');
+    }
+    if (p >= end) return 0;
+    const char* name = p + 1;
+    const char* nul = memchr(name, '\0', (size_t)(end - name));
+    if (!nul || end - nul < 1 + GIT_OID_RAWSZ) return 0;
+    entry->name = name;
+    entry->name_len = (size_t)(nul - name);
+    entry->mode = mode;
+    entry->oid = (const unsigned char*)nul + 1;
+    *cursor = nul + 1 + GIT_OID_RAWSZ;
+    return 1;
+}
+
+/* ── Ahead/behind ───────────────────────────────────────────────────────── */
+
+typedef struct {
+    unsigned char  oid[GIT_OID_RAWSZ];
+    int            used;
+    int            flags;         /* 1 = reachable from a, 2 = from b */
+    int            done;          /* flags already passed on to the parents */
+    int            loaded;
+    long long      time;
+    int            parent_count;
+    unsigned char (*parents)[GIT_OID_RAWSZ];
+} WalkNode;
+
+typedef struct {
+    long long     time;
+    unsigned char oid[GIT_OID_RAWSZ];
+    int           stale;          /* queued with both flags: cannot change any count */
+} WalkItem;
+
+typedef struct {
+    WalkNode* nodes;
+    size_t    cap;
+    size_t    count;
+    WalkItem* heap;
+    size_t    heap_len;
+    size_t    heap_cap;
+    int       active;             /* queued items that are not stale */
+} Walk;
+
+static size_t walk_slot(const Walk* walk, const unsigned char* oid) {
+    size_t slot = read_be32(oid) & (walk->cap - 1);
+    while (walk->nodes[slot].used && memcmp(walk->nodes[slot].oid, oid, GIT_OID_RAWSZ) != 0) {
+        slot = (slot + 1) & (walk->cap - 1);
+    }
+    return slot;
+}
+
+static WalkNode* walk_node(Walk* walk, const unsigned char* oid) {
+    if ((walk->count + 1) * 2 > walk->cap) {
+        size_t cap = walk->cap ? walk->cap * 2 : 1024;
+        WalkNode* old = walk->nodes;
+        size_t old_cap = walk->cap;
+        walk->nodes = calloc(cap, sizeof(WalkNode));
+        if (!walk->nodes) {
+            walk->nodes = old;
+            return NULL;
+        }
+        walk->cap = cap;
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old[i].used) walk->nodes[walk_slot(walk, old[i].oid)] = old[i];
+        }
+        free(old);
+    }
+    WalkNode* node = &walk->nodes[walk_slot(walk, oid)];
+    if (!node->used) {
+        node->used = 1;
+        memcpy(node->oid, oid, GIT_OID_RAWSZ);
+        walk->count++;
+    }
+    return node;
+}
+
+static int walk_load(git_repo* repo, Walk* walk, WalkNode* node) {
+    if (node->loaded) return 1;
+    if (walk->count > GIT_MAX_WALK) return 0;
+    git_commit commit;
+    if (!git_repo_commit(repo, node->oid, &commit)) return 0;
+    node->parents = malloc((size_t)(commit.parent_count ? commit.parent_count : 1) * GIT_OID_RAWSZ);
+    if (!node->parents) return 0;
+    memcpy(node->parents, commit.parents, (size_t)commit.parent_count * GIT_OID_RAWSZ);
+    node->parent_count = commit.parent_count;
+    node->time = commit.time;
+    node->loaded = 1;
+    return 1;
+}
+
+/* Max-heap on commit time: newest first */
+static int walk_push(Walk* walk, const WalkNode* node) {
+    if (walk->heap_len == walk->heap_cap) {
+        size_t cap = walk->heap_cap ? walk->heap_cap * 2 : 256;
+        WalkItem* grown = realloc(walk->heap, cap * sizeof(WalkItem));
+        if (!grown) return 0;
+        walk->heap = grown;
+        walk->heap_cap = cap;
+    }
+    size_t i = walk->heap_len++;
+    WalkItem item = { node->time, { 0 }, node->flags == 3 };
+    memcpy(item.oid, node->oid, GIT_OID_RAWSZ);
+    while (i > 0 && walk->heap[(i - 1) / 2].time < item.time) {
+        walk->heap[i] = walk->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    walk->heap[i] = item;
+    if (!item.stale) walk->active++;
+    return 1;
+}
+
+static WalkItem walk_pop(Walk* walk) {
+    WalkItem top = walk->heap[0];
+    WalkItem last = walk->heap[--walk->heap_len];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= walk->heap_len) break;
+        if (child + 1 < walk->heap_len && walk->heap[child + 1].time > walk->heap[child].time) child++;
+        if (walk->heap[child].time <= last.time) break;
+        walk->heap[i] = walk->heap[child];
+        i = child;
+    }
+    if (walk->heap_len > 0) walk->heap[i] = last;
+    if (!top.stale) walk->active--;
+    return top;
+}
+
+int git_repo_ahead_behind(git_repo* repo, const unsigned char* a, const unsigned char* b, int* ahead, int* behind) {
+    *ahead = 0;
+    *behind = 0;
+    if (!repo || memcmp(a, b, GIT_OID_RAWSZ) == 0) return repo != NULL;
+
+    /* Paint both histories newest first and stop once only commits reachable
+       from both sides remain queued: everything older is shared. */
+    Walk walk = { 0 };
+    int ok = 1;
+    const unsigned char* tips[2] = { a, b };
+    for (int side = 0; side < 2 && ok; side++) {
+        WalkNode* node = walk_node(&walk, tips[side]);
+        ok = node && walk_load(repo, &walk, node);
+        if (ok) {
+            node->flags |= side + 1;
+            ok = walk_push(&walk, node);
+        }
+    }
+    while (ok && walk.active > 0) {
+        WalkItem item = walk_pop(&walk);
+        WalkNode* node = &walk.nodes[walk_slot(&walk, item.oid)];
+        if (node->done == node->flags) continue;
+        node->done = node->flags;
+        int flags = node->flags;
+        int parent_count = node->parent_count;
+        unsigned char (*parents)[GIT_OID_RAWSZ] = node->parents;
+        for (int i = 0; i < parent_count && ok; i++) {
+            WalkNode* parent = walk_node(&walk, parents[i]);
+            ok = parent && walk_load(repo, &walk, parent);
+            if (ok && (parent->flags | flags) != parent->flags) {
+                parent->flags |= flags;
+                ok = walk_push(&walk, parent);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < walk.cap; i++) {
+        if (!walk.nodes[i].used) continue;
+        if (walk.nodes[i].flags == 1) (*ahead)++;
+        else if (walk.nodes[i].flags == 2) (*behind)++;
+        free(walk.nodes[i].parents);
+    }
+    free(walk.nodes);
+    free(walk.heap);
+    if (!ok) {
+        *ahead = 0;
+        *behind = 0;
+    }
+    return ok;
+}
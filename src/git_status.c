@@ -0,0 +1,673 @@
+#include "../include/git_status.h"
+#include "../include/gitignore.h"
+#include "../include/dir_walk.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INDEX_HEADER_SIZE   12
+#define INDEX_ENTRY_FIXED   62          /* stat data, id and flags before the path */
+#define INDEX_ASSUME_VALID  0x8000
+#define INDEX_EXTENDED      0x4000
+#define INDEX_SKIP_WORKTREE 0x4000      /* extended flags */
+#define INDEX_INTENT_TO_ADD 0x2000
+#define MODE_TYPE(mode)     ((mode) & 0170000)
+#define MODE_GITLINK        0160000
+#define MODE_SYMLINK        0120000
+#define MODE_DIR            0040000
+
+typedef struct {
+    size_t               path;          /* offset into the path arena */
+    size_t               path_len;
+    const unsigned char* oid;
+    unsigned int         mode;
+    uint32_t             ctime_sec, ctime_nsec, mtime_sec, mtime_nsec;
+    uint32_t             ino, uid, gid, size;
+    int                  assume_valid;
+    char                 index;         /* git status --short columns */
+    char                 worktree;
+} IndexEntry;
+
+typedef struct {
+    char*         path;                 /* "" for the root, otherwise "dir/sub/" */
+    int           valid;                /* the id is current */
+    unsigned char oid[GIT_OID_RAWSZ];
+} CacheTree;
+
+typedef struct {
+    char* path;
+    char  index;
+    char  worktree;
+} Change;
+
+typedef struct {
+    git_repo*       repo;
+    const char*     root;
+    size_t          root_len;
+    int             root_fd;
+    IndexEntry*     entries;
+    size_t          count;
+    char*           paths;
+    size_t          paths_len;
+    size_t          paths_cap;
+    CacheTree*      trees;
+    size_t          tree_count;
+    size_t          tree_cap;
+    long long       index_mtime;
+    int             trust_ctime;
+    int             file_mode;
+    int             has_filters;        /* .gitattributes or autocrlf may convert content */
+    int             collapse;           /* list untracked directories, not their files */
+    int             unsupported;        /* something only git can answer; set from walkers too */
+    Change*         changes;
+    size_t          change_count;
+    size_t          change_cap;
+    gitignore*      ignore;
+    pthread_mutex_t lock;
+} StatusState;
+
+static uint32_t read_be32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static const char* entry_path(const StatusState* state, size_t i) {
+    return state->paths + state->entries[i].path;
+}
+
+static int add_change(StatusState* state, const char* path, char index, char worktree) {
+    pthread_mutex_lock(&state->lock);
+    int ok = 1;
+    if (state->change_count == state->change_cap) {
+        size_t cap = state->change_cap ? state->change_cap * 2 : 32;
+        Change* grown = realloc(state->changes, cap * sizeof(Change));
+        if (grown) {
+            state->changes = grown;
+            state->change_cap = cap;
+        } else {
+            ok = 0;
+        }
+    }
+    char* copy = ok ? strdup(path) : NULL;
+    if (copy) {
+        state->changes[state->change_count].path = copy;
+        state->changes[state->change_count].index = index;
+        state->changes[state->change_count].worktree = worktree;
+        state->change_count++;
+    } else {
+        state->unsupported = 1;
+    }
+    pthread_mutex_unlock(&state->lock);
+    return copy != NULL;
+}
+
+/* ── Index ──────────────────────────────────────────────────────────────── */
+
+static int reserve_paths(StatusState* state, size_t extra) {
+    if (state->paths_len + extra <= state->paths_cap) return 1;
+    size_t cap = state->paths_cap ? state->paths_cap * 2 : 16384;
+    while (cap < state->paths_len + extra) cap *= 2;
+    char* grown = realloc(state->paths, cap);
+    if (!grown) return 0;
+    state->paths = grown;
+    state->paths_cap = cap;
+    return 1;
+}
+
+static int add_cache_tree(StatusState* state, const char* path, int valid, const unsigned char* oid) {
+    if (state->tree_count == state->tree_cap) {
+        size_t cap = state->tree_cap ? state->tree_cap * 2 : 64;
+        CacheTree* grown = realloc(state->trees, cap * sizeof(CacheTree));
+        if (!grown) return 0;
+        state->trees = grown;
+        state->tree_cap = cap;
+    }
+    CacheTree* tree = &state->trees[state->tree_count];
+    tree->path = strdup(path);
+    if (!tree->path) return 0;
+    tree->valid = valid;
+    if (valid) memcpy(tree->oid, oid, GIT_OID_RAWSZ);
+    state->tree_count++;
+    return 1;
+}
+
+static int parse_count(const unsigned char** p, const unsigned char* end, long* value, char terminator) {
+    int negative = *p < end && **p == '-';
+    if (negative) (*p)++;
+    long result = 0;
+    const unsigned char* start = *p;
+    while (*p < end && **p >= '0' && **p <= '9' && result < 100000000) result = result * 10 + (*(*p)++ - '0');
+    if (*p == start || *p >= end || **p != terminator) return 0;
+    (*p)++;
+    *value = negative ? -result : result;
+    return 1;
+}
+
+/* TREE extension: "<name>\0<entries> <subtrees>\n[id]" per directory, parents before children */
+static int parse_cache_tree(StatusState* state, const unsigned char** p, const unsigned char* end,
+                            const char* prefix, int depth) {
+    const unsigned char* nul = memchr(*p, '\0', (size_t)(end - *p));
+    if (!nul || depth > 256) return 0;
+    char path[PATH_MAX];
+    size_t name_len = (size_t)(nul - *p);
+    int len = snprintf(path, sizeof(path), "%s%.*s%s", prefix, (int)name_len, (const char*)*p, name_len ? "/" : "");
+    if (len < 0 || (size_t)len >= sizeof(path)) return 0;
+
+    const unsigned char* q = nul + 1;
+    long entries, subtrees;
+    if (!parse_count(&q, end, &entries, ' ') || !parse_count(&q, end, &subtrees, '\n')) return 0;
+    const unsigned char* oid = NULL;
+    if (entries >= 0) {
+        if (end - q < GIT_OID_RAWSZ) return 0;
+        oid = q;
+        q += GIT_OID_RAWSZ;
+    }
+    if (!add_cache_tree(state, path, entries >= 0, oid)) return 0;
+    *p = q;
+    for (long i = 0; i < subtrees; i++) {
+        if (!parse_cache_tree(state, p, end, path, depth + 1)) return 0;
+    }
+    return 1;
+}
+
+static int compare_cache_trees(const void* a, const void* b) {
+    return strcmp(((const CacheTree*)a)->path, ((const CacheTree*)b)->path);
+}
+
+static const CacheTree* find_cache_tree(const StatusState* state, const char* path) {
+    CacheTree key = { (char*)path, 0, { 0 } };
+    return state->tree_count ? bsearch(&key, state->trees, state->tree_count, sizeof(CacheTree), compare_cache_trees)
+                             : NULL;
+}
+
+static int parse_index(StatusState* state, const unsigned char* data, size_t len) {
+    if (len < INDEX_HEADER_SIZE + GIT_OID_RAWSZ || memcmp(data, "DIRC", 4) != 0) return 0;
+    uint32_t version = read_be32(data + 4);
+    uint32_t count = read_be32(data + 8);
+    if (version < 2 || version > 4 || count > len / INDEX_ENTRY_FIXED) return 0;
+    state->entries = calloc(count ? count : 1, sizeof(IndexEntry));
+    if (!state->entries) return 0;
+
+    const unsigned char* p = data + INDEX_HEADER_SIZE;
+    const unsigned char* end = data + len - GIT_OID_RAWSZ;
+    size_t previous = 0, previous_len = 0;     /* version 4 paths are stored relative to the previous one */
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < INDEX_ENTRY_FIXED + 1) return 0;
+        IndexEntry* entry = &state->entries[i];
+        entry->ctime_sec = read_be32(p);
+        entry->ctime_nsec = read_be32(p + 4);
+        entry->mtime_sec = read_be32(p + 8);
+        entry->mtime_nsec = read_be32(p + 12);
+        entry->ino = read_be32(p + 20);
+        entry->mode = read_be32(p + 24);
+        entry->uid = read_be32(p + 28);
+        entry->gid = read_be32(p + 32);
+        entry->size = read_be32(p + 36);
+        entry->oid = p + 40;
+        unsigned int flags = (unsigned int)p[60] << 8 | p[61];
+        entry->assume_valid = (flags & INDEX_ASSUME_VALID) != 0;
+        entry->index = ' ';
+        entry->worktree = ' ';
+        const unsigned char* q = p + INDEX_ENTRY_FIXED;
+        if (flags & INDEX_EXTENDED) {
+            if (version < 3 || end - q < 3) return 0;
+            unsigned int extended = (unsigned int)q[0] << 8 | q[1];
+            if (extended & (INDEX_SKIP_WORKTREE | INDEX_INTENT_TO_ADD)) return 0;
+            q += 2;
+        }
+        if ((flags >> 12) & 3) return 0;                 /* unmerged */
+        if (MODE_TYPE(entry->mode) == MODE_GITLINK) return 0;
+
+        size_t offset = state->paths_len;
+        if (version == 4) {
+            unsigned char c = *q++;
+            size_t strip = c & 0x7f;
+            while (c & 0x80) {
+                if (q >= end || strip > PATH_MAX) return 0;
+                c = *q++;
+                strip = ((strip + 1) << 7) | (c & 0x7f);
+            }
+            const unsigned char* nul = memchr(q, '\0', (size_t)(end - q));
+            if (!nul || strip > previous_len) return 0;
+            size_t keep = previous_len - strip;
+            size_t suffix = (size_t)(nul - q);
+            if (!reserve_paths(state, keep + suffix + 1)) return 0;
+            memcpy(state->paths + offset, state->paths + previous, keep);
+            memcpy(state->paths + offset + keep, q, suffix);
+            entry->path_len = keep + suffix;
+            p = nul + 1;
+        } else {
+            const unsigned char* nul = memchr(q, '\0', (size_t)(end - q));
+            if (!nul) return 0;
+            entry->path_len = (size_t)(nul - q);
+            if (!reserve_paths(state, entry->path_len + 1)) return 0;
+            memcpy(state->paths + offset, q, entry->path_len);
+            size_t entry_len = ((size_t)(q - p) + entry->path_len + 8) & ~(size_t)7;
+            if ((size_t)(end - p) < entry_len) return 0;
+            p += entry_len;
+        }
+        state->paths[offset + entry->path_len] = '\0';
+        state->paths_len += entry->path_len + 1;
+        entry->path = offset;
+        previous = offset;
+        previous_len = entry->path_len;
+
+        const char* path = state->paths + offset;
+        const char* name = strrchr(path, '/');
+        if (strcmp(name ? name + 1 : path, ".gitattributes") == 0) state->has_filters = 1;
+    }
+    state->count = count;
+
+    while (end - p >= 8) {
+        uint32_t size = read_be32(p + 4);
+        const unsigned char* body = p + 8;
+        if ((size_t)(end - body) < size) return 0;
+        if (memcmp(p, "TREE", 4) == 0) {
+            const unsigned char* q = body;
+            if (size > 0 && !parse_cache_tree(state, &q, body + size, "", 0)) return 0;
+            qsort(state->trees, state->tree_count, sizeof(CacheTree), compare_cache_trees);
+        } else if (p[0] < 'A' || p[0] > 'Z') {
+            return 0;                                     /* required extension, e.g. split index or sparse dirs */
+        }
+        p = body + size;
+    }
+    return 1;
+}
+
+/* ── Staged changes: HEAD's tree against the index ──────────────────────── */
+
+/* First entry in [lo, hi) that sorts at or after path */
+static size_t lower_bound(const StatusState* state, size_t lo, size_t hi, const char* path) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(entry_path(state, mid), path) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void mark_added(StatusState* state, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) state->entries[i].index = 'A';
+}
+
+/* Compares a tree with the index entries [lo, hi), which all start with prefix */
+static int diff_tree(StatusState* state, const unsigned char* tree_oid, char* prefix, size_t prefix_len,
+                     size_t lo, size_t hi) {
+    const CacheTree* cached = find_cache_tree(state, prefix);
+    if (cached && cached->valid && memcmp(cached->oid, tree_oid, GIT_OID_RAWSZ) == 0) return 1;
+
+    git_object_type type;
+    char* data;
+    size_t len;
+    if (!git_repo_read(state->repo, tree_oid, &type, &data, &len)) return 0;
+    if (type != GIT_OBJ_TREE) {
+        free(data);
+        return 0;
+    }
+
+    int ok = 1;
+    size_t i = lo;
+    const char* cursor = data;
+    git_tree_entry entry;
+    while (ok && git_tree_next(&cursor, data + len, &entry)) {
+        int is_dir = MODE_TYPE(entry.mode) == MODE_DIR;
+        size_t path_len = prefix_len + entry.name_len + (size_t)is_dir;
+        if (MODE_TYPE(entry.mode) == MODE_GITLINK || path_len >= PATH_MAX) {
+            ok = 0;
+            break;
+        }
+        memcpy(prefix + prefix_len, entry.name, entry.name_len);
+        if (is_dir) prefix[path_len - 1] = '/';
+        prefix[path_len] = '\0';
+
+        size_t at = lower_bound(state, i, hi, prefix);
+        mark_added(state, i, at);
+        i = at;
+        if (is_dir) {
+            size_t below = i;
+            while (below < hi && strncmp(entry_path(state, below), prefix, path_len) == 0) below++;
+            ok = diff_tree(state, entry.oid, prefix, path_len, i, below);
+            i = below;
+        } else if (i < hi && strcmp(entry_path(state, i), prefix) == 0) {
+            IndexEntry* indexed = &state->entries[i++];
+            if (memcmp(indexed->oid, entry.oid, GIT_OID_RAWSZ) != 0 || indexed->mode != entry.mode) {
+                indexed->index = MODE_TYPE(indexed->mode) == MODE_TYPE(entry.mode) ? 'M' : 'T';
+            }
+        } else {
+            ok = add_change(state, prefix, 'D', ' ');
+        }
+    }
+    prefix[prefix_len] = '\0';
+    if (ok) mark_added(state, i, hi);
+    free(data);
+    return ok;
+}
+
+/* ── Work tree changes ──────────────────────────────────────────────────── */
+
+static int hash_matches(StatusState* state, const IndexEntry* entry, const char* path, const struct stat* st) {
+    git_sha1_ctx ctx;
+    git_sha1_init(&ctx);
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "blob %lld", (long long)st->st_size);
+    git_sha1_update(&ctx, header, (size_t)header_len + 1);
+
+    if (S_ISLNK(st->st_mode)) {
+        char target[PATH_MAX];
+        ssize_t n = readlinkat(state->root_fd, path, target, sizeof(target));
+        if (n < 0 || n != st->st_size) return 0;
+        git_sha1_update(&ctx, target, (size_t)n);
+    } else if (st->st_size > 0) {
+        int fd = openat(state->root_fd, path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd < 0) return 0;
+        void* data = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) return 0;
+        madvise(data, (size_t)st->st_size, MADV_SEQUENTIAL);
+        git_sha1_update(&ctx, data, (size_t)st->st_size);
+        munmap(data, (size_t)st->st_size);
+    }
+    unsigned char oid[GIT_OID_RAWSZ];
+    git_sha1_final(&ctx, oid);
+    return memcmp(oid, entry->oid, GIT_OID_RAWSZ) == 0;
+}
+
+/* The same checks as git's ie_match_stat(): trust matching stat data unless
+   the file changed within the second the index was written */
+static char worktree_status(StatusState* state, const IndexEntry* entry, const char* path) {
+    if (entry->assume_valid) return ' ';
+    struct stat st;
+    if (fstatat(state->root_fd, path, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        if (errno == ENOENT || errno == ENOTDIR) return 'D';
+        state->unsupported = 1;
+        return ' ';
+    }
+    if (S_ISDIR(st.st_mode)) return 'D';
+    int is_link = MODE_TYPE(entry->mode) == MODE_SYMLINK;
+    if (is_link ? !S_ISLNK(st.st_mode) : !S_ISREG(st.st_mode)) return 'T';
+    if (!is_link && state->file_mode && ((entry->mode & 0100) != 0) != ((st.st_mode & S_IXUSR) != 0)) return 'M';
+
+    int size_changed = entry->size != (uint32_t)st.st_size;
+    int stat_changed = size_changed || entry->mtime_sec != (uint32_t)st.st_mtim.tv_sec ||
+                       entry->mtime_nsec != (uint32_t)st.st_mtim.tv_nsec || entry->ino != (uint32_t)st.st_ino ||
+                       entry->uid != (uint32_t)st.st_uid || entry->gid != (uint32_t)st.st_gid ||
+                       (state->trust_ctime && (entry->ctime_sec != (uint32_t)st.st_ctim.tv_sec ||
+                                               entry->ctime_nsec != (uint32_t)st.st_ctim.tv_nsec));
+    if (!stat_changed && (long long)entry->mtime_sec < state->index_mtime) return ' ';
+    /* A zero size means the index never saw this file's stat data (or smudged a racy entry) */
+    if (size_changed && entry->size != 0) return 'M';
+    if (hash_matches(state, entry, path, &st)) return ' ';
+    if (state->has_filters) state->unsupported = 1;
+    return 'M';
+}
+
+/* ── Untracked files ────────────────────────────────────────────────────── */
+
+static int is_tracked(const StatusState* state, const char* relative) {
+    size_t at = lower_bound(state, 0, state->count, relative);
+    return at < state->count && strcmp(entry_path(state, at), relative) == 0;
+}
+
+static int has_tracked_below(const StatusState* state, const char* relative_dir) {
+    char prefix[PATH_MAX];
+    int len = snprintf(prefix, sizeof(prefix), "%s/", relative_dir);
+    if (len < 0 || (size_t)len >= sizeof(prefix)) return 1;
+    size_t at = lower_bound(state, 0, state->count, prefix);
+    return at < state->count && strncmp(entry_path(state, at), prefix, (size_t)len) == 0;
+}
+
+/* An untracked directory is listed when it holds anything that is not ignored */
+static int dir_has_untracked(StatusState* state, const char* path, const char* relative, int depth) {
+    DIR* dir = opendir(path);
+    if (!dir) return 0;
+    if (depth > 0) gitignore_add_dir(state->ignore, relative);
+    int found = 0;
+    struct dirent* entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+        if (strcmp(name, ".git") == 0) {
+            found = 1;                                    /* a nested repository */
+            break;
+        }
+        char child[PATH_MAX];
+        char child_relative[PATH_MAX];
+        if (snprintf(child, sizeof(child), "%s/%s", path, name) >= (int)sizeof(child) ||
+            snprintf(child_relative, sizeof(child_relative), "%s/%s", relative, name) >= (int)sizeof(child_relative)) {
+            continue;
+        }
+        struct stat st;
+        if (lstat(child, &st) != 0) continue;
+        int is_dir = S_ISDIR(st.st_mode);
+        if (gitignore_ignored(state->ignore, child_relative, is_dir)) continue;
+        found = is_dir ? depth < 64 && dir_has_untracked(state, child, child_relative, depth + 1) : 1;
+    }
+    closedir(dir);
+    return found;
+}
+
+static int visit_untracked_file(const char* path, size_t name_offset, int worker, void* ctx) {
+    (void)worker;
+    StatusState* state = ctx;
+    const char* relative = path + state->root_len + 1;
+    if (strcmp(path + name_offset, ".git") == 0) return 1;   /* gitdir link of a worktree or submodule */
+    if (!is_tracked(state, relative) && !gitignore_ignored(state->ignore, relative, 0)) {
+        add_change(state, relative, '?', '?');
+    }
+    return 1;
+}
+
+static void load_dir_rules(const char* path, int worker, void* ctx) {
+    (void)worker;
+    StatusState* state = ctx;
+    if (path[state->root_len] == '/') gitignore_add_dir(state->ignore, path + state->root_len + 1);
+}
+
+static int accept_untracked_dir(const char* path, size_t name_offset, void* ctx) {
+    (void)name_offset;
+    StatusState* state = ctx;
+    const char* relative = path + state->root_len + 1;
+    if (gitignore_ignored(state->ignore, relative, 1)) return 0;
+    if (!state->collapse || has_tracked_below(state, relative)) return 1;
+    if (dir_has_untracked(state, path, relative, 0)) {
+        char listed[PATH_MAX];
+        snprintf(listed, sizeof(listed), "%s/", relative);
+        add_change(state, listed, '?', '?');
+    }
+    return 0;
+}
+
+/* ── Status ─────────────────────────────────────────────────────────────── */
+
+static int compare_changes(const void* a, const void* b) {
+    const Change* x = a;
+    const Change* y = b;
+    int untracked = (x->index == '?') - (y->index == '?');
+    return untracked != 0 ? untracked : strcmp(x->path, y->path);
+}
+
+static int file_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static int config_false(const char* value) {
+    return value && (strcasecmp(value, "false") == 0 || strcasecmp(value, "no") == 0 ||
+                     strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0);
+}
+
+/* Branch, upstream and HEAD's subject */
+static int read_head(StatusState* state, git_status* status, unsigned char* head, int* born) {
+    int result = git_repo_head(state->repo, status->branch, sizeof(status->branch), head);
+    if (result < 0) return 0;
+    *born = result == 1;
+    if (!*born) return 1;
+
+    git_commit commit;
+    if (!git_repo_commit(state->repo, head, &commit)) return 0;
+    git_oid_format(head, status->head);
+    snprintf(status->subject, sizeof(status->subject), "%s", commit.subject);
+
+    char upstream[sizeof(status->upstream)];
+    if (status->branch[0] == '\0' || !git_repo_upstream(state->repo, status->branch, upstream, sizeof(upstream))) {
+        return 1;
+    }
+    const char* shown = strncmp(upstream, "refs/remotes/", 13) == 0 ? upstream + 13
+                        : strncmp(upstream, "refs/heads/", 11) == 0 ? upstream + 11 : upstream;
+    snprintf(status->upstream, sizeof(status->upstream), "%s", shown);
+    unsigned char tracking[GIT_OID_RAWSZ];
+    if (!git_repo_resolve(state->repo, upstream, tracking)) {
+        status->upstream_gone = 1;
+        return 1;
+    }
+    return git_repo_ahead_behind(state->repo, head, tracking, &status->ahead, &status->behind);
+}
+
+static int read_status(StatusState* state, int threads, git_status* status) {
+    const char* autocrlf = git_repo_config(state->repo, "core.autocrlf");
+    const char* untracked = git_repo_config(state->repo, "status.showuntrackedfiles");
+    const char* xdg = getenv("XDG_CONFIG_HOME");
+    const char* home = getenv("HOME");
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/info/attributes", git_repo_gitdir(state->repo));
+    state->has_filters = (autocrlf && !config_false(autocrlf)) || file_exists(path) ||
+                         git_repo_config(state->repo, "core.attributesfile") != NULL;
+    if (xdg && xdg[0] == '/') snprintf(path, sizeof(path), "%s/git/attributes", xdg);
+    else snprintf(path, sizeof(path), "%s/.config/git/attributes", home ? home : "/");
+    if (file_exists(path)) state->has_filters = 1;
+    state->trust_ctime = !config_false(git_repo_config(state->repo, "core.trustctime"));
+    state->file_mode = !config_false(git_repo_config(state->repo, "core.filemode"));
+    state->collapse = !untracked || strcasecmp(untracked, "all") != 0;
+
+    unsigned char head[GIT_OID_RAWSZ];
+    int born;
+    if (!read_head(state, status, head, &born)) return 0;
+
+    /* The index may legitimately be missing, e.g. right after git init */
+    snprintf(path, sizeof(path), "%s/index", git_repo_gitdir(state->repo));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        struct stat st;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            state->index_mtime = (long long)st.st_mtim.tv_sec;
+        }
+        close(fd);
+        if (data == MAP_FAILED) return 0;
+        int parsed = parse_index(state, data, (size_t)st.st_size);
+        /* Entry ids point into the mapping, which stays until the comparisons are done */
+        if (parsed && born) {
+            git_commit commit;
+            char prefix[PATH_MAX] = "";
+            parsed = git_repo_commit(state->repo, head, &commit) &&
+                     diff_tree(state, commit.tree, prefix, 0, 0, state->count);
+        } else if (parsed) {
+            mark_added(state, 0, state->count);
+        }
+        for (size_t i = 0; parsed && i < state->count && !state->unsupported; i++) {
+            state->entries[i].worktree = worktree_status(state, &state->entries[i], entry_path(state, i));
+        }
+        for (size_t i = 0; parsed && i < state->count; i++) {
+            const IndexEntry* entry = &state->entries[i];
+            if (entry->index != ' ' || entry->worktree != ' ') {
+                parsed = add_change(state, entry_path(state, i), entry->index, entry->worktree);
+            }
+        }
+        munmap(data, (size_t)st.st_size);
+        if (!parsed) return 0;
+    } else if (born) {
+        return 0;
+    }
+    status->tracked = (int)state->count;
+
+    if (!untracked || !config_false(untracked)) {
+        state->ignore = gitignore_load(state->root);
+        if (!state->ignore) return 0;
+        const char* excludes = git_repo_config(state->repo, "core.excludesfile");
+        if (excludes && strncmp(excludes, "~/", 2) == 0) snprintf(path, sizeof(path), "%s/%s", home ? home : "", excludes + 2);
+        else if (excludes) snprintf(path, sizeof(path), "%s", excludes);
+        else if (xdg && xdg[0] == '/') snprintf(path, sizeof(path), "%s/git/ignore", xdg);
+        else snprintf(path, sizeof(path), "%s/.config/git/ignore", home ? home : "/");
+        gitignore_add_excludes(state->ignore, path);
+        static const char* const skip[] = { ".git", NULL };
+        dir_walk_options walk = { 0 };
+        walk.visit_file = visit_untracked_file;
+        walk.visit_dir = load_dir_rules;
+        walk.accept_dir = accept_untracked_dir;
+        walk.ctx = state;
+        walk.include_hidden = 1;
+        walk.skip_dirs = skip;
+        walk.threads = threads;
+        const char* roots[1] = { state->root };
+        dir_walk(roots, 1, &walk);
+    }
+    if (state->unsupported) return 0;
+
+    /* A staged deletion next to a staged addition may be a rename, which only git detects */
+    int staged_added = 0, staged_deleted = 0;
+    for (size_t i = 0; i < state->change_count; i++) {
+        staged_added |= state->changes[i].index == 'A';
+        staged_deleted |= state->changes[i].index == 'D';
+    }
+    if (staged_added && staged_deleted) return 0;
+
+    qsort(state->changes, state->change_count, sizeof(Change), compare_changes);
+    for (size_t i = 0; i < state->change_count; i++) {
+        const Change* change = &state->changes[i];
+        if (change->index == '?') status->untracked++;
+        if (change->index != ' ' && change->index != '?') status->staged++;
+        if (change->worktree == 'M' || change->worktree == 'T') status->modified++;
+        if (change->worktree == 'D') status->deleted++;
+        if (status->listed < GIT_STATUS_LISTED) {
+            git_status_entry* listed = &status->entries[status->listed++];
+            snprintf(listed->path, sizeof(listed->path), "%s", change->path);
+            listed->index = change->index;
+            listed->worktree = change->worktree;
+        }
+    }
+    status->changed = (int)state->change_count;
+    return 1;
+}
+
+int git_status_read(const char* path, int threads, git_status* status) {
+    if (!status) return 0;
+    memset(status, 0, sizeof(git_status));
+    int found;
+    git_repo* repo = git_repo_open(path ? path : ".", &found);
+    if (!repo) return found ? 0 : -1;
+
+    long long span = trace_begin();
+    StatusState state = { 0 };
+    state.repo = repo;
+    state.root = git_repo_workdir(repo);
+    state.root_len = strcmp(state.root, "/") == 0 ? 0 : strlen(state.root);
+    state.root_fd = open(state.root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    pthread_mutex_init(&state.lock, NULL);
+
+    int ok = state.root_fd >= 0 && read_status(&state, threads, status);
+
+    if (state.root_fd >= 0) close(state.root_fd);
+    for (size_t i = 0; i < state.change_count; i++) free(state.changes[i].path);
+    free(state.changes);
+    for (size_t i = 0; i < state.tree_count; i++) free(state.trees[i].path);
+    free(state.trees);
+    free(state.entries);
+    free(state.paths);
+    gitignore_free(state.ignore);
+    pthread_mutex_destroy(&state.lock);
+    trace_end("git_status", span, ok ? "native" : "fallback");
+    git_repo_close(repo);
+    if (!ok) memset(status, 0, sizeof(git_status));
+    return ok;
+}
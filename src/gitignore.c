@@ -0,0 +1,224 @@
+#include "../include/gitignore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+
+typedef struct {
+    char* pattern;    /* without the leading '!' or '/', or trailing '/' */
+    char* base;       /* directory of the .gitignore, relative to the root ("" = root) */
+    int   negate;
+    int   dir_only;
+    int   anchored;   /* matched against the path below base, not just the name */
+} IgnoreRule;
+
+struct gitignore {
+    char*            root;
+    IgnoreRule*      rules;
+    size_t           count;
+    size_t           cap;
+    pthread_rwlock_t lock;
+};
+
+/* ── Pattern matching ───────────────────────────────────────────────────── */
+
+/* [...] at *pattern; advances past it and reports whether c is in the set */
+static int match_class(const char** pattern, char c) {
+    const char* p = *pattern + 1;
+    int negate = *p == '!' || *p == '^';
+    if (negate) p++;
+
+    int matched = 0;
+    int first = 1;
+    while (*p && (*p != ']' || first)) {
+        char low = *p;
+        if (low == '\\' && p[1]) low = *++p;
+        char high = low;
+        if (p[1] == '-' && p[2] && p[2] != ']') {
+            high = p[2];
+            p += 2;
+        }
+        if (c >= low && c <= high) matched = 1;
+        p++;
+        first = 0;
+    }
+    *pattern = *p == ']' ? p + 1 : p;
+    return matched != negate;
+}
+
+/* Git wildmatch: '*' and '?' stop at '/', '**' crosses directories */
+static int wildmatch(const char* p, const char* t) {
+    while (*p) {
+        if (*p == '*') {
+            if (p[1] == '*') {
+                p += 2;
+                int dirs = *p == '/';
+                if (dirs) p++;
+                if (*p == '\0') return 1;
+                for (const char* s = t;; s++) {
+                    if ((!dirs || s == t || s[-1] == '/') && wildmatch(p, s)) return 1;
+                    if (*s == '\0') return 0;
+                }
+            }
+            p++;
+            for (const char* s = t;; s++) {
+                if (wildmatch(p, s)) return 1;
+                if (*s == '\0' || *s == '/') return 0;
+            }
+        }
+        if (*t == '\0') return 0;
+        if (*p == '?') {
+            if (*t == '/') return 0;
+        } else if (*p == '[') {
+            if (*t == '/' || !match_class(&p, *t)) return 0;
+            t++;
+            continue;
+        } else {
+            if (*p == '\\' && p[1]) p++;
+            if (*p != *t) return 0;
+        }
+        p++;
+        t++;
+    }
+    return *t == '\0';
+}
+
+/* ── Loading ────────────────────────────────────────────────────────────── */
+
+/* Caller holds the write lock */
+static void add_rule(gitignore* rules, const char* base, char* line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+    while (len > 0 && line[len - 1] == ' ' && (len < 2 || line[len - 2] != '\\')) line[--len] = '\0';
+    if (len == 0 || line[0] == '#') return;
+
+    IgnoreRule rule = { 0 };
+    char* p = line;
+    if (*p == '!') {
+        rule.negate = 1;
+        p++;
+    } else if (*p == '\\' && (p[1] == '!' || p[1] == '#')) {
+        p++;
+    }
+    len = strlen(p);
+    if (len > 0 && p[len - 1] == '/') {
+        rule.dir_only = 1;
+        p[--len] = '\0';
+    }
+    rule.anchored = strchr(p, '/') != NULL;
+    if (*p == '/') p++;
+    if (*p == '\0') return;
+
+    if (rules->count == rules->cap) {
+        size_t cap = rules->cap ? rules->cap * 2 : 32;
+        IgnoreRule* grown = realloc(rules->rules, cap * sizeof(IgnoreRule));
+        if (!grown) return;
+        rules->rules = grown;
+        rules->cap = cap;
+    }
+    rule.pattern = strdup(p);
+    rule.base = strdup(base);
+    if (!rule.pattern || !rule.base) {
+        free(rule.pattern);
+        free(rule.base);
+        return;
+    }
+    rules->rules[rules->count++] = rule;
+}
+
+static void add_file(gitignore* rules, const char* base, const char* path) {
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+    char line[1024];
+    pthread_rwlock_wrlock(&rules->lock);
+    while (fgets(line, sizeof(line), in) != NULL) add_rule(rules, base, line);
+    pthread_rwlock_unlock(&rules->lock);
+    fclose(in);
+}
+
+gitignore* gitignore_load(const char* root) {
+    gitignore* rules = calloc(1, sizeof(gitignore));
+    if (!rules) return NULL;
+    rules->root = strdup(root ? root : ".");
+    if (!rules->root || pthread_rwlock_init(&rules->lock, NULL) != 0) {
+        free(rules->root);
+        free(rules);
+        return NULL;
+    }
+
+    /* Lowest precedence first: later rules win */
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/.git/info/exclude", rules->root);
+    add_file(rules, "", path);
+    gitignore_add_dir(rules, "");
+    return rules;
+}
+
+void gitignore_add_dir(gitignore* rules, const char* relative_dir) {
+    if (!rules || !relative_dir) return;
+    char path[PATH_MAX];
+    if (relative_dir[0] == '\0') snprintf(path, sizeof(path), "%s/.gitignore", rules->root);
+    else snprintf(path, sizeof(path), "%s/%s/.gitignore", rules->root, relative_dir);
+    add_file(rules, relative_dir, path);
+}
+
+void gitignore_add_excludes(gitignore* rules, const char* path) {
+    if (!rules || !path) return;
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+    char line[1024];
+    pthread_rwlock_wrlock(&rules->lock);
+    size_t before = rules->count;
+    while (fgets(line, sizeof(line), in) != NULL) add_rule(rules, "", line);
+    /* Rotate the new rules to the front: earlier rules lose to later ones */
+    size_t added = rules->count - before;
+    IgnoreRule* moved = added > 0 ? malloc(added * sizeof(IgnoreRule)) : NULL;
+    if (moved) {
+        memcpy(moved, rules->rules + before, added * sizeof(IgnoreRule));
+        memmove(rules->rules + added, rules->rules, before * sizeof(IgnoreRule));
+        memcpy(rules->rules, moved, added * sizeof(IgnoreRule));
+        free(moved);
+    }
+    pthread_rwlock_unlock(&rules->lock);
+    fclose(in);
+}
+
+int gitignore_ignored(gitignore* rules, const char* relative_path, int is_dir) {
+    if (!rules || !relative_path) return 0;
+    const char* name = strrchr(relative_path, '/');
+    name = name ? name + 1 : relative_path;
+    if (is_dir && strcmp(name, ".git") == 0) return 1;
+
+    int ignored = 0;
+    pthread_rwlock_rdlock(&rules->lock);
+    for (size_t i = rules->count; i-- > 0;) {
+        const IgnoreRule* rule = &rules->rules[i];
+        if (rule->dir_only && !is_dir) continue;
+
+        const char* below = relative_path;
+        size_t base_len = strlen(rule->base);
+        if (base_len > 0) {
+            if (strncmp(relative_path, rule->base, base_len) != 0 || relative_path[base_len] != '/') continue;
+            below = relative_path + base_len + 1;
+        }
+        if (wildmatch(rule->pattern, rule->anchored ? below : name)) {
+            ignored = !rule->negate;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&rules->lock);
+    return ignored;
+}
+
+void gitignore_free(gitignore* rules) {
+    if (!rules) return;
+    for (size_t i = 0; i < rules->count; i++) {
+        free(rules->rules[i].pattern);
+        free(rules->rules[i].base);
+    }
+    free(rules->rules);
+    free(rules->root);
+    pthread_rwlock_destroy(&rules->lock);
+    free(rules);
+}
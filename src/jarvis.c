@@ -2,12 +2,24 @@
 #include "../include/voice_input.h"
 #include "../include/voice_output.h"
 #include "../include/command_processor.h"
+#include "../include/event_loop.h"
+#include "../include/session.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include "../include/log.h"
+#include "../include/file_index.h"
+#include "../include/project_watch.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
 
 /* ── ANSI colour macros ─────────────────────────────────────────────────── */
 #define CLR_RESET  "\033[0m"
@@ -17,54 +29,77 @@
 #define CLR_RED    "\033[1;31m"
 #define CLR_BOLD   "\033[1m"
 
-/* ── Context memory (last 5 commands) ───────────────────────────────────── */
-#define MEMORY_SIZE 5
-static char g_memory[MEMORY_SIZE][512];
-static int  g_memory_count = 0;
-
+/* ── Context memory (last 5 commands, kept in the default session) ─────── */
 void memory_push(const char* cmd) {
-    if (!cmd || strlen(cmd) == 0) return;
-    if (g_memory_count < MEMORY_SIZE) {
-        strncpy(g_memory[g_memory_count], cmd, 511);
-        g_memory[g_memory_count][511] = '\0';
-        g_memory_count++;
-    } else {
-        /* shift left */
-        for (int i = 0; i < MEMORY_SIZE - 1; i++)
-            memcpy(g_memory[i], g_memory[i + 1], 512);
-        strncpy(g_memory[MEMORY_SIZE - 1], cmd, 511);
-        g_memory[MEMORY_SIZE - 1][511] = '\0';
-    }
+    session_memory_push(session_current(), cmd);
 }
 
 const char* memory_last(void) {
-    if (g_memory_count == 0) return NULL;
-    return g_memory[g_memory_count - 1];
+    return session_memory_last(session_current());
 }
 
 /* Expose memory to command_processor via weak linkage alternative */
-int  jarvis_memory_count(void)              { return g_memory_count; }
-const char* jarvis_memory_get(int i)        { return (i >= 0 && i < g_memory_count) ? g_memory[i] : NULL; }
+int  jarvis_memory_count(void)              { return session_current()->memory_count; }
+const char* jarvis_memory_get(int i) {
+    const jarvis_session* session = session_current();
+    return (i >= 0 && i < session->memory_count) ? session->memory[i] : NULL;
+}
 
-/* ── Timestamp helper ───────────────────────────────────────────────────── */
-static void print_ts(const char* colour, const char* tag, const char* msg) {
-    time_t now = time(NULL);
-    struct tm* t = localtime(&now);
-    char ts[16];
-    strftime(ts, sizeof(ts), "%H:%M:%S", t);
-    printf("%s[%s]%s %s%s%s %s\n", CLR_CYAN, ts, CLR_RESET, colour, tag, CLR_RESET, msg);
+/* ── Boot options and timeline ──────────────────────────────────────────── */
+#define BOOT_TIMELINE_MAX 32
+typedef struct {
+    const char* label;
+    long long   at_us;
+} BootMark;
+
+static int       g_fast_boot = 0;
+static int       g_show_timeline = 0;
+static long long g_boot_start_us = 0;
+static BootMark  g_boot_marks[BOOT_TIMELINE_MAX];
+static int       g_boot_mark_count = 0;
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void boot_mark(const char* label) {
+    if (!g_show_timeline || g_boot_mark_count >= BOOT_TIMELINE_MAX) return;
+    g_boot_marks[g_boot_mark_count].label = label;
+    g_boot_marks[g_boot_mark_count].at_us = monotonic_us() - g_boot_start_us;
+    g_boot_mark_count++;
+}
+
+static void print_boot_timeline(void) {
+    if (!g_show_timeline || g_boot_mark_count == 0) return;
+    log_console(CLR_CYAN "\n  ── Boot timeline (%s) ─────────────────────\n" CLR_RESET,
+           g_fast_boot ? "fast" : "standard");
+    long long prev = 0;
+    for (int i = 0; i < g_boot_mark_count; i++) {
+        log_console("  %10lld us  (+%8lld us)  %s\n",
+               g_boot_marks[i].at_us, g_boot_marks[i].at_us - prev, g_boot_marks[i].label);
+        prev = g_boot_marks[i].at_us;
+    }
+    log_console(CLR_CYAN "  ─────────────────────────────────────────\n" CLR_RESET);
+}
+
+void jarvis_configure_boot(int fast_boot, int show_timeline) {
+    g_fast_boot = fast_boot;
+    g_show_timeline = show_timeline;
 }
 
 /* ── Loading bar animation ──────────────────────────────────────────────── */
 static void loading_bar(const char* label, int steps, int delay_ms) {
-    printf("%s  %-36s [", CLR_YELLOW, label);
-    fflush(stdout);
+    if (g_fast_boot) return;
+    log_console("%s  %-36s [", CLR_YELLOW, label);
+    log_flush();
     for (int i = 0; i < steps; i++) {
-        printf("█");
-        fflush(stdout);
+        log_console("█");
+        log_flush();
         usleep((unsigned int)(delay_ms * 1000));
     }
-    printf("]%s\n", CLR_RESET);
+    log_console("]%s\n", CLR_RESET);
 }
 
 /* ── env flag helper ────────────────────────────────────────────────────── */
@@ -80,9 +115,57 @@ static void launch_jarvis_ui_if_enabled(void) {
     if (env_flag_enabled(getenv("JARVIS_NO_GUI")))     return;
     int status = system("python3 src/jarvis_ui.py >/dev/null 2>&1 &");
     if (status == 0)
-        print_ts(CLR_GREEN, "[OK]", "UI window launched.");
+        log_message(LOG_INFO, CLR_GREEN, "[OK]", "UI window launched.");
+    else
+        log_message(LOG_WARN, CLR_YELLOW, "[WARN]", "UI window unavailable (GUI may be disabled).");
+}
+
+/* ── Capability probes (run concurrently on fast boot) ──────────────────── */
+static void* probe_voice_output_thread(void* arg) {
+    (void)arg;
+    voice_output_probe();
+    return NULL;
+}
+
+static void* probe_voice_input_thread(void* arg) {
+    (void)arg;
+    voice_input_probe();
+    return NULL;
+}
+
+static void run_capability_probes(void) {
+    void* (*probes[])(void*) = { probe_voice_output_thread, probe_voice_input_thread };
+    const int probe_count = (int)(sizeof(probes) / sizeof(probes[0]));
+    pthread_t threads[sizeof(probes) / sizeof(probes[0])];
+    int started[sizeof(probes) / sizeof(probes[0])];
+
+    for (int i = 0; i < probe_count; i++)
+        started[i] = pthread_create(&threads[i], NULL, probes[i], NULL) == 0;
+    for (int i = 0; i < probe_count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        else probes[i](NULL);   /* thread creation failed: probe inline */
+    }
+}
+
+/* ── Deferred startup work (UI + notification after the first prompt) ──── */
+static int g_deferred_started = 0;
+
+static void* deferred_startup_thread(void* arg) {
+    (void)arg;
+    launch_jarvis_ui_if_enabled();
+    notify_desktop("JARVIS", "JARVIS v2.0 is now online");
+    return NULL;
+}
+
+static void start_deferred_startup(void) {
+    if (g_deferred_started) return;
+    g_deferred_started = 1;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, deferred_startup_thread, NULL) == 0)
+        pthread_detach(thread);
     else
-        print_ts(CLR_YELLOW, "[WARN]", "UI window unavailable (GUI may be disabled).");
+        deferred_startup_thread(NULL);
 }
 
 /* ── Public API ─────────────────────────────────────────────────────────── */
@@ -105,188 +188,721 @@ char* get_system_info(void) {
 }
 
 int jarvis_init(void) {
+    if (!g_fast_boot) g_fast_boot = env_flag_enabled(getenv("JARVIS_FAST_BOOT"));
+    if (!g_show_timeline) g_show_timeline = env_flag_enabled(getenv("JARVIS_BOOT_TIMELINE"));
+    g_boot_start_us = monotonic_us();
+    boot_mark("init start");
+
+    /* Fast boot: probe capabilities in parallel so jarvis_init never shells out */
+    if (g_fast_boot) {
+        run_capability_probes();
+        boot_mark("capability probes joined");
+    }
+
     /* ── Banner ── */
-    printf("\n");
-    printf(CLR_CYAN "  ╔══════════════════════════════════════════╗\n" CLR_RESET);
-    printf(CLR_CYAN "  ║" CLR_BOLD "        J.A.R.V.I.S  SYSTEM  v%-6s      " CLR_RESET CLR_CYAN "║\n" CLR_RESET, JARVIS_VERSION);
-    printf(CLR_CYAN "  ║     Just A Rather Very Intelligent System  ║\n" CLR_RESET);
-    printf(CLR_CYAN "  ╚══════════════════════════════════════════╝\n\n" CLR_RESET);
+    log_console("\n");
+    log_console(CLR_CYAN "  ╔══════════════════════════════════════════╗\n" CLR_RESET);
+    log_console(CLR_CYAN "  ║" CLR_BOLD "        J.A.R.V.I.S  SYSTEM  v%-6s      " CLR_RESET CLR_CYAN "║\n" CLR_RESET, JARVIS_VERSION);
+    log_console(CLR_CYAN "  ║     Just A Rather Very Intelligent System  ║\n" CLR_RESET);
+    log_console(CLR_CYAN "  ╚══════════════════════════════════════════╝\n\n" CLR_RESET);
+    boot_mark("banner printed");
 
     /* ── Boot sequence ── */
-    print_ts(CLR_CYAN,   "[BOOT]", "Initializing AI core...");
+    log_message(LOG_INFO, CLR_CYAN, "[BOOT]", "Initializing AI core...");
     loading_bar("Loading neural modules",    10, 40);
 
-    print_ts(CLR_CYAN,   "[BOOT]", "Loading voice recognition module...");
+    log_message(LOG_INFO, CLR_CYAN, "[BOOT]", "Loading voice recognition module...");
     loading_bar("Voice recognition",         10, 30);
 
-    print_ts(CLR_CYAN,   "[BOOT]", "Loading voice synthesis module...");
+    log_message(LOG_INFO, CLR_CYAN, "[BOOT]", "Loading voice synthesis module...");
     loading_bar("Voice synthesis",           10, 30);
 
-    print_ts(CLR_CYAN,   "[BOOT]", "Loading command processor...");
+    log_message(LOG_INFO, CLR_CYAN, "[BOOT]", "Loading command processor...");
     loading_bar("Command processor",         10, 20);
 
-    print_ts(CLR_CYAN,   "[BOOT]", "Loading context memory...");
+    log_message(LOG_INFO, CLR_CYAN, "[BOOT]", "Loading context memory...");
     loading_bar("Context memory (5 slots)",  10, 20);
+    boot_mark("boot sequence done");
 
     if (!voice_output_init()) {
-        print_ts(CLR_RED, "[ERROR]", "Failed to initialize voice output.");
+        log_message(LOG_ERROR, CLR_RED, "[ERROR]", "Failed to initialize voice output.");
         return 0;
     }
+    boot_mark("voice output ready");
 
-    print_ts(CLR_GREEN, "[OK]", "All systems online. JARVIS is ready.");
-    printf("\n");
+    file_index_start();   /* crawls in the background; searches scan live until it is ready */
+    boot_mark("file index started");
 
-    launch_jarvis_ui_if_enabled();
-    notify_desktop("JARVIS", "JARVIS v2.0 is now online");
+    log_message(LOG_INFO, CLR_GREEN, "[OK]", "All systems online. JARVIS is ready.");
+    log_console("\n");
+
+    /* Fast boot defers these until the first prompt is on screen */
+    if (!g_fast_boot) {
+        launch_jarvis_ui_if_enabled();
+        boot_mark("UI launched");
+        notify_desktop("JARVIS", "JARVIS v2.0 is now online");
+        boot_mark("online notification sent");
+    }
+    boot_mark("init complete");
     return 1;
 }
 
-void jarvis_run(void) {
-    int running = 1;
-    int strict_speaker_mode = env_flag_enabled(getenv("JARVIS_STRICT_SPEAKER"));
-
-    speak("JARVIS version 2.0 is now online. How may I assist you?");
-
-    while (running) {
-        printf("\n");
-        printf(CLR_CYAN "  ═══════════════════════════════════════════\n" CLR_RESET);
-        printf(CLR_BOLD "  JARVIS  ›  Ready for your command\n" CLR_RESET);
-        printf(CLR_CYAN "  ═══════════════════════════════════════════\n" CLR_RESET);
-        printf(CLR_YELLOW "  Try: hello · time · joke · help · search [query] · exit\n" CLR_RESET);
-        printf("\n");
-
-        /* ── Capture input ── */
-        print_ts(CLR_GREEN, "🎤", "Listening...");
-        char* combined = capture_voice_input();
-        if (!combined) {
-            print_ts(CLR_YELLOW, "[WARN]", "No input received. Please try again.");
-            continue;
+/* ── Reactor state ──────────────────────────────────────────────────────── */
+#define INPUT_LINE_MAX         512
+#define RECOGNIZER_MAX_MISSES  2
+#define RECOGNIZER_RETRY_MS    250
+#define SHUTDOWN_DRAIN_MS      15000
+#define PENDING_TURNS_MAX      8
+
+typedef struct {
+    char   data[INPUT_LINE_MAX];
+    size_t len;
+} LineBuffer;
+
+typedef void (*line_handler)(const char* line);
+
+/* The command being processed off the reactor thread */
+typedef struct {
+    pthread_t thread;
+    int       threaded;                   /* joined when done_pipe fires */
+    char      speaker[128];
+    char      command[INPUT_LINE_MAX];
+    char      lower[INPUT_LINE_MAX];
+    char*     response;                   /* set by the worker */
+    long long span;                       /* trace: whole turn */
+} CommandTurn;
+
+/* Speaker verification of a recognized phrase, run as a child of the loop */
+typedef struct {
+    pid_t      pid;                       /* speaker_recognizer.py, 0 when idle */
+    int        fd;                        /* its stdout */
+    LineBuffer output;
+    char       speaker[128];              /* first line the child printed */
+    char       text[INPUT_LINE_MAX];      /* the phrase being verified */
+    long long  span;                      /* trace: speaker_verify */
+} SpeakerCheck;
+
+/* Input that arrived while a command was still running */
+typedef struct {
+    char speaker[128];
+    char text[INPUT_LINE_MAX];
+} PendingTurn;
+
+static int        g_running = 0;
+static int        g_strict_speaker_mode = 0;
+static int        g_keyboard_only = 0;     /* recognizer gave up: prompt for typing */
+static int        g_stdin_open = 0;
+static LineBuffer g_stdin_line;
+static pid_t      g_recognizer_pid = 0;
+static int        g_recognizer_fd = -1;
+static LineBuffer g_recognizer_line;
+static int        g_recognizer_heard = 0;
+static int        g_recognizer_misses = 0;
+static int        g_recognizer_timer = 0;
+static int        g_verify_speaker = 0;    /* JARVIS_VERIFY_SPEAKER */
+static SpeakerCheck g_speaker_check = { .pid = 0, .fd = -1 };
+static int        g_speaking = 0;          /* outstanding TTS children */
+static char       g_pending_command[512] = ""; /* strict mode: awaiting yes/no */
+static long long  g_listen_span = 0;       /* trace: recognizer started listening */
+static long long  g_tts_span = 0;          /* trace: last TTS child started */
+static int         g_turn_busy = 0;        /* a command is being processed */
+static CommandTurn g_turn;
+static int         g_turn_pipe[2] = {-1, -1};  /* worker -> reactor: command done */
+static PendingTurn g_pending_turns[PENDING_TURNS_MAX];
+static int         g_pending_head = 0;
+static int         g_pending_count = 0;
+
+static void start_recognizer(void);
+
+static void line_buffer_feed(LineBuffer* lb, const char* data, size_t n, line_handler on_line) {
+    for (size_t i = 0; i < n; i++) {
+        if (data[i] == '\n') {
+            lb->data[lb->len] = '\0';
+            lb->len = 0;
+            on_line(lb->data);
+        } else if (data[i] != '\r' && lb->len < sizeof(lb->data) - 1) {
+            lb->data[lb->len++] = data[i];
         }
+    }
+}
 
-        /* ── Split SPEAKER|TEXT ── */
-        char* sep = strchr(combined, '|');
-        char speaker[128]     = "";
-        char command_text[512] = "";
-
-        if (sep) {
-            size_t s_len = (size_t)(sep - combined);
-            if (s_len >= sizeof(speaker)) s_len = sizeof(speaker) - 1;
-            strncpy(speaker, combined, s_len);
-            speaker[s_len] = '\0';
-            strncpy(command_text, sep + 1, sizeof(command_text) - 1);
-            command_text[sizeof(command_text) - 1] = '\0';
-        } else {
-            strncpy(command_text, combined, sizeof(command_text) - 1);
-            command_text[sizeof(command_text) - 1] = '\0';
-            strcpy(speaker, "UNKNOWN");
+static void line_buffer_flush(LineBuffer* lb, line_handler on_line) {
+    if (lb->len == 0) return;
+    lb->data[lb->len] = '\0';
+    lb->len = 0;
+    on_line(lb->data);
+}
+
+static void stop_running(void) {
+    g_running = 0;
+    event_loop_stop();
+}
+
+static void print_prompt(void) {
+    log_console("\n");
+    log_console(CLR_CYAN "  ═══════════════════════════════════════════\n" CLR_RESET);
+    log_console(CLR_BOLD "  JARVIS  ›  Ready for your command\n" CLR_RESET);
+    log_console(CLR_CYAN "  ═══════════════════════════════════════════\n" CLR_RESET);
+    log_console(CLR_YELLOW "  Try: hello · time · joke · help · search [query] · exit\n" CLR_RESET);
+    log_console("\n");
+
+    if (g_show_timeline) {
+        boot_mark("first prompt");
+        print_boot_timeline();
+        g_show_timeline = 0;
+    }
+    if (g_keyboard_only) log_console(CLR_CYAN "  ❯ Type your command: " CLR_RESET);
+    log_flush();
+
+    if (g_fast_boot) start_deferred_startup();   /* no-op after the first prompt */
+}
+
+/* Stops the loop once neither stdin nor the recognizer can deliver input
+   and the last command has been answered */
+static void check_input_sources(void) {
+    if (!g_running || g_stdin_open || g_turn_busy || g_pending_count > 0 ||
+        g_speaker_check.pid > 0) return;
+    if (!g_keyboard_only || g_recognizer_pid > 0 || g_recognizer_timer > 0) return;
+    log_console("\n");
+    log_message(LOG_INFO, CLR_YELLOW, "[INFO]", "Input closed and no microphone available.");
+    stop_running();
+}
+
+static void enter_keyboard_mode(void) {
+    if (g_keyboard_only) return;
+    g_keyboard_only = 1;
+    log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]",
+                "Microphone unavailable or no speech detected. Switching to keyboard input.");
+    if (g_stdin_open) {
+        log_console(CLR_CYAN "  ❯ Type your command: " CLR_RESET);
+        log_flush();
+    }
+    check_input_sources();
+}
+
+static void on_speech_done(pid_t pid, int status, void* userdata) {
+    (void)pid; (void)status; (void)userdata;
+    trace_end("tts", g_tts_span, NULL);
+    if (g_speaking > 0) g_speaking--;
+    start_recognizer();
+}
+
+static void on_notify_done(pid_t pid, int status, void* userdata) {
+    (void)pid; (void)status; (void)userdata;
+}
+
+/* Watch mode flipped between green and red: say so without waiting for a command */
+static void on_watch_announcement(int fd, void* userdata) {
+    (void)fd; (void)userdata;
+    char message[512];
+    if (!project_watch_take_announcement(message, sizeof(message))) return;
+
+    log_console(CLR_GREEN "\n  JARVIS › %s\n" CLR_RESET, message);
+    pid_t tts_pid = speak_async(message);
+    if (tts_pid > 0) {
+        g_tts_span = trace_begin();
+        g_speaking++;
+        if (!event_loop_watch_child(tts_pid, on_speech_done, NULL)) {
+            waitpid(tts_pid, NULL, 0);
+            g_speaking--;
         }
+    }
+    pid_t notify_pid = notify_desktop_async("JARVIS", message);
+    if (notify_pid > 0 && !event_loop_watch_child(notify_pid, on_notify_done, NULL))
+        waitpid(notify_pid, NULL, 0);
+    print_prompt();
+}
 
-        /* ── Strict speaker check ── */
-        if (strict_speaker_mode && strcmp(speaker, "UNKNOWN") == 0) {
-            print_ts(CLR_YELLOW, "[WARN]", "Speaker not recognized. Requesting confirmation...");
-            int confirmed = 0;
-            FILE* cpipe = popen("python3 src/speech_recognizer.py 2>/dev/null", "r");
-            if (cpipe) {
-                char conf_buf[256] = "";
-                if (fgets(conf_buf, sizeof(conf_buf), cpipe) != NULL) {
-                    conf_buf[strcspn(conf_buf, "\n")] = 0;
-                    for (char* p = conf_buf; *p; ++p) *p = (char)tolower((unsigned char)*p);
-                    if (strstr(conf_buf, "yes") || strstr(conf_buf, "confirm") ||
-                        strstr(conf_buf, "ok")  || strstr(conf_buf, "execute") ||
-                        strstr(conf_buf, "run")) confirmed = 1;
-                }
-                pclose(cpipe);
-            }
-            if (!confirmed) {
-                printf(CLR_YELLOW "  [JARVIS] Confirm execution? (yes/no): " CLR_RESET);
-                fflush(stdout);
-                char kb[32] = "";
-                if (fgets(kb, sizeof(kb), stdin) != NULL) {
-                    kb[strcspn(kb, "\n")] = 0;
-                    for (char* p = kb; *p; ++p) *p = (char)tolower((unsigned char)*p);
-                    if (strcmp(kb, "yes") == 0 || strcmp(kb, "y") == 0) confirmed = 1;
-                }
-            }
-            if (!confirmed) {
-                print_ts(CLR_YELLOW, "[WARN]", "Command cancelled — no confirmation.");
-                free(combined);
-                continue;
+static int is_confirmation(const char* answer) {
+    char lower[64];
+    size_t i = 0;
+    for (; answer[i] && i < sizeof(lower) - 1; i++) lower[i] = (char)tolower((unsigned char)answer[i]);
+    lower[i] = '\0';
+    return strcmp(lower, "y") == 0 || strstr(lower, "yes") || strstr(lower, "confirm") ||
+           strstr(lower, "ok") || strstr(lower, "execute") || strstr(lower, "run");
+}
+
+static void handle_turn(const char* speaker, const char* text);
+
+/* Runs on its own thread so a slow build or search never stalls the reactor */
+static void* command_thread(void* arg) {
+    CommandTurn* turn = arg;
+
+    /* Handlers popen()/system() their own children: they need SIGCHLD */
+    event_loop_enter_foreign();
+    turn->response = process_command(turn->command);
+    event_loop_leave_foreign();
+
+    unsigned char done = 1;
+    ssize_t ignored = write(g_turn_pipe[1], &done, 1);
+    (void)ignored;
+    return NULL;
+}
+
+/* Second half of a turn, back on the reactor: reply, speak, re-arm input */
+static void finish_turn(void) {
+    char* response = g_turn.response;
+    int answered = response != NULL;
+    g_turn.response = NULL;
+    g_turn_busy = 0;
+
+    if (!answered) {
+        log_message(LOG_ERROR, CLR_RED, "[ERROR]", "Command processing failed.");
+    } else {
+        log_message(LOG_INFO, CLR_GREEN, "💬", "Responding...");
+        log_console(CLR_GREEN "  JARVIS › %s\n" CLR_RESET, response);
+
+        pid_t tts_pid = speak_async(response);
+        if (tts_pid > 0) {
+            g_tts_span = trace_begin();
+            g_speaking++;
+            if (!event_loop_watch_child(tts_pid, on_speech_done, NULL)) {
+                waitpid(tts_pid, NULL, 0);
+                g_speaking--;
             }
-            print_ts(CLR_YELLOW, "[WARN]", "Unverified source confirmed — proceeding with caution.");
-        } else if (strcmp(speaker, "UNKNOWN") == 0) {
-            strcpy(speaker, "GUEST");
         }
+        pid_t notify_pid = notify_desktop_async("JARVIS", response);
+        if (notify_pid > 0 && !event_loop_watch_child(notify_pid, on_notify_done, NULL))
+            waitpid(notify_pid, NULL, 0);
+        free(response);
+    }
+    trace_end("jarvis_run.turn", g_turn.span, g_turn.command);
 
-        if (strlen(command_text) == 0) {
-            print_ts(CLR_YELLOW, "[WARN]", "Empty command. Please try again.");
-            free(combined);
-            continue;
-        }
+    /* ── Exit check ── */
+    if (answered && (strstr(g_turn.lower, "quit") || strstr(g_turn.lower, "exit") ||
+                     strstr(g_turn.lower, "shutdown"))) {
+        stop_running();
+        return;
+    }
 
-        /* ── Context memory: handle recall commands before processing ── */
-        char lower_cmd_check[512];
-        for (size_t i = 0; command_text[i] && i < sizeof(lower_cmd_check) - 1; i++)
-            lower_cmd_check[i] = (char)tolower((unsigned char)command_text[i]);
-        lower_cmd_check[strlen(command_text)] = '\0';
-
-        if (strstr(lower_cmd_check, "repeat last") || strstr(lower_cmd_check, "last command")) {
-            const char* last = memory_last();
-            if (last) {
-                print_ts(CLR_CYAN, "🧠", "Recalling last command...");
-                printf(CLR_CYAN "  Last command: \"%s\"\n" CLR_RESET, last);
-                strncpy(command_text, last, sizeof(command_text) - 1);
-                command_text[sizeof(command_text) - 1] = '\0';
-            } else {
-                print_ts(CLR_YELLOW, "[INFO]", "No previous commands in memory.");
-                free(combined);
-                continue;
-            }
-        } else if (strstr(lower_cmd_check, "what did i say") || strstr(lower_cmd_check, "history")) {
-            printf(CLR_CYAN "\n  ── Command History ──────────────────────\n" CLR_RESET);
-            if (g_memory_count == 0) {
-                printf("  (empty)\n");
-            } else {
-                for (int i = g_memory_count - 1; i >= 0; i--)
-                    printf(CLR_YELLOW "  [%d] %s\n" CLR_RESET, g_memory_count - i, g_memory[i]);
-            }
-            printf(CLR_CYAN "  ─────────────────────────────────────────\n\n" CLR_RESET);
-            free(combined);
-            continue;
+    /* Typed ahead while the command ran: take the next ones (turns that end
+       without dispatching a command print their own prompt) */
+    char speaker[sizeof(g_turn.speaker)];
+    snprintf(speaker, sizeof(speaker), "%s", g_turn.speaker);
+    int took_pending = 0;
+    while (g_pending_count > 0 && !g_turn_busy && g_running) {
+        PendingTurn next = g_pending_turns[g_pending_head];
+        g_pending_head = (g_pending_head + 1) % PENDING_TURNS_MAX;
+        g_pending_count--;
+        handle_turn(next.speaker, next.text);
+        took_pending = 1;
+    }
+    if (g_turn_busy || !g_running) return;
+    if (!took_pending) print_prompt();
+
+    /* A typed command re-arms the microphone, like the serial loop did each turn */
+    if (g_keyboard_only && strcmp(speaker, "KEYBOARD") == 0 && voice_input_probe()) {
+        g_keyboard_only = 0;
+        g_recognizer_misses = 0;
+    }
+    start_recognizer();
+    check_input_sources();
+}
+
+static void on_command_done(int fd, void* userdata) {
+    (void)userdata;
+    unsigned char done;
+    if (read(fd, &done, 1) != 1 || !g_turn_busy) return;
+    if (g_turn.threaded) pthread_join(g_turn.thread, NULL);
+    finish_turn();
+}
+
+/* One assistant turn: recall/memory, then dispatch to the command thread.
+   @return 1 if a command was dispatched (the turn ends in finish_turn) */
+static int run_turn(const char* speaker_in, const char* text, long long span) {
+    if (!g_running) return 0;
+
+    char speaker[128];
+    char command_text[512];
+    snprintf(speaker, sizeof(speaker), "%s", speaker_in);
+    snprintf(command_text, sizeof(command_text), "%s", text);
+
+    /* ── Strict speaker check: this input may answer a pending confirmation ── */
+    if (g_pending_command[0] != '\0') {
+        if (!is_confirmation(command_text)) {
+            log_message(LOG_WARN, CLR_YELLOW, "[WARN]", "Command cancelled — no confirmation.");
+            g_pending_command[0] = '\0';
+            print_prompt();
+            return 0;
         }
+        log_message(LOG_WARN, CLR_YELLOW, "[WARN]", "Unverified source confirmed — proceeding with caution.");
+        snprintf(command_text, sizeof(command_text), "%s", g_pending_command);
+        g_pending_command[0] = '\0';
+    } else if (g_strict_speaker_mode && strcmp(speaker, "UNKNOWN") == 0) {
+        log_message(LOG_WARN, CLR_YELLOW, "[WARN]", "Speaker not recognized. Requesting confirmation...");
+        snprintf(g_pending_command, sizeof(g_pending_command), "%s", command_text);
+        log_console(CLR_YELLOW "  [JARVIS] Confirm execution? (yes/no): " CLR_RESET);
+        log_flush();
+        return 0;
+    } else if (strcmp(speaker, "UNKNOWN") == 0) {
+        strcpy(speaker, "GUEST");
+    }
 
-        /* ── Store in memory ── */
-        memory_push(command_text);
+    if (strlen(command_text) == 0) {
+        log_message(LOG_WARN, CLR_YELLOW, "[WARN]", "Empty command. Please try again.");
+        return 0;
+    }
 
-        print_ts(CLR_CYAN, "🧠", "Processing...");
-        printf(CLR_BOLD "  [%s] › %s\n" CLR_RESET, speaker, command_text);
+    /* ── Context memory: handle recall commands before processing ── */
+    char lower_cmd_check[512];
+    size_t lower_len = 0;
+    for (; command_text[lower_len] && lower_len < sizeof(lower_cmd_check) - 1; lower_len++)
+        lower_cmd_check[lower_len] = (char)tolower((unsigned char)command_text[lower_len]);
+    lower_cmd_check[lower_len] = '\0';
+
+    if (strstr(lower_cmd_check, "repeat last") || strstr(lower_cmd_check, "last command")) {
+        const char* last = memory_last();
+        if (last) {
+            log_message(LOG_INFO, CLR_CYAN, "🧠", "Recalling last command...");
+            log_console(CLR_CYAN "  Last command: \"%s\"\n" CLR_RESET, last);
+            strncpy(command_text, last, sizeof(command_text) - 1);
+            command_text[sizeof(command_text) - 1] = '\0';
+        } else {
+            log_message(LOG_INFO, CLR_YELLOW, "[INFO]", "No previous commands in memory.");
+            print_prompt();
+            return 0;
+        }
+    } else if (strstr(lower_cmd_check, "what did i say") || strstr(lower_cmd_check, "history")) {
+        log_console(CLR_CYAN "\n  ── Command History ──────────────────────\n" CLR_RESET);
+        int count = jarvis_memory_count();
+        if (count == 0) {
+            log_console("  (empty)\n");
+        } else {
+            for (int i = count - 1; i >= 0; i--)
+                log_console(CLR_YELLOW "  [%d] %s\n" CLR_RESET, count - i, jarvis_memory_get(i));
+        }
+        log_console(CLR_CYAN "  ─────────────────────────────────────────\n\n" CLR_RESET);
+        print_prompt();
+        return 0;
+    }
 
-        /* ── Process ── */
-        char* response = process_command(command_text);
-        if (!response) {
-            print_ts(CLR_RED, "[ERROR]", "Command processing failed.");
-            free(combined);
-            continue;
+    /* ── Store in memory ── */
+    memory_push(command_text);
+
+    log_message(LOG_INFO, CLR_CYAN, "🧠", "Processing...");
+    log_console(CLR_BOLD "  [%s] › %s\n" CLR_RESET, speaker, command_text);
+
+    /* ── Process off the reactor; on_command_done picks up the reply ── */
+    log_flush();
+    snprintf(g_turn.speaker, sizeof(g_turn.speaker), "%s", speaker);
+    snprintf(g_turn.command, sizeof(g_turn.command), "%s", command_text);
+    snprintf(g_turn.lower, sizeof(g_turn.lower), "%s", lower_cmd_check);
+    g_turn.response = NULL;
+    g_turn.span = span;
+    g_turn_busy = 1;
+    g_turn.threaded = g_turn_pipe[0] >= 0 &&
+                      pthread_create(&g_turn.thread, NULL, command_thread, &g_turn) == 0;
+    if (!g_turn.threaded) {
+        /* No thread or no pipe: answer inline as before */
+        event_loop_enter_foreign();
+        g_turn.response = process_command(g_turn.command);
+        event_loop_leave_foreign();
+        finish_turn();
+    }
+    return 1;
+}
+
+static void handle_turn(const char* speaker, const char* text) {
+    if (g_turn_busy) {
+        if (g_pending_count == PENDING_TURNS_MAX) {
+            log_message(LOG_WARN, CLR_YELLOW, "[WARN]", "Still working; ignoring \"%s\".", text);
+            return;
         }
+        PendingTurn* slot = &g_pending_turns[(g_pending_head + g_pending_count) % PENDING_TURNS_MAX];
+        snprintf(slot->speaker, sizeof(slot->speaker), "%s", speaker);
+        snprintf(slot->text, sizeof(slot->text), "%s", text);
+        g_pending_count++;
+        return;
+    }
+
+    long long span = trace_begin();
+    if (!run_turn(speaker, text, span)) trace_end("jarvis_run.turn", span, text);
+}
+
+/* ── Keyboard source ── */
+static void on_keyboard_line(const char* line) {
+    handle_turn("KEYBOARD", line);
+}
+
+static void on_stdin_readable(int fd, void* userdata) {
+    (void)userdata;
+    char buf[INPUT_LINE_MAX];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+        line_buffer_feed(&g_stdin_line, buf, (size_t)n, on_keyboard_line);
+        return;
+    }
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+
+    /* EOF or error: stop watching stdin */
+    line_buffer_flush(&g_stdin_line, on_keyboard_line);
+    event_loop_remove_fd(fd);
+    g_stdin_open = 0;
+    check_input_sources();
+}
+
+/* ── Recognizer source (python speech recognizer child, one phrase per run) ── */
+static void deliver_voice_line(const char* speaker, const char* line) {
+    if (strcmp(speaker, "UNKNOWN") != 0)
+        log_console(CLR_GREEN "  💬  (%s) You said: \"%s\"\n" CLR_RESET, speaker, line);
+    else
+        log_console(CLR_GREEN "  💬  You said: \"%s\"\n" CLR_RESET, line);
+    handle_turn(speaker, line);
+}
+
+static void on_speaker_line(const char* line) {
+    if (g_speaker_check.speaker[0] != '\0') return;
+    size_t len = strnlen(line, sizeof(g_speaker_check.speaker) - 1);
+    memcpy(g_speaker_check.speaker, line, len);
+    g_speaker_check.speaker[len] = '\0';
+}
+
+static void close_speaker_fd(void) {
+    if (g_speaker_check.fd < 0) return;
+    event_loop_remove_fd(g_speaker_check.fd);
+    close(g_speaker_check.fd);
+    g_speaker_check.fd = -1;
+    line_buffer_flush(&g_speaker_check.output, on_speaker_line);
+}
+
+static void on_speaker_readable(int fd, void* userdata) {
+    (void)userdata;
+    char buf[INPUT_LINE_MAX];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+        line_buffer_feed(&g_speaker_check.output, buf, (size_t)n, on_speaker_line);
+    } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+        close_speaker_fd();
+    }
+}
+
+/* The recognizer answered: the phrase becomes a turn with its speaker */
+static void on_speaker_exit(pid_t pid, int status, void* userdata) {
+    (void)pid; (void)status; (void)userdata;
+    g_speaker_check.pid = 0;
+    if (g_speaker_check.fd >= 0) {
+        char buf[INPUT_LINE_MAX];
+        ssize_t n;
+        while ((n = read(g_speaker_check.fd, buf, sizeof(buf))) > 0)
+            line_buffer_feed(&g_speaker_check.output, buf, (size_t)n, on_speaker_line);
+        close_speaker_fd();
+    }
+    if (g_speaker_check.speaker[0] == '\0')
+        snprintf(g_speaker_check.speaker, sizeof(g_speaker_check.speaker), "UNKNOWN");
+    trace_end("speaker_verify", g_speaker_check.span, g_speaker_check.speaker);
+    if (!g_running) return;
+
+    deliver_voice_line(g_speaker_check.speaker, g_speaker_check.text);
+    start_recognizer();   /* held off while the microphone was in use */
+    check_input_sources();
+}
+
+/* Starts speaker verification without blocking the loop.
+   @return 1 if the child is running (the turn starts in on_speaker_exit) */
+static int start_speaker_check(const char* line) {
+    if (g_speaker_check.pid > 0) return 0;   /* one at a time; later phrases stay unverified */
+
+    char* argv[] = {"python3", "src/speaker_recognizer.py", NULL};
+    int fd = -1;
+    pid_t pid = event_loop_spawn(argv, NULL, &fd);
+    if (pid <= 0) return 0;
+
+    g_speaker_check.pid = pid;
+    g_speaker_check.fd = fd;
+    g_speaker_check.output.len = 0;
+    g_speaker_check.speaker[0] = '\0';
+    snprintf(g_speaker_check.text, sizeof(g_speaker_check.text), "%s", line);
+    g_speaker_check.span = trace_begin();
+    event_loop_add_fd(fd, on_speaker_readable, NULL);
+    if (!event_loop_watch_child(pid, on_speaker_exit, NULL)) {
+        waitpid(pid, NULL, 0);
+        on_speaker_exit(pid, 0, NULL);
+    }
+    return 1;
+}
+
+static void on_voice_line(const char* line) {
+    if (strlen(line) == 0) return;
+    g_recognizer_heard = 1;
+    trace_end("recognize", g_listen_span, line);
 
-        print_ts(CLR_GREEN, "💬", "Responding...");
-        printf(CLR_GREEN "  JARVIS › %s\n" CLR_RESET, response);
-        speak(response);
-        notify_desktop("JARVIS", response);
+    if (g_verify_speaker && start_speaker_check(line)) return;
+    deliver_voice_line("UNKNOWN", line);
+}
+
+static void close_recognizer_fd(void) {
+    if (g_recognizer_fd < 0) return;
+    event_loop_remove_fd(g_recognizer_fd);
+    close(g_recognizer_fd);
+    g_recognizer_fd = -1;
+    line_buffer_flush(&g_recognizer_line, on_voice_line);
+}
+
+static void on_recognizer_readable(int fd, void* userdata) {
+    (void)userdata;
+    char buf[INPUT_LINE_MAX];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+        line_buffer_feed(&g_recognizer_line, buf, (size_t)n, on_voice_line);
+    } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+        close_recognizer_fd();
+    }
+}
+
+static void on_recognizer_retry(int timer_id, void* userdata) {
+    (void)timer_id; (void)userdata;
+    g_recognizer_timer = 0;
+    start_recognizer();
+}
+
+static void on_recognizer_exit(pid_t pid, int status, void* userdata) {
+    (void)pid; (void)status; (void)userdata;
+    g_recognizer_pid = 0;
+
+    /* The child may exit before its last line was read: drain the pipe */
+    if (g_recognizer_fd >= 0) {
+        char buf[INPUT_LINE_MAX];
+        ssize_t n;
+        while ((n = read(g_recognizer_fd, buf, sizeof(buf))) > 0)
+            line_buffer_feed(&g_recognizer_line, buf, (size_t)n, on_voice_line);
+        close_recognizer_fd();
+    }
+    if (!g_running) return;
+
+    if (g_recognizer_heard) {
+        g_recognizer_misses = 0;
+        start_recognizer();
+        return;
+    }
+
+    if (++g_recognizer_misses >= RECOGNIZER_MAX_MISSES) {
+        enter_keyboard_mode();
+        return;
+    }
+    log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "No speech detected. Retrying...");
+    g_recognizer_timer = event_loop_add_timer(RECOGNIZER_RETRY_MS, 0, on_recognizer_retry, NULL);
+    if (g_recognizer_timer == 0) start_recognizer();
+}
+
+static void start_recognizer(void) {
+    if (!g_running || g_keyboard_only || g_recognizer_pid > 0 ||
+        g_recognizer_timer > 0 || g_speaking > 0 || g_speaker_check.pid > 0) return;
+
+    if (!voice_input_probe()) {
+        enter_keyboard_mode();
+        return;
+    }
+
+    char* argv[] = {"python3", "src/speech_recognizer.py", NULL};
+    int fd = -1;
+    pid_t pid = event_loop_spawn(argv, NULL, &fd);
+    if (pid <= 0) {
+        enter_keyboard_mode();
+        return;
+    }
+
+    g_recognizer_pid = pid;
+    g_recognizer_fd = fd;
+    g_recognizer_heard = 0;
+    g_recognizer_line.len = 0;
+    g_listen_span = trace_begin();
+    event_loop_add_fd(fd, on_recognizer_readable, NULL);
+    event_loop_watch_child(pid, on_recognizer_exit, NULL);
+    log_message(LOG_INFO, CLR_GREEN, "🎤", "Listening...");
+}
+
+static void on_metrics_timer(int timer_id, void* userdata) {
+    (void)timer_id; (void)userdata;
+    metrics_write_prometheus(NULL);
+}
 
-        /* ── Exit check ── */
-        if (strstr(lower_cmd_check, "quit") || strstr(lower_cmd_check, "exit") ||
-            strstr(lower_cmd_check, "shutdown")) {
-            running = 0;
+static void on_shutdown_drain_timeout(int timer_id, void* userdata) {
+    (void)timer_id;
+    *(int*)userdata = 1;
+}
+
+void jarvis_run(void) {
+    if (!event_loop_init()) {
+        log_message(LOG_ERROR, CLR_RED, "[ERROR]", "Failed to initialize the event loop.");
+        return;
+    }
+
+    g_running = 1;
+    g_strict_speaker_mode = env_flag_enabled(getenv("JARVIS_STRICT_SPEAKER"));
+    g_verify_speaker = env_flag_enabled(getenv("JARVIS_VERIFY_SPEAKER"));
+    g_keyboard_only = !voice_input_probe();
+    g_stdin_open = event_loop_add_fd(STDIN_FILENO, on_stdin_readable, NULL);
+    if (pipe(g_turn_pipe) == 0) {
+        fcntl(g_turn_pipe[0], F_SETFD, FD_CLOEXEC);
+        fcntl(g_turn_pipe[1], F_SETFD, FD_CLOEXEC);
+        if (!event_loop_add_fd(g_turn_pipe[0], on_command_done, NULL)) {
+            close(g_turn_pipe[0]);
+            close(g_turn_pipe[1]);
+            g_turn_pipe[0] = g_turn_pipe[1] = -1;   /* commands run inline */
         }
+    }
+    int watch_fd = project_watch_announce_fd();
+    if (watch_fd >= 0 && !event_loop_add_fd(watch_fd, on_watch_announcement, NULL)) watch_fd = -1;
 
-        free(response);
-        free(combined);
+    int metrics_interval = metrics_export_interval_ms();
+    if (metrics_interval > 0) event_loop_add_timer(metrics_interval, 1, on_metrics_timer, NULL);
+
+    /* Fast boot skips the spoken greeting so the first prompt is not held up by TTS */
+    if (g_fast_boot) {
+        log_console(CLR_GREEN "  JARVIS › JARVIS version 2.0 is now online. How may I assist you?\n" CLR_RESET);
+    } else {
+        pid_t greeting = speak_async("JARVIS version 2.0 is now online. How may I assist you?");
+        if (greeting > 0 && event_loop_watch_child(greeting, on_speech_done, NULL)) g_speaking++;
+    }
+
+    print_prompt();
+    start_recognizer();
+    check_input_sources();
+
+    if (g_running) event_loop_run();
+
+    /* ── Shutdown: stop listening and watching, let the last reply finish speaking ── */
+    if (g_turn_busy && g_turn.threaded) {
+        pthread_join(g_turn.thread, NULL);
+        free(g_turn.response);
+        g_turn.response = NULL;
+        g_turn_busy = 0;
     }
+    if (g_turn_pipe[0] >= 0) {
+        event_loop_remove_fd(g_turn_pipe[0]);
+        close(g_turn_pipe[0]);
+        close(g_turn_pipe[1]);
+        g_turn_pipe[0] = g_turn_pipe[1] = -1;
+    }
+    project_watch_stop();
+    if (watch_fd >= 0) event_loop_remove_fd(watch_fd);
+    if (g_recognizer_pid > 0) {
+        kill(g_recognizer_pid, SIGTERM);
+        waitpid(g_recognizer_pid, NULL, 0);
+        g_recognizer_pid = 0;
+    }
+    close_recognizer_fd();
+    if (g_recognizer_timer > 0) event_loop_cancel_timer(g_recognizer_timer);
+    if (g_speaker_check.pid > 0) {
+        kill(g_speaker_check.pid, SIGTERM);
+        waitpid(g_speaker_check.pid, NULL, 0);
+        g_speaker_check.pid = 0;
+    }
+    close_speaker_fd();
+
+    int timed_out = 0;
+    int drain_timer = event_loop_add_timer(SHUTDOWN_DRAIN_MS, 0, on_shutdown_drain_timeout, &timed_out);
+    while (g_speaking > 0 && !timed_out && event_loop_run_once(-1) >= 0) {}
+    if (drain_timer > 0 && !timed_out) event_loop_cancel_timer(drain_timer);
+
+    if (g_stdin_open) event_loop_remove_fd(STDIN_FILENO);
+    event_loop_shutdown();
+    metrics_write_prometheus(NULL);
 }
 
 void jarvis_cleanup(void) {
-    printf("\n");
-    print_ts(CLR_YELLOW, "[SHUTDOWN]", "Powering down subsystems...");
-    print_ts(CLR_YELLOW, "[SHUTDOWN]", "All systems offline.");
-    printf(CLR_CYAN "\n  Goodbye, sir.\n\n" CLR_RESET);
+    log_console("\n");
+    log_message(LOG_INFO, CLR_YELLOW, "[SHUTDOWN]", "Powering down subsystems...");
+    log_message(LOG_INFO, CLR_YELLOW, "[SHUTDOWN]", "All systems offline.");
+    log_console(CLR_CYAN "\n  Goodbye, sir.\n\n" CLR_RESET);
 }
@@ -0,0 +1,196 @@
+#include "../include/json.h"
+#include <string.h>
+#include <ctype.h>
+
+/* Returns the escape sequence for ch, or NULL if it can be written verbatim */
+static const char* json_escape_char(unsigned char ch, char scratch[8]) {
+    switch (ch) {
+        case '"':  return "\\\"";
+        case '\\': return "\\\\";
+        case '\n': return "\\n";
+        case '\r': return "\\r";
+        case '\t': return "\\t";
+        case '\b': return "\\b";
+        case '\f': return "\\f";
+        default:
+            if (ch < 0x20) {
+                snprintf(scratch, 8, "\\u%04x", ch);
+                return scratch;
+            }
+            return NULL;
+    }
+}
+
+void json_write_string(FILE* out, const char* text) {
+    if (!out) return;
+    if (!text) {
+        fputs("null", out);
+        return;
+    }
+
+    char scratch[8];
+    fputc('"', out);
+    const char* run = text;
+    for (const char* p = text; *p; p++) {
+        const char* esc = json_escape_char((unsigned char)*p, scratch);
+        if (!esc) continue;
+        if (p > run) fwrite(run, 1, (size_t)(p - run), out);
+        fputs(esc, out);
+        run = p + 1;
+    }
+    fputs(run, out);
+    fputc('"', out);
+}
+
+size_t json_escape(const char* text, char* out, size_t out_size) {
+    if (!out || out_size == 0) return 0;
+
+    size_t len = 0;
+    char scratch[8];
+    for (const char* p = text ? text : ""; *p; p++) {
+        const char* esc = json_escape_char((unsigned char)*p, scratch);
+        size_t piece_len = esc ? strlen(esc) : 1;
+        if (len + piece_len >= out_size) break;
+        if (esc) memcpy(out + len, esc, piece_len);
+        else out[len] = *p;
+        len += piece_len;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static const char* skip_ws(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    return p;
+}
+
+/* Returns a pointer just past the JSON string starting at p (which must be '"') */
+static const char* skip_string(const char* p) {
+    for (p++; *p && *p != '"'; p++) {
+        if (*p == '\\' && p[1]) p++;
+    }
+    return *p == '"' ? p + 1 : NULL;
+}
+
+/* Returns a pointer just past the JSON value starting at p, or NULL if malformed */
+static const char* skip_value(const char* p) {
+    p = skip_ws(p);
+    if (*p == '"') return skip_string(p);
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '"') {
+                p = skip_string(p);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') depth++;
+            else if (*p == '}' || *p == ']') {
+                if (--depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    const char* start = p;
+    while (*p && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') p++;
+    return p > start ? p : NULL;
+}
+
+/* Finds the value of a top-level member of the object in json */
+static const char* find_member(const char* json, const char* key) {
+    if (!json || !key) return NULL;
+    const char* p = skip_ws(json);
+    if (*p != '{') return NULL;
+    p++;
+
+    size_t key_len = strlen(key);
+    while (1) {
+        p = skip_ws(p);
+        if (*p != '"') return NULL;
+        const char* name = p + 1;
+        const char* name_end = skip_string(p);
+        if (!name_end) return NULL;
+
+        p = skip_ws(name_end);
+        if (*p != ':') return NULL;
+        p = skip_ws(p + 1);
+
+        if ((size_t)(name_end - 1 - name) == key_len && strncmp(name, key, key_len) == 0) return p;
+
+        p = skip_value(p);
+        if (!p) return NULL;
+        p = skip_ws(p);
+        if (*p != ',') return NULL;
+        p++;
+    }
+}
+
+static void put_utf8(unsigned cp, char* out, size_t out_size, size_t* len) {
+    char buf[4];
+    size_t n;
+    if (cp < 0x80) { buf[0] = (char)cp; n = 1; }
+    else if (cp < 0x800) { buf[0] = (char)(0xC0 | (cp >> 6)); buf[1] = (char)(0x80 | (cp & 0x3F)); n = 2; }
+    else {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    }
+    if (*len + n >= out_size) return;
+    memcpy(out + *len, buf, n);
+    *len += n;
+}
+
+int json_get_string(const char* json, const char* key, char* out, size_t out_size) {
+    if (!out || out_size == 0) return 0;
+    out[0] = '\0';
+
+    const char* p = find_member(json, key);
+    if (!p || *p != '"') return 0;
+
+    size_t len = 0;
+    for (p++; *p && *p != '"'; p++) {
+        char ch = *p;
+        if (ch == '\\') {
+            p++;
+            switch (*p) {
+                case 'n': ch = '\n'; break;
+                case 'r': ch = '\r'; break;
+                case 't': ch = '\t'; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'u': {
+                    unsigned cp = 0;
+                    int digits = 0;
+                    for (; digits < 4 && isxdigit((unsigned char)p[1]); digits++, p++) {
+                        char h = (char)tolower((unsigned char)p[1]);
+                        cp = cp * 16 + (unsigned)(isdigit((unsigned char)h) ? h - '0' : h - 'a' + 10);
+                    }
+                    if (digits != 4) return 0;
+                    put_utf8(cp, out, out_size, &len);
+                    continue;
+                }
+                case '\0': return 0;
+                default: ch = *p; break;  /* \" \\ \/ */
+            }
+        }
+        if (len + 1 < out_size) out[len++] = ch;
+    }
+    out[len] = '\0';
+    return *p == '"';
+}
+
+int json_get_raw(const char* json, const char* key, char* out, size_t out_size) {
+    if (!out || out_size == 0) return 0;
+    out[0] = '\0';
+
+    const char* start = find_member(json, key);
+    const char* end = start ? skip_value(start) : NULL;
+    if (!end || (size_t)(end - start) >= out_size) return 0;
+
+    memcpy(out, start, (size_t)(end - start));
+    out[end - start] = '\0';
+    return 1;
+}
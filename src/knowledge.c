@@ -0,0 +1,870 @@
+#include "../include/knowledge.h"
+#include "../include/dir_walk.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define KB_MAGIC             "JKS1"
+#define KB_VERSION           2
+#define KB_MAX_FILE_BYTES    (4 * 1024 * 1024)
+#define KB_SECTION_MAX_BYTES 1500
+#define KB_RECHECK_US        (30LL * 1000 * 1000)
+#define KB_TERM_MAX          32
+#define KB_QUERY_TERMS       16
+#define KB_BM25_K1           1.2
+#define KB_BM25_B            0.75
+#define KB_DEFAULT_MIN_SCORE 4.0
+#define KB_SNIPPET_WINDOW    280
+
+/* ── Segment format ─────────────────────────────────────────────────────────
+   [header][docs][terms sorted by text][postings][strings]
+   Offsets are from the start of the file; postings are (doc, tf) pairs in
+   ascending doc order. Sections are re-read from their source for snippets. */
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t fingerprint;      /* corpus paths, sizes and mtimes */
+    uint64_t total_tokens;
+    uint32_t doc_count;
+    uint32_t term_count;
+    uint32_t docs_offset;
+    uint32_t terms_offset;
+    uint32_t postings_offset;
+    uint32_t strings_offset;
+    uint32_t file_size;
+    uint32_t reserved;
+} SegmentHeader;
+
+typedef struct {
+    uint32_t path;             /* string offset */
+    uint32_t title;            /* string offset */
+    uint32_t offset;           /* byte range of the section in its file */
+    uint32_t length;
+    uint32_t tokens;
+} SegmentDoc;
+
+typedef struct {
+    uint32_t text;             /* string offset */
+    uint32_t postings;         /* index of the first posting */
+    uint32_t count;            /* document frequency */
+} SegmentTerm;
+
+typedef struct {
+    uint32_t doc;
+    uint32_t tf;
+} SegmentPosting;
+
+/* ── Tokenizer ──────────────────────────────────────────────────────────── */
+
+static const char* const g_stopwords[] = {
+    "a", "an", "and", "are", "as", "at", "be", "by", "do", "does", "for", "from", "how", "i",
+    "in", "is", "it", "me", "my", "of", "on", "or", "tell", "that", "the", "this", "to",
+    "what", "when", "where", "which", "who", "why", "with", "you", "about", "can"
+};
+
+static int is_stopword(const char* term) {
+    for (size_t i = 0; i < sizeof(g_stopwords) / sizeof(g_stopwords[0]); i++) {
+        if (strcmp(term, g_stopwords[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int is_word_byte(unsigned char c) {
+    return isalnum(c) || c >= 0x80;
+}
+
+/* Next indexable term in [*cursor, end): lowercased, stopwords skipped, then
+   plural 's' folded (so "this" and "does" are dropped, not indexed as "thi"
+   and "doe"). Returns its length, 0 at the end. */
+static size_t next_term(const char** cursor, const char* end, char* out, const char** start) {
+    const char* p = *cursor;
+    for (;;) {
+        while (p < end && !is_word_byte((unsigned char)*p)) p++;
+        if (p >= end) {
+            *cursor = p;
+            return 0;
+        }
+
+        const char* word = p;
+        size_t len = 0;
+        while (p < end && is_word_byte((unsigned char)*p)) {
+            if (len + 1 < KB_TERM_MAX) out[len++] = (char)tolower((unsigned char)*p);
+            p++;
+        }
+        out[len] = '\0';
+        if (is_stopword(out)) continue;
+        if (len > 3 && out[len - 1] == 's' && out[len - 2] != 's') out[--len] = '\0';
+        if (len < 2) continue;
+
+        if (start) *start = word;
+        *cursor = p;
+        return len;
+    }
+}
+
+/* ── Corpus discovery ───────────────────────────────────────────────────── */
+
+typedef struct {
+    char**          paths;
+    size_t          count;
+    size_t          cap;
+    pthread_mutex_t lock;
+} FileList;
+
+static int has_knowledge_extension(const char* name) {
+    const char* dot = strrchr(name, '.');
+    if (!dot) return 0;
+    return strcasecmp(dot, ".md") == 0 || strcasecmp(dot, ".markdown") == 0 ||
+           strcasecmp(dot, ".txt") == 0 || strcasecmp(dot, ".rst") == 0;
+}
+
+static void file_list_add(FileList* list, const char* path) {
+    char resolved[PATH_MAX];
+    if (!realpath(path, resolved)) return;
+
+    pthread_mutex_lock(&list->lock);
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        char** grown = realloc(list->paths, cap * sizeof(char*));
+        if (!grown) {
+            pthread_mutex_unlock(&list->lock);
+            return;
+        }
+        list->paths = grown;
+        list->cap = cap;
+    }
+    char* copy = strdup(resolved);
+    if (copy) list->paths[list->count++] = copy;
+    pthread_mutex_unlock(&list->lock);
+}
+
+static void file_list_free(FileList* list) {
+    for (size_t i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->cap = 0;
+}
+
+static int collect_document(const char* path, size_t name_offset, int worker, void* ctx) {
+    (void)worker;
+    if (has_knowledge_extension(path + name_offset)) file_list_add((FileList*)ctx, path);
+    return 1;
+}
+
+static void walk_knowledge_dir(const char* dir, FileList* list) {
+    dir_walk_options options = {0};
+    options.visit_file = collect_document;
+    options.ctx = list;
+    dir_walk(&dir, 1, &options);
+}
+
+static int compare_strings(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void list_corpus(FileList* list) {
+    const char* configured = getenv("JARVIS_KNOWLEDGE_DIRS");
+    if (configured && configured[0] != '\0') {
+        char dirs[4096];
+        snprintf(dirs, sizeof(dirs), "%s", configured);
+        char* save = NULL;
+        for (char* dir = strtok_r(dirs, ":", &save); dir; dir = strtok_r(NULL, ":", &save)) {
+            walk_knowledge_dir(dir, list);
+        }
+    } else {
+        /* The project's own guides (top level only), plus a personal notes folder */
+        DIR* cwd = opendir(".");
+        if (cwd) {
+            struct dirent* entry;
+            while ((entry = readdir(cwd)) != NULL) {
+                if (entry->d_name[0] != '.' && has_knowledge_extension(entry->d_name)) file_list_add(list, entry->d_name);
+            }
+            closedir(cwd);
+        }
+        const char* home = getenv("HOME");
+        if (home) {
+            char notes[PATH_MAX];
+            snprintf(notes, sizeof(notes), "%s/.jarvis/knowledge", home);
+            struct stat st;
+            if (stat(notes, &st) == 0 && S_ISDIR(st.st_mode)) walk_knowledge_dir(notes, list);
+        }
+    }
+
+    qsort(list->paths, list->count, sizeof(char*), compare_strings);
+    size_t unique = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        if (unique > 0 && strcmp(list->paths[unique - 1], list->paths[i]) == 0) {
+            free(list->paths[i]);
+            continue;
+        }
+        list->paths[unique++] = list->paths[i];
+    }
+    list->count = unique;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t corpus_fingerprint(const FileList* list) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < list->count; i++) {
+        struct stat st;
+        long long stamp[2] = { -1, -1 };
+        if (stat(list->paths[i], &st) == 0) {
+            stamp[0] = (long long)st.st_size;
+            stamp[1] = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        }
+        hash = fnv1a(hash, list->paths[i], strlen(list->paths[i]) + 1);
+        hash = fnv1a(hash, stamp, sizeof(stamp));
+    }
+    return hash;
+}
+
+/* ── Segment builder ────────────────────────────────────────────────────── */
+
+typedef struct {
+    char*  data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+static int buffer_append(Buffer* buffer, const void* data, size_t len) {
+    if (buffer->len + len > buffer->cap) {
+        size_t cap = buffer->cap ? buffer->cap * 2 : 4096;
+        while (cap < buffer->len + len) cap *= 2;
+        char* grown = realloc(buffer->data, cap);
+        if (!grown) return 0;
+        buffer->data = grown;
+        buffer->cap = cap;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return 1;
+}
+
+static uint32_t buffer_add_string(Buffer* strings, const char* text) {
+    uint32_t offset = (uint32_t)strings->len;
+    buffer_append(strings, text, strlen(text) + 1);
+    return offset;
+}
+
+typedef struct {
+    uint32_t        text;       /* offset into the string pool; UINT32_MAX = empty slot */
+    SegmentPosting* postings;
+    uint32_t        count;
+    uint32_t        cap;
+} BuildTerm;
+
+typedef struct {
+    Buffer      strings;
+    Buffer      docs;           /* SegmentDoc[] */
+    BuildTerm*  terms;          /* open-addressing hash table */
+    uint32_t    term_slots;
+    uint32_t    term_count;
+    uint64_t    total_tokens;
+    uint32_t*   doc_terms;      /* scratch: term slots of the current section */
+    size_t      doc_terms_cap;
+} Builder;
+
+static uint32_t hash_term(const char* term) {
+    return (uint32_t)fnv1a(1469598103934665603ULL, term, strlen(term));
+}
+
+static int builder_grow_terms(Builder* builder) {
+    uint32_t slots = builder->term_slots ? builder->term_slots * 2 : 4096;
+    BuildTerm* terms = malloc(slots * sizeof(BuildTerm));
+    if (!terms) return 0;
+    for (uint32_t i = 0; i < slots; i++) terms[i].text = UINT32_MAX;
+
+    for (uint32_t i = 0; i < builder->term_slots; i++) {
+        BuildTerm* old = &builder->terms[i];
+        if (old->text == UINT32_MAX) continue;
+        uint32_t slot = hash_term(builder->strings.data + old->text) & (slots - 1);
+        while (terms[slot].text != UINT32_MAX) slot = (slot + 1) & (slots - 1);
+        terms[slot] = *old;
+    }
+    free(builder->terms);
+    builder->terms = terms;
+    builder->term_slots = slots;
+    return 1;
+}
+
+/* Slots move when the table grows, so callers reserve room before a section */
+static int builder_reserve_terms(Builder* builder, size_t extra) {
+    while ((builder->term_count + extra) * 10 >= (size_t)builder->term_slots * 7) {
+        if (!builder_grow_terms(builder)) return 0;
+    }
+    return 1;
+}
+
+static uint32_t builder_term_slot(Builder* builder, const char* term) {
+    uint32_t slot = hash_term(term) & (builder->term_slots - 1);
+    while (builder->terms[slot].text != UINT32_MAX) {
+        if (strcmp(builder->strings.data + builder->terms[slot].text, term) == 0) return slot;
+        slot = (slot + 1) & (builder->term_slots - 1);
+    }
+    BuildTerm* entry = &builder->terms[slot];
+    entry->text = buffer_add_string(&builder->strings, term);
+    entry->postings = NULL;
+    entry->count = entry->cap = 0;
+    builder->term_count++;
+    return slot;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Tokenizes one section into the index */
+static void builder_add_section(Builder* builder, uint32_t path, const char* title,
+                                const char* text, size_t offset, size_t length) {
+    uint32_t doc_id = (uint32_t)(builder->docs.len / sizeof(SegmentDoc));
+    size_t count = 0;
+    const char* cursor = text + offset;
+    const char* end = text + offset + length;
+    char term[KB_TERM_MAX];
+
+    /* Every term is at least two bytes plus a separator */
+    if (!builder_reserve_terms(builder, length / 3 + 2)) return;
+    while (next_term(&cursor, end, term, NULL) > 0) {
+        uint32_t slot = builder_term_slot(builder, term);
+        if (count == builder->doc_terms_cap) {
+            size_t cap = builder->doc_terms_cap ? builder->doc_terms_cap * 2 : 1024;
+            uint32_t* grown = realloc(builder->doc_terms, cap * sizeof(uint32_t));
+            if (!grown) break;
+            builder->doc_terms = grown;
+            builder->doc_terms_cap = cap;
+        }
+        builder->doc_terms[count++] = slot;
+    }
+    if (count == 0) return;
+
+    qsort(builder->doc_terms, count, sizeof(uint32_t), compare_u32);
+    for (size_t i = 0; i < count;) {
+        size_t run = i;
+        while (run < count && builder->doc_terms[run] == builder->doc_terms[i]) run++;
+        BuildTerm* entry = &builder->terms[builder->doc_terms[i]];
+        if (entry->count == entry->cap) {
+            uint32_t cap = entry->cap ? entry->cap * 2 : 4;
+            SegmentPosting* grown = realloc(entry->postings, cap * sizeof(SegmentPosting));
+            if (!grown) {
+                i = run;
+                continue;
+            }
+            entry->postings = grown;
+            entry->cap = cap;
+        }
+        entry->postings[entry->count].doc = doc_id;
+        entry->postings[entry->count].tf = (uint32_t)(run - i);
+        entry->count++;
+        i = run;
+    }
+
+    SegmentDoc doc = { path, buffer_add_string(&builder->strings, title), (uint32_t)offset, (uint32_t)length, (uint32_t)count };
+    buffer_append(&builder->docs, &doc, sizeof(doc));
+    builder->total_tokens += count;
+}
+
+/* Splits a file at Markdown headings, and long stretches at blank lines */
+static void builder_add_file(Builder* builder, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > KB_MAX_FILE_BYTES) return;
+    FILE* in = fopen(path, "rb");
+    if (!in) return;
+    char* text = malloc((size_t)st.st_size + 1);
+    size_t size = text ? fread(text, 1, (size_t)st.st_size, in) : 0;
+    fclose(in);
+    if (!text) return;
+    text[size] = '\0';
+
+    const char* dot = strrchr(path, '.');
+    int markdown = !dot || strcasecmp(dot, ".txt") != 0;
+    uint32_t path_offset = buffer_add_string(&builder->strings, path);
+    const char* slash = strrchr(path, '/');
+    char title[128];
+    snprintf(title, sizeof(title), "%s", slash ? slash + 1 : path);
+
+    size_t section_start = 0;
+    int has_body = 0;
+    for (size_t line = 0; line < size;) {
+        size_t line_end = line;
+        while (line_end < size && text[line_end] != '\n') line_end++;
+
+        int heading = markdown && text[line] == '#';
+        int blank = line_end == line;
+        /* Headings directly under a heading join its section instead of standing alone */
+        if (line > section_start && ((heading && has_body) || (blank && line - section_start > KB_SECTION_MAX_BYTES))) {
+            builder_add_section(builder, path_offset, title, text, section_start, line - section_start);
+            section_start = line;
+            has_body = 0;
+        }
+        if (!heading && !blank) has_body = 1;
+        if (heading) {
+            size_t h = line;
+            while (h < line_end && (text[h] == '#' || text[h] == ' ')) h++;
+            size_t len = line_end - h < sizeof(title) - 1 ? line_end - h : sizeof(title) - 1;
+            memcpy(title, text + h, len);
+            title[len] = '\0';
+        }
+        line = line_end + 1;
+    }
+    if (size > section_start) builder_add_section(builder, path_offset, title, text, section_start, size - section_start);
+    free(text);
+}
+
+static const char* g_sort_strings;   /* builder string pool while sorting terms */
+
+static int compare_terms(const void* a, const void* b) {
+    const BuildTerm* x = a;
+    const BuildTerm* y = b;
+    return strcmp(g_sort_strings + x->text, g_sort_strings + y->text);
+}
+
+/* Builds a complete segment image in memory */
+static char* build_segment(const FileList* corpus, uint64_t fingerprint, size_t* out_size) {
+    Builder builder;
+    memset(&builder, 0, sizeof(builder));
+    if (!builder_grow_terms(&builder)) return NULL;
+
+    for (size_t i = 0; i < corpus->count; i++) builder_add_file(&builder, corpus->paths[i]);
+
+    /* Compact the hash table and order terms by text for binary search */
+    uint32_t term_count = 0;
+    for (uint32_t i = 0; i < builder.term_slots; i++) {
+        if (builder.terms[i].text != UINT32_MAX && builder.terms[i].count > 0) builder.terms[term_count++] = builder.terms[i];
+        else if (builder.terms[i].text != UINT32_MAX) free(builder.terms[i].postings);
+    }
+    g_sort_strings = builder.strings.data;
+    qsort(builder.terms, term_count, sizeof(BuildTerm), compare_terms);
+
+    uint32_t doc_count = (uint32_t)(builder.docs.len / sizeof(SegmentDoc));
+    size_t posting_count = 0;
+    for (uint32_t i = 0; i < term_count; i++) posting_count += builder.terms[i].count;
+
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KB_MAGIC, 4);
+    header.version = KB_VERSION;
+    header.fingerprint = fingerprint;
+    header.total_tokens = builder.total_tokens;
+    header.doc_count = doc_count;
+    header.term_count = term_count;
+    header.docs_offset = (uint32_t)sizeof(SegmentHeader);
+    header.terms_offset = header.docs_offset + (uint32_t)builder.docs.len;
+    header.postings_offset = header.terms_offset + term_count * (uint32_t)sizeof(SegmentTerm);
+    header.strings_offset = header.postings_offset + (uint32_t)(posting_count * sizeof(SegmentPosting));
+    size_t total = header.strings_offset + builder.strings.len;
+    header.file_size = (uint32_t)total;
+
+    char* image = total < UINT32_MAX ? malloc(total) : NULL;
+    if (image) {
+        memcpy(image, &header, sizeof(header));
+        if (builder.docs.len) memcpy(image + header.docs_offset, builder.docs.data, builder.docs.len);
+        SegmentTerm* terms = (SegmentTerm*)(image + header.terms_offset);
+        SegmentPosting* postings = (SegmentPosting*)(image + header.postings_offset);
+        uint32_t next = 0;
+        for (uint32_t i = 0; i < term_count; i++) {
+            terms[i].text = builder.terms[i].text;
+            terms[i].postings = next;
+            terms[i].count = builder.terms[i].count;
+            memcpy(postings + next, builder.terms[i].postings, builder.terms[i].count * sizeof(SegmentPosting));
+            next += builder.terms[i].count;
+        }
+        if (builder.strings.len) memcpy(image + header.strings_offset, builder.strings.data, builder.strings.len);
+        *out_size = total;
+    }
+
+    for (uint32_t i = 0; i < term_count; i++) free(builder.terms[i].postings);
+    free(builder.terms);
+    free(builder.strings.data);
+    free(builder.docs.data);
+    free(builder.doc_terms);
+    return image;
+}
+
+/* ── Loaded segment ─────────────────────────────────────────────────────── */
+
+static pthread_mutex_t      g_lock = PTHREAD_MUTEX_INITIALIZER;
+static const SegmentHeader* g_segment = NULL;
+static void*                g_mapping = NULL;     /* mmap'd file, or NULL */
+static size_t               g_mapping_size = 0;
+static char*                g_owned = NULL;       /* in-memory image when the file can't be written */
+static long long            g_checked_us = 0;
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void segment_path(char* out, size_t out_size) {
+    const char* configured = getenv("JARVIS_KNOWLEDGE_INDEX");
+    if (configured && configured[0] != '\0') {
+        snprintf(out, out_size, "%s", configured);
+        return;
+    }
+    const char* cache = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    char dir[PATH_MAX - 32];
+    if (cache && cache[0] == '/') snprintf(dir, sizeof(dir), "%s/jarvis", cache);
+    else snprintf(dir, sizeof(dir), "%s/.cache/jarvis", home ? home : "/tmp");
+
+    char parent[PATH_MAX];
+    snprintf(parent, sizeof(parent), "%s", dir);
+    char* slash = strrchr(parent, '/');
+    if (slash && slash != parent) {
+        *slash = '\0';
+        mkdir(parent, 0700);
+    }
+    mkdir(dir, 0700);
+    snprintf(out, out_size, "%s/knowledge.seg", dir);
+}
+
+/* Checks every offset a query will follow, so a truncated or corrupt file is
+   rebuilt instead of read out of bounds */
+static int segment_valid(const SegmentHeader* header, size_t size, uint64_t fingerprint) {
+    if (size < sizeof(SegmentHeader) || memcmp(header->magic, KB_MAGIC, 4) != 0) return 0;
+    if (header->version != KB_VERSION || header->fingerprint != fingerprint || header->file_size != size) return 0;
+
+    /* Section layout, in 64 bits so that huge counts cannot wrap */
+    uint64_t terms_at = (uint64_t)header->docs_offset + (uint64_t)header->doc_count * sizeof(SegmentDoc);
+    uint64_t postings_at = terms_at + (uint64_t)header->term_count * sizeof(SegmentTerm);
+    if (header->docs_offset != sizeof(SegmentHeader) || header->terms_offset != terms_at ||
+        header->postings_offset != postings_at || header->strings_offset < postings_at ||
+        header->strings_offset > size || (header->strings_offset - postings_at) % sizeof(SegmentPosting) != 0) {
+        return 0;
+    }
+
+    /* Strings start inside the pool and the pool ends with a NUL, so none runs past the end */
+    const char* base = (const char*)header;
+    uint64_t strings_size = size - header->strings_offset;
+    if ((header->doc_count > 0 || header->term_count > 0) && (strings_size == 0 || base[size - 1] != '\0')) return 0;
+    uint64_t posting_count = (header->strings_offset - postings_at) / sizeof(SegmentPosting);
+
+    const SegmentDoc* docs = (const SegmentDoc*)(base + header->docs_offset);
+    for (uint32_t i = 0; i < header->doc_count; i++) {
+        if (docs[i].path >= strings_size || docs[i].title >= strings_size || docs[i].length > KB_MAX_FILE_BYTES) return 0;
+    }
+    const SegmentTerm* terms = (const SegmentTerm*)(base + header->terms_offset);
+    for (uint32_t i = 0; i < header->term_count; i++) {
+        if (terms[i].text >= strings_size || (uint64_t)terms[i].postings + terms[i].count > posting_count) return 0;
+    }
+    const SegmentPosting* postings = (const SegmentPosting*)(base + header->postings_offset);
+    for (uint64_t i = 0; i < posting_count; i++) {
+        if (postings[i].doc >= header->doc_count) return 0;
+    }
+    return 1;
+}
+
+static void release_segment(void) {
+    if (g_mapping) munmap(g_mapping, g_mapping_size);
+    free(g_owned);
+    g_mapping = NULL;
+    g_mapping_size = 0;
+    g_owned = NULL;
+    g_segment = NULL;
+}
+
+static int map_segment(const char* path, uint64_t fingerprint) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    if (!segment_valid(map, (size_t)st.st_size, fingerprint)) {
+        munmap(map, (size_t)st.st_size);
+        return 0;
+    }
+    release_segment();
+    g_mapping = map;
+    g_mapping_size = (size_t)st.st_size;
+    g_segment = map;
+    return 1;
+}
+
+static int write_segment(const char* path, const char* image, size_t size) {
+    char tmp_path[PATH_MAX + 32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    FILE* out = fopen(tmp_path, "wb");
+    if (!out) return 0;
+    int ok = fwrite(image, 1, size, out) == size;
+    if (fclose(out) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+/* Makes g_segment match the current corpus, rebuilding it when files changed.
+   Re-checks the corpus at most every KB_RECHECK_US. Caller holds g_lock. */
+static int ensure_segment(void) {
+    long long now = monotonic_us();
+    if (g_segment && now - g_checked_us < KB_RECHECK_US) return 1;
+
+    FileList corpus = { NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+    list_corpus(&corpus);
+    uint64_t fingerprint = corpus_fingerprint(&corpus);
+    g_checked_us = now;
+
+    if (g_segment && g_segment->fingerprint == fingerprint) {
+        file_list_free(&corpus);
+        return 1;
+    }
+
+    char path[PATH_MAX];
+    segment_path(path, sizeof(path));
+    if (map_segment(path, fingerprint)) {
+        file_list_free(&corpus);
+        return 1;
+    }
+
+    long long span = trace_begin();
+    size_t size = 0;
+    char* image = build_segment(&corpus, fingerprint, &size);
+    trace_end("knowledge.build", span, NULL);
+    file_list_free(&corpus);
+    if (!image) return g_segment != NULL;
+
+    if (write_segment(path, image, size) && map_segment(path, fingerprint)) {
+        free(image);
+        return 1;
+    }
+    release_segment();
+    g_owned = image;
+    g_segment = (const SegmentHeader*)image;
+    return 1;
+}
+
+/* ── Query ──────────────────────────────────────────────────────────────── */
+
+static const char* segment_string(uint32_t offset) {
+    return (const char*)g_segment + g_segment->strings_offset + offset;
+}
+
+static const SegmentTerm* find_term(const char* text) {
+    const SegmentTerm* terms = (const SegmentTerm*)((const char*)g_segment + g_segment->terms_offset);
+    uint32_t lo = 0, hi = g_segment->term_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(segment_string(terms[mid].text), text);
+        if (cmp == 0) return &terms[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+typedef struct {
+    char terms[KB_QUERY_TERMS][KB_TERM_MAX];
+    int  count;
+} QueryTerms;
+
+static void parse_terms(const char* query, QueryTerms* parsed) {
+    parsed->count = 0;
+    const char* cursor = query;
+    const char* end = query + strlen(query);
+    char term[KB_TERM_MAX];
+    while (parsed->count < KB_QUERY_TERMS && next_term(&cursor, end, term, NULL) > 0) {
+        int seen = 0;
+        for (int i = 0; i < parsed->count && !seen; i++) seen = strcmp(parsed->terms[i], term) == 0;
+        if (!seen) snprintf(parsed->terms[parsed->count++], KB_TERM_MAX, "%s", term);
+    }
+}
+
+static int is_query_term(const QueryTerms* query, const char* term) {
+    for (int i = 0; i < query->count; i++) {
+        if (strcmp(query->terms[i], term) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Picks the window of the section with the most query-term hits, with
+   Markdown markup and runs of whitespace removed */
+static void make_snippet(const char* path, const SegmentDoc* doc, const QueryTerms* query, char* out, size_t out_size) {
+    out[0] = '\0';
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    char* raw = malloc((size_t)doc->length + 1);
+    ssize_t got = raw ? pread(fd, raw, doc->length, doc->offset) : -1;
+    close(fd);
+    if (got <= 0) {
+        free(raw);
+        return;
+    }
+
+    /* Drop the leading heading lines; the innermost one is reported as the title */
+    size_t start = 0;
+    while (start < (size_t)got && (raw[start] == '#' || raw[start] == '\n')) {
+        while (start < (size_t)got && raw[start] != '\n') start++;
+        start++;
+    }
+    if (start > (size_t)got) start = (size_t)got;
+
+    char* clean = malloc((size_t)got + 1);
+    if (!clean) {
+        free(raw);
+        return;
+    }
+    size_t len = 0;
+    for (size_t i = start; i < (size_t)got; i++) {
+        char c = raw[i];
+        if (c == '#' || c == '*' || c == '`' || c == '>' || c == '|') continue;
+        if (isspace((unsigned char)c)) {
+            if (len > 0 && clean[len - 1] != ' ') clean[len++] = ' ';
+            continue;
+        }
+        clean[len++] = c;
+    }
+    clean[len] = '\0';
+    free(raw);
+
+    /* Slide over term starts and keep the densest window */
+    size_t best = 0;
+    int best_hits = -1;
+    const char* cursor = clean;
+    const char* end = clean + len;
+    const char* word;
+    char term[KB_TERM_MAX];
+    while (next_term(&cursor, end, term, &word) > 0) {
+        if (!is_query_term(query, term)) continue;
+        int hits = 0;
+        const char* inner = word;
+        const char* window_end = word + KB_SNIPPET_WINDOW < end ? word + KB_SNIPPET_WINDOW : end;
+        const char* inner_word;
+        char inner_term[KB_TERM_MAX];
+        while (next_term(&inner, window_end, inner_term, &inner_word) > 0) hits += is_query_term(query, inner_term);
+        if (hits > best_hits) {
+            best_hits = hits;
+            best = (size_t)(word - clean);
+        }
+    }
+
+    /* Back up to the start of the sentence when it is close */
+    for (size_t back = best; back > 0 && best - back < 80; back--) {
+        if (back >= 2 && clean[back - 1] == ' ' && (clean[back - 2] == '.' || clean[back - 2] == ':')) {
+            best = back;
+            break;
+        }
+        if (back == 1) best = 0;
+    }
+    while (best < len && clean[best] == ' ') best++;
+
+    size_t take = len - best;
+    size_t limit = out_size - 4 < KB_SNIPPET_WINDOW ? out_size - 4 : KB_SNIPPET_WINDOW;
+    int truncated = take > limit;
+    if (truncated) {
+        take = limit;
+        while (take > limit / 2 && clean[best + take] != ' ') take--;
+    }
+    snprintf(out, out_size, "%.*s%s", (int)take, clean + best, truncated ? "..." : "");
+    free(clean);
+}
+
+int knowledge_search(const char* query, knowledge_hit* hits, int max_hits) {
+    if (!query || !hits || max_hits <= 0) return 0;
+
+    QueryTerms parsed;
+    parse_terms(query, &parsed);
+    if (parsed.count == 0) return 0;
+
+    long long span = trace_begin();
+    pthread_mutex_lock(&g_lock);
+    if (!ensure_segment() || g_segment->doc_count == 0) {
+        pthread_mutex_unlock(&g_lock);
+        trace_end("knowledge.search", span, query);
+        return 0;
+    }
+
+    const SegmentDoc* docs = (const SegmentDoc*)((const char*)g_segment + g_segment->docs_offset);
+    const SegmentPosting* postings = (const SegmentPosting*)((const char*)g_segment + g_segment->postings_offset);
+    uint32_t doc_count = g_segment->doc_count;
+    double avgdl = (double)g_segment->total_tokens / (double)doc_count;
+    double* scores = calloc(doc_count, sizeof(double));
+    unsigned char* matched = calloc(doc_count, 1);
+    int found = 0;
+
+    if (scores && matched) {
+        for (int t = 0; t < parsed.count; t++) {
+            const SegmentTerm* term = find_term(parsed.terms[t]);
+            if (!term) continue;
+            double idf = log(1.0 + ((double)doc_count - term->count + 0.5) / (term->count + 0.5));
+            for (uint32_t p = 0; p < term->count; p++) {
+                const SegmentPosting* posting = &postings[term->postings + p];
+                double tf = (double)posting->tf;
+                double norm = KB_BM25_K1 * (1.0 - KB_BM25_B + KB_BM25_B * docs[posting->doc].tokens / avgdl);
+                scores[posting->doc] += idf * tf * (KB_BM25_K1 + 1.0) / (tf + norm);
+                matched[posting->doc]++;
+            }
+        }
+
+        /* Top-k by repeated selection; k is tiny */
+        for (; found < max_hits; found++) {
+            uint32_t best = UINT32_MAX;
+            for (uint32_t d = 0; d < doc_count; d++) {
+                if (scores[d] > 0 && (best == UINT32_MAX || scores[d] > scores[best])) best = d;
+            }
+            if (best == UINT32_MAX) break;
+
+            knowledge_hit* hit = &hits[found];
+            snprintf(hit->source, sizeof(hit->source), "%s", segment_string(docs[best].path));
+            snprintf(hit->title, sizeof(hit->title), "%s", segment_string(docs[best].title));
+            hit->score = scores[best];
+            hit->matched_terms = matched[best];
+            hit->query_terms = parsed.count;
+            make_snippet(hit->source, &docs[best], &parsed, hit->snippet, sizeof(hit->snippet));
+            scores[best] = 0;
+        }
+    }
+    free(scores);
+    free(matched);
+    pthread_mutex_unlock(&g_lock);
+    trace_end("knowledge.search", span, query);
+    return found;
+}
+
+int knowledge_answer(const char* query, char* response, size_t response_size) {
+    if (!response || response_size == 0) return 0;
+
+    const char* configured = getenv("JARVIS_KNOWLEDGE_MIN_SCORE");
+    double min_score = configured ? strtod(configured, NULL) : KB_DEFAULT_MIN_SCORE;
+
+    /* A confident hit must also cover most of the question, not one lucky rare word */
+    knowledge_hit hits[3];
+    int count = knowledge_search(query, hits, 3);
+    const knowledge_hit* best = NULL;
+    for (int i = 0; i < count && !best; i++) {
+        if (hits[i].score >= min_score && hits[i].matched_terms * 3 >= hits[i].query_terms * 2 && hits[i].snippet[0] != '\0')
+            best = &hits[i];
+    }
+    if (!best) return 0;
+
+    const char* slash = strrchr(best->source, '/');
+    snprintf(response, response_size, "From %s (%s): %s", slash ? slash + 1 : best->source, best->title, best->snippet);
+    return 1;
+}
@@ -0,0 +1,387 @@
+#include "../include/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CLR_RESET "\033[0m"
+#define CLR_CYAN  "\033[1;36m"
+
+#define LOG_TAG_MAX        24
+#define LOG_TEXT_MAX       4096
+#define LOG_DEFAULT_ROTATE (5L * 1024 * 1024)
+#define LOG_KEEP_FILES     3
+#define LOG_IDLE_WAIT_MS   200
+
+enum { RECORD_EVENT, RECORD_CONSOLE };
+
+typedef struct LogRecord {
+    _Atomic(struct LogRecord*) next;
+    int          kind;
+    log_level    level;
+    time_t       when;
+    const char*  colour;
+    char         tag[LOG_TAG_MAX];
+    char         text[];
+} LogRecord;
+
+static const char* const g_level_names[] = { "debug", "info", "warn", "error" };
+
+/* Configuration (written by log_init before the flusher starts) */
+static log_level g_min_level = LOG_INFO;
+static int       g_kv_terminal = 0;
+static int       g_terminal_events = 1;
+static char      g_file_path[512] = "";
+static long      g_rotate_bytes = LOG_DEFAULT_ROTATE;
+
+/* Intrusive MPSC queue (Vyukov): producers exchange g_queue_head, the
+   flusher alone walks from g_queue_tail */
+static LogRecord                  g_stub;
+static _Atomic(LogRecord*)        g_queue_head = &g_stub;
+static LogRecord*                 g_queue_tail = &g_stub;
+
+static atomic_int                 g_async = 0;
+static atomic_int                 g_flusher_idle = 0;
+static atomic_ullong              g_enqueued = 0;
+static unsigned long long         g_written = 0;      /* guarded by g_lock */
+static int                        g_stop = 0;         /* guarded by g_lock */
+static pthread_mutex_t            g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t             g_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t             g_drained = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t            g_sync_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t                  g_flusher;
+
+/* Renderer state: only touched by the flusher (or under g_sync_lock) */
+static FILE*   g_file = NULL;
+static long    g_file_size = 0;
+static time_t  g_ts_second = (time_t)-1;
+static char    g_ts_clock[16];   /* HH:MM:SS */
+static char    g_ts_iso[32];     /* 2026-01-31T09:30:00+0100 */
+
+static log_level parse_level(const char* value) {
+    if (!value) return LOG_INFO;
+    if (strcmp(value, "debug") == 0) return LOG_DEBUG;
+    if (strcmp(value, "warn") == 0 || strcmp(value, "warning") == 0) return LOG_WARN;
+    if (strcmp(value, "error") == 0) return LOG_ERROR;
+    return LOG_INFO;
+}
+
+/* ── Rendering ──────────────────────────────────────────────────────────── */
+
+static void refresh_timestamp(time_t when) {
+    if (when == g_ts_second) return;
+    struct tm t;
+    localtime_r(&when, &t);
+    strftime(g_ts_clock, sizeof(g_ts_clock), "%H:%M:%S", &t);
+    strftime(g_ts_iso, sizeof(g_ts_iso), "%Y-%m-%dT%H:%M:%S%z", &t);
+    g_ts_second = when;
+}
+
+/* Appends a double-quoted, escaped value with ANSI sequences removed */
+static void put_quoted(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const char* p = text; *p; p++) {
+        if (*p == '\033') {
+            while (*p && *p != 'm') p++;
+            if (!*p) break;
+            continue;
+        }
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if (*p == '\n') {
+            fputs("\\n", out);
+        } else if ((unsigned char)*p >= 0x20) {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void put_kv_record(FILE* out, const LogRecord* rec, const char* text) {
+    fprintf(out, "ts=%s level=%s", g_ts_iso, g_level_names[rec->level]);
+    if (rec->tag[0] != '\0') {
+        fputs(" tag=", out);
+        put_quoted(out, rec->tag);
+    }
+    fputs(" msg=", out);
+    put_quoted(out, text);
+    fputc('\n', out);
+}
+
+/* Console text in kv mode: one record per non-blank line, colours and indentation removed */
+static void put_kv_console(FILE* out, const LogRecord* rec) {
+    const char* p = rec->text;
+    while (*p) {
+        char line[LOG_TEXT_MAX];
+        size_t len = 0;
+        for (; *p && *p != '\n'; p++) {
+            if (*p == '\033') {
+                while (p[1] && *p != 'm') p++;
+                continue;
+            }
+            if (len == 0 && (*p == ' ' || *p == '\t')) continue;
+            if (len + 1 < sizeof(line)) line[len++] = *p;
+        }
+        while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+        line[len] = '\0';
+        if (len > 0) put_kv_record(out, rec, line);
+        if (*p == '\n') p++;
+    }
+}
+
+static void rotate_file(void) {
+    if (g_file) fclose(g_file);
+    g_file = NULL;
+
+    char from[600], to[600];
+    for (int i = LOG_KEEP_FILES - 1; i >= 1; i--) {
+        snprintf(from, sizeof(from), "%s.%d", g_file_path, i);
+        snprintf(to, sizeof(to), "%s.%d", g_file_path, i + 1);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", g_file_path);
+    rename(g_file_path, to);
+
+    g_file = fopen(g_file_path, "a");
+    g_file_size = 0;
+}
+
+static void render(const LogRecord* rec) {
+    refresh_timestamp(rec->when);
+
+    if (rec->kind == RECORD_CONSOLE) {
+        if (g_kv_terminal) put_kv_console(stdout, rec);
+        else fputs(rec->text, stdout);
+        return;
+    }
+
+    if (g_terminal_events) {
+        if (g_kv_terminal) {
+            put_kv_record(stdout, rec, rec->text);
+        } else {
+            printf("%s[%s]%s %s%s%s %s\n", CLR_CYAN, g_ts_clock, CLR_RESET,
+                   rec->colour ? rec->colour : "", rec->tag, CLR_RESET, rec->text);
+        }
+    }
+
+    if (g_file) {
+        long before = ftell(g_file);
+        put_kv_record(g_file, rec, rec->text);
+        long after = ftell(g_file);
+        if (before >= 0 && after >= before) g_file_size += after - before;
+        if (g_file_size > g_rotate_bytes) rotate_file();
+    }
+}
+
+static void flush_outputs(void) {
+    fflush(stdout);
+    if (g_file) fflush(g_file);
+}
+
+/* ── Queue ──────────────────────────────────────────────────────────────── */
+
+static void queue_push(LogRecord* rec) {
+    atomic_store_explicit(&rec->next, NULL, memory_order_relaxed);
+    LogRecord* prev = atomic_exchange_explicit(&g_queue_head, rec, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, rec, memory_order_release);
+}
+
+static LogRecord* queue_pop(void) {
+    LogRecord* tail = g_queue_tail;
+    LogRecord* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &g_stub) {
+        if (!next) return NULL;
+        g_queue_tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next) {
+        g_queue_tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&g_queue_head, memory_order_acquire)) return NULL;  /* push in flight */
+
+    queue_push(&g_stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        g_queue_tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static unsigned long long drain_queue(void) {
+    unsigned long long count = 0;
+    LogRecord* rec;
+    while ((rec = queue_pop()) != NULL) {
+        render(rec);
+        free(rec);
+        count++;
+    }
+    if (count > 0) flush_outputs();
+    return count;
+}
+
+static void* flusher_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_lock);
+    while (1) {
+        pthread_mutex_unlock(&g_lock);
+        unsigned long long count = drain_queue();
+        pthread_mutex_lock(&g_lock);
+
+        g_written += count;
+        pthread_cond_broadcast(&g_drained);
+        if (g_stop && atomic_load(&g_enqueued) == g_written) break;
+        if (count > 0) continue;
+
+        /* Nothing ready: sleep until a producer wakes us (or a short timeout,
+           which covers a push that was still in flight) */
+        atomic_store(&g_flusher_idle, 1);
+        if (atomic_load(&g_enqueued) == g_written && !g_stop) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)LOG_IDLE_WAIT_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&g_wake, &g_lock, &deadline);
+        }
+        atomic_store(&g_flusher_idle, 0);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+static void submit(LogRecord* rec) {
+    if (!atomic_load_explicit(&g_async, memory_order_acquire)) {
+        pthread_mutex_lock(&g_sync_lock);
+        render(rec);
+        flush_outputs();
+        pthread_mutex_unlock(&g_sync_lock);
+        free(rec);
+        return;
+    }
+
+    atomic_fetch_add(&g_enqueued, 1);
+    queue_push(rec);
+    if (atomic_load(&g_flusher_idle) || rec->level >= LOG_ERROR) {
+        pthread_mutex_lock(&g_lock);
+        pthread_cond_signal(&g_wake);
+        pthread_mutex_unlock(&g_lock);
+    }
+}
+
+static LogRecord* make_record(int kind, log_level level, const char* colour, const char* tag,
+                              const char* fmt, va_list args) {
+    char text[LOG_TEXT_MAX];
+    int len = vsnprintf(text, sizeof(text), fmt, args);
+    if (len < 0) return NULL;
+    if ((size_t)len >= sizeof(text)) len = (int)sizeof(text) - 1;
+
+    LogRecord* rec = malloc(sizeof(LogRecord) + (size_t)len + 1);
+    if (!rec) return NULL;
+    rec->kind = kind;
+    rec->level = level;
+    rec->when = time(NULL);
+    rec->colour = colour;
+    snprintf(rec->tag, sizeof(rec->tag), "%s", tag ? tag : "");
+    memcpy(rec->text, text, (size_t)len + 1);
+    return rec;
+}
+
+/* ── Public API ─────────────────────────────────────────────────────────── */
+
+void log_init(void) {
+    if (atomic_load(&g_async)) return;
+
+    g_min_level = parse_level(getenv("JARVIS_LOG_LEVEL"));
+
+    const char* format = getenv("JARVIS_LOG_FORMAT");
+    if (format && strcmp(format, "kv") == 0) g_kv_terminal = 1;
+    else if (format && strcmp(format, "text") == 0) g_kv_terminal = 0;
+    else g_kv_terminal = !isatty(STDOUT_FILENO);
+
+    const char* terminal = getenv("JARVIS_LOG_TERMINAL");
+    g_terminal_events = !(terminal && strcmp(terminal, "0") == 0);
+
+    const char* rotate = getenv("JARVIS_LOG_MAX_BYTES");
+    if (rotate && atol(rotate) > 0) g_rotate_bytes = atol(rotate);
+
+    const char* path = getenv("JARVIS_LOG_FILE");
+    if (path && path[0] != '\0') {
+        snprintf(g_file_path, sizeof(g_file_path), "%s", path);
+        g_file = fopen(g_file_path, "a");
+        if (g_file) {
+            fseek(g_file, 0, SEEK_END);
+            g_file_size = ftell(g_file);
+        }
+    }
+
+    g_stop = 0;
+    /* Started before event_loop_init(): create it with every signal blocked
+       so it never takes SIGCHLD meant for the reactor's signalfd */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    if (pthread_create(&g_flusher, NULL, flusher_main, NULL) == 0)
+        atomic_store_explicit(&g_async, 1, memory_order_release);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+}
+
+void log_flush(void) {
+    if (!atomic_load(&g_async)) {
+        fflush(stdout);
+        return;
+    }
+
+    unsigned long long target = atomic_load(&g_enqueued);
+    pthread_mutex_lock(&g_lock);
+    pthread_cond_signal(&g_wake);
+    while (g_written < target) pthread_cond_wait(&g_drained, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+    fflush(stdout);
+}
+
+void log_shutdown(void) {
+    if (atomic_load(&g_async)) {
+        pthread_mutex_lock(&g_lock);
+        g_stop = 1;
+        pthread_cond_signal(&g_wake);
+        pthread_mutex_unlock(&g_lock);
+        pthread_join(g_flusher, NULL);
+        atomic_store(&g_async, 0);
+    }
+
+    flush_outputs();
+    if (g_file) {
+        fclose(g_file);
+        g_file = NULL;
+    }
+}
+
+void log_message(log_level level, const char* colour, const char* tag, const char* fmt, ...) {
+    if (level < g_min_level) return;
+
+    va_list args;
+    va_start(args, fmt);
+    LogRecord* rec = make_record(RECORD_EVENT, level, colour, tag, fmt, args);
+    va_end(args);
+    if (rec) submit(rec);
+}
+
+void log_console(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    LogRecord* rec = make_record(RECORD_CONSOLE, LOG_INFO, NULL, NULL, fmt, args);
+    va_end(args);
+    if (rec) submit(rec);
+}
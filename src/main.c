@@ -1,14 +1,67 @@
 #include "../include/jarvis.h"
+#include "../include/batch.h"
+#include "../include/server.h"
+#include "../include/client.h"
+#include "../include/trace.h"
+#include "../include/log.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [--fast-boot] [--boot-timeline] [--batch [FILE]] [--serve [SOCKET]] [-c COMMAND]\n", program);
+    printf("  --fast-boot      Skip boot animations and defer UI/notifications\n");
+    printf("  --boot-timeline  Print a microsecond startup timeline\n");
+    printf("  --batch [FILE]   Run commands from FILE (or stdin) and print JSON lines\n");
+    printf("  --serve [SOCKET] Run as a daemon answering JSON requests on a Unix socket\n");
+    printf("  -c COMMAND       Send one command to the daemon (starting it if needed)\n");
+}
 
 /**
  * Main entry point for JARVIS Voice Assistant
  */
 int main(int argc, char* argv[]) {
-    (void)argc;  // Unused
-    (void)argv;  // Unused
-    
+    int fast_boot = 0;
+    int show_timeline = 0;
+
+    trace_init();   /* JARVIS_TRACE=<file> records spans and dumps them at exit */
+    atexit(log_shutdown);   /* drains the log queue; a no-op if log_init never ran */
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fast-boot") == 0) {
+            fast_boot = 1;
+        } else if (strcmp(argv[i], "--boot-timeline") == 0) {
+            show_timeline = 1;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            const char* input_path = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[i + 1] : NULL;
+            log_init();
+            return batch_main(input_path);
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            const char* socket_path = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[i + 1] : NULL;
+            log_init();
+            return server_main(socket_path);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            /* Remaining words form the command, so quoting is optional */
+            char command[2048] = "";
+            size_t len = 0;
+            for (int j = i + 1; j < argc && len < sizeof(command); j++) {
+                len += (size_t)snprintf(command + len, sizeof(command) - len, "%s%s",
+                                        j > i + 1 ? " " : "", argv[j]);
+            }
+            return client_main(argv[0], command);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    log_init();
+    jarvis_configure_boot(fast_boot, show_timeline);
+
     // Initialize JARVIS
     if (!jarvis_init()) {
         fprintf(stderr, "Failed to initialize JARVIS\n");
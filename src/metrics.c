@@ -0,0 +1,220 @@
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* HDR-style log-linear buckets: values below 16us get one bucket each, then
+   every power of two is split into 16 linear sub-buckets (~6% precision). */
+#define HIST_SUB_BITS    4
+#define HIST_SUB         (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP     40                           /* caps samples at ~12 days */
+#define HIST_BUCKETS     ((HIST_MAX_EXP - HIST_SUB_BITS + 2) * HIST_SUB)
+#define METRICS_MAX_SERIES 48
+
+typedef struct {
+    const char*        name;
+    atomic_ullong      counts[HIST_BUCKETS];
+    atomic_ullong      total;
+    atomic_ullong      sum_us;
+} Histogram;
+
+typedef struct {
+    Histogram       series[METRICS_MAX_SERIES];
+    atomic_int      count;
+    pthread_mutex_t register_lock;
+} HistogramFamily;
+
+static HistogramFamily g_intents = { .register_lock = PTHREAD_MUTEX_INITIALIZER };
+static HistogramFamily g_stages  = { .register_lock = PTHREAD_MUTEX_INITIALIZER };
+static atomic_ullong   g_counters[METRIC_COUNTER_COUNT];
+
+static const char* const g_counter_names[METRIC_COUNTER_COUNT] = {
+    "jarvis_children_spawned_total",
+    "jarvis_bytes_captured_total",
+    "jarvis_cache_hits_total",
+    "jarvis_cache_misses_total",
+};
+
+static const char* const g_counter_help[METRIC_COUNTER_COUNT] = {
+    "Child processes started by actions, TTS and notifications.",
+    "Bytes read from action output pipes.",
+    "Answers served from a cache.",
+    "Cache lookups that had to do the work.",
+};
+
+static int bucket_index(unsigned long long v) {
+    if (v < HIST_SUB) return (int)v;
+    int exp = 63 - __builtin_clzll(v);
+    if (exp > HIST_MAX_EXP) return HIST_BUCKETS - 1;
+    return (exp - HIST_SUB_BITS + 1) * HIST_SUB + (int)((v >> (exp - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* Largest value that lands in the bucket */
+static unsigned long long bucket_upper(int index) {
+    if (index < HIST_SUB) return (unsigned long long)index;
+    int exp = index / HIST_SUB + HIST_SUB_BITS - 1;
+    unsigned long long sub = (unsigned long long)(index % HIST_SUB);
+    unsigned long long width = 1ULL << (exp - HIST_SUB_BITS);
+    return ((HIST_SUB + sub) << (exp - HIST_SUB_BITS)) + width - 1;
+}
+
+static Histogram* family_lookup(HistogramFamily* family, const char* name, int create) {
+    if (!name) return NULL;
+
+    int count = atomic_load_explicit(&family->count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (family->series[i].name == name || strcmp(family->series[i].name, name) == 0)
+            return &family->series[i];
+    }
+    if (!create) return NULL;
+
+    pthread_mutex_lock(&family->register_lock);
+    Histogram* found = NULL;
+    count = atomic_load(&family->count);
+    for (int i = 0; i < count && !found; i++) {
+        if (strcmp(family->series[i].name, name) == 0) found = &family->series[i];
+    }
+    if (!found && count < METRICS_MAX_SERIES) {
+        found = &family->series[count];
+        found->name = name;
+        atomic_store_explicit(&family->count, count + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&family->register_lock);
+    return found;
+}
+
+static void histogram_record(Histogram* hist, long long micros) {
+    if (!hist) return;
+    unsigned long long v = micros > 0 ? (unsigned long long)micros : 0;
+    atomic_fetch_add_explicit(&hist->counts[bucket_index(v)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_us, v, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->total, 1, memory_order_relaxed);
+}
+
+static long long histogram_percentile(Histogram* hist, double percentile) {
+    if (!hist) return -1;
+    unsigned long long total = atomic_load(&hist->total);
+    if (total == 0) return -1;
+
+    if (percentile < 0) percentile = 0;
+    if (percentile > 100) percentile = 100;
+    unsigned long long rank = (unsigned long long)(percentile / 100.0 * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&hist->counts[i], memory_order_relaxed);
+        if (seen >= rank) return (long long)bucket_upper(i);
+    }
+    return (long long)bucket_upper(HIST_BUCKETS - 1);
+}
+
+void metrics_count(metrics_counter counter, unsigned long long amount) {
+    if (counter < 0 || counter >= METRIC_COUNTER_COUNT) return;
+    atomic_fetch_add_explicit(&g_counters[counter], amount, memory_order_relaxed);
+}
+
+void metrics_observe_intent(const char* intent, long long micros) {
+    histogram_record(family_lookup(&g_intents, intent, 1), micros);
+}
+
+void metrics_observe_stage(const char* stage, long long micros) {
+    histogram_record(family_lookup(&g_stages, stage, 1), micros);
+}
+
+long long metrics_intent_percentile(const char* intent, double percentile) {
+    return histogram_percentile(family_lookup(&g_intents, intent, 0), percentile);
+}
+
+static void format_micros(long long micros, char* out, size_t out_size) {
+    if (micros < 1000) snprintf(out, out_size, "%lldus", micros);
+    else if (micros < 1000000) snprintf(out, out_size, "%.1fms", (double)micros / 1000.0);
+    else snprintf(out, out_size, "%.2fs", (double)micros / 1000000.0);
+}
+
+static size_t format_family(HistogramFamily* family, const char* title, char* out, size_t out_size, size_t len) {
+    int count = atomic_load_explicit(&family->count, memory_order_acquire);
+    if (count == 0 || len >= out_size) return len;
+
+    len += (size_t)snprintf(out + len, out_size - len, "%s%s:", len > 0 ? "\n" : "", title);
+    for (int i = 0; i < count && len < out_size; i++) {
+        Histogram* hist = &family->series[i];
+        char p50[32], p99[32];
+        format_micros(histogram_percentile(hist, 50), p50, sizeof(p50));
+        format_micros(histogram_percentile(hist, 99), p99, sizeof(p99));
+        len += (size_t)snprintf(out + len, out_size - len, "\n  %s: p50 %s, p99 %s (%llu samples)",
+                                hist->name, p50, p99, atomic_load(&hist->total));
+    }
+    return len;
+}
+
+void metrics_format_report(char* out, size_t out_size) {
+    if (!out || out_size == 0) return;
+    out[0] = '\0';
+
+    size_t len = format_family(&g_intents, "Latency by intent", out, out_size, 0);
+    len = format_family(&g_stages, "Latency by stage", out, out_size, len);
+    if (len >= out_size) return;
+
+    snprintf(out + len, out_size - len, "%sChildren spawned: %llu, bytes captured: %llu, cache hits: %llu/%llu.",
+             len > 0 ? "\n" : "",
+             atomic_load(&g_counters[METRIC_CHILDREN_SPAWNED]),
+             atomic_load(&g_counters[METRIC_BYTES_CAPTURED]),
+             atomic_load(&g_counters[METRIC_CACHE_HITS]),
+             atomic_load(&g_counters[METRIC_CACHE_HITS]) + atomic_load(&g_counters[METRIC_CACHE_MISSES]));
+}
+
+static void write_summary(FILE* out, HistogramFamily* family, const char* metric, const char* label, const char* help) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+
+    fprintf(out, "# HELP %s %s\n# TYPE %s summary\n", metric, help, metric);
+    int count = atomic_load_explicit(&family->count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        Histogram* hist = &family->series[i];
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            fprintf(out, "%s{%s=\"%s\",quantile=\"%g\"} %.6f\n", metric, label, hist->name, quantiles[q],
+                    (double)histogram_percentile(hist, quantiles[q] * 100.0) / 1e6);
+        }
+        fprintf(out, "%s_sum{%s=\"%s\"} %.6f\n", metric, label, hist->name,
+                (double)atomic_load(&hist->sum_us) / 1e6);
+        fprintf(out, "%s_count{%s=\"%s\"} %llu\n", metric, label, hist->name, atomic_load(&hist->total));
+    }
+}
+
+int metrics_write_prometheus(const char* path) {
+    if (!path) path = getenv("JARVIS_METRICS_FILE");
+    if (!path || path[0] == '\0') return 0;
+
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) return 0;
+
+    write_summary(out, &g_intents, "jarvis_intent_latency_seconds", "intent",
+                  "Command latency by routed intent.");
+    write_summary(out, &g_stages, "jarvis_stage_latency_seconds", "stage",
+                  "Latency of assistant pipeline stages.");
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", g_counter_names[i], g_counter_help[i],
+                g_counter_names[i], g_counter_names[i], atomic_load(&g_counters[i]));
+    }
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+int metrics_export_interval_ms(void) {
+    const char* path = getenv("JARVIS_METRICS_FILE");
+    if (!path || path[0] == '\0') return 0;
+
+    const char* interval = getenv("JARVIS_METRICS_INTERVAL");
+    long seconds = interval ? strtol(interval, NULL, 10) : 15;
+    if (seconds <= 0) seconds = 15;
+    return (int)(seconds * 1000);
+}
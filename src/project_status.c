@@ -0,0 +1,368 @@
+#include "../include/project_status.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define STATUS_MAX_JOBS     32
+#define STATUS_DEFAULT_JOBS 8
+#define STATUS_SCAN_DEPTH   2
+
+/* ── Discovery ──────────────────────────────────────────────────────────── */
+
+typedef struct {
+    project_repo* repos;
+    int           count;
+    int           capacity;
+} RepoList;
+
+static int has_git_dir(const char* path) {
+    char marker[PATH_MAX];
+    struct stat st;
+    if (snprintf(marker, sizeof(marker), "%s/.git", path) >= (int)sizeof(marker)) return 0;
+    return lstat(marker, &st) == 0 && (S_ISDIR(st.st_mode) || S_ISREG(st.st_mode));
+}
+
+static void add_repo(RepoList* list, const char* path) {
+    char real[PATH_MAX];
+    if (!realpath(path, real)) return;
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->repos[i].path, real) == 0) return;
+    }
+    if (list->count == list->capacity) {
+        if (list->capacity >= PROJECT_STATUS_MAX_REPOS) return;
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        project_repo* grown = realloc(list->repos, (size_t)capacity * sizeof(project_repo));
+        if (!grown) return;
+        list->repos = grown;
+        list->capacity = capacity;
+    }
+    project_repo* repo = &list->repos[list->count++];
+    memset(repo, 0, sizeof(*repo));
+    snprintf(repo->path, sizeof(repo->path), "%s", real);
+}
+
+static void find_repos(RepoList* list, const char* dir, int depth) {
+    if (has_git_dir(dir)) {
+        add_repo(list, dir);
+        return;
+    }
+    if (depth >= STATUS_SCAN_DEPTH) return;
+
+    DIR* handle = opendir(dir);
+    if (!handle) return;
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.' || strcmp(entry->d_name, "node_modules") == 0) continue;
+        if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) continue;
+
+        char child[PATH_MAX];
+        if (snprintf(child, sizeof(child), "%s/%s", strcmp(dir, "/") == 0 ? "" : dir, entry->d_name) >= (int)sizeof(child)) continue;
+        struct stat st;
+        if (entry->d_type == DT_UNKNOWN && (lstat(child, &st) != 0 || !S_ISDIR(st.st_mode))) continue;
+        find_repos(list, child, depth + 1);
+    }
+    closedir(handle);
+}
+
+static int add_root(char roots[][PATH_MAX], int count, int max, const char* path) {
+    char real[PATH_MAX];
+    if (count >= max || !realpath(path, real)) return count;
+    struct stat st;
+    if (stat(real, &st) != 0 || !S_ISDIR(st.st_mode)) return count;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(roots[i], real) == 0) return count;
+    }
+    memcpy(roots[count], real, strlen(real) + 1);
+    return count + 1;
+}
+
+int project_status_roots(char roots[][PATH_MAX], int max) {
+    int count = 0;
+    const char* configured = getenv("JARVIS_PROJECT_ROOTS");
+    if (configured && *configured) {
+        const char* start = configured;
+        while (*start) {
+            const char* end = strchr(start, ':');
+            size_t len = end ? (size_t)(end - start) : strlen(start);
+            if (len > 0 && len < PATH_MAX) {
+                char root[PATH_MAX];
+                memcpy(root, start, len);
+                root[len] = '\0';
+                count = add_root(roots, count, max, root);
+            }
+            if (!end) break;
+            start = end + 1;
+        }
+        return count;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return 0;
+    count = add_root(roots, count, max, cwd);
+    count = add_root(roots, count, max, "ai_workspace/projects");
+
+    /* Checkouts usually sit side by side: scan the directory holding this one */
+    char dir[PATH_MAX];
+    memcpy(dir, cwd, strlen(cwd) + 1);
+    while (!has_git_dir(dir)) {
+        char* slash = strrchr(dir, '/');
+        if (!slash || slash == dir) return count;
+        *slash = '\0';
+    }
+    char* slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        count = add_root(roots, count, max, dir);
+    }
+    return count;
+}
+
+int project_status_jobs(void) {
+    const char* configured = getenv("JARVIS_STATUS_JOBS");
+    long jobs = configured ? strtol(configured, NULL, 10) : 0;
+    if (jobs <= 0) jobs = STATUS_DEFAULT_JOBS;
+    return jobs > STATUS_MAX_JOBS ? STATUS_MAX_JOBS : (int)jobs;
+}
+
+/* ── git status --porcelain fallback ────────────────────────────────────── */
+
+static int is_conflict(char x, char y) {
+    return x == 'U' || y == 'U' || (x == 'A' && y == 'A') || (x == 'D' && y == 'D');
+}
+
+/* "## main...origin/main [ahead 1, behind 2]", "## HEAD (no branch)", "## No commits yet on main" */
+static void parse_branch_line(const char* line, git_status* status) {
+    if (strncmp(line, "No commits yet on ", 18) == 0 || strncmp(line, "Initial commit on ", 18) == 0) {
+        snprintf(status->branch, sizeof(status->branch), "%.*s", (int)sizeof(status->branch) - 1, line + 18);
+        return;
+    }
+    status->head[0] = '?';  /* born, but the id is not printed */
+    if (strncmp(line, "HEAD (no branch)", 16) == 0) return;
+
+    const char* dots = strstr(line, "...");
+    const char* bracket = strstr(line, " [");
+    size_t branch_len = dots ? (size_t)(dots - line) : bracket ? (size_t)(bracket - line) : strlen(line);
+    if (branch_len >= sizeof(status->branch)) branch_len = sizeof(status->branch) - 1;
+    memcpy(status->branch, line, branch_len);
+    status->branch[branch_len] = '\0';
+
+    if (dots) {
+        const char* upstream = dots + 3;
+        size_t len = bracket ? (size_t)(bracket - upstream) : strlen(upstream);
+        if (len >= sizeof(status->upstream)) len = sizeof(status->upstream) - 1;
+        memcpy(status->upstream, upstream, len);
+        status->upstream[len] = '\0';
+    }
+    if (bracket) {
+        const char* ahead = strstr(bracket, "ahead ");
+        const char* behind = strstr(bracket, "behind ");
+        if (ahead) status->ahead = atoi(ahead + 6);
+        if (behind) status->behind = atoi(behind + 7);
+        if (strstr(bracket, "[gone]")) status->upstream_gone = 1;
+    }
+}
+
+static int read_with_git(project_repo* repo) {
+    char quoted[PATH_MAX * 2];
+    size_t q = 0;
+    quoted[q++] = '\'';
+    for (const char* c = repo->path; *c && q + 5 < sizeof(quoted); c++) {
+        if (*c == '\'') {
+            memcpy(quoted + q, "'\\''", 4);
+            q += 4;
+        } else {
+            quoted[q++] = *c;
+        }
+    }
+    quoted[q++] = '\'';
+    quoted[q] = '\0';
+
+    char command[PATH_MAX * 2 + 64];
+    snprintf(command, sizeof(command), "git -C %s status --porcelain -b 2>/dev/null", quoted);
+    FILE* fp = popen(command, "r");
+    if (!fp) return 0;
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+
+    git_status* status = &repo->status;
+    char line[PATH_MAX + 16];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strncmp(line, "## ", 3) == 0) {
+            parse_branch_line(line + 3, status);
+            continue;
+        }
+        if (strlen(line) < 4) continue;
+        char x = line[0], y = line[1];
+        if (status->listed < GIT_STATUS_LISTED) {
+            git_status_entry* entry = &status->entries[status->listed++];
+            snprintf(entry->path, sizeof(entry->path), "%.*s", (int)sizeof(entry->path) - 1, line + 3);
+            entry->index = x;
+            entry->worktree = y;
+        }
+        status->changed++;
+        if (x == '?') {
+            status->untracked++;
+        } else if (is_conflict(x, y)) {
+            repo->conflicts++;
+        } else {
+            if (x != ' ') status->staged++;
+            if (y == 'D') status->deleted++;
+            else if (y != ' ') status->modified++;
+        }
+    }
+    int exit_status = pclose(fp);
+    return WIFEXITED(exit_status) && WEXITSTATUS(exit_status) == 0;
+}
+
+/* ── Parallel scan ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    project_repo* repos;
+    int           count;
+    atomic_int    next;
+} StatusBatch;
+
+static int attention_score(const project_repo* repo) {
+    const git_status* status = &repo->status;
+    if (!repo->readable) return 1000;
+    if (repo->conflicts) return 900 + repo->conflicts;
+    int dirty = status->staged + status->modified + status->deleted;
+    if (dirty) return 100 + (dirty > 99 ? 99 : dirty);
+    if (status->ahead) return 80 + (status->ahead > 19 ? 19 : status->ahead);
+    if (status->upstream_gone) return 60;
+    if (status->behind) return 40 + (status->behind > 19 ? 19 : status->behind);
+    if (!status->branch[0] && status->head[0]) return 20;
+    if (status->untracked) return 10 + (status->untracked > 9 ? 9 : status->untracked);
+    return 0;
+}
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash && slash[1] ? slash + 1 : path;
+}
+
+static void read_repo(project_repo* repo) {
+    /* Each worker already owns a repository, so the untracked walk stays on it */
+    int result = git_status_read(repo->path, 1, &repo->status);
+    if (result == 1) {
+        repo->native = 1;
+        repo->readable = 1;
+    } else {
+        memset(&repo->status, 0, sizeof(repo->status));
+        repo->readable = read_with_git(repo);
+    }
+    repo->attention = attention_score(repo);
+}
+
+static void* status_worker(void* arg) {
+    StatusBatch* batch = arg;
+    int i;
+    while ((i = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+        read_repo(&batch->repos[i]);
+    }
+    return NULL;
+}
+
+static int compare_attention(const void* a, const void* b) {
+    const project_repo* x = a;
+    const project_repo* y = b;
+    if (x->attention != y->attention) return y->attention - x->attention;
+    return strcmp(base_name(x->path), base_name(y->path));
+}
+
+int project_status_scan(const char* const* roots, int root_count, int jobs, project_report* report) {
+    if (!report) return 0;
+    memset(report, 0, sizeof(*report));
+    long long span = trace_begin();
+
+    RepoList list = { 0 };
+    for (int i = 0; i < root_count; i++) {
+        if (roots[i]) find_repos(&list, roots[i], 0);
+    }
+
+    if (jobs <= 0) jobs = project_status_jobs();
+    if (jobs > STATUS_MAX_JOBS) jobs = STATUS_MAX_JOBS;
+    if (jobs > list.count) jobs = list.count > 0 ? list.count : 1;
+
+    StatusBatch batch = { list.repos, list.count, 0 };
+    pthread_t workers[STATUS_MAX_JOBS];
+    int started = 0;
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (int i = 1; i < jobs; i++) {
+        if (pthread_create(&workers[started], NULL, status_worker, &batch) == 0) started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    status_worker(&batch);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+
+    if (list.count > 1) qsort(list.repos, (size_t)list.count, sizeof(project_repo), compare_attention);
+    /* name points into path, so it is set once the entries stop moving */
+    for (int i = 0; i < list.count; i++) {
+        project_repo* repo = &list.repos[i];
+        repo->name = base_name(repo->path);
+        if (repo->attention > 0) report->needing_attention++;
+    }
+
+    report->repos = list.repos;
+    report->count = list.count;
+    report->jobs = jobs;
+    char detail[32];
+    snprintf(detail, sizeof(detail), "%d repos", list.count);
+    report->elapsed_us = trace_end("project_status", span, detail);
+    return 1;
+}
+
+static void append_part(char* out, size_t out_size, size_t* used, const char* part) {
+    if (*used >= out_size) return;
+    int written = snprintf(out + *used, out_size - *used, "%s%s", *used ? ", " : "", part);
+    if (written > 0) *used += (size_t)written;
+    if (*used >= out_size) *used = out_size - 1;
+}
+
+static void append_count(char* out, size_t out_size, size_t* used, int count, const char* what) {
+    if (count <= 0) return;
+    char part[64];
+    snprintf(part, sizeof(part), "%d %s", count, what);
+    append_part(out, out_size, used, part);
+}
+
+void project_status_describe(const project_repo* repo, char* out, size_t out_size) {
+    if (!out || out_size == 0) return;
+    out[0] = '\0';
+    if (!repo) return;
+    if (!repo->readable) {
+        snprintf(out, out_size, "unreadable");
+        return;
+    }
+
+    const git_status* status = &repo->status;
+    size_t used = 0;
+    append_count(out, out_size, &used, repo->conflicts, repo->conflicts == 1 ? "conflict" : "conflicts");
+    append_count(out, out_size, &used, status->staged, "staged");
+    append_count(out, out_size, &used, status->modified, "modified");
+    append_count(out, out_size, &used, status->deleted, "deleted");
+    append_count(out, out_size, &used, status->untracked, "untracked");
+    append_count(out, out_size, &used, status->ahead, "ahead");
+    append_count(out, out_size, &used, status->behind, "behind");
+    if (status->upstream_gone) append_part(out, out_size, &used, "upstream gone");
+    if (!status->branch[0] && status->head[0]) append_part(out, out_size, &used, "detached HEAD");
+    if (used == 0) snprintf(out, out_size, "clean");
+}
+
+void project_status_free(project_report* report) {
+    if (!report) return;
+    free(report->repos);
+    memset(report, 0, sizeof(*report));
+}
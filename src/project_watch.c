@@ -0,0 +1,728 @@
+#include "../include/project_watch.h"
+#include "../include/gitignore.h"
+#include "../include/log.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#define WATCH_MAX_DIRS        8192
+#define WATCH_MAX_CHANGED     64
+#define WATCH_DEFAULT_DEBOUNCE_MS 300
+#define WATCH_DEFAULT_POLL_MS 1000
+#define WATCH_SUMMARY_MAX     512
+
+typedef struct {
+    char*     path;                /* relative to the root */
+    long long mtime_ns;
+    long long size;
+} FileStamp;
+
+typedef struct {
+    FileStamp* files;
+    int        count;
+    int        capacity;
+} Snapshot;
+
+/* Directories whose .gitignore is already in the rule set (open addressing) */
+typedef struct {
+    char** slots;
+    int    capacity;
+    int    count;
+} DirSet;
+
+typedef struct {
+    char                   root[PATH_MAX];
+    project_watch_cycle_fn cycle;
+    void*                  context;
+    atomic_int             stop;
+    int                    wake[2];         /* project_watch_stop() writes here */
+    int                    inotify_fd;      /* -1 when polling */
+    int                    debounce_ms;
+    int                    poll_ms;
+    gitignore*             ignore;
+    DirSet                 ruled;           /* rescans and re-created directories must not add rules again */
+    char**                 dirs;            /* watch descriptor -> directory relative to the root */
+    int                    dir_capacity;
+    int                    dir_count;
+    Snapshot               snapshot;        /* polling: the files as last seen */
+    char*                  changed[WATCH_MAX_CHANGED];
+    int                    changed_count;
+    int                    everything;      /* too many changes, or ones no test maps to */
+
+    /* Guarded by g_lock */
+    project_watch_state    state;
+    int                    cycles;
+    char                   summary[WATCH_SUMMARY_MAX];
+} Watch;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static Watch*          g_watch = NULL;
+static pthread_once_t  g_announce_once = PTHREAD_ONCE_INIT;
+static int             g_announce_pipe[2] = { -1, -1 };
+static char            g_announcement[WATCH_SUMMARY_MAX + 32];
+
+static int env_ms(const char* name, int fallback) {
+    const char* configured = getenv(name);
+    long value = configured ? strtol(configured, NULL, 10) : 0;
+    return value > 0 && value < 600000 ? (int)value : fallback;
+}
+
+/* ── Announcements ──────────────────────────────────────────────────────── */
+
+static void open_announce_pipe(void) {
+    if (pipe(g_announce_pipe) != 0) {
+        g_announce_pipe[0] = g_announce_pipe[1] = -1;
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(g_announce_pipe[i], F_SETFD, FD_CLOEXEC);
+        fcntl(g_announce_pipe[i], F_SETFL, O_NONBLOCK);
+    }
+}
+
+int project_watch_announce_fd(void) {
+    pthread_once(&g_announce_once, open_announce_pipe);
+    return g_announce_pipe[0];
+}
+
+/* Called with g_lock held; a newer announcement replaces one not yet taken */
+static void announce(const char* text) {
+    log_message(LOG_INFO, NULL, "[WATCH]", "%s", text);
+    snprintf(g_announcement, sizeof(g_announcement), "%s", text);
+    if (project_watch_announce_fd() >= 0) {
+        ssize_t ignored = write(g_announce_pipe[1], "!", 1);
+        (void)ignored;
+    }
+}
+
+int project_watch_take_announcement(char* out, size_t out_size) {
+    int fd = project_watch_announce_fd();
+    char drain[64];
+    if (fd >= 0) {
+        while (read(fd, drain, sizeof(drain)) > 0) {}
+    }
+    pthread_mutex_lock(&g_lock);
+    int found = g_announcement[0] != '\0';
+    if (found && out && out_size > 0) snprintf(out, out_size, "%s", g_announcement);
+    g_announcement[0] = '\0';
+    pthread_mutex_unlock(&g_lock);
+    return found;
+}
+
+/* ── Which files matter ─────────────────────────────────────────────────── */
+
+static int is_watched_file(const char* name) {
+    static const char* const extensions[] = {
+        ".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx", ".inc", ".s", ".S", ".mk"
+    };
+    if (name[0] == '.') return 0;
+    if (strcmp(name, "Makefile") == 0 || strcmp(name, "makefile") == 0 || strcmp(name, "GNUmakefile") == 0) return 1;
+    const char* dot = strrchr(name, '.');
+    if (!dot) return 0;
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        if (strcmp(dot, extensions[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int is_build_rule(const char* name) {
+    const char* dot = strrchr(name, '.');
+    return strcmp(name, "Makefile") == 0 || strcmp(name, "makefile") == 0 || strcmp(name, "GNUmakefile") == 0 ||
+           (dot && strcmp(dot, ".mk") == 0);
+}
+
+static void add_change(Watch* watch, const char* path) {
+    for (int i = 0; i < watch->changed_count; i++) {
+        if (strcmp(watch->changed[i], path) == 0) return;
+    }
+    if (watch->changed_count == WATCH_MAX_CHANGED) {
+        watch->everything = 1;
+        return;
+    }
+    char* copy = strdup(path);
+    if (copy) watch->changed[watch->changed_count++] = copy;
+    else watch->everything = 1;
+}
+
+static void clear_changes(Watch* watch) {
+    for (int i = 0; i < watch->changed_count; i++) free(watch->changed[i]);
+    watch->changed_count = 0;
+    watch->everything = 0;
+}
+
+/* ── Walking the tree ───────────────────────────────────────────────────── */
+
+static int join_path(char* out, size_t out_size, const char* dir, const char* name) {
+    int len = snprintf(out, out_size, "%s%s%s", dir, dir[0] ? "/" : "", name);
+    return len >= 0 && (size_t)len < out_size;
+}
+
+static uint64_t hash_path(const char* path) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Returns 1 if path was not in the set yet (and is now), 0 if it was or memory ran out */
+static int dir_set_add(DirSet* set, const char* path) {
+    if ((set->count + 1) * 2 > set->capacity) {
+        int capacity = set->capacity ? set->capacity * 2 : 64;
+        char** slots = calloc((size_t)capacity, sizeof(char*));
+        if (!slots) return 0;
+        for (int i = 0; i < set->capacity; i++) {
+            if (!set->slots[i]) continue;
+            size_t at = (size_t)(hash_path(set->slots[i]) & (uint64_t)(capacity - 1));
+            while (slots[at]) at = (at + 1) & (size_t)(capacity - 1);
+            slots[at] = set->slots[i];
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+    size_t at = (size_t)(hash_path(path) & (uint64_t)(set->capacity - 1));
+    for (; set->slots[at]; at = (at + 1) & (size_t)(set->capacity - 1)) {
+        if (strcmp(set->slots[at], path) == 0) return 0;
+    }
+    set->slots[at] = strdup(path);
+    if (!set->slots[at]) return 0;
+    set->count++;
+    return 1;
+}
+
+static void dir_set_free(DirSet* set) {
+    for (int i = 0; i < set->capacity; i++) free(set->slots[i]);
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+static int remember_dir(Watch* watch, int wd, const char* relative) {
+    if (wd >= watch->dir_capacity) {
+        int capacity = watch->dir_capacity ? watch->dir_capacity : 64;
+        while (capacity <= wd) capacity *= 2;
+        char** grown = realloc(watch->dirs, (size_t)capacity * sizeof(char*));
+        if (!grown) return 0;
+        memset(grown + watch->dir_capacity, 0, (size_t)(capacity - watch->dir_capacity) * sizeof(char*));
+        watch->dirs = grown;
+        watch->dir_capacity = capacity;
+    }
+    free(watch->dirs[wd]);
+    watch->dirs[wd] = strdup(relative);
+    return watch->dirs[wd] != NULL;
+}
+
+static void add_stamp(Snapshot* snapshot, const char* path, const struct stat* st) {
+    if (snapshot->count == snapshot->capacity) {
+        int capacity = snapshot->capacity ? snapshot->capacity * 2 : 256;
+        FileStamp* grown = realloc(snapshot->files, (size_t)capacity * sizeof(FileStamp));
+        if (!grown) return;
+        snapshot->files = grown;
+        snapshot->capacity = capacity;
+    }
+    FileStamp* stamp = &snapshot->files[snapshot->count];
+    stamp->path = strdup(path);
+    if (!stamp->path) return;
+    stamp->mtime_ns = (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+    stamp->size = (long long)st->st_size;
+    snapshot->count++;
+}
+
+static void free_snapshot(Snapshot* snapshot) {
+    for (int i = 0; i < snapshot->count; i++) free(snapshot->files[i].path);
+    free(snapshot->files);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+/* Adds an inotify watch to every directory below relative, or records its files' stamps when polling */
+static int scan_dir(Watch* watch, const char* relative, Snapshot* snapshot) {
+    if (watch->dir_count >= WATCH_MAX_DIRS) return 1;
+    char path[PATH_MAX];
+    if (!join_path(path, sizeof(path), watch->root, relative)) return 1;
+
+#ifdef __linux__
+    if (watch->inotify_fd >= 0) {
+        int wd = inotify_add_watch(watch->inotify_fd, path,
+                                   IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                   IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK);
+        if (wd < 0 || !remember_dir(watch, wd, relative)) return 0;
+    }
+#endif
+    watch->dir_count++;
+    if (watch->ignore && relative[0] && dir_set_add(&watch->ruled, relative)) {
+        gitignore_add_dir(watch->ignore, relative);
+    }
+
+    DIR* handle = opendir(path);
+    if (!handle) return 1;
+    struct dirent* entry;
+    int ok = 1;
+    while (ok && (entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char child[PATH_MAX], full[PATH_MAX];
+        struct stat st;
+        if (!join_path(child, sizeof(child), relative, entry->d_name) ||
+            !join_path(full, sizeof(full), watch->root, child) || lstat(full, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            if (watch->ignore && gitignore_ignored(watch->ignore, child, 1)) continue;
+            ok = scan_dir(watch, child, snapshot);
+        } else if (snapshot && S_ISREG(st.st_mode) && is_watched_file(entry->d_name) &&
+                   !(watch->ignore && gitignore_ignored(watch->ignore, child, 0))) {
+            add_stamp(snapshot, child, &st);
+        }
+    }
+    closedir(handle);
+    return ok;
+}
+
+static int compare_stamps(const void* a, const void* b) {
+    return strcmp(((const FileStamp*)a)->path, ((const FileStamp*)b)->path);
+}
+
+/* Polling: rescans the tree and records what differs from the last scan; returns whether anything did */
+static int poll_changes(Watch* watch) {
+    Snapshot now = { 0 };
+    watch->dir_count = 0;
+    scan_dir(watch, "", &now);
+    if (now.count > 1) qsort(now.files, (size_t)now.count, sizeof(FileStamp), compare_stamps);
+
+    int i = 0, j = 0, found = 0;
+    const Snapshot* before = &watch->snapshot;
+    while (i < before->count || j < now.count) {
+        int order = i == before->count ? 1 : j == now.count ? -1 : strcmp(before->files[i].path, now.files[j].path);
+        if (order < 0) {
+            add_change(watch, before->files[i++].path);
+            found = 1;
+        } else if (order > 0) {
+            add_change(watch, now.files[j++].path);
+            found = 1;
+        } else {
+            if (before->files[i].mtime_ns != now.files[j].mtime_ns || before->files[i].size != now.files[j].size) {
+                add_change(watch, now.files[j].path);
+                found = 1;
+            }
+            i++;
+            j++;
+        }
+    }
+    free_snapshot(&watch->snapshot);
+    watch->snapshot = now;
+    return found;
+}
+
+/* ── Waiting for changes ────────────────────────────────────────────────── */
+
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+#ifdef __linux__
+/* Reads the queued inotify events; returns 1 if one concerned a watched file */
+static int read_events(Watch* watch) {
+    char buffer[16 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int relevant = 0;
+    for (;;) {
+        ssize_t n = read(watch->inotify_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return relevant;
+
+        for (char* p = buffer; p < buffer + n;) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                watch->everything = relevant = 1;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                if (event->wd >= 0 && event->wd < watch->dir_capacity) {
+                    free(watch->dirs[event->wd]);
+                    watch->dirs[event->wd] = NULL;
+                }
+                continue;
+            }
+            if (event->len == 0 || event->name[0] == '.' || event->wd < 0 || event->wd >= watch->dir_capacity ||
+                !watch->dirs[event->wd]) continue;
+
+            char path[PATH_MAX];
+            if (!join_path(path, sizeof(path), watch->dirs[event->wd], event->name)) continue;
+            if (event->mask & IN_ISDIR) {
+                /* A new directory may arrive with its files (a checkout, a move): watch it and rerun everything */
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+                    !(watch->ignore && gitignore_ignored(watch->ignore, path, 1))) {
+                    scan_dir(watch, path, NULL);
+                    watch->everything = relevant = 1;
+                }
+                continue;
+            }
+            if (!is_watched_file(event->name) || (watch->ignore && gitignore_ignored(watch->ignore, path, 0))) continue;
+            /* IN_CREATE alone is an empty file still being written; its IN_CLOSE_WRITE follows */
+            if (event->mask == IN_CREATE) continue;
+            add_change(watch, path);
+            relevant = 1;
+        }
+    }
+}
+#endif
+
+/* Waits up to timeout_ms (-1 = forever) for a change to a watched file:
+   1 if one came, 0 on timeout, -1 when stopped */
+static int wait_for_change(Watch* watch, int timeout_ms) {
+    long long deadline = timeout_ms < 0 ? -1 : monotonic_ms() + timeout_ms;
+    for (;;) {
+        if (atomic_load(&watch->stop)) return -1;
+        int wait_ms = -1;
+        if (deadline >= 0) {
+            long long left = deadline - monotonic_ms();
+            if (left <= 0) return 0;
+            wait_ms = (int)left;
+        }
+
+        struct pollfd fds[2] = { { watch->wake[0], POLLIN, 0 }, { watch->inotify_fd, POLLIN, 0 } };
+        if (watch->inotify_fd < 0 && (wait_ms < 0 || wait_ms > watch->poll_ms)) wait_ms = watch->poll_ms;
+        int ready = poll(fds, watch->inotify_fd >= 0 ? 2 : 1, wait_ms);
+        if (ready < 0 && errno != EINTR) return -1;
+        if (atomic_load(&watch->stop)) return -1;
+
+#ifdef __linux__
+        if (watch->inotify_fd >= 0) {
+            if (ready > 0 && (fds[1].revents & POLLIN) && read_events(watch)) return 1;
+            continue;
+        }
+#endif
+        if (poll_changes(watch)) return 1;
+    }
+}
+
+/* ── The watcher thread ─────────────────────────────────────────────────── */
+
+static void run_cycle(Watch* watch, int selective) {
+    char only[1024];
+    const char* selection = NULL;
+    if (selective && !watch->everything) {
+        int chosen = project_watch_affected_tests(watch->root, (const char* const*)watch->changed,
+                                                  watch->changed_count, only, sizeof(only));
+        if (chosen >= 0) selection = only;
+    }
+    /* A red project reruns everything, so "back to green" covers the tests that failed */
+    pthread_mutex_lock(&g_lock);
+    if (watch->state == PROJECT_WATCH_RED) selection = NULL;
+    pthread_mutex_unlock(&g_lock);
+    clear_changes(watch);
+
+    char summary[WATCH_SUMMARY_MAX] = "";
+    long long span = trace_begin();
+    int green = watch->cycle(watch->root, selection, summary, sizeof(summary), watch->context);
+    trace_end("watch.cycle", span, green ? "green" : "red");
+    for (char* c = summary; *c; c++) {
+        if (*c == '\n') *c = ' ';
+    }
+
+    pthread_mutex_lock(&g_lock);
+    project_watch_state previous = watch->state;
+    watch->state = green ? PROJECT_WATCH_GREEN : PROJECT_WATCH_RED;
+    watch->cycles++;
+    snprintf(watch->summary, sizeof(watch->summary), "%s", summary);
+    if (!atomic_load(&watch->stop) && watch->state != previous &&
+        (previous != PROJECT_WATCH_UNKNOWN || watch->state == PROJECT_WATCH_RED)) {
+        char text[sizeof(g_announcement)];
+        snprintf(text, sizeof(text), "%s: %s", green ? "Back to green" : "Build is red", summary);
+        announce(text);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void free_watch(Watch* watch) {
+    clear_changes(watch);
+    free_snapshot(&watch->snapshot);
+    for (int i = 0; i < watch->dir_capacity; i++) free(watch->dirs[i]);
+    free(watch->dirs);
+    gitignore_free(watch->ignore);
+    dir_set_free(&watch->ruled);
+    if (watch->inotify_fd >= 0) close(watch->inotify_fd);
+    close(watch->wake[0]);
+    close(watch->wake[1]);
+    free(watch);
+}
+
+static void* watch_main(void* arg) {
+    Watch* watch = arg;
+    run_cycle(watch, 0);
+    while (wait_for_change(watch, -1) > 0) {
+        /* Let the burst of saves settle */
+        int settled;
+        while ((settled = wait_for_change(watch, watch->debounce_ms)) > 0) {}
+        if (settled < 0) break;
+        run_cycle(watch, 1);
+    }
+
+    pthread_mutex_lock(&g_lock);
+    if (g_watch == watch) g_watch = NULL;
+    pthread_mutex_unlock(&g_lock);
+    free_watch(watch);
+    return NULL;
+}
+
+int project_watch_start(const char* dir, project_watch_cycle_fn cycle, void* context) {
+    if (!dir || !cycle) return 0;
+    pthread_mutex_lock(&g_lock);
+    int busy = g_watch != NULL;
+    pthread_mutex_unlock(&g_lock);
+    if (busy) return -1;
+
+    Watch* watch = calloc(1, sizeof(Watch));
+    if (!watch) return 0;
+    if (!realpath(dir, watch->root) || pipe(watch->wake) != 0) {
+        free(watch);
+        return 0;
+    }
+    fcntl(watch->wake[0], F_SETFD, FD_CLOEXEC);
+    fcntl(watch->wake[1], F_SETFD, FD_CLOEXEC);
+    watch->cycle = cycle;
+    watch->context = context;
+    watch->debounce_ms = env_ms("JARVIS_WATCH_DEBOUNCE_MS", WATCH_DEFAULT_DEBOUNCE_MS);
+    watch->poll_ms = env_ms("JARVIS_WATCH_POLL_MS", WATCH_DEFAULT_POLL_MS);
+    watch->ignore = gitignore_load(watch->root);
+    watch->inotify_fd = -1;
+
+    const char* force_poll = getenv("JARVIS_WATCH_POLL");
+#ifdef __linux__
+    if (!(force_poll && strcmp(force_poll, "1") == 0)) {
+        watch->inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (watch->inotify_fd >= 0 && !scan_dir(watch, "", NULL)) {
+            /* Out of watches (fs.inotify.max_user_watches): poll instead */
+            log_message(LOG_WARN, NULL, "[WATCH]", "inotify unavailable for %s; polling every %d ms",
+                        watch->root, watch->poll_ms);
+            close(watch->inotify_fd);
+            watch->inotify_fd = -1;
+        }
+    }
+#else
+    (void)force_poll;
+#endif
+    if (watch->inotify_fd < 0) {
+        for (int i = 0; i < watch->dir_capacity; i++) {
+            free(watch->dirs[i]);
+            watch->dirs[i] = NULL;
+        }
+        watch->dir_count = 0;
+        scan_dir(watch, "", &watch->snapshot);
+        if (watch->snapshot.count > 1) {
+            qsort(watch->snapshot.files, (size_t)watch->snapshot.count, sizeof(FileStamp), compare_stamps);
+        }
+    }
+
+    pthread_mutex_lock(&g_lock);
+    if (g_watch) {
+        pthread_mutex_unlock(&g_lock);
+        free_watch(watch);
+        return -1;
+    }
+    g_watch = watch;
+
+    pthread_t thread;
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int started = pthread_create(&thread, NULL, watch_main, watch) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (started) pthread_detach(thread);
+    else g_watch = NULL;
+    pthread_mutex_unlock(&g_lock);
+    if (!started) free_watch(watch);
+    return started;
+}
+
+int project_watch_stop(void) {
+    pthread_mutex_lock(&g_lock);
+    Watch* watch = g_watch;
+    int stopped = watch && !atomic_load(&watch->stop);
+    if (stopped) {
+        /* The watch stays registered until its thread exits, so a cycle still
+           building cannot overlap the first cycle of the next watch */
+        atomic_store(&watch->stop, 1);
+        ssize_t ignored = write(watch->wake[1], "!", 1);
+        (void)ignored;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return stopped;
+}
+
+int project_watch_status(char* out, size_t out_size) {
+    if (!out || out_size == 0) return 0;
+    pthread_mutex_lock(&g_lock);
+    Watch* watch = g_watch;
+    if (!watch) {
+        pthread_mutex_unlock(&g_lock);
+        snprintf(out, out_size, "Not watching a project.");
+        return 0;
+    }
+    if (atomic_load(&watch->stop)) {
+        snprintf(out, out_size, "Stopping the watch on %s; its last build is still finishing.", watch->root);
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+    const char* state = watch->state == PROJECT_WATCH_GREEN ? "green"
+                      : watch->state == PROJECT_WATCH_RED   ? "red"
+                                                            : "running the first build";
+    if (watch->cycles == 0) {
+        snprintf(out, out_size, "Watching %s (%s): %s.", watch->root,
+                 watch->inotify_fd >= 0 ? "inotify" : "polling", state);
+    } else {
+        snprintf(out, out_size, "Watching %s (%s): %s after %d build%s. Last: %s", watch->root,
+                 watch->inotify_fd >= 0 ? "inotify" : "polling", state, watch->cycles,
+                 watch->cycles == 1 ? "" : "s", watch->summary);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return 1;
+}
+
+/* ── Affected tests ─────────────────────────────────────────────────────── */
+
+/* The file's name without directory and extension: src/foo.c -> foo */
+static int file_stem(const char* path, char* out, size_t out_size) {
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    const char* dot = strrchr(name, '.');
+    size_t len = dot ? (size_t)(dot - name) : strlen(name);
+    if (len == 0 || len >= out_size) return 0;
+    memcpy(out, name, len);
+    out[len] = '\0';
+    return 1;
+}
+
+static char* read_file(const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (!in) return NULL;
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char* text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    size_t len = text ? fread(text, 1, (size_t)size, in) : 0;
+    fclose(in);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+/* Adds the tests in one file whose bodies mention any stem; marks which stems matched */
+static int select_tests(const char* text, char stems[][NAME_MAX + 1], int stem_count, int* matched,
+                        char* only, size_t only_size, size_t* used) {
+    int chosen = 0;
+    const char* p = text;
+    while ((p = strstr(p, "static int test_")) != NULL) {
+        const char* name = p + strlen("static int ");
+        size_t name_len = 0;
+        while (name[name_len] == '_' || (name[name_len] >= 'a' && name[name_len] <= 'z') ||
+               (name[name_len] >= 'A' && name[name_len] <= 'Z') || (name[name_len] >= '0' && name[name_len] <= '9')) {
+            name_len++;
+        }
+        const char* open = name + name_len;
+        while (*open == ' ') open++;
+        if (*open != '(' || strncmp(open, "(void) {", 8) != 0) {
+            p = open;
+            continue;
+        }
+        /* The body ends at the first closing brace in column one */
+        const char* end = strstr(open, "\n}");
+        if (!end) end = open + strlen(open);
+
+        int hit = 0;
+        for (int s = 0; s < stem_count; s++) {
+            size_t stem_len = strlen(stems[s]);
+            for (const char* q = open; q && q < end; q = strstr(q + 1, stems[s])) {
+                if (q + stem_len <= end && strncmp(q, stems[s], stem_len) == 0) {
+                    matched[s] = 1;
+                    hit = 1;
+                    break;
+                }
+            }
+        }
+        if (hit) {
+            int written = snprintf(only + *used, only_size - *used, "%s%.*s", *used ? "," : "", (int)name_len, name);
+            if (written < 0 || (size_t)written >= only_size - *used) return -1;
+            *used += (size_t)written;
+            chosen++;
+        }
+        p = end;
+    }
+    return chosen;
+}
+
+int project_watch_affected_tests(const char* dir, const char* const* changed, int count, char* only, size_t only_size) {
+    if (!dir || !only || only_size == 0) return -1;
+    only[0] = '\0';
+    if (count <= 0) return 0;
+
+    char (*stems)[NAME_MAX + 1] = calloc((size_t)count, NAME_MAX + 1);
+    int* matched = calloc((size_t)count, sizeof(int));
+    if (!stems || !matched) {
+        free(stems);
+        free(matched);
+        return -1;
+    }
+    int stem_count = 0, everything = 0;
+    for (int i = 0; i < count && !everything; i++) {
+        const char* name = strrchr(changed[i], '/');
+        name = name ? name + 1 : changed[i];
+        /* Tests, build rules and names too short to search for rerun everything */
+        if (strncmp(changed[i], "tests/", 6) == 0 || !is_watched_file(name) || is_build_rule(name) ||
+            !file_stem(changed[i], stems[stem_count], NAME_MAX + 1) || strlen(stems[stem_count]) < 3) {
+            everything = 1;
+        } else {
+            stem_count++;
+        }
+    }
+
+    int chosen = 0;
+    size_t used = 0;
+    char tests_dir[PATH_MAX];
+    snprintf(tests_dir, sizeof(tests_dir), "%s/tests", dir);
+    DIR* handle = everything ? NULL : opendir(tests_dir);
+    if (!everything && !handle) everything = 1;
+    struct dirent* entry;
+    while (handle && !everything && (entry = readdir(handle)) != NULL) {
+        const char* dot = strrchr(entry->d_name, '.');
+        if (!dot || strcmp(dot, ".c") != 0) continue;
+        char path[PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%s", tests_dir, entry->d_name) >= (int)sizeof(path)) continue;
+        char* text = read_file(path);
+        if (!text) continue;
+        int found = select_tests(text, stems, stem_count, matched, only, only_size, &used);
+        free(text);
+        if (found < 0) everything = 1;
+        else chosen += found;
+    }
+    if (handle) closedir(handle);
+
+    /* A change no test mentions (e.g. the dispatcher every test goes through) reruns everything */
+    for (int s = 0; s < stem_count && !everything; s++) {
+        if (!matched[s]) everything = 1;
+    }
+    free(stems);
+    free(matched);
+    if (everything) {
+        only[0] = '\0';
+        return -1;
+    }
+    return chosen;
+}
@@ -0,0 +1,289 @@
+#include "../include/result_cache.h"
+#include "../include/json.h"
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_MAX_ENTRIES    128
+#define CACHE_SOURCE_MAX     32
+#define CACHE_KEY_MAX        256
+#define CACHE_VALUE_MAX      1024
+#define CACHE_REFRESH_IDLE_S (60 * 60)   /* stop refreshing entries nobody asked for in an hour */
+
+typedef struct {
+    int                        used;
+    char                       source[CACHE_SOURCE_MAX];
+    char                       key[CACHE_KEY_MAX];
+    char                       value[CACHE_VALUE_MAX];
+    int                        ok;
+    time_t                     expires;
+    time_t                     last_used;
+    time_t                     refresh_after;   /* retry throttle after a failed refresh */
+    int                        refreshing;
+    const result_cache_policy* policy;          /* NULL for entries loaded from disk until first use */
+    result_cache_fetch_fn      fetch;
+} CacheEntry;
+
+static CacheEntry      g_entries[CACHE_MAX_ENTRIES];
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_refresh_wake = PTHREAD_COND_INITIALIZER;
+static int             g_loaded = 0;
+static int             g_refresher_started = 0;
+
+static int policy_ttl(const result_cache_policy* policy) {
+    char name[64] = "JARVIS_CACHE_TTL_";
+    size_t len = strlen(name);
+    for (const char* p = policy->source; *p && len + 1 < sizeof(name); p++) {
+        name[len++] = isalnum((unsigned char)*p) ? (char)toupper((unsigned char)*p) : '_';
+    }
+    name[len] = '\0';
+
+    const char* value = getenv(name);
+    if (value && value[0] != '\0') {
+        long ttl = strtol(value, NULL, 10);
+        if (ttl >= 0) return (int)ttl;
+    }
+    return policy->ttl_seconds;
+}
+
+static CacheEntry* find_entry(const char* source, const char* key) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        CacheEntry* entry = &g_entries[i];
+        if (entry->used && strcmp(entry->source, source) == 0 && strcmp(entry->key, key) == 0) return entry;
+    }
+    return NULL;
+}
+
+/* Free slot, else the least recently used entry */
+static CacheEntry* claim_entry(void) {
+    CacheEntry* victim = NULL;
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        CacheEntry* entry = &g_entries[i];
+        if (!entry->used) return entry;
+        if (!entry->refreshing && (!victim || entry->last_used < victim->last_used)) victim = entry;
+    }
+    return victim ? victim : &g_entries[0];
+}
+
+/* ── Persistence (JARVIS_CACHE_FILE) ────────────────────────────────────── */
+
+static const char* cache_file(void) {
+    const char* path = getenv("JARVIS_CACHE_FILE");
+    return path && path[0] != '\0' ? path : NULL;
+}
+
+static void load_persisted(void) {
+    g_loaded = 1;
+    const char* path = cache_file();
+    FILE* in = path ? fopen(path, "r") : NULL;
+    if (!in) return;
+
+    time_t now = time(NULL);
+    char line[8192];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char source[CACHE_SOURCE_MAX], key[CACHE_KEY_MAX], value[CACHE_VALUE_MAX], number[32];
+        if (!json_get_string(line, "source", source, sizeof(source)) ||
+            !json_get_string(line, "key", key, sizeof(key)) ||
+            !json_get_string(line, "value", value, sizeof(value)) ||
+            !json_get_raw(line, "expires", number, sizeof(number))) continue;
+
+        time_t expires = (time_t)strtoll(number, NULL, 10);
+        if (expires <= now || find_entry(source, key)) continue;
+
+        CacheEntry* entry = claim_entry();
+        memset(entry, 0, sizeof(*entry));
+        entry->used = 1;
+        snprintf(entry->source, sizeof(entry->source), "%s", source);
+        snprintf(entry->key, sizeof(entry->key), "%s", key);
+        snprintf(entry->value, sizeof(entry->value), "%s", value);
+        entry->ok = json_get_raw(line, "ok", number, sizeof(number)) && strcmp(number, "true") == 0;
+        entry->expires = expires;
+        entry->last_used = now;
+    }
+    fclose(in);
+}
+
+/* Rewrites the file (temp + rename) with every unexpired entry */
+static void save_persisted(void) {
+    const char* path = cache_file();
+    if (!path) return;
+
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) return;
+
+    time_t now = time(NULL);
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        const CacheEntry* entry = &g_entries[i];
+        if (!entry->used || entry->expires <= now) continue;
+        fputs("{\"source\":", out);
+        json_write_string(out, entry->source);
+        fputs(",\"key\":", out);
+        json_write_string(out, entry->key);
+        fprintf(out, ",\"expires\":%lld,\"ok\":%s,\"value\":", (long long)entry->expires, entry->ok ? "true" : "false");
+        json_write_string(out, entry->value);
+        fputs("}\n", out);
+    }
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) unlink(tmp_path);
+}
+
+/* ── Background refresh ─────────────────────────────────────────────────── */
+
+static int refresh_eligible(const CacheEntry* entry, time_t now) {
+    return entry->used && entry->ok && !entry->refreshing && entry->fetch && entry->policy &&
+           entry->policy->refresh_ahead_seconds > 0 && now - entry->last_used < CACHE_REFRESH_IDLE_S;
+}
+
+static time_t refresh_due(const CacheEntry* entry) {
+    time_t due = entry->expires - entry->policy->refresh_ahead_seconds;
+    return due > entry->refresh_after ? due : entry->refresh_after;
+}
+
+static void store_entry(CacheEntry* entry, const result_cache_policy* policy, const char* key,
+                        const char* value, int ok, result_cache_fetch_fn fetch, time_t now) {
+    int ttl = ok ? policy_ttl(policy) : policy->negative_ttl_seconds;
+    entry->used = 1;
+    snprintf(entry->source, sizeof(entry->source), "%s", policy->source);
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    snprintf(entry->value, sizeof(entry->value), "%s", ok ? value : "");
+    entry->ok = ok;
+    entry->expires = now + ttl;
+    entry->refresh_after = 0;
+    entry->policy = policy;
+    entry->fetch = fetch;
+}
+
+static void* refresher_main(void* arg) {
+    (void)arg;
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+    pthread_mutex_lock(&g_lock);
+    for (;;) {
+        time_t now = time(NULL);
+        CacheEntry* next = NULL;
+        for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+            CacheEntry* entry = &g_entries[i];
+            if (refresh_eligible(entry, now) && (!next || refresh_due(entry) < refresh_due(next))) next = entry;
+        }
+
+        if (!next) {
+            pthread_cond_wait(&g_refresh_wake, &g_lock);
+            continue;
+        }
+        time_t due = refresh_due(next);
+        if (due > now) {
+            struct timespec deadline = { due, 0 };
+            pthread_cond_timedwait(&g_refresh_wake, &g_lock, &deadline);
+            continue;
+        }
+
+        /* Fetch outside the lock; the entry is pinned by the refreshing flag */
+        const result_cache_policy* policy = next->policy;
+        result_cache_fetch_fn fetch = next->fetch;
+        char key[CACHE_KEY_MAX], value[CACHE_VALUE_MAX] = "";
+        snprintf(key, sizeof(key), "%s", next->key);
+        next->refreshing = 1;
+        pthread_mutex_unlock(&g_lock);
+
+        int ok = fetch(key, value, sizeof(value));
+
+        pthread_mutex_lock(&g_lock);
+        next->refreshing = 0;
+        now = time(NULL);
+        if (ok) {
+            store_entry(next, policy, key, value, 1, fetch, now);
+            save_persisted();
+        } else {
+            /* Keep serving the old answer until it expires; try again later */
+            int retry = policy->negative_ttl_seconds > 0 ? policy->negative_ttl_seconds : 30;
+            next->refresh_after = now + retry;
+        }
+    }
+    return NULL;
+}
+
+static void start_refresher(void) {
+    if (g_refresher_started) return;
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    g_refresher_started = pthread_create(&thread, &attr, refresher_main, NULL) == 0;
+    pthread_attr_destroy(&attr);
+}
+
+/* ── Public API ─────────────────────────────────────────────────────────── */
+
+int result_cache_get(const result_cache_policy* policy, const char* key, char* out, size_t out_size,
+                     result_cache_fetch_fn fetch, int* cached) {
+    if (cached) *cached = 0;
+    if (!policy || !out || out_size == 0 || !fetch) return 0;
+    if (!key) key = "";
+    out[0] = '\0';
+
+    pthread_mutex_lock(&g_lock);
+    if (!g_loaded) load_persisted();
+
+    time_t now = time(NULL);
+    CacheEntry* entry = find_entry(policy->source, key);
+    if (entry && now < entry->expires) {
+        entry->last_used = now;
+        entry->policy = policy;
+        entry->fetch = fetch;
+        int ok = entry->ok;
+        snprintf(out, out_size, "%s", entry->value);
+        if (policy->refresh_ahead_seconds > 0) pthread_cond_signal(&g_refresh_wake);
+        pthread_mutex_unlock(&g_lock);
+
+        metrics_count(METRIC_CACHE_HITS, 1);
+        if (cached) *cached = 1;
+        return ok;
+    }
+    pthread_mutex_unlock(&g_lock);
+    metrics_count(METRIC_CACHE_MISSES, 1);
+
+    char value[CACHE_VALUE_MAX] = "";
+    int ok = fetch(key, value, sizeof(value));
+    if (ok) snprintf(out, out_size, "%s", value);
+
+    if (!ok && policy->negative_ttl_seconds <= 0) return 0;
+    if (ok && policy_ttl(policy) <= 0) return 1;
+
+    pthread_mutex_lock(&g_lock);
+    now = time(NULL);
+    entry = find_entry(policy->source, key);
+    if (!entry || !entry->refreshing) {
+        if (!entry) entry = claim_entry();
+        store_entry(entry, policy, key, value, ok, fetch, now);
+        entry->last_used = now;
+        save_persisted();
+        if (ok && policy->refresh_ahead_seconds > 0) {
+            start_refresher();
+            pthread_cond_signal(&g_refresh_wake);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ok;
+}
+
+void result_cache_clear(void) {
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (!g_entries[i].refreshing) memset(&g_entries[i], 0, sizeof(g_entries[i]));
+    }
+    g_loaded = 1;
+    const char* path = cache_file();
+    if (path) unlink(path);
+    pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,512 @@
+#include "../include/routine.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#define ROUTINE_FILE_MAX (64 * 1024)
+
+/* Built in so "morning sync" works without a routines file */
+static const char g_builtin_routines[] =
+    "[morning]\n"
+    "status: daily status\n"
+    "projects: status of all projects\n";
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* ── Parsing ────────────────────────────────────────────────────────────── */
+
+static const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static size_t identifier_length(const char* p, const char* end) {
+    size_t len = 0;
+    while (p + len < end && (isalnum((unsigned char)p[len]) || p[len] == '_' || p[len] == '-')) len++;
+    return len;
+}
+
+static void copy_lower(char* out, size_t out_size, const char* text, size_t len) {
+    if (len >= out_size) len = out_size - 1;
+    for (size_t i = 0; i < len; i++) out[i] = (char)tolower((unsigned char)text[i]);
+    out[len] = '\0';
+}
+
+/* Section header "[name]": name into out, 1 if the line is one */
+static int parse_header(const char* line, const char* end, char* out, size_t out_size) {
+    line = skip_spaces(line, end);
+    if (line >= end || *line != '[') return 0;
+    const char* close = memchr(line, ']', (size_t)(end - line));
+    if (!close) return 0;
+    const char* name = skip_spaces(line + 1, close);
+    size_t len = (size_t)(close - name);
+    while (len > 0 && (name[len - 1] == ' ' || name[len - 1] == '\t')) len--;
+    copy_lower(out, out_size, name, len);
+    return 1;
+}
+
+static int find_step(const routine* routine, const char* name) {
+    for (int i = 0; i < routine->step_count; i++) {
+        if (strcmp(routine->steps[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* "name (after a, b): command"; dependency names are kept until every step is known */
+static int parse_step(const char* line, const char* end, routine* routine,
+                      char deps[][ROUTINE_NAME_MAX], int* dep_total, char* error, size_t error_size) {
+    line = skip_spaces(line, end);
+    size_t len = identifier_length(line, end);
+    if (len == 0 || len >= ROUTINE_NAME_MAX) {
+        snprintf(error, error_size, "expected 'step: command', got '%.*s'", (int)(end - line > 60 ? 60 : end - line), line);
+        return 0;
+    }
+    if (routine->step_count == ROUTINE_MAX_STEPS) {
+        snprintf(error, error_size, "more than %d steps", ROUTINE_MAX_STEPS);
+        return 0;
+    }
+    routine_step* step = &routine->steps[routine->step_count];
+    memset(step, 0, sizeof(*step));
+    copy_lower(step->name, sizeof(step->name), line, len);
+    if (find_step(routine, step->name) >= 0) {
+        snprintf(error, error_size, "step '%s' is defined twice", step->name);
+        return 0;
+    }
+
+    const char* p = skip_spaces(line + len, end);
+    if (p < end && *p == '(') {
+        const char* close = memchr(p, ')', (size_t)(end - p));
+        p = skip_spaces(p + 1, end);
+        if (!close || (size_t)(close - p) < 5 || strncasecmp(p, "after", 5) != 0) {
+            snprintf(error, error_size, "step '%s': expected '(after <steps>)'", step->name);
+            return 0;
+        }
+        p += 5;
+        while (p < close) {
+            p = skip_spaces(p, close);
+            if (p < close && *p == ',') {
+                p++;
+                continue;
+            }
+            size_t dep_len = identifier_length(p, close);
+            if (dep_len == 0 || dep_len >= ROUTINE_NAME_MAX) {
+                snprintf(error, error_size, "step '%s': bad dependency list", step->name);
+                return 0;
+            }
+            /* Dependency names are resolved once every step is known */
+            if (step->dep_count < ROUTINE_MAX_STEPS) {
+                copy_lower(deps[*dep_total], ROUTINE_NAME_MAX, p, dep_len);
+                step->deps[step->dep_count++] = (*dep_total)++;
+            }
+            p += dep_len;
+        }
+        p = skip_spaces(close + 1, end);
+    }
+
+    if (p >= end || *p != ':') {
+        snprintf(error, error_size, "step '%s': expected ':' before the command", step->name);
+        return 0;
+    }
+    p = skip_spaces(p + 1, end);
+    size_t command_len = (size_t)(end - p);
+    while (command_len > 0 && isspace((unsigned char)p[command_len - 1])) command_len--;
+    if (command_len == 0 || command_len >= ROUTINE_COMMAND_MAX) {
+        snprintf(error, error_size, "step '%s': %s command", step->name, command_len ? "overlong" : "missing");
+        return 0;
+    }
+    memcpy(step->command, p, command_len);
+    step->command[command_len] = '\0';
+    routine->step_count++;
+    return 1;
+}
+
+/* Kahn's algorithm: every step must become ready once its dependencies are done */
+static int check_acyclic(const routine* routine, char* error, size_t error_size) {
+    int waiting[ROUTINE_MAX_STEPS];
+    int done[ROUTINE_MAX_STEPS] = { 0 };
+    for (int i = 0; i < routine->step_count; i++) waiting[i] = routine->steps[i].dep_count;
+
+    int finished = 0, progress = 1;
+    while (progress) {
+        progress = 0;
+        for (int i = 0; i < routine->step_count; i++) {
+            if (done[i] || waiting[i] > 0) continue;
+            done[i] = 1;
+            finished++;
+            progress = 1;
+            for (int j = 0; j < routine->step_count; j++) {
+                for (int d = 0; d < routine->steps[j].dep_count; d++) {
+                    if (routine->steps[j].deps[d] == i) waiting[j]--;
+                }
+            }
+        }
+    }
+    if (finished == routine->step_count) return 1;
+    for (int i = 0; i < routine->step_count; i++) {
+        if (!done[i]) {
+            snprintf(error, error_size, "step '%s' is part of a dependency cycle", routine->steps[i].name);
+            break;
+        }
+    }
+    return 0;
+}
+
+int routine_parse(const char* text, const char* name, routine* out, char* error, size_t error_size) {
+    char scratch[8];
+    if (!error || error_size == 0) {
+        error = scratch;
+        error_size = sizeof(scratch);
+    }
+    error[0] = '\0';
+    if (!text || !name || !out) return 0;
+    memset(out, 0, sizeof(*out));
+    copy_lower(out->name, sizeof(out->name), name, strlen(name));
+
+    char (*names)[ROUTINE_NAME_MAX] = malloc((size_t)ROUTINE_MAX_STEPS * ROUTINE_MAX_STEPS * ROUTINE_NAME_MAX);
+    if (!names) return 0;
+    int dep_total = 0;
+
+    int in_section = 0, found = 0, line_number = 0;
+    const char* line = text;
+    while (*line) {
+        const char* end = strchr(line, '\n');
+        if (!end) end = line + strlen(line);
+        line_number++;
+        const char* content = skip_spaces(line, end);
+        char header[ROUTINE_NAME_MAX];
+
+        if (content == end || *content == '#' || *content == '\r') {
+            /* blank or comment */
+        } else if (parse_header(content, end, header, sizeof(header))) {
+            if (found) break;      /* the first definition wins */
+            in_section = strcmp(header, out->name) == 0;
+            found = in_section;
+        } else if (in_section) {
+            const char* trimmed = end;
+            if (trimmed > content && trimmed[-1] == '\r') trimmed--;
+            char reason[200];
+            if (!parse_step(content, trimmed, out, names, &dep_total, reason, sizeof(reason))) {
+                snprintf(error, error_size, "line %d: %s", line_number, reason);
+                free(names);
+                return -1;
+            }
+        }
+        line = *end ? end + 1 : end;
+    }
+
+    if (!found) {
+        free(names);
+        return 0;
+    }
+    if (out->step_count == 0) {
+        snprintf(error, error_size, "routine '%s' has no steps", out->name);
+        free(names);
+        return -1;
+    }
+
+    /* Turn the dependency names into step indexes */
+    for (int i = 0; i < out->step_count; i++) {
+        routine_step* step = &out->steps[i];
+        for (int d = 0; d < step->dep_count; d++) {
+            const char* dep = names[step->deps[d]];
+            int index = find_step(out, dep);
+            if (index < 0) {
+                snprintf(error, error_size, "step '%s' waits for unknown step '%s'", step->name, dep);
+                free(names);
+                return -1;
+            }
+            step->deps[d] = index;
+        }
+    }
+    free(names);
+    return check_acyclic(out, error, error_size) ? 1 : -1;
+}
+
+/* ── Loading ────────────────────────────────────────────────────────────── */
+
+static int routines_path(char* out, size_t out_size) {
+    const char* configured = getenv("JARVIS_ROUTINES");
+    const char* config = getenv("XDG_CONFIG_HOME");
+    const char* home = getenv("HOME");
+    int len;
+    if (configured && configured[0]) len = snprintf(out, out_size, "%s", configured);
+    else if (config && config[0] == '/') len = snprintf(out, out_size, "%s/jarvis/routines", config);
+    else if (home && home[0]) len = snprintf(out, out_size, "%s/.config/jarvis/routines", home);
+    else return 0;
+    return len > 0 && (size_t)len < out_size;
+}
+
+/* The routines file's contents (malloc'd), NULL if there is none */
+static char* read_routines_file(void) {
+    char path[4096];
+    if (!routines_path(path, sizeof(path))) return NULL;
+    FILE* in = fopen(path, "r");
+    if (!in) return NULL;
+    char* text = malloc(ROUTINE_FILE_MAX + 1);
+    size_t len = text ? fread(text, 1, ROUTINE_FILE_MAX, in) : 0;
+    fclose(in);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+int routine_load(const char* name, routine* out, char* error, size_t error_size) {
+    char* text = read_routines_file();
+    int result = text ? routine_parse(text, name, out, error, error_size) : 0;
+    free(text);
+    if (result == 0) result = routine_parse(g_builtin_routines, name, out, error, error_size);
+    return result;
+}
+
+static int add_names(const char* text, char names[][ROUTINE_NAME_MAX], int count, int max) {
+    const char* line = text;
+    while (*line && count < max) {
+        const char* end = strchr(line, '\n');
+        if (!end) end = line + strlen(line);
+        char header[ROUTINE_NAME_MAX];
+        if (parse_header(line, end, header, sizeof(header)) && header[0]) {
+            int known = 0;
+            for (int i = 0; i < count && !known; i++) known = strcmp(names[i], header) == 0;
+            if (!known) memcpy(names[count++], header, sizeof(header));
+        }
+        line = *end ? end + 1 : end;
+    }
+    return count;
+}
+
+int routine_list(char names[][ROUTINE_NAME_MAX], int max) {
+    char* text = read_routines_file();
+    int count = text ? add_names(text, names, 0, max) : 0;
+    free(text);
+    return add_names(g_builtin_routines, names, count, max);
+}
+
+int routine_jobs(void) {
+    const char* configured = getenv("JARVIS_ROUTINE_JOBS");
+    long jobs = configured ? strtol(configured, NULL, 10) : 0;
+    if (jobs <= 0 || jobs > ROUTINE_MAX_STEPS) jobs = ROUTINE_MAX_STEPS;
+    return (int)jobs;
+}
+
+/* ── Scheduling ─────────────────────────────────────────────────────────── */
+
+typedef struct {
+    routine*         routine;
+    routine_step_fn  run;
+    void*            context;
+    long long        origin;
+    int              remaining;     /* steps not yet finished or skipped */
+    pthread_mutex_t  lock;
+    pthread_cond_t   changed;
+} Scheduler;
+
+/* Called with the lock held: skips steps below a failure, returns a ready step or -1 */
+static int next_ready(Scheduler* scheduler) {
+    routine* routine = scheduler->routine;
+    int skipped = 1;
+    while (skipped) {
+        skipped = 0;
+        for (int i = 0; i < routine->step_count; i++) {
+            routine_step* step = &routine->steps[i];
+            if (step->state != ROUTINE_PENDING) continue;
+            int ready = 1, blocked = 0;
+            for (int d = 0; d < step->dep_count; d++) {
+                routine_step_state dep = routine->steps[step->deps[d]].state;
+                if (dep == ROUTINE_FAILED || dep == ROUTINE_SKIPPED) blocked = 1;
+                else if (dep != ROUTINE_OK) ready = 0;
+            }
+            if (blocked) {
+                step->state = ROUTINE_SKIPPED;
+                scheduler->remaining--;
+                skipped = 1;
+            } else if (ready) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static void* routine_worker(void* arg) {
+    Scheduler* scheduler = arg;
+    routine* routine = scheduler->routine;
+    pthread_mutex_lock(&scheduler->lock);
+    while (scheduler->remaining > 0) {
+        int i = next_ready(scheduler);
+        if (i < 0) {
+            if (scheduler->remaining == 0) break;
+            pthread_cond_wait(&scheduler->changed, &scheduler->lock);
+            continue;
+        }
+        routine_step* step = &routine->steps[i];
+        step->state = ROUTINE_RUNNING;
+        pthread_mutex_unlock(&scheduler->lock);
+
+        long long span = trace_begin();
+        long long start = monotonic_us();
+        char* output = NULL;
+        int ok = scheduler->run(step->command, &output, scheduler->context);
+        long long finish = monotonic_us();
+        trace_end("routine.step", span, step->name);
+
+        pthread_mutex_lock(&scheduler->lock);
+        step->output = output;
+        step->start_us = start - scheduler->origin;
+        step->elapsed_us = finish - start;
+        step->state = ok ? ROUTINE_OK : ROUTINE_FAILED;
+        scheduler->remaining--;
+        pthread_cond_broadcast(&scheduler->changed);
+    }
+    /* Skips done while looking for work can end the run: wake the waiting workers */
+    pthread_cond_broadcast(&scheduler->changed);
+    pthread_mutex_unlock(&scheduler->lock);
+    return NULL;
+}
+
+/* Longest chain of dependent steps, by their measured times */
+static long long critical_path(const routine* routine) {
+    long long finish[ROUTINE_MAX_STEPS] = { 0 };
+    long long longest = 0;
+    /* The graph is acyclic, so step_count relaxation rounds settle every chain */
+    for (int round = 0; round < routine->step_count; round++) {
+        for (int i = 0; i < routine->step_count; i++) {
+            long long before = 0;
+            for (int d = 0; d < routine->steps[i].dep_count; d++) {
+                long long dep = finish[routine->steps[i].deps[d]];
+                if (dep > before) before = dep;
+            }
+            finish[i] = before + routine->steps[i].elapsed_us;
+            if (finish[i] > longest) longest = finish[i];
+        }
+    }
+    return longest;
+}
+
+int routine_run(routine* routine, int jobs, routine_step_fn run, void* context) {
+    if (!routine || !run) return 0;
+    long long span = trace_begin();
+    for (int i = 0; i < routine->step_count; i++) {
+        routine_step* step = &routine->steps[i];
+        step->state = ROUTINE_PENDING;
+        step->start_us = step->elapsed_us = 0;
+        step->output = NULL;
+    }
+
+    Scheduler scheduler = { .routine = routine, .run = run, .context = context,
+                            .origin = monotonic_us(), .remaining = routine->step_count };
+    pthread_mutex_init(&scheduler.lock, NULL);
+    pthread_cond_init(&scheduler.changed, NULL);
+
+    if (jobs <= 0) jobs = routine_jobs();
+    if (jobs > routine->step_count) jobs = routine->step_count;
+
+    /* Steps run on fresh threads only, so a step may bind per-thread state (a session) freely */
+    pthread_t workers[ROUTINE_MAX_STEPS];
+    int started = 0;
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[started], NULL, routine_worker, &scheduler) == 0) started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (started == 0) routine_worker(&scheduler);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    pthread_cond_destroy(&scheduler.changed);
+    pthread_mutex_destroy(&scheduler.lock);
+
+    routine->ok = routine->failed = routine->skipped = 0;
+    for (int i = 0; i < routine->step_count; i++) {
+        switch (routine->steps[i].state) {
+            case ROUTINE_OK:      routine->ok++; break;
+            case ROUTINE_FAILED:  routine->failed++; break;
+            default:              routine->skipped++; break;
+        }
+    }
+    routine->elapsed_us = monotonic_us() - scheduler.origin;
+    routine->critical_us = critical_path(routine);
+    trace_end("routine", span, routine->name);
+    return routine->ok == routine->step_count;
+}
+
+/* ── Reporting ──────────────────────────────────────────────────────────── */
+
+/* Appends text on one line, its lines joined by "; ", at most limit bytes */
+static size_t append_flattened(char* out, size_t used, size_t out_size, const char* text, size_t limit) {
+    size_t start = used;
+    int pending_separator = 0;
+    for (const char* c = text; *c && used + 4 < out_size && used - start < limit; c++) {
+        if (*c == '\n' || *c == '\r') {
+            pending_separator = used > start;
+            continue;
+        }
+        if (pending_separator) {
+            /* "Branch:\nmain" reads as "Branch: main" */
+            if (out[used - 1] != ':' && out[used - 1] != '.') out[used++] = ';';
+            out[used++] = ' ';
+            pending_separator = 0;
+        }
+        out[used++] = *c;
+    }
+    out[used] = '\0';
+    return used;
+}
+
+void routine_format_report(const routine* routine, char* out, size_t out_size) {
+    if (!out || out_size == 0) return;
+    out[0] = '\0';
+    if (!routine) return;
+
+    int written;
+    if (routine->ok == routine->step_count) {
+        written = snprintf(out, out_size, "Routine %s: %d %s succeeded in %lld ms (critical path %lld ms).",
+                           routine->name, routine->step_count, routine->step_count == 1 ? "step" : "steps",
+                           routine->elapsed_us / 1000, routine->critical_us / 1000);
+    } else {
+        written = snprintf(out, out_size, "Routine %s: %d of %d steps succeeded, %d failed, %d skipped in %lld ms.",
+                           routine->name, routine->ok, routine->step_count, routine->failed, routine->skipped,
+                           routine->elapsed_us / 1000);
+    }
+    size_t used = written < 0 ? 0 : (size_t)written >= out_size ? out_size - 1 : (size_t)written;
+
+    for (int i = 0; i < routine->step_count && used + 1 < out_size; i++) {
+        const routine_step* step = &routine->steps[i];
+        if (step->state == ROUTINE_SKIPPED) {
+            written = snprintf(out + used, out_size - used, "\n%s: skipped", step->name);
+        } else {
+            written = snprintf(out + used, out_size - used, "\n%s: %s, %lld ms", step->name,
+                               step->state == ROUTINE_OK ? "ok" : step->state == ROUTINE_FAILED ? "failed" : "not run",
+                               step->elapsed_us / 1000);
+        }
+        if (written < 0 || (size_t)written >= out_size - used) {
+            out[used] = '\0';
+            break;
+        }
+        used += (size_t)written;
+
+        /* Share what is left between this step's output and the ones still to come */
+        size_t budget = (out_size - used) / (size_t)(routine->step_count - i);
+        if (step->output && step->output[0] && budget > 8) {
+            memcpy(out + used, " - ", 4);
+            used = append_flattened(out, used + 3, out_size, step->output, budget - 8);
+        }
+    }
+}
+
+void routine_release(routine* routine) {
+    if (!routine) return;
+    for (int i = 0; i < routine->step_count; i++) {
+        free(routine->steps[i].output);
+        routine->steps[i].output = NULL;
+    }
+}
@@ -1,8 +1,17 @@
 #include "../include/search.h"
+#include "../include/session.h"
+#include "../include/file_index.h"
+#include "../include/file_meta.h"
+#include "../include/result_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
+#include <time.h>
+
+#define FILE_SEARCH_MAX_RESULTS 5
+#define FILE_SEARCH_CANDIDATES  200
 
 static void trim_whitespace_inplace(char* text) {
     if (!text) return;
@@ -25,14 +34,16 @@ static void trim_whitespace_inplace(char* text) {
 }
 
 static const char* normalize_search_query(const char* query) {
-    static char cleaned[512];
+    /* Lives in the caller's session so concurrent clients don't share it */
+    char* cleaned = session_current()->query_buffer;
+    const size_t cleaned_size = sizeof(session_current()->query_buffer);
     if (!query) {
         cleaned[0] = '\0';
         return cleaned;
     }
 
-    strncpy(cleaned, query, sizeof(cleaned) - 1);
-    cleaned[sizeof(cleaned) - 1] = '\0';
+    strncpy(cleaned, query, cleaned_size - 1);
+    cleaned[cleaned_size - 1] = '\0';
     trim_whitespace_inplace(cleaned);
 
     const char* fillers[] = {
@@ -93,15 +104,11 @@ static void url_encode_query(const char* input, char* output, size_t output_size
     output[out] = '\0';
 }
 
-/**
- * Performs a web search using command-line tools
- */
-char* web_search(const char* query) {
-    if (!query || strlen(query) == 0) return NULL;
-
-    char* result = (char*)malloc(1024);
-    if (!result) return NULL;
+/* Repeating a query within five minutes answers from the cache instead of
+   opening another browser tab; launch failures are not cached */
+static const result_cache_policy g_web_search_cache = { "web_search", 300, 0, 0 };
 
+static int launch_web_search(const char* query, char* out, size_t out_size) {
     char encoded[512];
     url_encode_query(query, encoded, sizeof(encoded));
 
@@ -114,13 +121,90 @@ char* web_search(const char* query) {
     snprintf(open_cmd, sizeof(open_cmd),
              "xdg-open 'https://duckduckgo.com/?q=%s' &", encoded);
 #endif
-    system(open_cmd);
+    if (system(open_cmd) == -1) return 0;
 
-    snprintf(result, 1024,
+    snprintf(out, out_size,
              "Searching DuckDuckGo for '%s'. Opening results in your browser.", query);
+    return 1;
+}
+
+/**
+ * Performs a web search using command-line tools
+ */
+char* web_search(const char* query) {
+    if (!query || strlen(query) == 0) return NULL;
+
+    char* result = (char*)malloc(1024);
+    if (!result) return NULL;
+
+    char key[512];
+    size_t i = 0;
+    for (; query[i] && i + 1 < sizeof(key); i++) key[i] = (char)tolower((unsigned char)query[i]);
+    key[i] = '\0';
+
+    char answer[1024];
+    int cached = 0;
+    if (!result_cache_get(&g_web_search_cache, key, answer, sizeof(answer), launch_web_search, &cached)) {
+        snprintf(result, 1024, "I couldn't open the browser to search for '%s'.", query);
+    } else if (cached) {
+        snprintf(result, 1024, "The DuckDuckGo results for '%s' are already open in your browser.", query);
+    } else {
+        snprintf(result, 1024, "%s", answer);
+    }
     return result;
 }
 
+/* Drops the words people wrap around a file name: "the file named budget" -> "budget" */
+static void clean_file_query(const char* query, char* out, size_t out_size) {
+    static const char* const fillers[] = {
+        "file", "files", "named", "called", "my", "the", "a", "an", "for", "find", "search",
+        "newest", "latest", "recent", "most", "largest", "biggest"
+    };
+
+    out[0] = '\0';
+    size_t len = 0;
+    const char* p = query;
+    while (*p) {
+        while (*p && (isspace((unsigned char)*p) || *p == '\'' || *p == '"')) p++;
+        const char* start = p;
+        while (*p && !isspace((unsigned char)*p) && *p != '\'' && *p != '"') p++;
+        size_t word_len = (size_t)(p - start);
+        if (word_len == 0) continue;
+
+        int filler = 0;
+        for (size_t i = 0; i < sizeof(fillers) / sizeof(fillers[0]) && !filler; i++) {
+            filler = strlen(fillers[i]) == word_len && strncasecmp(start, fillers[i], word_len) == 0;
+        }
+        if (filler || len + word_len + 2 > out_size) continue;
+
+        if (len > 0) out[len++] = ' ';
+        memcpy(out + len, start, word_len);
+        len += word_len;
+        out[len] = '\0';
+    }
+}
+
+/* "newest budget file" / "largest video" pick an order; -1 keeps relevance order */
+static int detect_file_sort(const char* query) {
+    char lowered[256];
+    size_t i = 0;
+    for (; query[i] && i + 1 < sizeof(lowered); i++) lowered[i] = (char)tolower((unsigned char)query[i]);
+    lowered[i] = '\0';
+
+    if (strstr(lowered, "newest") || strstr(lowered, "latest") || strstr(lowered, "recent"))
+        return FILE_SORT_NEWEST;
+    if (strstr(lowered, "largest") || strstr(lowered, "biggest"))
+        return FILE_SORT_LARGEST;
+    return -1;
+}
+
+static void format_file_size(long long bytes, char* out, size_t out_size) {
+    if (bytes < 1024) snprintf(out, out_size, "%lld B", bytes);
+    else if (bytes < 1024LL * 1024) snprintf(out, out_size, "%.1f KB", (double)bytes / 1024.0);
+    else if (bytes < 1024LL * 1024 * 1024) snprintf(out, out_size, "%.1f MB", (double)bytes / (1024.0 * 1024.0));
+    else snprintf(out, out_size, "%.1f GB", (double)bytes / (1024.0 * 1024.0 * 1024.0));
+}
+
 /**
  * Searches for files on the system
  */
@@ -128,36 +212,71 @@ char* file_search(const char* filename) {
     if (!filename || strlen(filename) == 0) {
         return NULL;
     }
-    
+
     char* result = (char*)malloc(2048);
     if (!result) return NULL;
-    
-    char command[512];
-    FILE* fp;
-    int file_count = 0;
-    
-    // Use find command to search for files (limit search to home directory)
-    snprintf(command, sizeof(command), 
-            "find ~/ -name '*%s*' -type f 2>/dev/null | head -10 | wc -l", 
-            filename);
-    
-    fp = popen(command, "r");
-    if (fp) {
-        fscanf(fp, "%d", &file_count);
-        pclose(fp);
+
+    /* "budget in ~/Downloads" searches just that directory */
+    char scope[512] = "";
+    char words[256];
+    snprintf(words, sizeof(words), "%s", filename);
+    char* in = strstr(words, " in ");
+    if (in && (in[4] == '/' || in[4] == '~')) {
+        const char* dir = in + 4;
+        const char* home = getenv("HOME");
+        if (dir[0] == '~' && home) snprintf(scope, sizeof(scope), "%s%s", home, dir + 1);
+        else snprintf(scope, sizeof(scope), "%s", dir);
+        trim_whitespace_inplace(scope);
+        *in = '\0';
     }
-    
-    if (file_count > 0) {
-        snprintf(result, 2048, 
-                "File search for '%s': Found %d matching file(s) in your system. "
-                "Locations include your home directory and subdirectories.", 
-                filename, file_count);
+
+    char query[256];
+    clean_file_query(words, query, sizeof(query));
+    if (query[0] == '\0') {
+        snprintf(result, 2048, "Which file should I look for?");
+        return result;
+    }
+
+    /* Answered from the background index (or a bounded live scan while it builds) */
+    /* Sorted searches rank a wider candidate set by metadata */
+    int sort = detect_file_sort(words);
+    char* paths[FILE_SEARCH_CANDIDATES];
+    int found = file_index_find_under(scope[0] ? scope : NULL, query, paths,
+                                      sort >= 0 ? FILE_SEARCH_CANDIDATES : FILE_SEARCH_MAX_RESULTS);
+
+    if (found > 0) {
+        /* One batched statx round trip for every candidate */
+        file_meta meta[FILE_SEARCH_CANDIDATES];
+        file_meta_collect((const char* const*)paths, found, meta);
+        if (sort >= 0) file_meta_sort(paths, meta, found, (file_sort)sort);
+
+        const char* order = sort == FILE_SORT_NEWEST ? "Newest first" :
+                            sort == FILE_SORT_LARGEST ? "Largest first" :
+                            found == 1 ? "Best match" : "Best matches";
+        int len = snprintf(result, 2048, "File search for '%s': found %d matching file%s. %s: ",
+                           query, found, found == 1 ? "" : "s", order);
+        for (int i = 0; i < found; i++) {
+            if (i < FILE_SEARCH_MAX_RESULTS && len < 2048) {
+                len += snprintf(result + len, 2048 - (size_t)len, "%s%s", i > 0 ? ", " : "", paths[i]);
+                if (meta[i].ok && len < 2048) {
+                    char size[32], modified[32];
+                    struct tm tm_info;
+                    time_t mtime = (time_t)meta[i].mtime;
+                    format_file_size(meta[i].size, size, sizeof(size));
+                    localtime_r(&mtime, &tm_info);
+                    strftime(modified, sizeof(modified), "%Y-%m-%d %H:%M", &tm_info);
+                    len += snprintf(result + len, 2048 - (size_t)len, " (%s, modified %s)", size, modified);
+                }
+            }
+            free(paths[i]);
+        }
+        if (len < 2048) snprintf(result + len, 2048 - (size_t)len, ".");
     } else {
-        snprintf(result, 2048, 
-                "File search for '%s': No matching files found in your system directories.", 
-                filename);
+        snprintf(result, 2048,
+                "File search for '%s': No matching files found in your system directories.",
+                query);
     }
-    
+
     return result;
 }
 
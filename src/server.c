@@ -0,0 +1,539 @@
+#include "../include/server.h"
+#include "../include/session.h"
+#include "../include/event_loop.h"
+#include "../include/json.h"
+#include "../include/metrics.h"
+#include "../include/log.h"
+#include "../include/file_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#ifdef __linux__
+#include <linux/sched.h>
+#include <sys/syscall.h>
+#endif
+
+#define CLR_GREEN  "\033[1;32m"
+#define CLR_YELLOW "\033[1;33m"
+#define CLR_RED    "\033[1;31m"
+
+#define SERVE_LINE_MAX    4096
+#define SERVE_ID_MAX      128
+#define SERVE_MIN_WORKERS 2
+#define SERVE_MAX_WORKERS 16
+
+typedef struct ServeJob {
+    struct ServeJob* next;
+    char*            command;            /* NULL when the request was rejected */
+    char*            cwd;                /* client's working directory, NULL if it sent none */
+    const char*      error;              /* static error text for rejected requests */
+    char             id[SERVE_ID_MAX];   /* raw JSON id to echo back, "" if none */
+} ServeJob;
+
+typedef struct ServeClient {
+    int                 fd;
+    jarvis_session*     session;
+    char                line[SERVE_LINE_MAX];
+    size_t              line_len;
+    int                 overlong;        /* discarding the rest of an oversized line */
+    ServeJob*           head;            /* pending requests, FIFO */
+    ServeJob*           tail;
+    int                 active;          /* a worker is answering one of its requests */
+    int                 queued;          /* linked into the ready list */
+    int                 read_closed;     /* reactor saw EOF and dropped the fd */
+    struct ServeClient* next_ready;
+} ServeClient;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_ready_cond = PTHREAD_COND_INITIALIZER;
+static ServeClient*    g_ready_head = NULL;
+static ServeClient*    g_ready_tail = NULL;
+static int             g_stopping = 0;
+static int             g_listen_fd = -1;
+static int             g_signal_pipe[2] = { -1, -1 };
+static char            g_daemon_cwd[PATH_MAX];
+static pthread_mutex_t g_cwd_lock = PTHREAD_MUTEX_INITIALIZER;  /* workers without a private cwd */
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void server_default_socket_path(char* out, size_t out_size) {
+    if (!out || out_size == 0) return;
+
+    const char* explicit_path = getenv("JARVIS_SOCKET");
+    if (explicit_path && explicit_path[0] != '\0') {
+        snprintf(out, out_size, "%s", explicit_path);
+        return;
+    }
+
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && runtime_dir[0] != '\0') {
+        snprintf(out, out_size, "%s/jarvis.sock", runtime_dir);
+        return;
+    }
+
+    snprintf(out, out_size, "/tmp/jarvis-%u.sock", (unsigned)getuid());
+}
+
+/* ── Scheduling (call with g_lock held) ─────────────────────────────────── */
+
+static void schedule_client(ServeClient* client) {
+    if (client->active || client->queued || !client->head) return;
+    client->queued = 1;
+    client->next_ready = NULL;
+    if (g_ready_tail) g_ready_tail->next_ready = client;
+    else g_ready_head = client;
+    g_ready_tail = client;
+    pthread_cond_signal(&g_ready_cond);
+}
+
+static void free_client(ServeClient* client) {
+    while (client->head) {
+        ServeJob* job = client->head;
+        client->head = job->next;
+        free(job->command);
+        free(job->cwd);
+        free(job);
+    }
+    if (client->fd >= 0) close(client->fd);
+    session_destroy(client->session);
+    free(client);
+}
+
+/* ── Responses ──────────────────────────────────────────────────────────── */
+
+static int send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n > 0) {
+            data += n;
+            len -= (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, 5000) <= 0) return 0;
+            continue;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+static void write_id(FILE* out, const char* id) {
+    fputs("{\"id\":", out);
+    fputs(id[0] ? id : "null", out);
+}
+
+/* Moves the worker into the session's directory (the daemon's own until the
+   client names one); returns 0 if that directory is gone */
+static int enter_session_dir(jarvis_session* session, const char* cwd) {
+    if (cwd) snprintf(session->cwd, sizeof(session->cwd), "%s", cwd);
+    const char* dir = session->cwd[0] ? session->cwd : g_daemon_cwd;
+    return dir[0] == '\0' || chdir(dir) == 0;
+}
+
+/* Runs one request in the client's session and writes the JSON reply */
+static int answer_job(ServeClient* client, ServeJob* job) {
+    char* frame = NULL;
+    size_t frame_len = 0;
+    FILE* out = open_memstream(&frame, &frame_len);
+    if (!out) return 0;
+
+    int end_session = 0;
+    write_id(out, job->id);
+
+    if (job->command && !enter_session_dir(client->session, job->cwd)) {
+        job->error = "cannot enter the working directory";
+        free(job->command);
+        job->command = NULL;
+    }
+
+    if (!job->command) {
+        fputs(",\"error\":", out);
+        json_write_string(out, job->error);
+    } else {
+        command_result result = { "error", 0 };
+        long long start = monotonic_us();
+        char* response = session_respond(client->session, job->command, &result);
+        long long elapsed = monotonic_us() - start;
+        /* "change directory" moves this session only */
+        if (!getcwd(client->session->cwd, sizeof(client->session->cwd))) client->session->cwd[0] = '\0';
+        if (!response) {
+            result.intent = "error";
+            result.status = -1;
+        }
+
+        fputs(",\"command\":", out);
+        json_write_string(out, job->command);
+        fputs(",\"intent\":", out);
+        json_write_string(out, result.intent);
+        fputs(",\"response\":", out);
+        json_write_string(out, response);
+        fprintf(out, ",\"status\":%d,\"elapsed_us\":%lld", result.status, elapsed);
+        free(response);
+
+        end_session = strcmp(result.intent, "shutdown") == 0;
+    }
+    fputs("}\n", out);
+    fclose(out);
+
+    int ok = frame && send_all(client->fd, frame, frame_len);
+    free(frame);
+
+    /* "exit"/"quit" ends this client's session, not the daemon */
+    if (end_session) shutdown(client->fd, SHUT_RDWR);
+    return ok;
+}
+
+static void* worker_main(void* arg) {
+    (void)arg;
+
+    /* Handlers popen()/system() their own children: they need SIGCHLD */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+    /* Each worker chdirs into its client's directory: give it a cwd of its
+       own where the kernel allows, otherwise take turns with the process cwd */
+    int private_cwd = 0;
+#ifdef __linux__
+    private_cwd = syscall(SYS_unshare, CLONE_FS) == 0;
+#endif
+
+    pthread_mutex_lock(&g_lock);
+    while (1) {
+        while (!g_ready_head && !g_stopping)
+            pthread_cond_wait(&g_ready_cond, &g_lock);
+        if (g_stopping) break;
+
+        ServeClient* client = g_ready_head;
+        g_ready_head = client->next_ready;
+        if (!g_ready_head) g_ready_tail = NULL;
+        client->queued = 0;
+        client->active = 1;
+
+        ServeJob* job = client->head;
+        client->head = job->next;
+        if (!client->head) client->tail = NULL;
+        pthread_mutex_unlock(&g_lock);
+
+        if (!private_cwd) pthread_mutex_lock(&g_cwd_lock);
+        answer_job(client, job);
+        if (!private_cwd) pthread_mutex_unlock(&g_cwd_lock);
+        free(job->command);
+        free(job->cwd);
+        free(job);
+
+        pthread_mutex_lock(&g_lock);
+        client->active = 0;
+        if (client->head) {
+            schedule_client(client);  /* back of the line: keeps clients fair */
+        } else if (client->read_closed) {
+            free_client(client);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+/* ── Reactor side ───────────────────────────────────────────────────────── */
+
+static ServeJob* parse_request(const char* line) {
+    ServeJob* job = calloc(1, sizeof(ServeJob));
+    if (!job) return NULL;
+
+    /* Sessions keep commands in SESSION_TEXT_MAX buffers: refuse, rather than cut, longer ones */
+    if (line[0] != '{') {
+        if (strlen(line) > SESSION_COMMAND_MAX) job->error = "command too long";
+        else if (!(job->command = strdup(line))) job->error = "out of memory";
+        return job;
+    }
+
+    char command[SERVE_LINE_MAX];
+    char cwd[PATH_MAX];
+    int has_cwd = json_get_string(line, "cwd", cwd, sizeof(cwd));
+    json_get_raw(line, "id", job->id, sizeof(job->id));
+    if (!json_get_string(line, "command", command, sizeof(command))) {
+        job->error = "request needs a \"command\" string";
+    } else if (command[0] == '\0') {
+        job->error = "empty command";
+    } else if (strlen(command) > SESSION_COMMAND_MAX) {
+        job->error = "command too long";
+    } else if (has_cwd && cwd[0] != '/') {
+        job->error = "cwd must be an absolute path";
+    } else {
+        job->command = strdup(command);
+        job->cwd = has_cwd ? strdup(cwd) : NULL;
+        if (!job->command || (has_cwd && !job->cwd)) {
+            free(job->command);
+            free(job->cwd);
+            job->command = job->cwd = NULL;
+            job->error = "out of memory";
+        }
+    }
+    return job;
+}
+
+static void enqueue_line(ServeClient* client, char* line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t'))
+        line[--len] = '\0';
+    const char* text = line;
+    while (*text == ' ' || *text == '\t') text++;
+    if (*text == '\0') return;
+
+    ServeJob* job = parse_request(text);
+    if (!job) return;
+
+    pthread_mutex_lock(&g_lock);
+    if (client->tail) client->tail->next = job;
+    else client->head = job;
+    client->tail = job;
+    schedule_client(client);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void close_client_input(ServeClient* client) {
+    event_loop_remove_fd(client->fd);
+
+    pthread_mutex_lock(&g_lock);
+    client->read_closed = 1;
+    if (!client->active && !client->queued && !client->head) free_client(client);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void on_client_readable(int fd, void* userdata) {
+    ServeClient* client = userdata;
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    if (n <= 0) {
+        if (client->line_len > 0 && !client->overlong) {
+            client->line[client->line_len] = '\0';
+            enqueue_line(client, client->line);
+        }
+        client->line_len = 0;
+        close_client_input(client);
+        return;
+    }
+
+    for (ssize_t i = 0; i < n; i++) {
+        if (buf[i] == '\n') {
+            if (client->overlong) {
+                ServeJob* job = calloc(1, sizeof(ServeJob));
+                if (job) {
+                    job->error = "request too long";
+                    pthread_mutex_lock(&g_lock);
+                    if (client->tail) client->tail->next = job;
+                    else client->head = job;
+                    client->tail = job;
+                    schedule_client(client);
+                    pthread_mutex_unlock(&g_lock);
+                }
+            } else {
+                client->line[client->line_len] = '\0';
+                enqueue_line(client, client->line);
+            }
+            client->line_len = 0;
+            client->overlong = 0;
+        } else if (client->line_len + 1 < sizeof(client->line)) {
+            client->line[client->line_len++] = buf[i];
+        } else {
+            client->overlong = 1;
+        }
+    }
+}
+
+static void on_listen_readable(int fd, void* userdata) {
+    (void)userdata;
+    while (1) {
+        int client_fd = accept(fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR) continue;
+            return;  /* EAGAIN: drained */
+        }
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        fcntl(client_fd, F_SETFD, FD_CLOEXEC);
+
+        ServeClient* client = calloc(1, sizeof(ServeClient));
+        jarvis_session* session = client ? session_create() : NULL;
+        if (!session || !event_loop_add_fd(client_fd, on_client_readable, client)) {
+            static const char busy[] = "{\"id\":null,\"error\":\"server busy\"}\n";
+            send_all(client_fd, busy, sizeof(busy) - 1);
+            close(client_fd);
+            session_destroy(session);
+            free(client);
+            continue;
+        }
+        /* The daemon answers in text; clients that want speech do it themselves */
+        snprintf(session->tts_engine, sizeof(session->tts_engine), "none");
+        client->fd = client_fd;
+        client->session = session;
+    }
+}
+
+static void on_metrics_timer(int timer_id, void* userdata) {
+    (void)timer_id; (void)userdata;
+    metrics_write_prometheus(NULL);
+}
+
+static void on_stop_signal(int signo) {
+    int saved = errno;
+    unsigned char b = (unsigned char)signo;
+    ssize_t ignored = write(g_signal_pipe[1], &b, 1);
+    (void)ignored;
+    errno = saved;
+}
+
+static void on_signal_pipe(int fd, void* userdata) {
+    (void)userdata;
+    unsigned char b;
+    while (read(fd, &b, 1) > 0) {}
+    event_loop_stop();
+}
+
+static int open_listen_socket(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log_message(LOG_ERROR, CLR_RED, "[JARVIS]", "Socket path too long: %s", path);
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        if (errno != EADDRINUSE) {
+            close(fd);
+            return -1;
+        }
+
+        /* Stale socket file, or a live daemon? Only a live one accepts. */
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        int live = probe >= 0 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) {
+            log_message(LOG_ERROR, CLR_RED, "[JARVIS]", "Another daemon is already serving %s", path);
+            close(fd);
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    chmod(path, S_IRUSR | S_IWUSR);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (listen(fd, 64) != 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+static int worker_count(void) {
+    const char* env = getenv("JARVIS_SERVE_WORKERS");
+    long count = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < SERVE_MIN_WORKERS) count = SERVE_MIN_WORKERS;
+    if (count > SERVE_MAX_WORKERS) count = SERVE_MAX_WORKERS;
+    return (int)count;
+}
+
+int server_main(const char* socket_path) {
+    char path[256];
+    if (socket_path && socket_path[0] != '\0') snprintf(path, sizeof(path), "%s", socket_path);
+    else server_default_socket_path(path, sizeof(path));
+
+    if (!event_loop_init()) {
+        log_message(LOG_ERROR, CLR_RED, "[JARVIS]", "Could not initialise the event loop");
+        return EXIT_FAILURE;
+    }
+
+    g_listen_fd = open_listen_socket(path);
+    if (g_listen_fd < 0) {
+        log_message(LOG_ERROR, CLR_RED, "[JARVIS]", "Cannot listen on %s: %s", path, strerror(errno));
+        event_loop_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    if (pipe(g_signal_pipe) == 0) {
+        fcntl(g_signal_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(g_signal_pipe[1], F_SETFL, O_NONBLOCK);
+        event_loop_add_fd(g_signal_pipe[0], on_signal_pipe, NULL);
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_stop_signal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+
+    if (!getcwd(g_daemon_cwd, sizeof(g_daemon_cwd))) g_daemon_cwd[0] = '\0';
+    int workers = worker_count();
+    pthread_t threads[SERVE_MAX_WORKERS];
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, worker_main, NULL) == 0) started++;
+    }
+    if (started == 0) {
+        log_message(LOG_ERROR, CLR_RED, "[JARVIS]", "Could not start worker threads");
+        close(g_listen_fd);
+        unlink(path);
+        event_loop_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    event_loop_add_fd(g_listen_fd, on_listen_readable, NULL);
+    file_index_start();   /* crawl in the background so file searches hit the index */
+    int metrics_interval = metrics_export_interval_ms();
+    if (metrics_interval > 0) event_loop_add_timer(metrics_interval, 1, on_metrics_timer, NULL);
+    log_message(LOG_INFO, CLR_GREEN, "[JARVIS]", "Serving on %s with %d workers", path, started);
+
+    event_loop_run();
+
+    log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "Daemon stopping...");
+
+    event_loop_remove_fd(g_listen_fd);
+    close(g_listen_fd);
+    unlink(path);
+
+    pthread_mutex_lock(&g_lock);
+    g_stopping = 1;
+    pthread_cond_broadcast(&g_ready_cond);
+    pthread_mutex_unlock(&g_lock);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    event_loop_shutdown();
+    metrics_write_prometheus(NULL);
+    if (g_signal_pipe[0] >= 0) {
+        close(g_signal_pipe[0]);
+        close(g_signal_pipe[1]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "../include/session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static jarvis_session g_default_session;
+static _Thread_local jarvis_session* t_session = NULL;
+
+jarvis_session* session_create(void) {
+    return calloc(1, sizeof(jarvis_session));
+}
+
+void session_destroy(jarvis_session* session) {
+    if (!session || session == &g_default_session) return;
+    if (t_session == session) t_session = NULL;
+    free(session);
+}
+
+jarvis_session* session_current(void) {
+    return t_session ? t_session : &g_default_session;
+}
+
+void session_bind(jarvis_session* session) {
+    t_session = session;
+}
+
+void session_memory_push(jarvis_session* session, const char* command) {
+    if (!session || !command || command[0] == '\0') return;
+
+    if (session->memory_count == SESSION_MEMORY_SIZE) {
+        memmove(session->memory[0], session->memory[1],
+                sizeof(session->memory[0]) * (SESSION_MEMORY_SIZE - 1));
+        session->memory_count--;
+    }
+    snprintf(session->memory[session->memory_count], SESSION_TEXT_MAX, "%s", command);
+    session->memory_count++;
+}
+
+const char* session_memory_last(const jarvis_session* session) {
+    if (!session || session->memory_count == 0) return NULL;
+    return session->memory[session->memory_count - 1];
+}
+
+static char* history_response(const jarvis_session* session) {
+    size_t size = 64 + (size_t)SESSION_MEMORY_SIZE * (SESSION_TEXT_MAX + 8);
+    char* response = malloc(size);
+    if (!response) return NULL;
+
+    if (session->memory_count == 0) {
+        snprintf(response, size, "No previous commands in memory.");
+        return response;
+    }
+
+    size_t len = (size_t)snprintf(response, size, "Recent commands:");
+    for (int i = session->memory_count - 1; i >= 0 && len < size; i--) {
+        len += (size_t)snprintf(response + len, size - len, "\n[%d] %s",
+                                session->memory_count - i, session->memory[i]);
+    }
+    return response;
+}
+
+char* session_respond(jarvis_session* session, const char* command, command_result* result) {
+    if (!session || !command) return NULL;
+
+    char text[SESSION_TEXT_MAX];
+    char lower[SESSION_TEXT_MAX];
+    snprintf(text, sizeof(text), "%s", command);
+    size_t i = 0;
+    for (; text[i]; i++) lower[i] = (char)tolower((unsigned char)text[i]);
+    lower[i] = '\0';
+
+    if (strstr(lower, "repeat last") || strstr(lower, "last command")) {
+        const char* last = session_memory_last(session);
+        if (!last) {
+            if (result) {
+                result->intent = "recall";
+                result->status = 0;
+            }
+            char* response = malloc(64);
+            if (response) snprintf(response, 64, "No previous commands in memory.");
+            return response;
+        }
+        snprintf(text, sizeof(text), "%s", last);
+    } else if (strstr(lower, "what did i say") || strstr(lower, "history")) {
+        if (result) {
+            result->intent = "history";
+            result->status = 0;
+        }
+        return history_response(session);
+    }
+
+    session_memory_push(session, text);
+
+    jarvis_session* previous = t_session;
+    t_session = session;
+    char* response = process_command_ex(text, result);
+    t_session = previous;
+    return response;
+}
@@ -0,0 +1,1163 @@
+#include "../include/symbol_index.h"
+#include "../include/dir_walk.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SYMBOL_INDEX_DIR      ".jarvis"
+#define SYMBOL_INDEX_FILE     "symbols.idx"
+#define SYMBOL_INDEX_MAGIC    "JSYM 1"
+#define SYMBOL_MAX_FILE_BYTES (2 * 1024 * 1024)
+#define SYMBOL_MAX_FILES      50000
+#define SYMBOL_WALK_BUDGET_US (5LL * 1000 * 1000)
+#define SYMBOL_NAME_MAX       128
+#define SYMBOL_SCOPE_MAX      64
+
+/* Record kinds, also the persisted tags */
+#define KIND_FUNCTION    'f'
+#define KIND_DECLARATION 'p'
+#define KIND_STRUCT      's'
+#define KIND_UNION       'n'
+#define KIND_CLASS       'c'
+#define KIND_ENUM        'e'
+#define KIND_CONSTANT    'k'
+#define KIND_TYPEDEF     't'
+#define KIND_MACRO       'm'
+#define KIND_CALL        'C'
+#define KIND_REFERENCE   'u'
+
+typedef struct {
+    uint32_t name;         /* offset into the file's string pool */
+    uint32_t context;      /* offset into the pool, UINT32_MAX at file scope */
+    uint32_t line;
+    uint32_t hash;         /* of the name, to skip most strcmp calls */
+    char     kind;
+} SymbolRecord;
+
+typedef struct {
+    char*         path;    /* relative to the root */
+    long long     size;
+    long long     mtime;   /* nanoseconds */
+    uint64_t      hash;    /* FNV-1a of the content */
+    SymbolRecord* records;
+    size_t        count;
+    size_t        cap;
+    char*         strings;
+    size_t        strings_len;
+    size_t        strings_cap;
+    int           seen;
+} SourceFile;
+
+typedef struct {
+    char*       root;
+    SourceFile* files;     /* sorted by path */
+    size_t      count;
+    size_t      cap;
+} SymbolIndex;
+
+static SymbolIndex     g_index;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t hash_name(const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t hash_content(const char* data, size_t len) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* ── Per-file records ───────────────────────────────────────────────────── */
+
+static uint32_t file_add_string(SourceFile* file, const char* text, size_t len) {
+    if (file->strings_len + len + 1 > file->strings_cap) {
+        size_t cap = file->strings_cap ? file->strings_cap * 2 : 1024;
+        while (cap < file->strings_len + len + 1) cap *= 2;
+        char* grown = realloc(file->strings, cap);
+        if (!grown) return UINT32_MAX;
+        file->strings = grown;
+        file->strings_cap = cap;
+    }
+    uint32_t offset = (uint32_t)file->strings_len;
+    memcpy(file->strings + offset, text, len);
+    file->strings[offset + len] = '\0';
+    file->strings_len += len + 1;
+    return offset;
+}
+
+static void file_add_record(SourceFile* file, char kind, const char* name, size_t len, int line, const char* context) {
+    if (len == 0 || len >= SYMBOL_NAME_MAX) return;
+    if (file->count == file->cap) {
+        size_t cap = file->cap ? file->cap * 2 : 64;
+        SymbolRecord* grown = realloc(file->records, cap * sizeof(SymbolRecord));
+        if (!grown) return;
+        file->records = grown;
+        file->cap = cap;
+    }
+    uint32_t name_offset = file_add_string(file, name, len);
+    uint32_t context_offset = context && context[0] ? file_add_string(file, context, strlen(context)) : UINT32_MAX;
+    if (name_offset == UINT32_MAX) return;
+
+    SymbolRecord* record = &file->records[file->count++];
+    record->name = name_offset;
+    record->context = context_offset;
+    record->line = (uint32_t)line;
+    record->hash = hash_name(name, len);
+    record->kind = kind;
+}
+
+static void file_clear_records(SourceFile* file) {
+    free(file->records);
+    free(file->strings);
+    file->records = NULL;
+    file->strings = NULL;
+    file->count = file->cap = 0;
+    file->strings_len = file->strings_cap = 0;
+}
+
+/* ── Lexer (C, C++ and Python) ──────────────────────────────────────────── */
+
+typedef enum { TOKEN_END, TOKEN_IDENT, TOKEN_PUNCT, TOKEN_STRING, TOKEN_NUMBER } TokenType;
+
+typedef struct {
+    TokenType   type;
+    const char* start;
+    size_t      len;
+    int         line;
+    char        punct;      /* single character; ':' '::' is 'Q', '->' is 'A' */
+    int         indent;     /* column of the token when it starts a line, else -1 */
+} Token;
+
+typedef struct {
+    const char* p;
+    const char* end;
+    const char* line_begin;
+    int         line;
+    int         line_start; /* only whitespace so far on this line */
+    int         python;
+    SourceFile* file;
+} Lexer;
+
+static int is_ident_start(unsigned char c) {
+    return isalpha(c) || c == '_' || c >= 0x80;
+}
+
+static int is_ident_char(unsigned char c) {
+    return isalnum(c) || c == '_' || c >= 0x80;
+}
+
+static void lexer_newline(Lexer* lx) {
+    lx->line++;
+    lx->line_begin = lx->p;
+    lx->line_start = 1;
+}
+
+/* Skips a quoted literal starting at lx->p (python triple quotes included) */
+static void lexer_skip_string(Lexer* lx) {
+    char quote = *lx->p;
+    int triple = lx->python && lx->end - lx->p >= 3 && lx->p[1] == quote && lx->p[2] == quote;
+    lx->p += triple ? 3 : 1;
+    while (lx->p < lx->end) {
+        char c = *lx->p;
+        if (c == '\\' && lx->p + 1 < lx->end) {
+            lx->p++;
+            if (*lx->p == '\n') {
+                lx->p++;
+                lexer_newline(lx);
+            } else {
+                lx->p++;
+            }
+            continue;
+        }
+        if (c == '\n') {
+            if (!triple) return;   /* unterminated: resume on the next line */
+            lx->p++;
+            lexer_newline(lx);
+            lx->line_start = 0;
+            continue;
+        }
+        if (c == quote) {
+            if (!triple) {
+                lx->p++;
+                return;
+            }
+            if (lx->end - lx->p >= 3 && lx->p[1] == quote && lx->p[2] == quote) {
+                lx->p += 3;
+                return;
+            }
+        }
+        lx->p++;
+    }
+}
+
+/* Handles a preprocessor line: records #define names, skips everything else */
+static void lexer_directive(Lexer* lx) {
+    lx->p++;
+    while (lx->p < lx->end && (*lx->p == ' ' || *lx->p == '\t')) lx->p++;
+    const char* word = lx->p;
+    while (lx->p < lx->end && is_ident_char((unsigned char)*lx->p)) lx->p++;
+
+    if (lx->p - word == 6 && strncmp(word, "define", 6) == 0) {
+        while (lx->p < lx->end && (*lx->p == ' ' || *lx->p == '\t')) lx->p++;
+        const char* name = lx->p;
+        while (lx->p < lx->end && is_ident_char((unsigned char)*lx->p)) lx->p++;
+        file_add_record(lx->file, KIND_MACRO, name, (size_t)(lx->p - name), lx->line, NULL);
+    }
+
+    while (lx->p < lx->end && *lx->p != '\n') {
+        if (*lx->p == '\\' && lx->p + 1 < lx->end && lx->p[1] == '\n') {
+            lx->p += 2;
+            lexer_newline(lx);
+            continue;
+        }
+        if (*lx->p == '/' && lx->p + 1 < lx->end && lx->p[1] == '*') {
+            lx->p += 2;
+            while (lx->p + 1 < lx->end && !(lx->p[0] == '*' && lx->p[1] == '/')) {
+                if (*lx->p == '\n') {
+                    lx->p++;
+                    lexer_newline(lx);
+                } else {
+                    lx->p++;
+                }
+            }
+            lx->p += 2;
+            continue;
+        }
+        lx->p++;
+    }
+}
+
+static void lexer_next(Lexer* lx, Token* tok) {
+    for (;;) {
+        if (lx->p >= lx->end) {
+            tok->type = TOKEN_END;
+            return;
+        }
+        char c = *lx->p;
+        if (c == '\n') {
+            lx->p++;
+            lexer_newline(lx);
+            continue;
+        }
+        if (isspace((unsigned char)c)) {
+            lx->p++;
+            continue;
+        }
+        if (!lx->python && c == '/' && lx->p + 1 < lx->end && lx->p[1] == '/') {
+            while (lx->p < lx->end && *lx->p != '\n') lx->p++;
+            continue;
+        }
+        if (!lx->python && c == '/' && lx->p + 1 < lx->end && lx->p[1] == '*') {
+            lx->p += 2;
+            while (lx->p + 1 < lx->end && !(lx->p[0] == '*' && lx->p[1] == '/')) {
+                if (*lx->p == '\n') {
+                    lx->p++;
+                    int at_start = lx->line_start;
+                    lexer_newline(lx);
+                    lx->line_start = at_start;
+                } else {
+                    lx->p++;
+                }
+            }
+            lx->p = lx->p + 2 <= lx->end ? lx->p + 2 : lx->end;
+            continue;
+        }
+        if (lx->python && c == '#') {
+            while (lx->p < lx->end && *lx->p != '\n') lx->p++;
+            continue;
+        }
+        if (!lx->python && c == '#' && lx->line_start) {
+            lexer_directive(lx);
+            continue;
+        }
+        break;
+    }
+
+    tok->start = lx->p;
+    tok->line = lx->line;
+    tok->indent = lx->line_start ? (int)(lx->p - lx->line_begin) : -1;
+    tok->punct = 0;
+    lx->line_start = 0;
+
+    unsigned char c = (unsigned char)*lx->p;
+    if (c == '"' || c == '\'') {
+        lexer_skip_string(lx);
+        tok->type = TOKEN_STRING;
+    } else if (is_ident_start(c)) {
+        while (lx->p < lx->end && is_ident_char((unsigned char)*lx->p)) lx->p++;
+        size_t len = (size_t)(lx->p - tok->start);
+        /* Python string prefixes: r"..", b'..', f"..", rb"..." */
+        if (lx->python && len <= 2 && lx->p < lx->end && (*lx->p == '"' || *lx->p == '\'') &&
+            strspn(tok->start, "rRbBfFuU") >= len) {
+            lexer_skip_string(lx);
+            tok->type = TOKEN_STRING;
+        } else {
+            tok->type = TOKEN_IDENT;
+        }
+    } else if (isdigit(c)) {
+        while (lx->p < lx->end && (is_ident_char((unsigned char)*lx->p) || *lx->p == '.' || *lx->p == '\'')) lx->p++;
+        tok->type = TOKEN_NUMBER;
+    } else {
+        tok->type = TOKEN_PUNCT;
+        tok->punct = (char)c;
+        lx->p++;
+        if (c == ':' && lx->p < lx->end && *lx->p == ':') {
+            tok->punct = 'Q';
+            lx->p++;
+        } else if (c == '-' && lx->p < lx->end && *lx->p == '>') {
+            tok->punct = 'A';
+            lx->p++;
+        }
+    }
+    tok->len = (size_t)(lx->p - tok->start);
+}
+
+static int token_is(const Token* tok, const char* word) {
+    return tok->type == TOKEN_IDENT && strlen(word) == tok->len && strncmp(tok->start, word, tok->len) == 0;
+}
+
+static int word_in(const Token* tok, const char* const* words) {
+    for (; *words; words++) {
+        if (token_is(tok, *words)) return 1;
+    }
+    return 0;
+}
+
+static const char* const g_c_keywords[] = {
+    "if", "else", "for", "while", "do", "switch", "case", "default", "return", "break", "continue",
+    "goto", "sizeof", "typedef", "struct", "union", "enum", "class", "namespace", "static", "extern",
+    "const", "volatile", "inline", "register", "auto", "int", "char", "short", "long", "float",
+    "double", "void", "signed", "unsigned", "bool", "_Bool", "true", "false", "NULL", "nullptr",
+    "public", "private", "protected", "virtual", "override", "final", "template", "typename",
+    "using", "new", "delete", "this", "operator", "friend", "explicit", "constexpr", "noexcept",
+    "throw", "try", "catch", "static_assert", "_Static_assert", "decltype", "alignof", "alignas",
+    "_Alignas", "restrict", "__restrict", "__attribute__", "__declspec", "asm", "__asm__",
+    "mutable", "_Thread_local", "thread_local", "_Atomic", "__inline", "__inline__", NULL
+};
+
+/* ── C / C++ scanner ────────────────────────────────────────────────────── */
+
+typedef enum { SCOPE_TRANSPARENT, SCOPE_TYPE, SCOPE_FUNCTION, SCOPE_BLOCK } ScopeKind;
+
+/* State of the declaration being read at namespace or class scope */
+typedef struct {
+    int  is_typedef;
+    int  assigned;               /* '=' seen: what follows is an initializer */
+    int  paren_depth;
+    char typedef_name[SYMBOL_NAME_MAX];
+    int  typedef_line;
+    char type_kind;              /* after struct/union/class/enum */
+    char type_name[SYMBOL_NAME_MAX];
+    int  type_line;
+    int  base_clause;            /* class X : public Y */
+    int  opens_namespace;        /* namespace N / extern "C" */
+    int  after_extern;
+} Declaration;
+
+typedef struct {
+    ScopeKind   kind;
+    char        type_kind;       /* for SCOPE_TYPE */
+    char        function[SYMBOL_NAME_MAX];
+    Declaration resume;          /* the enclosing declaration, restored at '}' */
+} Scope;
+
+typedef struct {
+    Lexer       lx;
+    Token       tok;
+    Token       prev;
+    Scope       scopes[SYMBOL_SCOPE_MAX];
+    int         depth;
+    int         overflow;        /* braces nested beyond SYMBOL_SCOPE_MAX */
+    Declaration decl;
+    SourceFile* file;
+} CScanner;
+
+static void scanner_advance(CScanner* s) {
+    s->prev = s->tok;
+    lexer_next(&s->lx, &s->tok);
+}
+
+static int scanner_in_body(const CScanner* s) {
+    if (s->overflow) return 1;
+    return s->depth > 0 && (s->scopes[s->depth - 1].kind == SCOPE_FUNCTION || s->scopes[s->depth - 1].kind == SCOPE_BLOCK);
+}
+
+static const char* scanner_function(const CScanner* s) {
+    for (int i = s->depth - 1; i >= 0; i--) {
+        if (s->scopes[i].kind == SCOPE_FUNCTION) return s->scopes[i].function;
+    }
+    return NULL;
+}
+
+static void copy_token(char* out, const Token* tok) {
+    size_t len = tok->len < SYMBOL_NAME_MAX - 1 ? tok->len : SYMBOL_NAME_MAX - 1;
+    memcpy(out, tok->start, len);
+    out[len] = '\0';
+}
+
+static void scanner_record(CScanner* s, char kind, const Token* tok) {
+    file_add_record(s->file, kind, tok->start, tok->len, tok->line, scanner_function(s));
+}
+
+static void scanner_push(CScanner* s, ScopeKind kind, char type_kind, const char* function) {
+    if (s->depth >= SYMBOL_SCOPE_MAX) {
+        s->overflow++;
+        return;
+    }
+    Scope* scope = &s->scopes[s->depth++];
+    scope->kind = kind;
+    scope->type_kind = type_kind;
+    snprintf(scope->function, sizeof(scope->function), "%s", function ? function : "");
+    scope->resume = s->decl;
+    scope->resume.type_kind = 0;
+    scope->resume.opens_namespace = 0;
+    memset(&s->decl, 0, sizeof(s->decl));
+}
+
+static void scanner_pop(CScanner* s) {
+    if (s->overflow) {
+        s->overflow--;
+        return;
+    }
+    if (s->depth == 0) return;   /* unbalanced braces: stay at file scope */
+    Scope* scope = &s->scopes[--s->depth];
+    s->decl = scope->resume;
+    if (scope->kind == SCOPE_FUNCTION || scope->kind == SCOPE_TRANSPARENT) memset(&s->decl, 0, sizeof(s->decl));
+}
+
+static void scanner_end_declaration(CScanner* s) {
+    if (s->decl.is_typedef && s->decl.typedef_name[0]) {
+        file_add_record(s->file, KIND_TYPEDEF, s->decl.typedef_name, strlen(s->decl.typedef_name), s->decl.typedef_line, NULL);
+    }
+    if (s->decl.type_kind && s->decl.type_name[0]) {
+        file_add_record(s->file, KIND_REFERENCE, s->decl.type_name, strlen(s->decl.type_name), s->decl.type_line, NULL);
+    }
+    memset(&s->decl, 0, sizeof(s->decl));
+}
+
+/* Consumes a balanced (...) group, recording the identifiers inside it */
+static void scanner_skip_parens(CScanner* s) {
+    int depth = 0;
+    while (s->tok.type != TOKEN_END) {
+        if (s->tok.type == TOKEN_PUNCT && s->tok.punct == '(') depth++;
+        else if (s->tok.type == TOKEN_PUNCT && s->tok.punct == ')' && --depth <= 0) {
+            scanner_advance(s);
+            return;
+        } else if (s->tok.type == TOKEN_IDENT && !word_in(&s->tok, g_c_keywords)) {
+            scanner_record(s, KIND_REFERENCE, &s->tok);
+        }
+        scanner_advance(s);
+    }
+}
+
+/* NAME( at namespace or class scope: a definition if a body follows, a
+   declaration if ';' ',' or '=' does. s->tok is the '(' on entry and the
+   first unconsumed token on return. */
+static void scanner_function_candidate(CScanner* s, const Token* name) {
+    static const char* const qualifiers[] = {
+        "const", "volatile", "noexcept", "override", "final", "throw", "mutable", "__attribute__", NULL
+    };
+    scanner_skip_parens(s);
+
+    for (;;) {
+        if (word_in(&s->tok, qualifiers)) {
+            scanner_advance(s);
+            if (s->tok.type == TOKEN_PUNCT && s->tok.punct == '(') scanner_skip_parens(s);
+            continue;
+        }
+        if (s->tok.type == TOKEN_PUNCT && s->tok.punct == 'A') {
+            /* trailing return type */
+            scanner_advance(s);
+            while (s->tok.type == TOKEN_IDENT || (s->tok.type == TOKEN_PUNCT && strchr("Q<>*&,", s->tok.punct))) {
+                if (s->tok.type == TOKEN_IDENT && !word_in(&s->tok, g_c_keywords)) scanner_record(s, KIND_REFERENCE, &s->tok);
+                scanner_advance(s);
+            }
+            continue;
+        }
+        break;
+    }
+
+    char function[SYMBOL_NAME_MAX];
+    copy_token(function, name);
+    if (s->tok.type == TOKEN_PUNCT && (s->tok.punct == '{' || s->tok.punct == ':')) {
+        scanner_record(s, KIND_FUNCTION, name);
+        if (s->tok.punct == ':') {
+            /* Constructor initializer list: the body is the first '{' after ')' or '}' */
+            while (s->tok.type != TOKEN_END) {
+                scanner_advance(s);
+                if (s->tok.type == TOKEN_PUNCT && s->tok.punct == '(') scanner_skip_parens(s);
+                if (s->tok.type == TOKEN_PUNCT && s->tok.punct == '{' &&
+                    s->prev.type == TOKEN_PUNCT && (s->prev.punct == ')' || s->prev.punct == '}')) break;
+            }
+            if (s->tok.type == TOKEN_END) return;
+        }
+        scanner_push(s, SCOPE_FUNCTION, 0, function);
+        scanner_advance(s);
+        return;
+    }
+    if (s->tok.type == TOKEN_PUNCT && (s->tok.punct == ';' || s->tok.punct == ',' || s->tok.punct == '=')) {
+        scanner_record(s, KIND_DECLARATION, name);
+        if (s->tok.punct == '=') {
+            s->decl.assigned = 1;   /* = 0, = default, = delete */
+            scanner_advance(s);
+        }
+        return;
+    }
+    /* A macro invocation or something the scanner does not model */
+    scanner_record(s, KIND_CALL, name);
+}
+
+static void scan_c(SourceFile* file, const char* text, size_t size) {
+    CScanner* s = calloc(1, sizeof(CScanner));
+    if (!s) return;
+    s->file = file;
+    s->lx.p = s->lx.line_begin = text;
+    s->lx.end = text + size;
+    s->lx.line = 1;
+    s->lx.line_start = 1;
+    s->lx.file = file;
+    lexer_next(&s->lx, &s->tok);
+
+    while (s->tok.type != TOKEN_END) {
+        Token tok = s->tok;
+        int body = scanner_in_body(s);
+
+        if (tok.type == TOKEN_IDENT) {
+            if (word_in(&tok, g_c_keywords)) {
+                if (!body) {
+                    if (token_is(&tok, "typedef")) s->decl.is_typedef = 1;
+                    else if (token_is(&tok, "struct")) s->decl.type_kind = KIND_STRUCT;
+                    else if (token_is(&tok, "union")) s->decl.type_kind = KIND_UNION;
+                    else if (token_is(&tok, "class")) s->decl.type_kind = KIND_CLASS;
+                    else if (token_is(&tok, "enum")) s->decl.type_kind = KIND_ENUM;
+                    else if (token_is(&tok, "namespace")) s->decl.opens_namespace = 1;
+                    s->decl.after_extern = token_is(&tok, "extern");
+                }
+                scanner_advance(s);
+                continue;
+            }
+
+            /* Enumerators are definitions */
+            if (!body && s->depth > 0 && !s->overflow && s->scopes[s->depth - 1].kind == SCOPE_TYPE &&
+                s->scopes[s->depth - 1].type_kind == KIND_ENUM && s->decl.paren_depth == 0 &&
+                !s->decl.assigned && s->prev.type == TOKEN_PUNCT && (s->prev.punct == '{' || s->prev.punct == ',')) {
+                scanner_record(s, KIND_CONSTANT, &tok);
+                scanner_advance(s);
+                continue;
+            }
+
+            if (!body && s->decl.type_kind && !s->decl.type_name[0]) {
+                copy_token(s->decl.type_name, &tok);
+                s->decl.type_line = tok.line;
+                scanner_advance(s);
+                continue;
+            }
+            if (!body && s->decl.type_kind && !s->decl.base_clause) {
+                /* struct X var; -- X was a use, not a definition */
+                file_add_record(file, KIND_REFERENCE, s->decl.type_name, strlen(s->decl.type_name), s->decl.type_line, NULL);
+                s->decl.type_kind = 0;
+                s->decl.type_name[0] = '\0';
+            }
+            if (!body && s->decl.is_typedef &&
+                (s->decl.paren_depth == 0 || (s->prev.type == TOKEN_PUNCT && s->prev.punct == '*'))) {
+                copy_token(s->decl.typedef_name, &tok);
+                s->decl.typedef_line = tok.line;
+            }
+
+            scanner_advance(s);
+            int call = s->tok.type == TOKEN_PUNCT && s->tok.punct == '(';
+            if (call && !body && !s->decl.assigned && !s->decl.is_typedef && s->decl.paren_depth == 0) {
+                scanner_function_candidate(s, &tok);
+            } else {
+                scanner_record(s, call ? KIND_CALL : KIND_REFERENCE, &tok);
+            }
+            continue;
+        }
+
+        if (tok.type == TOKEN_STRING && s->decl.after_extern) {
+            s->decl.opens_namespace = 1;   /* extern "C" { */
+        }
+        if (tok.type == TOKEN_PUNCT) {
+            switch (tok.punct) {
+                case '(':
+                    s->decl.paren_depth++;
+                    break;
+                case ')':
+                    if (s->decl.paren_depth > 0) s->decl.paren_depth--;
+                    break;
+                case '=':
+                    if (s->decl.paren_depth == 0) s->decl.assigned = 1;
+                    break;
+                case ':':
+                    if (s->decl.type_kind && s->decl.type_name[0]) s->decl.base_clause = 1;
+                    break;
+                case '{':
+                    if (body) {
+                        scanner_push(s, SCOPE_BLOCK, 0, NULL);
+                    } else if (s->decl.type_kind) {
+                        char kind = s->decl.type_kind;
+                        if (s->decl.type_name[0]) {
+                            file_add_record(file, kind, s->decl.type_name, strlen(s->decl.type_name), s->decl.type_line, NULL);
+                        }
+                        s->decl.type_kind = 0;
+                        s->decl.type_name[0] = '\0';
+                        scanner_push(s, SCOPE_TYPE, kind, NULL);
+                    } else if (s->decl.opens_namespace) {
+                        scanner_push(s, SCOPE_TRANSPARENT, 0, NULL);
+                    } else {
+                        scanner_push(s, SCOPE_BLOCK, 0, NULL);   /* initializer */
+                    }
+                    break;
+                case '}':
+                    scanner_pop(s);
+                    break;
+                case ';':
+                    if (!body && s->decl.paren_depth == 0) scanner_end_declaration(s);
+                    break;
+                case ',':
+                    if (!body && s->depth > 0 && !s->overflow && s->scopes[s->depth - 1].kind == SCOPE_TYPE &&
+                        s->scopes[s->depth - 1].type_kind == KIND_ENUM) s->decl.assigned = 0;
+                    if (!body && s->decl.paren_depth == 0 && s->decl.is_typedef && s->decl.typedef_name[0]) {
+                        file_add_record(file, KIND_TYPEDEF, s->decl.typedef_name, strlen(s->decl.typedef_name),
+                                        s->decl.typedef_line, NULL);
+                        s->decl.typedef_name[0] = '\0';
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if (tok.punct != ';' && tok.punct != '{' && tok.punct != '}') s->decl.after_extern = 0;
+        }
+        scanner_advance(s);
+    }
+    free(s);
+}
+
+/* ── Python scanner ─────────────────────────────────────────────────────── */
+
+static const char* const g_python_keywords[] = {
+    "def", "class", "if", "elif", "else", "for", "while", "try", "except", "finally", "with", "as",
+    "return", "yield", "import", "from", "pass", "break", "continue", "lambda", "and", "or", "not",
+    "in", "is", "None", "True", "False", "global", "nonlocal", "assert", "del", "raise", "async",
+    "await", "self", "cls", NULL
+};
+
+static void scan_python(SourceFile* file, const char* text, size_t size) {
+    struct {
+        int  indent;
+        int  is_function;
+        char name[SYMBOL_NAME_MAX];
+    } blocks[SYMBOL_SCOPE_MAX];
+    int depth = 0;
+    int paren_depth = 0;
+    char define = 0;
+    int define_indent = 0;
+    int statement_indent = 0;
+
+    Lexer lx = { text, text + size, text, 1, 1, 1, file };
+    Token tok;
+    lexer_next(&lx, &tok);
+    while (tok.type != TOKEN_END) {
+        if (tok.indent >= 0 && paren_depth == 0) {
+            statement_indent = tok.indent;
+            while (depth > 0 && blocks[depth - 1].indent >= tok.indent) depth--;
+        }
+
+        const char* context = NULL;
+        for (int i = depth - 1; i >= 0 && !context; i--) {
+            if (blocks[i].is_function) context = blocks[i].name;
+        }
+
+        if (tok.type == TOKEN_IDENT) {
+            if (token_is(&tok, "def") || token_is(&tok, "class")) {
+                define = token_is(&tok, "def") ? KIND_FUNCTION : KIND_CLASS;
+                define_indent = statement_indent;
+                lexer_next(&lx, &tok);
+                continue;
+            }
+            if (word_in(&tok, g_python_keywords)) {
+                lexer_next(&lx, &tok);
+                continue;
+            }
+            if (define) {
+                file_add_record(file, define, tok.start, tok.len, tok.line, context);
+                if (depth < SYMBOL_SCOPE_MAX) {
+                    blocks[depth].indent = define_indent;
+                    blocks[depth].is_function = define == KIND_FUNCTION;
+                    copy_token(blocks[depth].name, &tok);
+                    depth++;
+                }
+                define = 0;
+                lexer_next(&lx, &tok);
+                continue;
+            }
+
+            Token name = tok;
+            lexer_next(&lx, &tok);
+            int call = tok.type == TOKEN_PUNCT && tok.punct == '(';
+            file_add_record(file, call ? KIND_CALL : KIND_REFERENCE, name.start, name.len, name.line, context);
+            continue;
+        }
+
+        if (tok.type == TOKEN_PUNCT) {
+            if (tok.punct == '(' || tok.punct == '[' || tok.punct == '{') paren_depth++;
+            else if ((tok.punct == ')' || tok.punct == ']' || tok.punct == '}') && paren_depth > 0) paren_depth--;
+        }
+        define = 0;
+        lexer_next(&lx, &tok);
+    }
+}
+
+/* ── Indexing a tree ────────────────────────────────────────────────────── */
+
+static int source_language(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot || strchr(dot, '/')) return 0;
+    static const char* const c_like[] = { ".c", ".h", ".cc", ".cpp", ".cxx", ".hpp", ".hh", ".hxx", ".ipp", NULL };
+    for (const char* const* ext = c_like; *ext; ext++) {
+        if (strcasecmp(dot, *ext) == 0) return 'c';
+    }
+    return strcmp(dot, ".py") == 0 ? 'p' : 0;
+}
+
+static void scan_file(SourceFile* file, const char* text, size_t size) {
+    file_clear_records(file);
+    if (source_language(file->path) == 'p') scan_python(file, text, size);
+    else scan_c(file, text, size);
+}
+
+typedef struct {
+    char*     path;
+    long long size;
+    long long mtime;
+} WalkedFile;
+
+typedef struct {
+    size_t          root_len;
+    WalkedFile*     files;
+    size_t          count;
+    size_t          cap;
+    pthread_mutex_t lock;
+} WalkResult;
+
+static int collect_source(const char* path, size_t name_offset, int worker, void* ctx) {
+    (void)worker;
+    WalkResult* result = ctx;
+    if (!source_language(path + name_offset)) return 1;
+
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > SYMBOL_MAX_FILE_BYTES) return 1;
+    const char* relative = path + result->root_len;
+    if (*relative == '/') relative++;
+    if (strpbrk(relative, "\t\n")) return 1;   /* not representable in the index file */
+
+    pthread_mutex_lock(&result->lock);
+    int keep_going = result->count < SYMBOL_MAX_FILES;
+    if (keep_going && result->count == result->cap) {
+        size_t cap = result->cap ? result->cap * 2 : 256;
+        WalkedFile* grown = realloc(result->files, cap * sizeof(WalkedFile));
+        if (grown) {
+            result->files = grown;
+            result->cap = cap;
+        }
+    }
+    if (keep_going && result->count < result->cap) {
+        WalkedFile* file = &result->files[result->count];
+        file->path = strdup(relative);
+        file->size = (long long)st.st_size;
+        file->mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        if (file->path) result->count++;
+    }
+    pthread_mutex_unlock(&result->lock);
+    return keep_going;
+}
+
+static int compare_files(const void* a, const void* b) {
+    return strcmp(((const SourceFile*)a)->path, ((const SourceFile*)b)->path);
+}
+
+/* Binary search over the first `sorted` files */
+static SourceFile* index_find(const char* path, size_t sorted) {
+    size_t lo = 0, hi = sorted;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(g_index.files[mid].path, path);
+        if (cmp == 0) return &g_index.files[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+static SourceFile* index_append(const char* path) {
+    if (g_index.count == g_index.cap) {
+        size_t cap = g_index.cap ? g_index.cap * 2 : 256;
+        SourceFile* grown = realloc(g_index.files, cap * sizeof(SourceFile));
+        if (!grown) return NULL;
+        g_index.files = grown;
+        g_index.cap = cap;
+    }
+    SourceFile* file = &g_index.files[g_index.count];
+    memset(file, 0, sizeof(*file));
+    file->path = strdup(path);
+    if (!file->path) return NULL;
+    g_index.count++;
+    return file;
+}
+
+static void index_reset(void) {
+    for (size_t i = 0; i < g_index.count; i++) {
+        file_clear_records(&g_index.files[i]);
+        free(g_index.files[i].path);
+    }
+    free(g_index.files);
+    free(g_index.root);
+    memset(&g_index, 0, sizeof(g_index));
+}
+
+static void index_file_path(char* out, size_t out_size) {
+    snprintf(out, out_size, "%s/%s/%s", g_index.root, SYMBOL_INDEX_DIR, SYMBOL_INDEX_FILE);
+}
+
+/* Reads <root>/.jarvis/symbols.idx:
+     JSYM 1
+     F <size> <mtime> <hash> <records> <path>        (tab separated)
+     <kind> <line> <name> <context>                  (one line per record) */
+static void index_load(void) {
+    char path[PATH_MAX];
+    index_file_path(path, sizeof(path));
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t len = getline(&line, &line_cap, in);
+    if (len < 0 || strncmp(line, SYMBOL_INDEX_MAGIC, strlen(SYMBOL_INDEX_MAGIC)) != 0) {
+        free(line);
+        fclose(in);
+        return;
+    }
+
+    SourceFile* current = NULL;
+    while ((len = getline(&line, &line_cap, in)) > 0) {
+        if (line[len - 1] == '\n') line[--len] = '\0';
+        if (len < 2 || line[1] != '\t') continue;
+
+        char* p = line + 2;
+        if (line[0] == 'F') {
+            long long size = strtoll(p, &p, 10);
+            long long mtime = strtoll(p, &p, 10);
+            unsigned long long hash = strtoull(p, &p, 16);
+            strtoull(p, &p, 10);   /* record count, informational */
+            if (*p != '\t') {
+                current = NULL;
+                continue;
+            }
+            current = index_append(p + 1);
+            if (!current) break;
+            current->size = size;
+            current->mtime = mtime;
+            current->hash = (uint64_t)hash;
+            continue;
+        }
+
+        long record_line = strtol(p, &p, 10);
+        if (!current || *p != '\t') continue;
+        char* name = p + 1;
+        char* context = strchr(name, '\t');
+        if (context) *context++ = '\0';
+        file_add_record(current, line[0], name, strlen(name), (int)record_line, context);
+    }
+    free(line);
+    fclose(in);
+    qsort(g_index.files, g_index.count, sizeof(SourceFile), compare_files);
+}
+
+static void index_save(void) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/%s", g_index.root, SYMBOL_INDEX_DIR);
+    mkdir(dir, 0755);
+
+    char path[PATH_MAX], tmp_path[PATH_MAX + 32];
+    index_file_path(path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) return;
+
+    fprintf(out, "%s\n", SYMBOL_INDEX_MAGIC);
+    for (size_t i = 0; i < g_index.count; i++) {
+        const SourceFile* file = &g_index.files[i];
+        fprintf(out, "F\t%lld\t%lld\t%016llx\t%zu\t%s\n", file->size, file->mtime,
+                (unsigned long long)file->hash, file->count, file->path);
+        for (size_t r = 0; r < file->count; r++) {
+            const SymbolRecord* record = &file->records[r];
+            fprintf(out, "%c\t%u\t%s\t%s\n", record->kind, record->line, file->strings + record->name,
+                    record->context == UINT32_MAX ? "" : file->strings + record->context);
+        }
+    }
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) unlink(tmp_path);
+}
+
+/* Re-reads changed files; caller holds g_lock */
+static int index_refresh(const char* root, symbol_index_stats* stats) {
+    char resolved[PATH_MAX];
+    if (!realpath(root, resolved)) return 0;
+    if (!g_index.root || strcmp(g_index.root, resolved) != 0) {
+        index_reset();
+        g_index.root = strdup(resolved);
+        if (!g_index.root) return 0;
+        index_load();
+    }
+
+    WalkResult walked = { strlen(resolved), NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+    static const char* const skip_dirs[] = { "node_modules", "__pycache__", "venv", NULL };
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    dir_walk_options options = { 0 };
+    options.visit_file = collect_source;
+    options.ctx = &walked;
+    options.skip_dirs = skip_dirs;
+    options.deadline_us = (long long)now.tv_sec * 1000000LL + now.tv_nsec / 1000 + SYMBOL_WALK_BUDGET_US;
+    const char* roots[1] = { resolved };
+    int complete = dir_walk(roots, 1, &options) && walked.count < SYMBOL_MAX_FILES;
+
+    for (size_t i = 0; i < g_index.count; i++) g_index.files[i].seen = !complete;
+
+    int dirty = 0, rescanned = 0;
+    size_t sorted = g_index.count;   /* new files are appended past this point */
+    for (size_t i = 0; i < walked.count; i++) {
+        WalkedFile* seen = &walked.files[i];
+        SourceFile* file = index_find(seen->path, sorted);
+        if (file && file->size == seen->size && file->mtime == seen->mtime) {
+            file->seen = 1;
+            continue;
+        }
+
+        char full[PATH_MAX];
+        snprintf(full, sizeof(full), "%s/%s", resolved, seen->path);
+        FILE* in = fopen(full, "rb");
+        char* text = in ? malloc((size_t)seen->size + 1) : NULL;
+        size_t size = text ? fread(text, 1, (size_t)seen->size, in) : 0;
+        if (in) fclose(in);
+        if (!text) continue;
+
+        uint64_t hash = hash_content(text, size);
+        if (!file) file = index_append(seen->path);
+        if (file) {
+            file->seen = 1;
+            file->size = seen->size;
+            file->mtime = seen->mtime;
+            if (file->hash != hash || file->count == 0) {
+                file->hash = hash;
+                scan_file(file, text, size);
+                rescanned++;
+            }
+            dirty = 1;
+        }
+        free(text);
+    }
+
+    /* Drop deleted files */
+    size_t kept = 0;
+    for (size_t i = 0; i < g_index.count; i++) {
+        if (!g_index.files[i].seen) {
+            file_clear_records(&g_index.files[i]);
+            free(g_index.files[i].path);
+            dirty = 1;
+            continue;
+        }
+        g_index.files[kept++] = g_index.files[i];
+    }
+    g_index.count = kept;
+    if (dirty) {
+        qsort(g_index.files, g_index.count, sizeof(SourceFile), compare_files);
+        index_save();
+    }
+
+    for (size_t i = 0; i < walked.count; i++) free(walked.files[i].path);
+    free(walked.files);
+
+    if (stats) {
+        stats->files = (int)g_index.count;
+        stats->rescanned = rescanned;
+        stats->symbols = 0;
+        for (size_t i = 0; i < g_index.count; i++) stats->symbols += (int)g_index.files[i].count;
+    }
+    return 1;
+}
+
+int symbol_index_update(const char* root, symbol_index_stats* stats) {
+    if (!root) return 0;
+    long long start = trace_begin();
+    pthread_mutex_lock(&g_lock);
+    int ok = index_refresh(root, stats);
+    pthread_mutex_unlock(&g_lock);
+    trace_end("symbol_index.update", start, root);
+    return ok;
+}
+
+/* ── Queries ────────────────────────────────────────────────────────────── */
+
+typedef struct {
+    const SourceFile*   file;
+    const SymbolRecord* record;
+    int                 rank;
+} Match;
+
+static const char* kind_name(char kind) {
+    switch (kind) {
+        case KIND_FUNCTION:    return "function";
+        case KIND_DECLARATION: return "declaration";
+        case KIND_STRUCT:      return "struct";
+        case KIND_UNION:       return "union";
+        case KIND_CLASS:       return "class";
+        case KIND_ENUM:        return "enum";
+        case KIND_CONSTANT:    return "constant";
+        case KIND_TYPEDEF:     return "typedef";
+        case KIND_MACRO:       return "macro";
+        case KIND_CALL:        return "call";
+        default:               return "reference";
+    }
+}
+
+static int is_definition(char kind) {
+    return kind != KIND_DECLARATION && kind != KIND_CALL && kind != KIND_REFERENCE;
+}
+
+static int match_rank(char kind, symbol_query query) {
+    if (query == SYMBOL_QUERY_CALLERS) return kind == KIND_CALL ? 0 : -1;
+    if (is_definition(kind)) return 0;
+    if (kind == KIND_DECLARATION) return 1;
+    return query == SYMBOL_QUERY_REFERENCES ? 2 : -1;
+}
+
+static int compare_matches(const void* a, const void* b) {
+    const Match* x = a;
+    const Match* y = b;
+    if (x->rank != y->rank) return x->rank - y->rank;
+    int cmp = strcmp(x->file->path, y->file->path);
+    if (cmp != 0) return cmp;
+    return x->record->line < y->record->line ? -1 : x->record->line > y->record->line;
+}
+
+static void read_source_line(const char* root, const char* path, int line, char* out, size_t out_size) {
+    out[0] = '\0';
+    char full[PATH_MAX];
+    snprintf(full, sizeof(full), "%s/%s", root, path);
+    FILE* in = fopen(full, "r");
+    if (!in) return;
+
+    char buffer[1024];
+    int current = 1;
+    while (fgets(buffer, sizeof(buffer), in) != NULL) {
+        if (current == line) {
+            char* start = buffer;
+            while (*start && isspace((unsigned char)*start)) start++;
+            size_t len = strlen(start);
+            while (len > 0 && isspace((unsigned char)start[len - 1])) start[--len] = '\0';
+            snprintf(out, out_size, "%s", start);
+            break;
+        }
+        if (strchr(buffer, '\n')) current++;
+    }
+    fclose(in);
+}
+
+int symbol_index_lookup(const char* root, const char* name, symbol_query query,
+                        symbol_location* out, int max, int* total) {
+    if (total) *total = 0;
+    if (!root || !name || !name[0] || !out || max <= 0) return 0;
+
+    long long start = trace_begin();
+    pthread_mutex_lock(&g_lock);
+    if (!index_refresh(root, NULL)) {
+        pthread_mutex_unlock(&g_lock);
+        trace_end("symbol_index.lookup", start, name);
+        return 0;
+    }
+
+    size_t name_len = strlen(name);
+    uint32_t hash = hash_name(name, name_len);
+    Match* matches = NULL;
+    size_t count = 0, cap = 0;
+    for (size_t i = 0; i < g_index.count; i++) {
+        const SourceFile* file = &g_index.files[i];
+        for (size_t r = 0; r < file->count; r++) {
+            const SymbolRecord* record = &file->records[r];
+            if (record->hash != hash || strcmp(file->strings + record->name, name) != 0) continue;
+            int rank = match_rank(record->kind, query);
+            if (rank < 0) continue;
+            if (count == cap) {
+                cap = cap ? cap * 2 : 32;
+                Match* grown = realloc(matches, cap * sizeof(Match));
+                if (!grown) break;
+                matches = grown;
+            }
+            matches[count].file = file;
+            matches[count].record = record;
+            matches[count].rank = rank;
+            count++;
+        }
+    }
+
+    /* Definitions only fall back to declarations when nothing defines the name */
+    if (query == SYMBOL_QUERY_DEFINITIONS) {
+        int defined = 0;
+        for (size_t i = 0; i < count && !defined; i++) defined = matches[i].rank == 0;
+        if (defined) {
+            size_t kept = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (matches[i].rank == 0) matches[kept++] = matches[i];
+            }
+            count = kept;
+        }
+    }
+    if (count > 1) {
+        /* One entry per line: `x = x + 1` is a single reference */
+        qsort(matches, count, sizeof(Match), compare_matches);
+        size_t kept = 1;
+        for (size_t i = 1; i < count; i++) {
+            const Match* last = &matches[kept - 1];
+            if (matches[i].file == last->file && matches[i].record->line == last->record->line && matches[i].rank == last->rank) continue;
+            matches[kept++] = matches[i];
+        }
+        count = kept;
+    }
+
+    int stored = 0;
+    for (size_t i = 0; i < count && stored < max; i++) {
+        const Match* match = &matches[i];
+        symbol_location* location = &out[stored++];
+        snprintf(location->path, sizeof(location->path), "%s", match->file->path);
+        location->line = (int)match->record->line;
+        snprintf(location->kind, sizeof(location->kind), "%s", kind_name(match->record->kind));
+        snprintf(location->context, sizeof(location->context), "%s",
+                 match->record->context == UINT32_MAX ? "" : match->file->strings + match->record->context);
+        read_source_line(g_index.root, location->path, location->line, location->text, sizeof(location->text));
+    }
+    if (total) *total = (int)count;
+    free(matches);
+    pthread_mutex_unlock(&g_lock);
+    trace_end("symbol_index.lookup", start, name);
+    return stored;
+}
@@ -0,0 +1,164 @@
+#include "../include/trace.h"
+#include "../include/json.h"
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_RING_SIZE  2048   /* events kept per thread (power of two) */
+#define TRACE_DETAIL_MAX 64
+
+typedef struct {
+    const char* name;
+    long long   ts_us;
+    long long   dur_us;
+    char        detail[TRACE_DETAIL_MAX];
+} TraceEvent;
+
+/* One writer (the owning thread); readers only run in trace_dump(), which
+   drops any slot the writer reached while it was being copied */
+typedef struct TraceRing {
+    TraceEvent        events[TRACE_RING_SIZE];
+    atomic_ulong      head;       /* total events ever written */
+    int               tid;
+    struct TraceRing* next;
+} TraceRing;
+
+static atomic_int                 g_trace_on = 0;
+static _Atomic(TraceRing*)        g_rings = NULL;   /* lock-free registry (push only) */
+static atomic_int                 g_next_tid = 1;
+static _Thread_local TraceRing*   t_ring = NULL;
+static char                       g_trace_path[512] = "";
+static int                        g_initialized = 0;
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void dump_at_exit(void) {
+    if (atomic_load(&g_trace_on) && g_trace_path[0] != '\0') {
+        int count = trace_dump(NULL);
+        if (count >= 0) fprintf(stderr, "  [JARVIS] Trace written to %s (%d events)\n", g_trace_path, count);
+    }
+}
+
+void trace_init(void) {
+    if (g_initialized) return;
+    g_initialized = 1;
+
+    const char* path = getenv("JARVIS_TRACE");
+    if (!path || path[0] == '\0') return;
+
+    snprintf(g_trace_path, sizeof(g_trace_path), "%s", path);
+    atomic_store(&g_trace_on, 1);
+    atexit(dump_at_exit);
+}
+
+int trace_enabled(void) {
+    return atomic_load_explicit(&g_trace_on, memory_order_relaxed);
+}
+
+static TraceRing* thread_ring(void) {
+    if (t_ring) return t_ring;
+
+    TraceRing* ring = calloc(1, sizeof(TraceRing));
+    if (!ring) return NULL;
+    ring->tid = atomic_fetch_add(&g_next_tid, 1);
+
+    TraceRing* head = atomic_load(&g_rings);
+    do {
+        ring->next = head;
+    } while (!atomic_compare_exchange_weak(&g_rings, &head, ring));
+
+    t_ring = ring;
+    return ring;
+}
+
+const char* trace_output_path(void) {
+    return g_trace_path;
+}
+
+long long trace_begin(void) {
+    return monotonic_us();
+}
+
+long long trace_end(const char* name, long long start, const char* detail) {
+    if (start == 0) return 0;
+
+    long long now = monotonic_us();
+    metrics_observe_stage(name, now - start);
+    if (!atomic_load_explicit(&g_trace_on, memory_order_relaxed)) return now - start;
+
+    TraceRing* ring = thread_ring();
+    if (!ring) return now - start;
+
+    unsigned long slot = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    TraceEvent* ev = &ring->events[slot & (TRACE_RING_SIZE - 1)];
+    atomic_thread_fence(memory_order_release);   /* head = slot is visible before the slot changes */
+    ev->name = name;
+    ev->ts_us = start;
+    ev->dur_us = now - start;
+    if (detail) snprintf(ev->detail, sizeof(ev->detail), "%s", detail);
+    else ev->detail[0] = '\0';
+    atomic_store_explicit(&ring->head, slot + 1, memory_order_release);
+
+    return now - start;
+}
+
+int trace_dump(const char* path) {
+    if (!path) path = g_trace_path;
+    if (!path || path[0] == '\0') return -1;
+
+    char tmp_path[600];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) return -1;
+
+    int pid = (int)getpid();
+    int count = 0;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+
+    for (TraceRing* ring = atomic_load(&g_rings); ring; ring = ring->next) {
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                     "\"args\":{\"name\":\"thread-%d\"}}",
+                count > 0 ? "," : "", pid, ring->tid, ring->tid);
+        count++;
+
+        unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned long first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (unsigned long i = first; i < head; i++) {
+            /* Copy the slot, then skip it if the owner may have started event
+               i + TRACE_RING_SIZE, which reuses it: the copy may be torn.
+               This thread's own ring cannot change under it. */
+            TraceEvent ev = ring->events[i & (TRACE_RING_SIZE - 1)];
+            atomic_thread_fence(memory_order_acquire);
+            if (ring != t_ring &&
+                atomic_load_explicit(&ring->head, memory_order_relaxed) >= i + TRACE_RING_SIZE) continue;
+            ev.detail[sizeof(ev.detail) - 1] = '\0';
+
+            fputs(",\n{\"name\":", out);
+            json_write_string(out, ev.name);
+            fprintf(out, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d",
+                    ev.ts_us, ev.dur_us, pid, ring->tid);
+            if (ev.detail[0] != '\0') {
+                fputs(",\"args\":{\"detail\":", out);
+                json_write_string(out, ev.detail);
+                fputc('}', out);
+            }
+            fputc('}', out);
+            count++;
+        }
+    }
+
+    fputs("\n]}\n", out);
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return count;
+}
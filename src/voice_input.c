@@ -1,4 +1,7 @@
 #include "../include/voice_input.h"
+#include "../include/voice_output.h"
+#include "../include/trace.h"
+#include "../include/log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,10 +20,19 @@ static int env_flag_enabled(const char* value) {
            strcmp(value, "YES") == 0 || strcmp(value, "on") == 0;
 }
 
+static int g_recognizer_available = -1; /* -1 = not yet probed */
+
+int voice_input_probe(void) {
+    if (g_recognizer_available == -1) {
+        g_recognizer_available = command_exists("python3") &&
+                                 access("src/speech_recognizer.py", R_OK) == 0;
+    }
+    return g_recognizer_available;
+}
+
 /* Try one speech recognition attempt; returns heap string or NULL */
 static char* try_speech(void) {
-    printf(CLR_GREEN "  🎤  Listening...\n" CLR_RESET);
-    fflush(stdout);
+    log_message(LOG_INFO, CLR_GREEN, "🎤", "Listening...");
 
     FILE* pipe = popen("python3 src/speech_recognizer.py 2>/dev/null", "r");
     if (!pipe) return NULL;
@@ -39,52 +51,66 @@ static char* try_speech(void) {
     return result;
 }
 
-char* capture_voice_input(void) {
+void voice_input_identify_speaker(char* speaker, size_t speaker_size) {
+    if (!speaker || speaker_size == 0) return;
+    snprintf(speaker, speaker_size, "UNKNOWN");
+
+    if (env_flag_enabled(getenv("JARVIS_VERIFY_SPEAKER"))) {
+        FILE* spipe = popen("python3 src/speaker_recognizer.py 2>/dev/null", "r");
+        if (spipe) {
+            if (fgets(speaker, (int)speaker_size, spipe) != NULL)
+                speaker[strcspn(speaker, "\n")] = '\0';
+            pclose(spipe);
+        }
+    }
+    if (speaker[0] == '\0') snprintf(speaker, speaker_size, "UNKNOWN");
+}
+
+static char* traced_speech(void) {
+    long long span = trace_begin();
+    char* text = try_speech();
+    trace_end("recognize", span, text);
+    return text;
+}
+
+static char* capture_input_once(void) {
     char* combined = (char*)malloc(768);
     if (!combined) return NULL;
     combined[0] = '\0';
 
-    /* ── Attempt 1 ── */
-    char* text = try_speech();
+    /* ── Attempt 1 (skipped when the recognizer cannot run at all) ── */
+    char* text = voice_input_probe() ? traced_speech() : NULL;
 
     /* ── Retry once on timeout/empty ── */
-    if (!text) {
-        printf(CLR_YELLOW "  [JARVIS] No speech detected. Retrying...\n" CLR_RESET);
-        text = try_speech();
+    if (!text && voice_input_probe()) {
+        log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "No speech detected. Retrying...");
+        text = traced_speech();
     }
 
     if (text) {
-        printf(CLR_CYAN "  🧠  Processing...\n" CLR_RESET);
-
-        char speaker[128] = "UNKNOWN";
-        if (env_flag_enabled(getenv("JARVIS_VERIFY_SPEAKER"))) {
-            FILE* spipe = popen("python3 src/speaker_recognizer.py 2>/dev/null", "r");
-            if (spipe) {
-                if (fgets(speaker, sizeof(speaker), spipe) != NULL)
-                    speaker[strcspn(speaker, "\n")] = '\0';
-                pclose(spipe);
-            }
-        }
-        if (speaker[0] == '\0') strcpy(speaker, "UNKNOWN");
+        log_message(LOG_INFO, CLR_CYAN, "🧠", "Processing...");
+
+        char speaker[128];
+        long long span = trace_begin();
+        voice_input_identify_speaker(speaker, sizeof(speaker));
+        trace_end("speaker_verify", span, speaker);
 
         snprintf(combined, 768, "%s|%s", speaker, text);
 
         if (strcmp(speaker, "UNKNOWN") != 0)
-            printf(CLR_GREEN "  💬  (%s) You said: \"%s\"\n" CLR_RESET, speaker, text);
+            log_message(LOG_INFO, CLR_GREEN, "💬", "(%s) You said: \"%s\"", speaker, text);
         else
-            printf(CLR_GREEN "  💬  You said: \"%s\"\n" CLR_RESET, text);
+            log_message(LOG_INFO, CLR_GREEN, "💬", "You said: \"%s\"", text);
 
         free(text);
         return combined;
     }
 
     /* ── Keyboard fallback ── */
-    printf(CLR_YELLOW
-           "  [JARVIS] Microphone unavailable or no speech detected.\n"
-           "           Switching to keyboard input.\n"
-           CLR_RESET);
-    printf(CLR_CYAN "  ❯ Type your command: " CLR_RESET);
-    fflush(stdout);
+    log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]",
+                "Microphone unavailable or no speech detected. Switching to keyboard input.");
+    log_console(CLR_CYAN "  ❯ Type your command: " CLR_RESET);
+    log_flush();
 
     char kb_buf[512] = "";
     if (fgets(kb_buf, sizeof(kb_buf), stdin) != NULL) {
@@ -99,9 +125,16 @@ char* capture_voice_input(void) {
     return NULL;
 }
 
+char* capture_voice_input(void) {
+    long long span = trace_begin();
+    char* input = capture_input_once();
+    trace_end("capture_voice_input", span, NULL);
+    return input;
+}
+
 int record_audio(const char* filename) {
     (void)filename;
-    printf(CLR_CYAN "  [JARVIS] Voice input ready.\n" CLR_RESET);
+    log_message(LOG_INFO, CLR_CYAN, "[JARVIS]", "Voice input ready.");
     return 1;
 }
 
@@ -1,11 +1,15 @@
 #include "../include/voice_output.h"
+#include "../include/event_loop.h"
+#include "../include/session.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include "../include/log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 
-#define CLR_RESET  "\033[0m"
 #define CLR_YELLOW "\033[1;33m"
 #define CLR_GREEN  "\033[1;32m"
 
@@ -13,20 +17,34 @@ static int run_process_wait(const char* program, char* const argv[]) {
     pid_t pid = fork();
     if (pid < 0) return 0;
     if (pid == 0) { execvp(program, argv); _exit(127); }
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
     int status = 0;
     if (waitpid(pid, &status, 0) < 0) return 0;
     return WIFEXITED(status) && WEXITSTATUS(status) == 0;
 }
 
-/* Check whether a command exists on PATH */
-static int command_exists(const char* cmd) {
-    char check[128];
-    snprintf(check, sizeof(check), "command -v %s >/dev/null 2>&1", cmd);
-    return system(check) == 0;
+/* Scans PATH directly, no shell */
+int command_exists(const char* cmd) {
+    const char* path = getenv("PATH");
+    if (!cmd || !path) return 0;
+
+    char candidate[1024];
+    const char* dir = path;
+    while (*dir) {
+        size_t len = strcspn(dir, ":");
+        if (len > 0 && len + strlen(cmd) + 2 < sizeof(candidate)) {
+            snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)len, dir, cmd);
+            if (access(candidate, X_OK) == 0) return 1;
+        }
+        dir += len;
+        if (*dir == ':') dir++;
+    }
+    return 0;
 }
 
 static int g_tts_available = -1;   /* -1 = not yet probed */
-static char g_tts_engine[32] = ""; /* "say", "espeak", "festival", or "" */
+static char g_detected_engine[32] = ""; /* "say", "espeak", "festival", or "" */
+static int g_notify_available = -1; /* -1 = not yet probed */
 
 static void probe_tts(void) {
     if (g_tts_available != -1) return;
@@ -34,46 +52,62 @@ static void probe_tts(void) {
 #ifdef __APPLE__
     if (command_exists("say")) {
         g_tts_available = 1;
-        strcpy(g_tts_engine, "say");
+        strcpy(g_detected_engine, "say");
         return;
     }
 #else
     if (command_exists("espeak")) {
         g_tts_available = 1;
-        strcpy(g_tts_engine, "espeak");
+        strcpy(g_detected_engine, "espeak");
         return;
     }
     if (command_exists("festival")) {
         g_tts_available = 1;
-        strcpy(g_tts_engine, "festival");
+        strcpy(g_detected_engine, "festival");
         return;
     }
 #endif
     g_tts_available = 0;
-    g_tts_engine[0] = '\0';
+    g_detected_engine[0] = '\0';
 }
 
-int speak(const char* text) {
+/* The calling session may pin an engine ("none" silences it); otherwise use the probed one */
+static const char* session_tts_engine(void) {
+    const char* engine = session_current()->tts_engine;
+    if (engine[0] == '\0') return g_detected_engine;
+    if (strcmp(engine, "none") == 0) return "";
+    return engine;
+}
+
+static void probe_notify(void) {
+    if (g_notify_available != -1) return;
+#ifdef __APPLE__
+    g_notify_available = command_exists("osascript");
+#else
+    g_notify_available = command_exists("notify-send");
+#endif
+}
+
+static int speak_untraced(const char* text) {
     if (!text || strlen(text) == 0) return 0;
 
     probe_tts();
 
-    if (!g_tts_available) {
-        printf(CLR_YELLOW
-               "  [JARVIS] Voice output unavailable. Switching to text mode.\n"
-               CLR_RESET);
+    const char* engine = session_tts_engine();
+    if (!g_tts_available || engine[0] == '\0') {
+        log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "Voice output unavailable. Switching to text mode.");
         /* Text already printed by jarvis_run — nothing more needed */
         return 1;
     }
 
     int result = 0;
-    if (strcmp(g_tts_engine, "say") == 0) {
+    if (strcmp(engine, "say") == 0) {
         char* args[] = {"say", "-v", "Alex", (char*)text, NULL};
         result = run_process_wait("say", args);
-    } else if (strcmp(g_tts_engine, "espeak") == 0) {
+    } else if (strcmp(engine, "espeak") == 0) {
         char* args[] = {"espeak", (char*)text, NULL};
         result = run_process_wait("espeak", args);
-    } else if (strcmp(g_tts_engine, "festival") == 0) {
+    } else if (strcmp(engine, "festival") == 0) {
         /* festival reads from stdin */
         char cmd[2048];
         snprintf(cmd, sizeof(cmd), "echo '%s' | festival --tts 2>/dev/null", text);
@@ -81,17 +115,96 @@ int speak(const char* text) {
     }
 
     if (!result) {
-        printf(CLR_YELLOW
-               "  [JARVIS] Voice output unavailable. Switching to text mode.\n"
-               CLR_RESET);
+        log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "Voice output unavailable. Switching to text mode.");
     }
     return 1;
 }
 
-int notify_desktop(const char* title, const char* message) {
+int speak(const char* text) {
+    long long span = trace_begin();
+    int result = speak_untraced(text);
+    trace_end("speak", span, NULL);
+    return result;
+}
+
+static pid_t speak_async_untraced(const char* text) {
+    if (!text || strlen(text) == 0) return 0;
+
+    probe_tts();
+    const char* engine = session_tts_engine();
+    if (!g_tts_available || engine[0] == '\0') {
+        log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "Voice output unavailable. Switching to text mode.");
+        return 0;
+    }
+
+    pid_t pid = -1;
+    if (strcmp(engine, "say") == 0) {
+        char* args[] = {"say", "-v", "Alex", (char*)text, NULL};
+        pid = event_loop_spawn(args, NULL, NULL);
+    } else if (strcmp(engine, "espeak") == 0) {
+        char* args[] = {"espeak", (char*)text, NULL};
+        pid = event_loop_spawn(args, NULL, NULL);
+    } else if (strcmp(engine, "festival") == 0) {
+        /* festival reads the text from stdin; no shell quoting involved */
+        char* args[] = {"festival", "--tts", NULL};
+        pid = event_loop_spawn(args, text, NULL);
+    }
+
+    if (pid <= 0) {
+        log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "Voice output unavailable. Switching to text mode.");
+        return 0;
+    }
+    return pid;
+}
+
+pid_t speak_async(const char* text) {
+    long long span = trace_begin();
+    pid_t result = speak_async_untraced(text);
+    trace_end("speak_async", span, NULL);
+    return result;
+}
+
+static pid_t notify_desktop_async_untraced(const char* title, const char* message) {
+    if (!title)   title   = "JARVIS";
+    if (!message) message = "";
+
+    probe_notify();
+    if (!g_notify_available) return 0;
+
+#ifdef __APPLE__
+    const char* en = getenv("JARVIS_ENABLE_NOTIFICATIONS");
+    if (!(en && (strcmp(en, "1") == 0 || strcmp(en, "true") == 0))) return 0;
+    char* args[] = {
+        "osascript",
+        "-e", "on run argv",
+        "-e", "set msg to item 1 of argv",
+        "-e", "set ttl to item 2 of argv",
+        "-e", "display dialog msg with title ttl giving up after 1",
+        "-e", "end run",
+        "--",
+        (char*)message, (char*)title, NULL
+    };
+#else
+    char* args[] = {"notify-send", (char*)title, (char*)message, NULL};
+#endif
+    pid_t pid = event_loop_spawn(args, NULL, NULL);
+    return pid > 0 ? pid : 0;
+}
+
+pid_t notify_desktop_async(const char* title, const char* message) {
+    long long span = trace_begin();
+    pid_t result = notify_desktop_async_untraced(title, message);
+    trace_end("notify_desktop_async", span, NULL);
+    return result;
+}
+
+static int notify_desktop_untraced(const char* title, const char* message) {
     if (!title)   title   = "JARVIS";
     if (!message) message = "";
 
+    probe_notify();
+    if (!g_notify_available) return 0;
+
 #ifdef __APPLE__
     const char* en = getenv("JARVIS_ENABLE_NOTIFICATIONS");
     if (!(en && (strcmp(en, "1") == 0 || strcmp(en, "true") == 0))) return 1;
@@ -112,14 +225,25 @@ int notify_desktop(const char* title, const char* message) {
 #endif
 }
 
+int notify_desktop(const char* title, const char* message) {
+    long long span = trace_begin();
+    int result = notify_desktop_untraced(title, message);
+    trace_end("notify_desktop", span, NULL);
+    return result;
+}
+
+int voice_output_probe(void) {
+    probe_tts();
+    probe_notify();
+    return g_tts_available;
+}
+
 int voice_output_init(void) {
     probe_tts();
     if (g_tts_available) {
-        printf(CLR_GREEN "  [JARVIS] Voice output ready (engine: %s)\n" CLR_RESET, g_tts_engine);
+        log_message(LOG_INFO, CLR_GREEN, "[JARVIS]", "Voice output ready (engine: %s)", g_detected_engine);
     } else {
-        printf(CLR_YELLOW
-               "  [JARVIS] Voice output unavailable. Text-only mode active.\n"
-               CLR_RESET);
+        log_message(LOG_WARN, CLR_YELLOW, "[JARVIS]", "Voice output unavailable. Text-only mode active.");
     }
     return 1;
 }
@@ -0,0 +1,637 @@
+#include "../include/warning_cache.h"
+#include "../include/build_plan.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define WARNING_CACHE_DIR   ".jarvis"
+#define WARNING_CACHE_FILE  "warnings.cache"
+#define WARNING_CACHE_MAGIC "JWRN 1"
+#define WARNING_MAX_OUTPUT  (256 * 1024)
+
+typedef struct {
+    char*     path;        /* relative to the project root, or absolute */
+    long long size;
+    long long mtime;       /* nanoseconds */
+    uint64_t  hash;        /* FNV-1a of the content */
+} CachedDep;
+
+typedef struct {
+    char*      key;        /* directory \t source \t output */
+    uint64_t   command;    /* hash of the command line */
+    CachedDep* deps;       /* the source and every header it included */
+    size_t     dep_count;
+    char*      output;     /* everything the compiler printed */
+} CachedUnit;
+
+typedef struct {
+    CachedUnit* units;     /* sorted by key after loading */
+    size_t      count;
+    size_t      cap;
+} WarningCache;
+
+/* Stat and content hash of each file, computed at most once per check */
+typedef struct {
+    char*     path;
+    long long size;
+    long long mtime;
+    uint64_t  hash;
+    int       state;       /* 0 = empty slot, 1 = stat only, 2 = hashed, -1 = missing */
+} FileMemo;
+
+typedef struct {
+    FileMemo* slots;
+    size_t    cap;
+    size_t    count;
+} FileTable;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#define HASH_SEED 1469598103934665603ULL
+
+static void cached_unit_free(CachedUnit* unit) {
+    free(unit->key);
+    for (size_t i = 0; i < unit->dep_count; i++) free(unit->deps[i].path);
+    free(unit->deps);
+    free(unit->output);
+    memset(unit, 0, sizeof(*unit));
+}
+
+static void cache_free(WarningCache* cache) {
+    for (size_t i = 0; i < cache->count; i++) cached_unit_free(&cache->units[i]);
+    free(cache->units);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/* ── File stats and hashes ──────────────────────────────────────────────── */
+
+static void full_path(char* out, size_t out_size, const char* root, const char* path) {
+    if (path[0] == '/') snprintf(out, out_size, "%s", path);
+    else snprintf(out, out_size, "%s/%s", root, path);
+}
+
+static int hash_file(const char* path, uint64_t* hash) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    char buffer[65536];
+    uint64_t value = HASH_SEED;
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) value = hash_bytes(value, buffer, (size_t)n);
+    close(fd);
+    if (n < 0) return 0;
+    *hash = value;
+    return 1;
+}
+
+static void files_free(FileTable* table) {
+    for (size_t i = 0; i < table->cap; i++) free(table->slots[i].path);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+static FileMemo* files_slot(FileTable* table, const char* path) {
+    if (table->count * 2 >= table->cap) {
+        size_t cap = table->cap ? table->cap * 2 : 256;
+        FileMemo* slots = calloc(cap, sizeof(FileMemo));
+        if (!slots) return NULL;
+        for (size_t i = 0; i < table->cap; i++) {
+            if (!table->slots[i].state) continue;
+            size_t j = hash_bytes(HASH_SEED, table->slots[i].path, strlen(table->slots[i].path)) & (cap - 1);
+            while (slots[j].state) j = (j + 1) & (cap - 1);
+            slots[j] = table->slots[i];
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->cap = cap;
+    }
+    size_t i = hash_bytes(HASH_SEED, path, strlen(path)) & (table->cap - 1);
+    while (table->slots[i].state) {
+        if (strcmp(table->slots[i].path, path) == 0) return &table->slots[i];
+        i = (i + 1) & (table->cap - 1);
+    }
+    return &table->slots[i];
+}
+
+/* Looks up a file, hashing it only when want_hash is set */
+static const FileMemo* files_get(FileTable* table, const char* root, const char* path, int want_hash) {
+    FileMemo* memo = files_slot(table, path);
+    if (!memo) return NULL;
+    char full[PATH_MAX];
+    full_path(full, sizeof(full), root, path);
+    if (!memo->state) {
+        memo->path = strdup(path);
+        if (!memo->path) return NULL;
+        table->count++;
+        struct stat st;
+        if (stat(full, &st) != 0) {
+            memo->state = -1;
+        } else {
+            memo->size = (long long)st.st_size;
+            memo->mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+            memo->state = 1;
+        }
+    }
+    if (memo->state == 1 && want_hash) memo->state = hash_file(full, &memo->hash) ? 2 : -1;
+    return memo->state == -1 ? NULL : memo;
+}
+
+/* A dependency is fresh when its size and mtime match, or when they moved
+   but the content hash did not (touch, checkout of identical content) */
+static int dep_fresh(FileTable* table, const char* root, CachedDep* dep, int* touched) {
+    const FileMemo* memo = files_get(table, root, dep->path, 0);
+    if (!memo) return 0;
+    if (memo->size == dep->size && memo->mtime == dep->mtime) return 1;
+    memo = files_get(table, root, dep->path, 1);
+    if (!memo || memo->hash != dep->hash) return 0;
+    dep->size = memo->size;
+    dep->mtime = memo->mtime;
+    *touched = 1;
+    return 1;
+}
+
+/* ── Persistence ────────────────────────────────────────────────────────── */
+
+static int compare_units(const void* a, const void* b) {
+    return strcmp(((const CachedUnit*)a)->key, ((const CachedUnit*)b)->key);
+}
+
+static CachedUnit* cache_find(WarningCache* cache, const char* key) {
+    CachedUnit probe = { .key = (char*)key };
+    return cache->count ? bsearch(&probe, cache->units, cache->count, sizeof(CachedUnit), compare_units) : NULL;
+}
+
+static int cache_push(WarningCache* cache, CachedUnit* unit) {
+    if (cache->count == cache->cap) {
+        size_t cap = cache->cap ? cache->cap * 2 : 64;
+        CachedUnit* grown = realloc(cache->units, cap * sizeof(CachedUnit));
+        if (!grown) return 0;
+        cache->units = grown;
+        cache->cap = cap;
+    }
+    cache->units[cache->count++] = *unit;
+    return 1;
+}
+
+/* Format:
+     JWRN 1
+     U <command> <deps> <output bytes>\t<key>
+     D <size> <mtime> <hash>\t<path>        (one per dependency)
+     <output bytes>\n */
+static void cache_load(WarningCache* cache, const char* path) {
+    FILE* in = fopen(path, "r");
+    if (!in) return;
+
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t read = getline(&line, &line_cap, in);
+    if (read <= 0 || strcmp(line, WARNING_CACHE_MAGIC "\n") != 0) goto done;
+
+    while ((read = getline(&line, &line_cap, in)) > 0) {
+        if (line[read - 1] == '\n') line[--read] = '\0';
+        unsigned long long command = 0;
+        size_t dep_count = 0, output_len = 0;
+        char* tab = strchr(line, '\t');
+        if (line[0] != 'U' || !tab || sscanf(line, "U %llx %zu %zu", &command, &dep_count, &output_len) != 3 ||
+            output_len > WARNING_MAX_OUTPUT) break;
+
+        CachedUnit unit = { 0 };
+        unit.command = command;
+        unit.key = strdup(tab + 1);
+        unit.deps = calloc(dep_count ? dep_count : 1, sizeof(CachedDep));
+        unit.output = malloc(output_len + 1);
+        if (!unit.key || !unit.deps || !unit.output) {
+            cached_unit_free(&unit);
+            break;
+        }
+        int ok = 1;
+        for (size_t i = 0; i < dep_count && ok; i++) {
+            CachedDep* dep = &unit.deps[i];
+            unsigned long long hash = 0;
+            ok = getline(&line, &line_cap, in) > 0 && (tab = strchr(line, '\t')) != NULL &&
+                 sscanf(line, "D %lld %lld %llx", &dep->size, &dep->mtime, &hash) == 3;
+            if (!ok) break;
+            tab[1 + strcspn(tab + 1, "\n")] = '\0';
+            dep->hash = hash;
+            dep->path = strdup(tab + 1);
+            ok = dep->path != NULL;
+            unit.dep_count++;
+        }
+        if (ok) ok = fread(unit.output, 1, output_len, in) == output_len && fgetc(in) == '\n';
+        unit.output[ok ? output_len : 0] = '\0';
+        if (!ok || !cache_push(cache, &unit)) {
+            cached_unit_free(&unit);
+            break;
+        }
+    }
+    qsort(cache->units, cache->count, sizeof(CachedUnit), compare_units);
+
+done:
+    free(line);
+    fclose(in);
+}
+
+static void cache_save(const WarningCache* cache, const char* dir, const char* path) {
+    mkdir(dir, 0755);
+    char tmp_path[PATH_MAX];
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) return;
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) return;
+
+    fprintf(out, "%s\n", WARNING_CACHE_MAGIC);
+    for (size_t i = 0; i < cache->count; i++) {
+        const CachedUnit* unit = &cache->units[i];
+        size_t output_len = strlen(unit->output);
+        fprintf(out, "U %llx %zu %zu\t%s\n", (unsigned long long)unit->command, unit->dep_count, output_len, unit->key);
+        for (size_t j = 0; j < unit->dep_count; j++) {
+            const CachedDep* dep = &unit->deps[j];
+            fprintf(out, "D %lld %lld %llx\t%s\n", dep->size, dep->mtime, (unsigned long long)dep->hash, dep->path);
+        }
+        fwrite(unit->output, 1, output_len, out);
+        fputc('\n', out);
+    }
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) unlink(tmp_path);
+}
+
+/* ── Compiling ──────────────────────────────────────────────────────────── */
+
+typedef struct {
+    const build_unit* unit;
+    char              key[1600];
+    uint64_t          command;
+    CachedUnit*       cached;     /* valid entry, or NULL when it must be compiled */
+    char*             output;     /* fresh compiler output */
+    int               status;
+    pid_t             pid;
+    int               done_fd;    /* read end of a pipe only the compiler holds: EOF when it exits */
+    FILE*             log;
+    char              depfile[PATH_MAX + 64];
+} UnitJob;
+
+/* The unit's command with its own -o and dependency flags replaced */
+static char** diagnostic_argv(const build_unit* unit, const char* depfile) {
+    char** argv = calloc((size_t)unit->argc + 6, sizeof(char*));
+    if (!argv) return NULL;
+    int n = 0;
+    for (int i = 0; i < unit->argc; i++) {
+        const char* arg = unit->argv[i];
+        if (strcmp(arg, "-o") == 0 || strcmp(arg, "-MF") == 0 || strcmp(arg, "-MT") == 0 || strcmp(arg, "-MQ") == 0) {
+            i++;
+            continue;
+        }
+        if (strcmp(arg, "-MD") == 0 || strcmp(arg, "-MMD") == 0 || strcmp(arg, "-MP") == 0) continue;
+        argv[n++] = unit->argv[i];
+    }
+    argv[n++] = "-MD";
+    argv[n++] = "-MF";
+    argv[n++] = (char*)depfile;
+    argv[n++] = "-o";
+    argv[n++] = "/dev/null";
+    argv[n] = NULL;
+    return argv;
+}
+
+static int job_start(UnitJob* job, const char* root) {
+    char** argv = diagnostic_argv(job->unit, job->depfile);
+    int done[2] = { -1, -1 };
+    job->log = tmpfile();
+    if (!argv || !job->log || pipe(done) != 0) {
+        free(argv);
+        if (job->log) fclose(job->log);
+        job->log = NULL;
+        return 0;
+    }
+    fcntl(done[0], F_SETFD, FD_CLOEXEC);
+    fcntl(done[1], F_SETFD, FD_CLOEXEC);
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = fileno(job->log);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        fcntl(done[1], F_SETFD, 0);   /* held across exec until the compiler exits */
+        if (chdir(root) != 0 || chdir(job->unit->directory) != 0) _exit(127);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    free(argv);
+    close(done[1]);
+    if (pid < 0) {
+        close(done[0]);
+        fclose(job->log);
+        job->log = NULL;
+        return 0;
+    }
+    job->done_fd = done[0];
+    metrics_count(METRIC_CHILDREN_SPAWNED, 1);
+    job->pid = pid;
+    return 1;
+}
+
+static void job_finish(UnitJob* job, int status) {
+    job->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    job->pid = 0;
+    close(job->done_fd);
+    job->done_fd = -1;
+    long len = ftell(job->log);
+    if (len < 0) len = 0;
+    if (len > WARNING_MAX_OUTPUT) len = WARNING_MAX_OUTPUT;
+    job->output = malloc((size_t)len + 1);
+    if (job->output) {
+        rewind(job->log);
+        size_t got = fread(job->output, 1, (size_t)len, job->log);
+        job->output[got] = '\0';
+        metrics_count(METRIC_BYTES_CAPTURED, got);
+    }
+    fclose(job->log);
+    job->log = NULL;
+}
+
+/* Runs every job that has no valid cache entry, a few at a time, refilling
+   a slot as soon as any job in it finishes. waitpid(-1) would also reap the
+   children other threads popen(), so completion is seen on each job's pipe. */
+static void run_jobs(UnitJob* jobs, int count, const char* root) {
+    int limit = build_plan_jobs();
+    struct pollfd* fds = calloc((size_t)(limit < count ? limit : count) + 1, sizeof(struct pollfd));
+    UnitJob** polled = calloc((size_t)(limit < count ? limit : count) + 1, sizeof(UnitJob*));
+    int next = 0, running = 0;
+    while (fds && polled) {
+        while (running < limit && next < count) {
+            UnitJob* job = &jobs[next++];
+            if (job->cached) continue;
+            if (job_start(job, root)) running++;
+            else job->status = 127;
+        }
+        if (running == 0) break;
+
+        int nfds = 0;
+        for (int i = 0; i < next; i++) {
+            if (jobs[i].pid <= 0) continue;
+            fds[nfds] = (struct pollfd){ .fd = jobs[i].done_fd, .events = POLLIN };
+            polled[nfds++] = &jobs[i];
+        }
+        if (poll(fds, (nfds_t)nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < nfds; i++) {
+            if (!fds[i].revents) continue;
+            UnitJob* job = polled[i];
+            int status;
+            while (waitpid(job->pid, &status, 0) < 0) {
+                if (errno == EINTR) continue;
+                status = 127 << 8;
+                break;
+            }
+            job_finish(job, status);
+            running--;
+        }
+    }
+
+    /* Out of memory or poll failed: fall back to reaping in order */
+    for (int i = 0; i < next; i++) {
+        if (jobs[i].pid <= 0) continue;
+        int status;
+        while (waitpid(jobs[i].pid, &status, 0) < 0) {
+            if (errno == EINTR) continue;
+            status = 127 << 8;
+            break;
+        }
+        job_finish(&jobs[i], status);
+    }
+    free(fds);
+    free(polled);
+}
+
+/* The unit's depfile as cache dependencies (hashes filled in later) */
+static int read_deps(const char* path, const char* directory, CachedDep** deps, size_t* count) {
+    char** paths = NULL;
+    int path_count = 0;
+    if (!build_plan_read_depfile(path, directory, &paths, &path_count)) return 0;
+    *deps = calloc((size_t)path_count, sizeof(CachedDep));
+    if (!*deps) {
+        build_plan_free_deps(paths, path_count);
+        return 0;
+    }
+    for (int i = 0; i < path_count; i++) {
+        (*deps)[i].path = paths[i];
+    }
+    *count = (size_t)path_count;
+    free(paths);
+    return 1;
+}
+
+/* Turns a successful compile into a cache entry */
+static int job_to_entry(UnitJob* job, FileTable* files, const char* root, CachedUnit* entry) {
+    memset(entry, 0, sizeof(*entry));
+    if (!read_deps(job->depfile, job->unit->directory, &entry->deps, &entry->dep_count)) {
+        cached_unit_free(entry);
+        return 0;
+    }
+    for (size_t i = 0; i < entry->dep_count; i++) {
+        const FileMemo* memo = files_get(files, root, entry->deps[i].path, 1);
+        if (!memo) {
+            cached_unit_free(entry);
+            return 0;
+        }
+        entry->deps[i].size = memo->size;
+        entry->deps[i].mtime = memo->mtime;
+        entry->deps[i].hash = memo->hash;
+    }
+    entry->key = strdup(job->key);
+    entry->output = job->output;
+    job->output = NULL;
+    entry->command = job->command;
+    if (!entry->key) {
+        cached_unit_free(entry);
+        return 0;
+    }
+    return 1;
+}
+
+/* ── Merging ────────────────────────────────────────────────────────────── */
+
+typedef struct {
+    uint64_t* hashes;
+    size_t    cap;
+    size_t    count;
+} LineSet;
+
+/* Returns 1 when the line had not been seen yet */
+static int lines_add(LineSet* set, const char* line, size_t len) {
+    if (set->count * 2 >= set->cap) {
+        size_t cap = set->cap ? set->cap * 2 : 256;
+        uint64_t* hashes = calloc(cap, sizeof(uint64_t));
+        if (!hashes) return 1;
+        for (size_t i = 0; i < set->cap; i++) {
+            if (!set->hashes[i]) continue;
+            size_t j = set->hashes[i] & (cap - 1);
+            while (hashes[j]) j = (j + 1) & (cap - 1);
+            hashes[j] = set->hashes[i];
+        }
+        free(set->hashes);
+        set->hashes = hashes;
+        set->cap = cap;
+    }
+    uint64_t hash = hash_bytes(HASH_SEED, line, len) | 1;
+    size_t i = hash & (set->cap - 1);
+    while (set->hashes[i]) {
+        if (set->hashes[i] == hash) return 0;
+        i = (i + 1) & (set->cap - 1);
+    }
+    set->hashes[i] = hash;
+    set->count++;
+    return 1;
+}
+
+/* Appends the distinct "warning:" lines of one unit's output */
+static void merge_warnings(const char* output, LineSet* seen, char* out, size_t out_size, size_t* used, int* warnings) {
+    const char* line = output;
+    while (line && *line) {
+        const char* end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+        int warning = 0;
+        for (size_t i = 0; i + 8 <= len && !warning; i++) warning = strncasecmp(line + i, "warning:", 8) == 0;
+        if (warning && lines_add(seen, line, len)) {
+            (*warnings)++;
+            if (*used + len + 2 <= out_size) {
+                if (*used > 0) out[(*used)++] = '\n';
+                memcpy(out + *used, line, len);
+                *used += len;
+                out[*used] = '\0';
+            }
+        }
+        line = end ? end + 1 : NULL;
+    }
+}
+
+/* ── Public API ─────────────────────────────────────────────────────────── */
+
+int warning_cache_check(const char* dir, char* out, size_t out_size, warning_stats* stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (out && out_size > 0) out[0] = '\0';
+    if (!dir) dir = ".";
+
+    build_plan plan;
+    if (!build_plan_load(dir, &plan)) return 0;
+
+    char root[PATH_MAX];
+    if (!realpath(dir, root)) {
+        build_plan_free(&plan);
+        return 0;
+    }
+    /* Room for the cache directory, file and depfile names below the root */
+    char cache_dir[PATH_MAX], cache_path[PATH_MAX + 32];
+    int len = snprintf(cache_dir, sizeof(cache_dir), "%s/%s", root, WARNING_CACHE_DIR);
+    if (len < 0 || (size_t)len + 64 >= sizeof(cache_dir)) {
+        build_plan_free(&plan);
+        return 0;
+    }
+    snprintf(cache_path, sizeof(cache_path), "%s/%s", cache_dir, WARNING_CACHE_FILE);
+
+    UnitJob* jobs = calloc((size_t)plan.count, sizeof(UnitJob));
+    if (!jobs) {
+        build_plan_free(&plan);
+        return 0;
+    }
+
+    long long start = trace_begin();
+    pthread_mutex_lock(&g_lock);
+    mkdir(cache_dir, 0755);
+
+    WarningCache cache = { 0 };
+    cache_load(&cache, cache_path);
+    FileTable files = { 0 };
+    int touched = 0, recompiled = 0, failed = 0;
+
+    for (int i = 0; i < plan.count; i++) {
+        UnitJob* job = &jobs[i];
+        const build_unit* unit = &plan.units[i];
+        job->unit = unit;
+        snprintf(job->key, sizeof(job->key), "%s\t%s\t%s", unit->directory, unit->source, unit->output);
+        job->command = HASH_SEED;
+        for (int j = 0; j < unit->argc; j++) job->command = hash_bytes(job->command, unit->argv[j], strlen(unit->argv[j]) + 1);
+        snprintf(job->depfile, sizeof(job->depfile), "%s/warn-%d-%d.d", cache_dir, (int)getpid(), i);
+
+        CachedUnit* cached = cache_find(&cache, job->key);
+        if (cached && cached->command == job->command) {
+            int fresh = 1;
+            for (size_t j = 0; j < cached->dep_count && fresh; j++) fresh = dep_fresh(&files, root, &cached->deps[j], &touched);
+            if (fresh) job->cached = cached;
+        }
+        if (!job->cached) recompiled++;
+    }
+
+    run_jobs(jobs, plan.count, root);
+
+    /* Rebuild the cache from this plan: reused entries plus fresh compiles */
+    WarningCache next = { 0 };
+    LineSet seen = { 0 };
+    size_t used = 0;
+    int warnings = 0;
+    for (int i = 0; i < plan.count; i++) {
+        UnitJob* job = &jobs[i];
+        const char* output = NULL;
+        if (job->cached) {
+            output = job->cached->output;
+        } else {
+            output = job->output;
+            if (job->status != 0) failed++;
+        }
+        if (output && out && out_size > 0) merge_warnings(output, &seen, out, out_size, &used, &warnings);
+
+        CachedUnit entry;
+        if (job->cached) {
+            entry = *job->cached;
+            memset(job->cached, 0, sizeof(*job->cached));
+            if (!cache_push(&next, &entry)) cached_unit_free(&entry);
+        } else if (job->status == 0 && job_to_entry(job, &files, root, &entry)) {
+            if (!cache_push(&next, &entry)) cached_unit_free(&entry);
+        }
+        unlink(job->depfile);
+        free(job->output);
+    }
+    if (recompiled > 0 || touched || next.count != cache.count) cache_save(&next, cache_dir, cache_path);
+
+    cache_free(&next);
+    cache_free(&cache);
+    files_free(&files);
+    free(seen.hashes);
+    pthread_mutex_unlock(&g_lock);
+
+    metrics_count(METRIC_CACHE_HITS, (unsigned long long)(plan.count - recompiled));
+    metrics_count(METRIC_CACHE_MISSES, (unsigned long long)recompiled);
+    if (stats) {
+        stats->units = plan.count;
+        stats->recompiled = recompiled;
+        stats->failed = failed;
+        stats->warnings = warnings;
+    }
+
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%d/%d recompiled", recompiled, plan.count);
+    trace_end("warning_cache.check", start, detail);
+    free(jobs);
+    build_plan_free(&plan);
+    return 1;
+}
@@ -1,11 +1,49 @@
 #include "command_processor.h"
 #include "search.h"
+#include "session.h"
+#include "file_index.h"
+#include "file_meta.h"
+#include "knowledge.h"
+#include "symbol_index.h"
+#include "code_search.h"
+#include "warning_cache.h"
+#include "diagnostics.h"
+#include "build_driver.h"
+#include "compile_cache.h"
+#include "git_status.h"
+#include "project_status.h"
+#include "routine.h"
+#include "project_watch.h"
+#include "server.h"
+#include "client.h"
+#include "event_loop.h"
+#include "dir_walk.h"
+#include "trace.h"
+#include "log.h"
+#include "batch.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <limits.h>
+#include <utime.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Where the suite was started; each test runs in its own temporary directory */
+static char g_source_dir[PATH_MAX];
+/* This binary, which doubles as the daemon the client auto-starts (see main) */
+static char g_self_path[PATH_MAX];
 
 static int file_contains(const char* path, const char* needle) {
     FILE* file = fopen(path, "r");
@@ -111,6 +149,1156 @@ static int test_process_help(void) {
     return ok;
 }
 
+static int test_process_command_ex_reports_intent(void) {
+    command_result result = { NULL, -1 };
+    char* response = process_command_ex("what time is it", &result);
+    if (!response) {
+        fprintf(stderr, "process_command_ex(time) returned NULL\n");
+        return 0;
+    }
+
+    int ok = result.intent != NULL && strcmp(result.intent, "time") == 0 && result.status == 0;
+    if (!ok) {
+        fprintf(stderr, "Unexpected result: intent=%s status=%d\n",
+                result.intent ? result.intent : "(null)", result.status);
+    }
+
+    free(response);
+    return ok;
+}
+
+static int test_sessions_keep_separate_memory(void) {
+    jarvis_session* first = session_create();
+    jarvis_session* second = session_create();
+    if (!first || !second) {
+        session_destroy(first);
+        session_destroy(second);
+        return 0;
+    }
+
+    free(session_respond(first, "tell me a joke", NULL));
+    free(session_respond(second, "what time is it", NULL));
+
+    command_result result = { NULL, -1 };
+    char* history = session_respond(first, "what did i say", &result);
+    int ok = history != NULL &&
+             strstr(history, "tell me a joke") != NULL &&
+             strstr(history, "what time is it") == NULL &&
+             result.intent != NULL && strcmp(result.intent, "history") == 0;
+    if (!ok) {
+        fprintf(stderr, "Unexpected session history: %s\n", history ? history : "(null)");
+    }
+
+    free(history);
+    session_destroy(first);
+    session_destroy(second);
+    return ok;
+}
+
+static int wait_for_path(const char* path, int timeout_ms) {
+    for (int waited = 0; waited < timeout_ms; waited += 10) {
+        if (access(path, F_OK) == 0) return 1;
+        usleep(10000);
+    }
+    return access(path, F_OK) == 0;
+}
+
+/* Runs client_main() from dir in a child and captures what it prints
+   @return The client's exit status, or -1 if it did not exit normally */
+static int run_client(const char* dir, const char* command, char* out, size_t out_size) {
+    int output[2];
+    if (pipe(output) != 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(output[0]);
+        close(output[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(output[0]);
+        dup2(output[1], STDOUT_FILENO);
+        close(output[1]);
+        if (chdir(dir) != 0) _exit(126);
+        int code = client_main(g_self_path, command);
+        fflush(stdout);
+        _exit(code);
+    }
+
+    close(output[1]);
+    size_t len = 0;
+    ssize_t n;
+    while (len + 1 < out_size && (n = read(output[0], out + len, out_size - len - 1)) != 0) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        len += (size_t)n;
+    }
+    out[len] = '\0';
+    close(output[0]);
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static int test_client_runs_commands_in_its_own_directory(void) {
+    char template[] = "/tmp/jarvis_client_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char socket_path[PATH_MAX], first[PATH_MAX], second[PATH_MAX];
+    snprintf(socket_path, sizeof(socket_path), "%s/jarvis.sock", temp_dir);
+    snprintf(first, sizeof(first), "%s/first", temp_dir);
+    snprintf(second, sizeof(second), "%s/second", temp_dir);
+    mkdir(first, 0755);
+    mkdir(second, 0755);
+    setenv("JARVIS_SOCKET", socket_path, 1);
+    setenv("JARVIS_NO_AUTOSTART", "1", 1);
+    setenv("JARVIS_INDEX", "0", 1);
+
+    /* The daemon runs from the test directory, the clients from first/ and second/ */
+    pid_t daemon = fork();
+    if (daemon == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        _exit(server_main(socket_path));
+    }
+    int ok = daemon > 0 && wait_for_path(socket_path, 3000);
+    if (!ok) fprintf(stderr, "Daemon did not start\n");
+
+    char output[1024], expected[PATH_MAX + 32];
+    const char* dirs[] = { first, second, first };
+    for (int i = 0; ok && i < 3; i++) {
+        int status = run_client(dirs[i], "where am i", output, sizeof(output));
+        snprintf(expected, sizeof(expected), "Current directory: %s\n", dirs[i]);
+        if (status != 0 || strcmp(output, expected) != 0) {
+            fprintf(stderr, "Client in %s got status %d: %s\n", dirs[i], status, output);
+            ok = 0;
+        }
+    }
+
+    if (daemon > 0) {
+        kill(daemon, SIGTERM);
+        int status = 0;
+        waitpid(daemon, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || access(socket_path, F_OK) == 0) {
+            fprintf(stderr, "Daemon did not shut down cleanly\n");
+            ok = 0;
+        }
+    }
+
+    unsetenv("JARVIS_SOCKET");
+    unsetenv("JARVIS_NO_AUTOSTART");
+    unsetenv("JARVIS_INDEX");
+    rmdir(first);
+    rmdir(second);
+    remove(socket_path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+/* Finds the process serving socket_path by its `--serve path` command line */
+static pid_t find_daemon(const char* socket_path) {
+    DIR* proc = opendir("/proc");
+    if (!proc) return -1;
+    pid_t found = -1;
+    struct dirent* entry;
+    while (found < 0 && (entry = readdir(proc)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+        char path[sizeof(entry->d_name) + 16], cmdline[PATH_MAX + 64];
+        snprintf(path, sizeof(path), "/proc/%s/cmdline", entry->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) continue;
+        ssize_t len = read(fd, cmdline, sizeof(cmdline) - 1);
+        close(fd);
+        if (len <= 0) continue;
+        cmdline[len] = '\0';
+
+        /* Arguments are NUL-separated */
+        for (const char* arg = cmdline; arg < cmdline + len; arg += strlen(arg) + 1) {
+            const char* next = arg + strlen(arg) + 1;
+            if (strcmp(arg, "--serve") == 0 && next < cmdline + len && strcmp(next, socket_path) == 0) {
+                found = (pid_t)atoi(entry->d_name);
+                break;
+            }
+        }
+    }
+    closedir(proc);
+    return found;
+}
+
+static int test_client_starts_the_daemon_on_first_use(void) {
+    char template[] = "/tmp/jarvis_autostart_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char socket_path[PATH_MAX];
+    snprintf(socket_path, sizeof(socket_path), "%s/jarvis.sock", temp_dir);
+    setenv("JARVIS_SOCKET", socket_path, 1);
+    setenv("JARVIS_INDEX", "0", 1);
+    unsetenv("JARVIS_NO_AUTOSTART");
+
+    char output[1024];
+    int ok = 1;
+    int status = run_client(temp_dir, "what time is it", output, sizeof(output));
+    pid_t daemon = find_daemon(socket_path);
+    if (status != 0 || strstr(output, "time") == NULL || daemon <= 0) {
+        fprintf(stderr, "Auto-start failed (status %d, daemon %d): %s\n", status, (int)daemon, output);
+        ok = 0;
+    }
+
+    /* The second client reuses the running daemon */
+    status = run_client(temp_dir, "what time is it", output, sizeof(output));
+    if (ok && (status != 0 || find_daemon(socket_path) != daemon)) {
+        fprintf(stderr, "Second client did not reuse the daemon (status %d)\n", status);
+        ok = 0;
+    }
+
+    /* It is not our child, so watch for it unlinking its socket on the way out */
+    if (daemon > 0) {
+        kill(daemon, SIGTERM);
+        for (int waited = 0; waited < 3000 && access(socket_path, F_OK) == 0; waited += 10) usleep(10000);
+        if (access(socket_path, F_OK) == 0) {
+            fprintf(stderr, "Daemon did not stop on SIGTERM\n");
+            ok = 0;
+        }
+    }
+    unsetenv("JARVIS_SOCKET");
+    unsetenv("JARVIS_INDEX");
+    remove(socket_path);
+    char lock_path[PATH_MAX + 8];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", socket_path);
+    remove(lock_path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+static void on_test_readable(int fd, void* userdata) {
+    char buf[64];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) *(int*)userdata += (int)n;
+    else if (n == 0) event_loop_remove_fd(fd);   /* EOF stays readable */
+}
+
+static void on_test_timer(int timer_id, void* userdata) {
+    (void)timer_id;
+    (*(int*)userdata)++;
+}
+
+static void on_test_stop_timer(int timer_id, void* userdata) {
+    (void)timer_id; (void)userdata;
+    event_loop_stop();
+}
+
+static void on_test_child(pid_t pid, int status, void* userdata) {
+    (void)pid;
+    *(int*)userdata = WIFEXITED(status) ? WEXITSTATUS(status) : 1000;
+}
+
+/* Dispatches rounds until *flag reaches at_least or timeout_ms passes */
+static int run_loop_until(const int* flag, int at_least, int timeout_ms) {
+    for (int waited = 0; *flag < at_least && waited < timeout_ms; waited += 10) {
+        if (event_loop_run_once(10) < 0) return 0;
+    }
+    return *flag >= at_least;
+}
+
+static int test_event_loop_dispatches_fds_timers_and_children(void) {
+    if (!event_loop_init()) {
+        fprintf(stderr, "event_loop_init failed\n");
+        return 0;
+    }
+    int ok = 1;
+
+    /* fd readiness: nothing until the pipe has data */
+    int fds[2];
+    int bytes = 0;
+    if (pipe(fds) != 0 || !event_loop_add_fd(fds[0], on_test_readable, &bytes)) {
+        fprintf(stderr, "Could not register a pipe\n");
+        event_loop_shutdown();
+        return 0;
+    }
+    if (event_loop_run_once(0) != 0 || bytes != 0) {
+        fprintf(stderr, "Idle pipe was dispatched\n");
+        ok = 0;
+    }
+    if (write(fds[1], "ping", 4) != 4 || !run_loop_until(&bytes, 4, 1000)) {
+        fprintf(stderr, "Readable pipe was not dispatched (%d bytes)\n", bytes);
+        ok = 0;
+    }
+    event_loop_remove_fd(fds[0]);
+    if (write(fds[1], "more", 4) != 4 || event_loop_run_once(20) != 0 || bytes != 4) {
+        fprintf(stderr, "Removed fd was still dispatched\n");
+        ok = 0;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    /* Timers: a one-shot fires once, a repeating one until cancelled */
+    int once = 0, repeats = 0;
+    int once_id = event_loop_add_timer(20, 0, on_test_timer, &once);
+    int repeat_id = event_loop_add_timer(10, 1, on_test_timer, &repeats);
+    if (once_id <= 0 || repeat_id <= 0 || !run_loop_until(&repeats, 5, 2000) || once != 1) {
+        fprintf(stderr, "Timers fired wrongly: once=%d repeats=%d\n", once, repeats);
+        ok = 0;
+    }
+    event_loop_cancel_timer(repeat_id);
+    int cancelled_at = repeats;
+    for (int i = 0; i < 5; i++) event_loop_run_once(10);
+    if (repeats != cancelled_at || once != 1) {
+        fprintf(stderr, "Cancelled timer kept firing\n");
+        ok = 0;
+    }
+
+    /* Children: reaped through SIGCHLD, with their stdout as a source */
+    int exit_code = -1, echoed = 0, echo_code = -1, out_fd = -1;
+    char* failing[] = { "sh", "-c", "exit 7", NULL };
+    char* echo[] = { "sh", "-c", "cat", NULL };
+    pid_t first = event_loop_spawn(failing, NULL, NULL);
+    pid_t second = event_loop_spawn(echo, "hello\n", &out_fd);
+    if (first <= 0 || second <= 0 || !event_loop_watch_child(first, on_test_child, &exit_code) ||
+        !event_loop_watch_child(second, on_test_child, &echo_code) ||
+        !event_loop_add_fd(out_fd, on_test_readable, &echoed)) {
+        fprintf(stderr, "Could not spawn children\n");
+        ok = 0;
+    }
+    for (int waited = 0; waited < 3000 && (exit_code < 0 || echo_code < 0 || echoed < 6); waited += 10)
+        event_loop_run_once(10);
+    if (exit_code != 7 || echo_code != 0 || echoed != 6) {
+        fprintf(stderr, "Children not reaped: exit=%d echo=%d bytes=%d\n", exit_code, echo_code, echoed);
+        ok = 0;
+    }
+    if (out_fd >= 0) {
+        event_loop_remove_fd(out_fd);
+        close(out_fd);
+    }
+
+    /* event_loop_run returns once a handler calls event_loop_stop */
+    if (event_loop_add_timer(10, 0, on_test_stop_timer, NULL) <= 0) ok = 0;
+    else event_loop_run();
+
+    event_loop_shutdown();
+    return ok;
+}
+
+static int test_performance_report_lists_intents(void) {
+    free(process_command("what time is it"));
+    free(process_command("what time is it"));
+
+    char* report = process_command("performance report");
+    if (!report) {
+        fprintf(stderr, "process_command(performance report) returned NULL\n");
+        return 0;
+    }
+
+    int ok = strstr(report, "time: p50") != NULL && strstr(report, "p99") != NULL;
+    if (!ok) {
+        fprintf(stderr, "Unexpected performance report: %s\n", report);
+    }
+
+    free(report);
+    return ok;
+}
+
+static char* read_log(const char* path);
+
+static int count_occurrences(const char* text, const char* needle) {
+    int count = 0;
+    for (const char* p = text; p && (p = strstr(p, needle)) != NULL; p += strlen(needle)) count++;
+    return count;
+}
+
+static int test_batch_refuses_overlong_lines_whole(void) {
+    /* A line longer than any session buffer, whose tail is a valid command */
+    size_t filler = SESSION_COMMAND_MAX + 1024;
+    const char* tail = "what time is it\n";
+    size_t input_size = filler + strlen(tail) + strlen(tail);
+    char* input = malloc(input_size + 1);
+    if (!input) return 0;
+    memset(input, 'x', filler);
+    snprintf(input + filler, input_size + 1 - filler, "%s%s", tail, tail);
+
+    FILE* in = fmemopen(input, input_size, "r");
+    char* output = NULL;
+    size_t output_size = 0;
+    FILE* out = open_memstream(&output, &output_size);
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        free(input);
+        return 0;
+    }
+    int failures = batch_run(in, out);
+    fclose(in);
+    fclose(out);
+
+    /* One too_long result for the whole line, then the real command */
+    char* second = output ? strchr(output, '\n') : NULL;
+    int ok = failures == 1 && second != NULL && count_occurrences(output, "\n") == 2 &&
+             strstr(output, "\"intent\":\"too_long\"") != NULL &&
+             strstr(output, "\"intent\":\"too_long\"") < second &&
+             strstr(output, "\"status\":-1") < second &&
+             strstr(second, "{\"command\":\"what time is it\",\"intent\":\"time\"") != NULL;
+    if (!ok) {
+        fprintf(stderr, "batch_run returned %d for an overlong line: %.200s...\n", failures,
+                output ? output : "(null)");
+    }
+
+    free(output);
+    free(input);
+    return ok;
+}
+
+static void* trace_worker_span(void* arg) {
+    (void)arg;
+    trace_end("test.worker", trace_begin(), NULL);
+    return NULL;
+}
+
+static int test_trace_exports_chrome_json(void) {
+    char template[] = "/tmp/jarvis_trace_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+    char trace_path[PATH_MAX], tmp_path[PATH_MAX + 8];
+    snprintf(trace_path, sizeof(trace_path), "%s/trace.json", temp_dir);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", trace_path);
+
+    setenv("JARVIS_TRACE", trace_path, 1);
+    trace_init();
+    unsetenv("JARVIS_TRACE");
+    int ok = trace_enabled() && strcmp(trace_output_path(), trace_path) == 0;
+    if (!ok) fprintf(stderr, "JARVIS_TRACE did not enable tracing\n");
+
+    /* One span with an escaped detail here, one from another thread, then
+       enough to wrap this thread's ring (only the newest 2048 are kept) */
+    long long start = trace_begin();
+    usleep(2000);
+    long long duration = trace_end("test.span", start, "say \"hi\"\\now");
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, trace_worker_span, NULL) == 0) pthread_join(thread, NULL);
+    else ok = 0;
+    for (int i = 0; i < 2100; i++) trace_end("test.wrap", trace_begin(), NULL);
+
+    int events = trace_dump(NULL);
+    char* json = read_log(trace_path);
+    /* 2 thread_name records + 2048 kept on this thread + 1 on the worker */
+    if (duration < 2000 || events != 2 + 2048 + 1 || !json) {
+        fprintf(stderr, "trace_dump wrote %d events (span %lld us)\n", events, duration);
+        ok = 0;
+    } else if (strncmp(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 39) != 0 ||
+               strstr(json, "\n]}\n") == NULL ||
+               count_occurrences(json, "\"ph\":\"M\"") != 2 ||
+               count_occurrences(json, "\"ph\":\"X\"") != 2049 ||
+               count_occurrences(json, "\"name\":\"test.worker\"") != 1 ||
+               count_occurrences(json, "\"name\":\"test.wrap\"") != 2048 ||
+               strstr(json, "\"name\":\"test.span\"") != NULL ||
+               count_occurrences(json, "{") != count_occurrences(json, "}")) {
+        fprintf(stderr, "Unexpected trace JSON layout\n");
+        ok = 0;
+    }
+    free(json);
+
+    /* The escaped detail survives when it is still in the ring */
+    trace_end("test.span", trace_begin(), "say \"hi\"\\now");
+    trace_dump(NULL);
+    json = read_log(trace_path);
+    if (!json || strstr(json, "\"name\":\"test.span\"") == NULL ||
+        strstr(json, "\"args\":{\"detail\":\"say \\\"hi\\\"\\\\now\"}") == NULL) {
+        fprintf(stderr, "Span detail was not escaped: %s\n", json ? strstr(json, "test.span") : "(no file)");
+        ok = 0;
+    }
+    if (access(tmp_path, F_OK) == 0) {
+        fprintf(stderr, "Temporary trace file left behind\n");
+        ok = 0;
+    }
+    free(json);
+
+    remove(trace_path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+/* Alternates two spans whose fields differ everywhere, as fast as possible */
+static void* trace_racing_writer(void* arg) {
+    atomic_int* stop = arg;
+    while (!atomic_load(stop)) {
+        trace_end("test.short", trace_begin(), "s");
+        trace_end("test.long", trace_begin(), "a much longer detail that fills most of the slot");
+    }
+    return NULL;
+}
+
+static int test_trace_dump_skips_slots_being_overwritten(void) {
+    char template[] = "/tmp/jarvis_trace_race_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+    char trace_path[PATH_MAX];
+    snprintf(trace_path, sizeof(trace_path), "%s/trace.json", temp_dir);
+    setenv("JARVIS_TRACE", trace_path, 1);
+    trace_init();
+    unsetenv("JARVIS_TRACE");
+
+    atomic_int stop = 0;
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, trace_racing_writer, &stop) != 0) {
+        rmdir(temp_dir);
+        return 0;
+    }
+
+    /* Every exported span must be one of the two the writer records, whole */
+    int ok = trace_enabled();
+    for (int round = 0; round < 50 && ok; round++) {
+        int events = trace_dump(NULL);
+        char* json = read_log(trace_path);
+        int spans = count_occurrences(json, "\"ph\":\"X\"");
+        int whole = count_occurrences(json, "{\"name\":\"test.short\",\"ph\":\"X\"") +
+                    count_occurrences(json, "{\"name\":\"test.long\",\"ph\":\"X\"");
+        int details = count_occurrences(json, "\"args\":{\"detail\":\"s\"}}") +
+                      count_occurrences(json, "\"args\":{\"detail\":\"a much longer detail that fills most of the slot\"}}");
+        if (!json || events < 0 || spans != whole || spans != details) {
+            fprintf(stderr, "Dump %d exported %d spans, %d whole, %d intact details\n",
+                    round, spans, whole, details);
+            ok = 0;
+        }
+        free(json);
+    }
+
+    atomic_store(&stop, 1);
+    pthread_join(writer, NULL);
+    remove(trace_path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+static void* log_worker(void* arg) {
+    int id = *(int*)arg;
+    for (int i = 0; i < 200; i++) log_message(LOG_INFO, NULL, "[T]", "worker %d record %d", id, i);
+    return NULL;
+}
+
+static int test_log_formats_rotates_and_flushes(void) {
+    char template[] = "/tmp/jarvis_log_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+    char log_path[PATH_MAX], rotated[PATH_MAX + 8];
+    snprintf(log_path, sizeof(log_path), "%s/jarvis.log", temp_dir);
+
+    log_shutdown();
+    setenv("JARVIS_LOG_FILE", log_path, 1);
+    setenv("JARVIS_LOG_TERMINAL", "0", 1);
+    setenv("JARVIS_LOG_LEVEL", "info", 1);
+    setenv("JARVIS_LOG_MAX_BYTES", "10000000", 1);
+    /* As in main(), the logger starts while SIGCHLD is still deliverable */
+    sigset_t chld, saved_mask;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    pthread_sigmask(SIG_UNBLOCK, &chld, &saved_mask);
+    log_init();
+    pthread_sigmask(SIG_SETMASK, &saved_mask, NULL);
+
+    /* key=value records: quotes, backslashes and newlines escaped, colours stripped */
+    int ok = 1;
+    log_message(LOG_DEBUG, NULL, "[DBG]", "below the level");
+    log_message(LOG_WARN, "\033[1;31m", "[BOOT]", "say \"hi\"\\now\nnext \033[1;33mline\033[0m");
+    log_console("console text stays off the file\n");
+    log_flush();
+
+    /* The flusher, the only other thread here, has run by now (new threads start
+       fully masked): it must leave SIGCHLD to the reactor */
+    int flushers = 0;
+    DIR* tasks = opendir("/proc/self/task");
+    struct dirent* task;
+    while (tasks && (task = readdir(tasks)) != NULL) {
+        if (task->d_name[0] == '.' || atoi(task->d_name) == getpid()) continue;
+        char status_path[300];
+        snprintf(status_path, sizeof(status_path), "/proc/self/task/%s/status", task->d_name);
+        char* status = read_log(status_path);
+        const char* blocked = status ? strstr(status, "SigBlk:") : NULL;
+        unsigned long long mask = blocked ? strtoull(blocked + 7, NULL, 16) : 0;
+        if (!(mask & (1ULL << (SIGCHLD - 1)))) {
+            fprintf(stderr, "Logger thread %s does not block SIGCHLD\n", task->d_name);
+            ok = 0;
+        }
+        flushers++;
+        free(status);
+    }
+    if (tasks) closedir(tasks);
+    if (flushers != 1) {
+        fprintf(stderr, "Expected one flusher thread, found %d\n", flushers);
+        ok = 0;
+    }
+
+    char* text = read_log(log_path);
+    if (!text || strncmp(text, "ts=", 3) != 0 ||
+        strstr(text, " level=warn tag=\"[BOOT]\" msg=\"say \\\"hi\\\"\\\\now\\nnext line\"\n") == NULL ||
+        strstr(text, "below the level") != NULL || strstr(text, "console text") != NULL) {
+        fprintf(stderr, "Unexpected key=value record: %s\n", text ? text : "(no file)");
+        ok = 0;
+    }
+    free(text);
+
+    /* log_flush returns only once every record from every thread is written */
+    pthread_t threads[4];
+    int ids[4] = { 0, 1, 2, 3 };
+    int started = 0;
+    for (int i = 0; i < 4; i++) {
+        if (pthread_create(&threads[started], NULL, log_worker, &ids[i]) == 0) started++;
+    }
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    log_flush();
+    text = read_log(log_path);
+    if (started != 4 || !text || count_occurrences(text, "tag=\"[T]\"") != 800 ||
+        strstr(text, "msg=\"worker 3 record 199\"") == NULL) {
+        fprintf(stderr, "log_flush returned before %d records were written\n", 200 * started);
+        ok = 0;
+    }
+    free(text);
+
+    /* Past JARVIS_LOG_MAX_BYTES the file rotates, keeping .1 .. .3 */
+    log_shutdown();
+    setenv("JARVIS_LOG_MAX_BYTES", "2048", 1);
+    log_init();
+    for (int i = 0; i < 200; i++) log_message(LOG_INFO, NULL, "[R]", "rotation record %03d", i);
+    log_flush();
+    struct stat st;
+    text = read_log(log_path);
+    if (stat(log_path, &st) != 0 || st.st_size > 2048 + 256) ok = 0;
+    for (int i = 1; i <= 4; i++) {
+        snprintf(rotated, sizeof(rotated), "%s.%d", log_path, i);
+        if ((access(rotated, F_OK) == 0) != (i <= 3)) {
+            fprintf(stderr, "Rotated file %s %s\n", rotated, i <= 3 ? "missing" : "should not exist");
+            ok = 0;
+        }
+    }
+    snprintf(rotated, sizeof(rotated), "%s.1", log_path);
+    char* previous = read_log(rotated);
+    if (!text || !previous || (strstr(text, "rotation record 199") == NULL &&
+                               strstr(previous, "rotation record 199") == NULL)) {
+        fprintf(stderr, "Newest record missing after rotation\n");
+        ok = 0;
+    }
+    free(text);
+    free(previous);
+
+    log_shutdown();
+    unsetenv("JARVIS_LOG_FILE");
+    unsetenv("JARVIS_LOG_TERMINAL");
+    unsetenv("JARVIS_LOG_LEVEL");
+    unsetenv("JARVIS_LOG_MAX_BYTES");
+    remove(log_path);
+    for (int i = 1; i <= 3; i++) {
+        snprintf(rotated, sizeof(rotated), "%s.%d", log_path, i);
+        remove(rotated);
+    }
+    rmdir(temp_dir);
+    return ok;
+}
+
+static int test_file_index_ranks_and_tracks_files(void) {
+    char template[] = "/tmp/jarvis_file_index_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char docs[PATH_MAX], archive[PATH_MAX], old[PATH_MAX];
+    char near_match[PATH_MAX], exact_match[PATH_MAX], other[PATH_MAX], created[PATH_MAX];
+    snprintf(docs, sizeof(docs), "%s/docs", temp_dir);
+    snprintf(archive, sizeof(archive), "%s/archive", temp_dir);
+    snprintf(old, sizeof(old), "%s/archive/old", temp_dir);
+    snprintf(near_match, sizeof(near_match), "%s/docs/budget-2024.pdf", temp_dir);
+    snprintf(exact_match, sizeof(exact_match), "%s/archive/old/Budget.pdf", temp_dir);
+    snprintf(other, sizeof(other), "%s/docs/notes.txt", temp_dir);
+    snprintf(created, sizeof(created), "%s/docs/budget-final.txt", temp_dir);
+
+    int ok = 1;
+    mkdir(docs, 0700);
+    mkdir(archive, 0700);
+    mkdir(old, 0700);
+    const char* initial[] = { near_match, exact_match, other };
+    for (size_t i = 0; i < sizeof(initial) / sizeof(initial[0]); i++) {
+        FILE* file = fopen(initial[i], "w");
+        if (file) fclose(file);
+    }
+
+    setenv("JARVIS_INDEX_ROOTS", temp_dir, 1);
+    if (!file_index_start() || !file_index_wait_ready(5000)) {
+        fprintf(stderr, "File index did not become ready\n");
+        ok = 0;
+        goto cleanup;
+    }
+
+    char* paths[5];
+    int found = file_index_find("budget", paths, 5);
+    if (found != 2 || strcmp(paths[0], exact_match) != 0 || strcmp(paths[1], near_match) != 0) {
+        fprintf(stderr, "Unexpected ranking (%d results)\n", found);
+        ok = 0;
+    }
+    for (int i = 0; i < found; i++) free(paths[i]);
+
+    /* New files show up through inotify without a re-crawl */
+    FILE* file = fopen(created, "w");
+    if (file) fclose(file);
+    found = 0;
+    for (int attempt = 0; attempt < 200 && found != 1; attempt++) {
+        found = file_index_find("budget final", paths, 5);
+        for (int i = 0; i < found; i++) free(paths[i]);
+        if (found != 1) usleep(10000);
+    }
+    if (found != 1) {
+        fprintf(stderr, "Created file was not picked up by the index\n");
+        ok = 0;
+    }
+
+cleanup:
+    unsetenv("JARVIS_INDEX_ROOTS");
+    remove(created);
+    remove(near_match);
+    remove(exact_match);
+    remove(other);
+    rmdir(old);
+    rmdir(archive);
+    rmdir(docs);
+    rmdir(temp_dir);
+    return ok;
+}
+
+static int test_file_meta_sorts_results(void) {
+    char template[] = "/tmp/jarvis_file_meta_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char small_new[PATH_MAX], large_old[PATH_MAX], missing[PATH_MAX];
+    snprintf(small_new, sizeof(small_new), "%s/small_new.txt", temp_dir);
+    snprintf(large_old, sizeof(large_old), "%s/large_old.txt", temp_dir);
+    snprintf(missing, sizeof(missing), "%s/missing.txt", temp_dir);
+
+    FILE* file = fopen(small_new, "w");
+    if (file) {
+        fputs("hi", file);
+        fclose(file);
+    }
+    file = fopen(large_old, "w");
+    if (file) {
+        for (int i = 0; i < 1000; i++) fputs("0123456789", file);
+        fclose(file);
+    }
+    struct utimbuf old_times = { 1000000000, 1000000000 };
+    utime(large_old, &old_times);
+
+    char* paths[3] = { strdup(missing), strdup(large_old), strdup(small_new) };
+    file_meta meta[3];
+    int ok = 1;
+
+    if (file_meta_collect((const char* const*)paths, 3, meta) != 2 || meta[0].ok ||
+        meta[1].size != 10000 || meta[1].mtime != 1000000000 || meta[2].size != 2) {
+        fprintf(stderr, "Unexpected metadata via %s\n", file_meta_backend());
+        ok = 0;
+    }
+
+    file_meta_sort(paths, meta, 3, FILE_SORT_NEWEST);
+    if (strcmp(paths[0], small_new) != 0 || strcmp(paths[1], large_old) != 0 || strcmp(paths[2], missing) != 0) {
+        fprintf(stderr, "Unexpected newest-first order\n");
+        ok = 0;
+    }
+    file_meta_sort(paths, meta, 3, FILE_SORT_LARGEST);
+    if (strcmp(paths[0], large_old) != 0 || strcmp(paths[1], small_new) != 0) {
+        fprintf(stderr, "Unexpected largest-first order\n");
+        ok = 0;
+    }
+
+    for (int i = 0; i < 3; i++) free(paths[i]);
+    remove(small_new);
+    remove(large_old);
+    rmdir(temp_dir);
+    return ok;
+}
+
+/* Minimal HTTP stub: answers every request with a fixed weather line and counts them */
+typedef struct {
+    int listen_fd;
+    int requests;
+} WeatherStub;
+
+static void* weather_stub_main(void* arg) {
+    WeatherStub* stub = arg;
+    static const char reply[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 17\r\nConnection: close\r\n\r\n"
+        "Stubville: +21C\n\n";
+    for (;;) {
+        int client = accept(stub->listen_fd, NULL, NULL);
+        if (client < 0) break;
+        char request[2048];
+        if (recv(client, request, sizeof(request), 0) > 0) {
+            __atomic_add_fetch(&stub->requests, 1, __ATOMIC_SEQ_CST);
+            send(client, reply, sizeof(reply) - 1, 0);
+        }
+        close(client);
+    }
+    return NULL;
+}
+
+static int test_weather_answers_from_cache(void) {
+    if (system("command -v curl >/dev/null 2>&1") != 0) {
+        fprintf(stderr, "curl not available; skipping weather cache check\n");
+        return 1;
+    }
+
+    WeatherStub stub = { socket(AF_INET, SOCK_STREAM, 0), 0 };
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (stub.listen_fd < 0 || bind(stub.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(stub.listen_fd, 4) != 0 || getsockname(stub.listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        perror("weather stub");
+        return 0;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, weather_stub_main, &stub) != 0) {
+        close(stub.listen_fd);
+        return 0;
+    }
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+    setenv("JARVIS_WEATHER_URL", url, 1);
+
+    int ok = 1;
+    for (int i = 0; i < 2; i++) {
+        char* response = process_command("what's the weather");
+        if (!response || strstr(response, "Stubville: +21C") == NULL) {
+            fprintf(stderr, "Unexpected weather response: %s\n", response ? response : "(null)");
+            ok = 0;
+        }
+        free(response);
+    }
+    int requests = __atomic_load_n(&stub.requests, __ATOMIC_SEQ_CST);
+    if (requests != 1) {
+        fprintf(stderr, "Expected one upstream request, saw %d\n", requests);
+        ok = 0;
+    }
+
+    unsetenv("JARVIS_WEATHER_URL");
+    shutdown(stub.listen_fd, SHUT_RDWR);
+    close(stub.listen_fd);
+    pthread_join(thread, NULL);
+    return ok;
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t          root_len;
+    int             threads;
+    int             count;
+    int             bad_worker;
+    char            seen[2048];     /* "|rel/path|" for every visited file */
+} WalkProbe;
+
+static int probe_visit_file(const char* path, size_t name_offset, int worker, void* ctx) {
+    WalkProbe* probe = ctx;
+    pthread_mutex_lock(&probe->lock);
+    probe->count++;
+    if (worker < 0 || worker >= probe->threads || path[name_offset - 1] != '/') probe->bad_worker = 1;
+    size_t len = strlen(probe->seen);
+    snprintf(probe->seen + len, sizeof(probe->seen) - len, "%s|", path + probe->root_len + 1);
+    pthread_mutex_unlock(&probe->lock);
+    return 1;
+}
+
+/* Walks root with the probe and reports which files were visited */
+static int run_probe_walk(const char* root, dir_walk_options* options, WalkProbe* probe) {
+    memset(probe, 0, sizeof(*probe));
+    pthread_mutex_init(&probe->lock, NULL);
+    probe->root_len = strlen(root);
+    probe->threads = options->threads;
+    probe->seen[0] = '|';
+    options->visit_file = probe_visit_file;
+    options->ctx = probe;
+    const char* roots[] = { root };
+    int completed = dir_walk(roots, 1, options);
+    pthread_mutex_destroy(&probe->lock);
+    return completed;
+}
+
+static int probe_saw(const WalkProbe* probe, const char* relative) {
+    char needle[PATH_MAX];
+    snprintf(needle, sizeof(needle), "|%s|", relative);
+    return strstr(probe->seen, needle) != NULL;
+}
+
+static int test_dir_walk_filters_and_stops(void) {
+    char template[] = "/tmp/jarvis_walk_test_XXXXXX";
+    char* root = mkdtemp(template);
+    if (!root) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    const char* dirs[] = { "src", "src/Deep", ".hidden", "node_modules", "sub" };
+    const char* files[] = { "a.c", "b.h", "notes.txt", "src/main.c", "src/util.c", "src/Deep/x.C",
+                            ".hidden/secret.c", "node_modules/pkg.c", "sub/.dotfile.c" };
+    const int file_count = (int)(sizeof(files) / sizeof(files[0]));
+    char path[PATH_MAX];
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        mkdir(path, 0755);
+    }
+    for (int i = 0; i < file_count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        FILE* file = fopen(path, "w");
+        if (file) fclose(file);
+    }
+    snprintf(path, sizeof(path), "%s/link", root);
+    int linked = symlink("src", path) == 0;
+
+    int ok = 1;
+    WalkProbe probe;
+    const char* const skip[] = { "node_modules", NULL };
+
+    /* Glob, case-insensitive; hidden and skipped directories, dotfiles and symlinks stay out */
+    dir_walk_options options = { 0 };
+    options.name_pattern = "*.c";
+    options.skip_dirs = skip;
+    options.threads = 4;
+    if (!run_probe_walk(root, &options, &probe) || probe.count != 4 || probe.bad_worker ||
+        !probe_saw(&probe, "a.c") || !probe_saw(&probe, "src/main.c") || !probe_saw(&probe, "src/util.c") ||
+        !probe_saw(&probe, "src/Deep/x.C")) {
+        fprintf(stderr, "Glob walk visited %d: %s\n", probe.count, probe.seen);
+        ok = 0;
+    }
+    if (!linked) fprintf(stderr, "(symlink not created; symlink case untested)\n");
+
+    /* Hidden directories and skip_dirs are opt-in/opt-out */
+    memset(&options, 0, sizeof(options));
+    options.name_pattern = "*.c";
+    options.include_hidden = 1;
+    options.threads = 2;
+    if (!run_probe_walk(root, &options, &probe) || probe.count != 6 ||
+        !probe_saw(&probe, ".hidden/secret.c") || !probe_saw(&probe, "node_modules/pkg.c")) {
+        fprintf(stderr, "Hidden walk visited %d: %s\n", probe.count, probe.seen);
+        ok = 0;
+    }
+
+    /* No wildcard: a case-insensitive substring, which also matches dotfiles */
+    memset(&options, 0, sizeof(options));
+    options.name_pattern = "DOT";
+    options.threads = 3;
+    if (!run_probe_walk(root, &options, &probe) || probe.count != 1 || !probe_saw(&probe, "sub/.dotfile.c")) {
+        fprintf(stderr, "Substring walk visited %d: %s\n", probe.count, probe.seen);
+        ok = 0;
+    }
+
+    /* max_matches stops the walk early and reports it */
+    memset(&options, 0, sizeof(options));
+    options.max_matches = 2;
+    options.threads = 1;
+    if (run_probe_walk(root, &options, &probe) || probe.count != 2) {
+        fprintf(stderr, "max_matches walk visited %d\n", probe.count);
+        ok = 0;
+    }
+
+    /* A deadline already past stops before reading anything */
+    memset(&options, 0, sizeof(options));
+    options.deadline_us = 1;
+    options.threads = 2;
+    if (run_probe_walk(root, &options, &probe) || probe.count != 0) {
+        fprintf(stderr, "Expired deadline still visited %d\n", probe.count);
+        ok = 0;
+    }
+
+    /* Without a filter every regular file outside hidden directories is seen once */
+    memset(&options, 0, sizeof(options));
+    options.threads = 4;
+    if (!run_probe_walk(root, &options, &probe) || probe.count != file_count - 1 || probe_saw(&probe, "link/main.c")) {
+        fprintf(stderr, "Full walk visited %d: %s\n", probe.count, probe.seen);
+        ok = 0;
+    }
+
+    if (linked) {
+        snprintf(path, sizeof(path), "%s/link", root);
+        unlink(path);
+    }
+    for (int i = 0; i < file_count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        remove(path);
+    }
+    for (int i = (int)(sizeof(dirs) / sizeof(dirs[0])) - 1; i >= 0; i--) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        rmdir(path);
+    }
+    rmdir(root);
+    return ok;
+}
+
+static int test_knowledge_answers_from_local_notes(void) {
+    char template[] = "/tmp/jarvis_knowledge_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char notes_dir[PATH_MAX], index_path[PATH_MAX];
+    char garden[PATH_MAX + 32], kitchen[PATH_MAX + 32], scripts[PATH_MAX + 32];
+    snprintf(notes_dir, sizeof(notes_dir), "%s/notes", temp_dir);
+    snprintf(garden, sizeof(garden), "%s/garden.md", notes_dir);
+    snprintf(kitchen, sizeof(kitchen), "%s/kitchen.txt", notes_dir);
+    snprintf(scripts, sizeof(scripts), "%s/scripts.md", notes_dir);
+    snprintf(index_path, sizeof(index_path), "%s/knowledge.seg", temp_dir);
+    mkdir(notes_dir, 0755);
+
+    FILE* file = fopen(garden, "w");
+    if (file) {
+        fputs("# Garden\n\nGeneral notes about the garden.\n\n"
+              "## Tomato watering\n\nWater the tomato plants every morning before nine. "
+              "Tomatoes crack when the watering schedule is irregular.\n\n"
+              "## Compost\n\nTurn the compost heap weekly.\n", file);
+        fclose(file);
+    }
+    file = fopen(kitchen, "w");
+    if (file) {
+        fputs("The kettle descaler lives under the sink. Use it monthly.\n", file);
+        fclose(file);
+    }
+    file = fopen(scripts, "w");
+    if (file) {
+        fputs("## Backup script\n\nThe backup script copies the photos to the NAS every night.\n", file);
+        fclose(file);
+    }
+
+    setenv("JARVIS_KNOWLEDGE_DIRS", notes_dir, 1);
+    setenv("JARVIS_KNOWLEDGE_INDEX", index_path, 1);
+    int ok = 1;
+
+    knowledge_hit hits[3];
+    int count = knowledge_search("when should I water tomatoes", hits, 3);
+    if (count < 1 || strcmp(hits[0].title, "Tomato watering") != 0 || strstr(hits[0].snippet, "every morning") == NULL) {
+        fprintf(stderr, "Unexpected top hit: %s\n", count > 0 ? hits[0].title : "(none)");
+        ok = 0;
+    }
+    if (access(index_path, R_OK) != 0) {
+        fprintf(stderr, "Segment file was not written\n");
+        ok = 0;
+    }
+
+    char response[512];
+    setenv("JARVIS_KNOWLEDGE_MIN_SCORE", "0.5", 1);
+    if (!knowledge_answer("kettle descaler", response, sizeof(response)) ||
+        strstr(response, "kitchen.txt") == NULL || strstr(response, "under the sink") == NULL) {
+        fprintf(stderr, "Unexpected local answer\n");
+        ok = 0;
+    }
+    if (knowledge_answer("quantum chromodynamics lecture", response, sizeof(response))) {
+        fprintf(stderr, "Unrelated question should fall back to the web\n");
+        ok = 0;
+    }
+    /* "what does this ... do": only "backup" and "script" count towards coverage */
+    count = knowledge_search("what does this backup script do", hits, 3);
+    if (count < 1 || hits[0].query_terms != 2 || hits[0].matched_terms != 2 ||
+        !knowledge_answer("what does this backup script do", response, sizeof(response)) ||
+        strstr(response, "copies the photos") == NULL) {
+        fprintf(stderr, "Stopwords counted as query terms: %d of %d matched\n",
+                count > 0 ? hits[0].matched_terms : 0, count > 0 ? hits[0].query_terms : 0);
+        ok = 0;
+    }
+
+    unsetenv("JARVIS_KNOWLEDGE_DIRS");
+    unsetenv("JARVIS_KNOWLEDGE_INDEX");
+    unsetenv("JARVIS_KNOWLEDGE_MIN_SCORE");
+    remove(garden);
+    remove(kitchen);
+    remove(scripts);
+    remove(index_path);
+    rmdir(notes_dir);
+    rmdir(temp_dir);
+    return ok;
+}
+
+/* Runs one search in a child, so every search maps the segment file afresh */
+static int knowledge_search_in_child(const char* query, const char* title) {
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        knowledge_hit hits[3];
+        int count = knowledge_search(query, hits, 3);
+        _exit(count >= 1 && strcmp(hits[0].title, title) == 0 ? 0 : 1);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) return 0;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int test_knowledge_rebuilds_corrupt_segment(void) {
+    char template[] = "/tmp/jarvis_knowledge_corrupt_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char notes_dir[PATH_MAX], garden[PATH_MAX + 32], index_path[PATH_MAX];
+    snprintf(notes_dir, sizeof(notes_dir), "%s/notes", temp_dir);
+    snprintf(garden, sizeof(garden), "%s/garden.md", notes_dir);
+    snprintf(index_path, sizeof(index_path), "%s/knowledge.seg", temp_dir);
+    mkdir(notes_dir, 0755);
+    FILE* file = fopen(garden, "w");
+    if (file) {
+        fputs("## Tomato watering\n\nWater the tomato plants every morning.\n", file);
+        fclose(file);
+    }
+
+    setenv("JARVIS_KNOWLEDGE_DIRS", notes_dir, 1);
+    setenv("JARVIS_KNOWLEDGE_INDEX", index_path, 1);
+    int ok = knowledge_search_in_child("water tomatoes", "Tomato watering");
+    if (!ok) fprintf(stderr, "Initial search failed\n");
+
+    /* Point the first document's path past the end of the file; the header
+       (56 bytes) still matches the corpus, so only the body checks catch it */
+    int fd = open(index_path, O_WRONLY);
+    uint32_t bad_offset = 0xFFFFFFF0u;
+    if (fd < 0 || pwrite(fd, &bad_offset, sizeof(bad_offset), 56) != (ssize_t)sizeof(bad_offset)) {
+        fprintf(stderr, "Could not corrupt the segment\n");
+        ok = 0;
+    }
+    if (fd >= 0) close(fd);
+    if (ok && !knowledge_search_in_child("water tomatoes", "Tomato watering")) {
+        fprintf(stderr, "Corrupt segment was not rebuilt\n");
+        ok = 0;
+    }
+
+    unsetenv("JARVIS_KNOWLEDGE_DIRS");
+    unsetenv("JARVIS_KNOWLEDGE_INDEX");
+    remove(garden);
+    remove(index_path);
+    rmdir(notes_dir);
+    rmdir(temp_dir);
+    return ok;
+}
+
 static int test_create_module_updates_makefile(void) {
     char original_cwd[PATH_MAX];
     if (!getcwd(original_cwd, sizeof(original_cwd))) {
@@ -118,7 +1306,109 @@ static int test_create_module_updates_makefile(void) {
         return 0;
     }
 
-    char template[] = "/tmp/jarvis_module_test_XXXXXX";
+    char template[] = "/tmp/jarvis_module_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    int ok = 1;
+
+    char include_dir[PATH_MAX];
+    char src_dir[PATH_MAX];
+    char makefile_path[PATH_MAX];
+    char header_path[PATH_MAX];
+    char source_path[PATH_MAX];
+
+    snprintf(include_dir, sizeof(include_dir), "%s/include", temp_dir);
+    snprintf(src_dir, sizeof(src_dir), "%s/src", temp_dir);
+    snprintf(makefile_path, sizeof(makefile_path), "%s/Makefile", temp_dir);
+    snprintf(header_path, sizeof(header_path), "%s/include/auto_mod_test.h", temp_dir);
+    snprintf(source_path, sizeof(source_path), "%s/src/auto_mod_test.c", temp_dir);
+
+    if (mkdir(include_dir, 0700) != 0 || mkdir(src_dir, 0700) != 0) {
+        perror("mkdir");
+        ok = 0;
+        goto cleanup;
+    }
+
+    FILE* makefile = fopen(makefile_path, "w");
+    if (!makefile) {
+        perror("fopen Makefile");
+        ok = 0;
+        goto cleanup;
+    }
+
+    fprintf(makefile,
+            "SRC_DIR = src\n"
+            "BUILD_DIR = build\n"
+            "SOURCES = $(SRC_DIR)/main.c $(SRC_DIR)/command_processor.c\n"
+            "OBJECTS = $(BUILD_DIR)/main.o $(BUILD_DIR)/command_processor.o\n");
+    fclose(makefile);
+
+    if (chdir(temp_dir) != 0) {
+        perror("chdir temp_dir");
+        ok = 0;
+        goto cleanup;
+    }
+
+    char* response = process_command("create c module auto_mod_test");
+    if (!response) {
+        fprintf(stderr, "process_command(create c module) returned NULL\n");
+        ok = 0;
+    } else {
+        if (strstr(response, "updated Makefile") == NULL) {
+            fprintf(stderr, "Expected Makefile update message, got: %s\n", response);
+            ok = 0;
+        }
+        free(response);
+    }
+
+    if (access(header_path, F_OK) != 0) {
+        fprintf(stderr, "Expected scaffold header missing: %s\n", header_path);
+        ok = 0;
+    }
+
+    if (access(source_path, F_OK) != 0) {
+        fprintf(stderr, "Expected scaffold source missing: %s\n", source_path);
+        ok = 0;
+    }
+
+    if (!file_contains(makefile_path, "$(SRC_DIR)/auto_mod_test.c")) {
+        fprintf(stderr, "Makefile missing source update for module\n");
+        ok = 0;
+    }
+
+    if (!file_contains(makefile_path, "$(BUILD_DIR)/auto_mod_test.o")) {
+        fprintf(stderr, "Makefile missing object update for module\n");
+        ok = 0;
+    }
+
+cleanup:
+    if (chdir(original_cwd) != 0) {
+        perror("chdir original_cwd");
+        ok = 0;
+    }
+
+    remove(header_path);
+    remove(source_path);
+    remove(makefile_path);
+    rmdir(include_dir);
+    rmdir(src_dir);
+    rmdir(temp_dir);
+
+    return ok;
+}
+
+static int test_daily_status_non_git_dir(void) {
+    char original_cwd[PATH_MAX];
+    if (!getcwd(original_cwd, sizeof(original_cwd))) {
+        perror("getcwd");
+        return 0;
+    }
+
+    char template[] = "/tmp/jarvis_daily_status_test_XXXXXX";
     char* temp_dir = mkdtemp(template);
     if (!temp_dir) {
         perror("mkdtemp");
@@ -126,24 +1416,265 @@ static int test_create_module_updates_makefile(void) {
     }
 
     int ok = 1;
+    if (chdir(temp_dir) != 0) {
+        perror("chdir temp_dir");
+        ok = 0;
+        goto cleanup;
+    }
 
-    char include_dir[PATH_MAX];
-    char src_dir[PATH_MAX];
-    char makefile_path[PATH_MAX];
-    char header_path[PATH_MAX];
-    char source_path[PATH_MAX];
+    char* response = process_command("daily status");
+    if (!response) {
+        fprintf(stderr, "process_command(daily status) returned NULL\n");
+        ok = 0;
+    } else {
+        if (strstr(response, "Not a git repository.") == NULL) {
+            fprintf(stderr, "Unexpected daily status response: %s\n", response);
+            ok = 0;
+        }
+        free(response);
+    }
 
-    snprintf(include_dir, sizeof(include_dir), "%s/include", temp_dir);
+cleanup:
+    if (chdir(original_cwd) != 0) {
+        perror("chdir original_cwd");
+        ok = 0;
+    }
+    rmdir(temp_dir);
+
+    return ok;
+}
+
+static int test_symbol_index_finds_definitions_and_callers(void) {
+    char template[] = "/tmp/jarvis_symbol_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char c_path[PATH_MAX], py_path[PATH_MAX], index_path[PATH_MAX + 32], index_dir[PATH_MAX];
+    snprintf(c_path, sizeof(c_path), "%s/engine.c", temp_dir);
+    snprintf(py_path, sizeof(py_path), "%s/tool.py", temp_dir);
+    snprintf(index_dir, sizeof(index_dir), "%s/.jarvis", temp_dir);
+    snprintf(index_path, sizeof(index_path), "%s/symbols.idx", index_dir);
+
+    FILE* file = fopen(c_path, "w");
+    if (file) {
+        fputs("#define ENGINE_MAX 8\n"
+              "typedef struct { int rpm; } Engine;\n"
+              "static int engine_rev(Engine* engine);\n"
+              "/* engine_start() is documented here, not called */\n"
+              "static int engine_rev(Engine* engine) {\n"
+              "    return engine->rpm + ENGINE_MAX;\n"
+              "}\n"
+              "int engine_start(Engine* engine) {\n"
+              "    const char* label = \"engine_rev()\";\n"
+              "    (void)label;\n"
+              "    return engine_rev(engine);\n"
+              "}\n", file);
+        fclose(file);
+    }
+    file = fopen(py_path, "w");
+    if (file) {
+        fputs("class Pump:\n"
+              "    def prime(self):\n"
+              "        return run_pump(self)\n"
+              "\n"
+              "def run_pump(pump):\n"
+              "    return pump\n", file);
+        fclose(file);
+    }
+
+    int ok = 1;
+    symbol_location found[4];
+    int total = 0;
+    if (symbol_index_lookup(temp_dir, "engine_rev", SYMBOL_QUERY_DEFINITIONS, found, 4, &total) != 1 ||
+        strcmp(found[0].kind, "function") != 0 || found[0].line != 5 || strcmp(found[0].path, "engine.c") != 0) {
+        fprintf(stderr, "Unexpected definition of engine_rev (%d matches)\n", total);
+        ok = 0;
+    }
+    if (symbol_index_lookup(temp_dir, "engine_rev", SYMBOL_QUERY_CALLERS, found, 4, &total) != 1 ||
+        strcmp(found[0].context, "engine_start") != 0 || found[0].line != 11) {
+        fprintf(stderr, "Comments and strings should not count as calls (%d callers)\n", total);
+        ok = 0;
+    }
+    if (symbol_index_lookup(temp_dir, "Engine", SYMBOL_QUERY_DEFINITIONS, found, 4, NULL) != 1 || strcmp(found[0].kind, "typedef") != 0 ||
+        symbol_index_lookup(temp_dir, "ENGINE_MAX", SYMBOL_QUERY_DEFINITIONS, found, 4, NULL) != 1 || strcmp(found[0].kind, "macro") != 0) {
+        fprintf(stderr, "Typedef or macro definition missing\n");
+        ok = 0;
+    }
+    if (symbol_index_lookup(temp_dir, "run_pump", SYMBOL_QUERY_CALLERS, found, 4, NULL) != 1 ||
+        strcmp(found[0].context, "prime") != 0 || strcmp(found[0].path, "tool.py") != 0) {
+        fprintf(stderr, "Python caller of run_pump not found\n");
+        ok = 0;
+    }
+    if (access(index_path, R_OK) != 0) {
+        fprintf(stderr, "Index was not persisted to .jarvis/\n");
+        ok = 0;
+    }
+
+    /* Touching a file without changing it re-hashes but does not re-scan;
+       editing it re-scans only that file */
+    symbol_index_stats stats;
+    struct utimbuf later = { time(NULL) + 5, time(NULL) + 5 };
+    utime(c_path, &later);
+    if (!symbol_index_update(temp_dir, &stats) || stats.files != 2 || stats.rescanned != 0) {
+        fprintf(stderr, "Unchanged content was re-scanned (%d)\n", stats.rescanned);
+        ok = 0;
+    }
+    file = fopen(py_path, "a");
+    if (file) {
+        fputs("def drain():\n    run_pump(None)\n", file);
+        fclose(file);
+    }
+    if (!symbol_index_update(temp_dir, &stats) || stats.rescanned != 1 ||
+        symbol_index_lookup(temp_dir, "run_pump", SYMBOL_QUERY_CALLERS, found, 4, NULL) != 2) {
+        fprintf(stderr, "Edited file was not re-indexed\n");
+        ok = 0;
+    }
+
+    remove(index_path);
+    rmdir(index_dir);
+    remove(c_path);
+    remove(py_path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+static int test_code_search_respects_gitignore_and_regex(void) {
+    char template[] = "/tmp/jarvis_grep_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char ignore_path[PATH_MAX], src_dir[PATH_MAX], src_path[PATH_MAX], out_dir[PATH_MAX], out_path[PATH_MAX];
+    char log_path[PATH_MAX], bin_path[PATH_MAX];
+    snprintf(ignore_path, sizeof(ignore_path), "%s/.gitignore", temp_dir);
     snprintf(src_dir, sizeof(src_dir), "%s/src", temp_dir);
-    snprintf(makefile_path, sizeof(makefile_path), "%s/Makefile", temp_dir);
-    snprintf(header_path, sizeof(header_path), "%s/include/auto_mod_test.h", temp_dir);
-    snprintf(source_path, sizeof(source_path), "%s/src/auto_mod_test.c", temp_dir);
+    snprintf(src_path, sizeof(src_path), "%s/src/pump.c", temp_dir);
+    snprintf(out_dir, sizeof(out_dir), "%s/out", temp_dir);
+    snprintf(out_path, sizeof(out_path), "%s/out/pump.c", temp_dir);
+    snprintf(log_path, sizeof(log_path), "%s/run.log", temp_dir);
+    snprintf(bin_path, sizeof(bin_path), "%s/blob.bin", temp_dir);
+    mkdir(src_dir, 0755);
+    mkdir(out_dir, 0755);
+
+    FILE* file = fopen(ignore_path, "w");
+    if (file) {
+        fputs("out/\n*.log\n", file);
+        fclose(file);
+    }
+    file = fopen(src_path, "w");
+    if (file) {
+        fputs("int pump_rate(void) {\n"
+              "    return 3; /* TODO: tune */\n"
+              "}\n"
+              "int pump_rate_max = 9; // FIXME\n"
+              "void prime(void) { pump_rate(); }\n", file);
+        fclose(file);
+    }
+    const char* ignored = "int pump_rate(void); /* TODO */\n";
+    file = fopen(out_path, "w");
+    if (file) {
+        fputs(ignored, file);
+        fclose(file);
+    }
+    file = fopen(log_path, "w");
+    if (file) {
+        fputs(ignored, file);
+        fclose(file);
+    }
+    file = fopen(bin_path, "wb");
+    if (file) {
+        fwrite("pump_rate\0\0\1", 1, 12, file);
+        fclose(file);
+    }
 
-    if (mkdir(include_dir, 0700) != 0 || mkdir(src_dir, 0700) != 0) {
-        perror("mkdir");
+    int ok = 1;
+    code_match found[8];
+    int truncated = 0;
+    int count = code_search(temp_dir, "pump_rate(", NULL, found, 8, &truncated);
+    if (count != 2 || strcmp(found[0].path, "src/pump.c") != 0 || found[0].line != 1 || found[1].line != 5 || truncated) {
+        fprintf(stderr, "Literal search should skip ignored and binary files (%d matches)\n", count);
         ok = 0;
-        goto cleanup;
     }
+    count = code_search(temp_dir, "TODO|FIXME", NULL, found, 8, NULL);
+    if (count != 2 || found[0].line != 2 || found[1].line != 4 || strstr(found[1].text, "FIXME") == NULL) {
+        fprintf(stderr, "Alternation found %d matches\n", count);
+        ok = 0;
+    }
+    count = code_search(temp_dir, "\\bpump_rate\\b", NULL, found, 8, NULL);
+    if (count != 2) {
+        fprintf(stderr, "Word boundary should exclude pump_rate_max (%d matches)\n", count);
+        ok = 0;
+    }
+    code_search_options options = { .ignore_case = 1 };
+    count = code_search(temp_dir, "^INT PUMP_\\w+", &options, found, 1, &truncated);
+    if (count != 1 || !truncated) {
+        fprintf(stderr, "Capped case-insensitive search should report truncation (%d)\n", count);
+        ok = 0;
+    }
+    if (code_search(temp_dir, "[abc", NULL, found, 8, NULL) != -1) {
+        fprintf(stderr, "Unterminated class should be rejected\n");
+        ok = 0;
+    }
+
+    remove(src_path);
+    remove(out_path);
+    remove(log_path);
+    remove(bin_path);
+    remove(ignore_path);
+    rmdir(src_dir);
+    rmdir(out_dir);
+    rmdir(temp_dir);
+    return ok;
+}
+
+static int test_find_function_path(void) {
+    /* Searches this repository's own sources */
+    if (chdir(g_source_dir) != 0) {
+        perror("chdir source dir");
+        return 0;
+    }
+    char* response = process_command("find function process_command");
+    if (!response) {
+        fprintf(stderr, "process_command(find function) returned NULL\n");
+        return 0;
+    }
+
+    int ok = 1;
+    if (strstr(response, "process_command") == NULL) {
+        fprintf(stderr, "Expected function search to mention process_command, got: %s\n", response);
+        ok = 0;
+    }
+    if (strstr(response, "No matches found for") != NULL) {
+        fprintf(stderr, "Expected at least one function match, got: %s\n", response);
+        ok = 0;
+    }
+
+    free(response);
+    return ok;
+}
+
+static int test_warning_check_flow(void) {
+    char original_cwd[PATH_MAX];
+    if (!getcwd(original_cwd, sizeof(original_cwd))) {
+        perror("getcwd");
+        return 0;
+    }
+
+    char template[] = "/tmp/jarvis_warning_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    int ok = 1;
+    char makefile_path[PATH_MAX];
+    snprintf(makefile_path, sizeof(makefile_path), "%s/Makefile", temp_dir);
 
     FILE* makefile = fopen(makefile_path, "w");
     if (!makefile) {
@@ -153,190 +1684,790 @@ static int test_create_module_updates_makefile(void) {
     }
 
     fprintf(makefile,
-            "SRC_DIR = src\n"
-            "BUILD_DIR = build\n"
-            "SOURCES = $(SRC_DIR)/main.c $(SRC_DIR)/command_processor.c\n"
-            "OBJECTS = $(BUILD_DIR)/main.o $(BUILD_DIR)/command_processor.o\n");
+            "all:\n"
+            "\t@echo \"warning: synthetic warning from test\"\n\n"
+            "clean:\n"
+            "\t@echo \"clean\"\n");
     fclose(makefile);
 
     if (chdir(temp_dir) != 0) {
         perror("chdir temp_dir");
         ok = 0;
-        goto cleanup;
+        goto cleanup;
+    }
+
+    char* response = process_command("check warnings");
+    if (!response) {
+        fprintf(stderr, "process_command(check warnings) returned NULL\n");
+        ok = 0;
+    } else {
+        if (strstr(response, "Compiler warnings:") == NULL ||
+            strstr(response, "synthetic warning from test") == NULL) {
+            fprintf(stderr, "Unexpected warning-check response: %s\n", response);
+            ok = 0;
+        }
+        free(response);
+    }
+
+cleanup:
+    if (chdir(original_cwd) != 0) {
+        perror("chdir original_cwd");
+        ok = 0;
+    }
+
+    remove(makefile_path);
+    rmdir(temp_dir);
+
+    return ok;
+}
+
+static int test_warning_cache_recompiles_only_changed_units(void) {
+    char template[] = "/tmp/jarvis_warncache_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char makefile_path[PATH_MAX], header_path[PATH_MAX], a_path[PATH_MAX], b_path[PATH_MAX];
+    char cache_dir[PATH_MAX], cache_path[PATH_MAX + 32];
+    snprintf(makefile_path, sizeof(makefile_path), "%s/Makefile", temp_dir);
+    snprintf(header_path, sizeof(header_path), "%s/gauge.h", temp_dir);
+    snprintf(a_path, sizeof(a_path), "%s/a.c", temp_dir);
+    snprintf(b_path, sizeof(b_path), "%s/b.c", temp_dir);
+    snprintf(cache_dir, sizeof(cache_dir), "%s/.jarvis", temp_dir);
+    snprintf(cache_path, sizeof(cache_path), "%s/warnings.cache", cache_dir);
+
+    FILE* file = fopen(makefile_path, "w");
+    if (file) {
+        fputs("all: a.o b.o\n"
+              "%.o: %.c\n"
+              "\tcc -Wall -c $< -o $@\n", file);
+        fclose(file);
+    }
+    file = fopen(header_path, "w");
+    if (file) {
+        fputs("#define GAUGE 1\n", file);
+        fclose(file);
+    }
+    file = fopen(a_path, "w");
+    if (file) {
+        fputs("#include \"gauge.h\"\nint a(void) { int unused_a; return GAUGE; }\n", file);
+        fclose(file);
+    }
+    file = fopen(b_path, "w");
+    if (file) {
+        fputs("int b(void) { return 2; }\n", file);
+        fclose(file);
+    }
+
+    int ok = 1;
+    char warnings[1024];
+    warning_stats stats;
+    if (!warning_cache_check(temp_dir, warnings, sizeof(warnings), &stats) || stats.units != 2 ||
+        stats.recompiled != 2 || stats.warnings != 1 || strstr(warnings, "unused_a") == NULL) {
+        fprintf(stderr, "First check: %d units, %d recompiled, %d warnings: %s\n",
+                stats.units, stats.recompiled, stats.warnings, warnings);
+        ok = 0;
+    }
+    if (!warning_cache_check(temp_dir, warnings, sizeof(warnings), &stats) || stats.recompiled != 0 ||
+        strstr(warnings, "unused_a") == NULL) {
+        fprintf(stderr, "Unchanged project recompiled %d units\n", stats.recompiled);
+        ok = 0;
+    }
+
+    /* A touched header is re-hashed, not recompiled; an edited one
+       recompiles only the units that include it */
+    struct utimbuf later = { time(NULL) + 5, time(NULL) + 5 };
+    utime(header_path, &later);
+    if (!warning_cache_check(temp_dir, warnings, sizeof(warnings), &stats) || stats.recompiled != 0) {
+        fprintf(stderr, "Touched header recompiled %d units\n", stats.recompiled);
+        ok = 0;
+    }
+    file = fopen(header_path, "w");
+    if (file) {
+        fputs("#define GAUGE 2\n", file);
+        fclose(file);
+    }
+    if (!warning_cache_check(temp_dir, warnings, sizeof(warnings), &stats) || stats.recompiled != 1 || stats.warnings != 1) {
+        fprintf(stderr, "Edited header recompiled %d units\n", stats.recompiled);
+        ok = 0;
+    }
+
+    remove(cache_path);
+    rmdir(cache_dir);
+    remove(makefile_path);
+    remove(header_path);
+    remove(a_path);
+    remove(b_path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+static int test_diagnostics_summarize_build_log(void) {
+    const char* log =
+        "Compiling src/parser.c...\n"
+        "gcc -Wall -Iinclude -c src/parser.c -o build/parser.o\n"
+        "src/parser.c: In function 'parse_expr':\n"
+        "src/parser.c:12:5: error: 'depth' undeclared (first use in this function)\n"
+        "   12 |     depth++;\n"
+        "      |     ^~~~~\n"
+        "src/parser.c:12:5: note: each undeclared identifier is reported only once\n"
+        "\033[01m\033[Kinclude/parser.h:4:12:\033[m\033[K warning: 'limit' defined but not used [-Wunused-variable]\n"
+        "include/parser.h:4:12: warning: 'limit' defined but not used [-Wunused-variable]\n"
+        "src/lexer.c:30:9: error: unused variable 'c' [-Werror=unused-variable]\n"
+        "/usr/bin/ld: build/main.o: in function `main':\n"
+        "main.c:(.text+0x1a): undefined reference to `parse_all'\n"
+        "collect2: error: ld returned 1 exit status\n"
+        "make: *** [Makefile:31: build/parser.o] Error 1";
+
+    /* Odd-sized chunks split lines mid-way, as a pipe would */
+    diag_summary* summary = malloc(sizeof(diag_summary));
+    if (!summary) return 0;
+    diagnostics_init(summary);
+    size_t len = strlen(log);
+    for (size_t offset = 0; offset < len; offset += 13) {
+        diagnostics_feed(summary, log + offset, len - offset < 13 ? len - offset : 13);
+    }
+    diagnostics_finish(summary);
+
+    int ok = 1;
+    if (summary->errors != 3 || summary->warnings != 1 || summary->notes != 1) {
+        fprintf(stderr, "Expected 3 errors, 1 warning, 1 note; got %d, %d, %d\n",
+                summary->errors, summary->warnings, summary->notes);
+        ok = 0;
+    }
+    const diagnostic* first = &summary->first_errors[0];
+    if (strcmp(first->file, "src/parser.c") != 0 || first->line != 12 || first->column != 5 ||
+        strcmp(first->function, "parse_expr") != 0 || first->notes != 1) {
+        fprintf(stderr, "First error parsed as %s:%d:%d in '%s' (%d notes)\n",
+                first->file, first->line, first->column, first->function, first->notes);
+        ok = 0;
+    }
+    if (strcmp(summary->first_errors[1].flag, "-Wunused-variable") != 0 ||
+        strcmp(summary->first_warnings[0].file, "include/parser.h") != 0 ||
+        strstr(summary->first_errors[2].message, "undefined reference to `parse_all'") == NULL) {
+        fprintf(stderr, "Flag, coloured warning or linker error not parsed\n");
+        ok = 0;
+    }
+
+    char spoken[512];
+    if (!diagnostics_format(summary, spoken, sizeof(spoken)) ||
+        strncmp(spoken, "Build failed with 3 errors and 1 warning across 3 files. First error: parser.c line 12:", 87) != 0) {
+        fprintf(stderr, "Unexpected summary: %s\n", spoken);
+        ok = 0;
+    }
+
+    diagnostics_init(summary);
+    diagnostics_feed(summary, "make: Nothing to be done for 'all'.\n", 36);
+    diagnostics_finish(summary);
+    if (diagnostics_format(summary, spoken, sizeof(spoken)) != 0) {
+        fprintf(stderr, "Clean log should have nothing to report\n");
+        ok = 0;
+    }
+    free(summary);
+    return ok;
+}
+
+static int write_test_file(const char* path, const char* content) {
+    FILE* file = fopen(path, "w");
+    if (!file) return 0;
+    fputs(content, file);
+    fclose(file);
+    return 1;
+}
+
+static int test_build_driver_rebuilds_only_stale_objects(void) {
+    char template[] = "/tmp/jarvis_driver_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char makefile_path[PATH_MAX], header_path[PATH_MAX], a_path[PATH_MAX], b_path[PATH_MAX];
+    snprintf(makefile_path, sizeof(makefile_path), "%s/Makefile", temp_dir);
+    snprintf(header_path, sizeof(header_path), "%s/shared.h", temp_dir);
+    snprintf(a_path, sizeof(a_path), "%s/a.c", temp_dir);
+    snprintf(b_path, sizeof(b_path), "%s/b.c", temp_dir);
+
+    /* No header dependencies in the Makefile: the driver supplies them.
+       The compile cache would restore a touched but unchanged header's users. */
+    setenv("JARVIS_COMPILE_CACHE", "0", 1);
+    write_test_file(makefile_path, "app: obj/a.o obj/b.o\n\tcc $^ -o app\nobj/%.o: %.c\n\tcc -c $< -o $@\n");
+    write_test_file(header_path, "#define SHARED 1\n");
+    write_test_file(a_path, "#include \"shared.h\"\nint main(void) { return SHARED - 1; }\n");
+    write_test_file(b_path, "int b(void) { return 2; }\n");
+
+    int ok = 1;
+    build_stats stats;
+    if (!build_driver_compile(temp_dir, 0, NULL, &stats) || stats.units != 2 || stats.compiled != 2 || stats.failed != 0) {
+        fprintf(stderr, "First build compiled %d of %d (%d failed)\n", stats.compiled, stats.units, stats.failed);
+        ok = 0;
+    }
+    if (!build_driver_compile(temp_dir, 0, NULL, &stats) || stats.stale != 0) {
+        fprintf(stderr, "Up-to-date project had %d stale objects\n", stats.stale);
+        ok = 0;
+    }
+
+    struct utimbuf later = { time(NULL) + 5, time(NULL) + 5 };
+    utime(header_path, &later);
+    if (!build_driver_compile(temp_dir, 0, NULL, &stats) || stats.stale != 1 || stats.compiled != 1) {
+        fprintf(stderr, "Header edit made %d objects stale, expected only a.o\n", stats.stale);
+        ok = 0;
+    }
+
+    write_test_file(makefile_path, "app: obj/a.o obj/b.o\n\tcc $^ -o app\nobj/%.o: %.c\n\tcc -O1 -c $< -o $@\n");
+    if (!build_driver_compile(temp_dir, 0, NULL, &stats) || stats.stale != 2) {
+        fprintf(stderr, "Changed flags made %d objects stale\n", stats.stale);
+        ok = 0;
+    }
+
+    diag_summary* diagnostics = malloc(sizeof(diag_summary));
+    if (diagnostics) {
+        diagnostics_init(diagnostics);
+        write_test_file(b_path, "int b(void) { return missing; }\n");
+        if (!build_driver_compile(temp_dir, 0, diagnostics, &stats) || stats.failed != 1 || diagnostics->errors < 1 ||
+            strcmp(diagnostics->first_errors[0].file, "b.c") != 0) {
+            fprintf(stderr, "Compile error not reported (%d failed, %d errors)\n", stats.failed, diagnostics->errors);
+            ok = 0;
+        }
+        free(diagnostics);
+    }
+    unsetenv("JARVIS_COMPILE_CACHE");
+
+    char command[PATH_MAX + 32];
+    snprintf(command, sizeof(command), "rm -rf '%s'", temp_dir);
+    if (system(command) != 0) ok = 0;
+    return ok;
+}
+
+static int test_compile_cache_restores_clean_build(void) {
+    char template[] = "/tmp/jarvis_ccache_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    char cache_dir[256], project_dir[256], path[PATH_MAX];
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", temp_dir);
+    snprintf(project_dir, sizeof(project_dir), "%s/project", temp_dir);
+    mkdir(project_dir, 0755);
+    setenv("JARVIS_COMPILE_CACHE", cache_dir, 1);
+    snprintf(path, sizeof(path), "%s/Makefile", project_dir);
+    write_test_file(path, "app: obj/a.o obj/b.o\n\tcc $^ -o app\nobj/%.o: %.c\n\tcc -Wall -c $< -o $@\n");
+    snprintf(path, sizeof(path), "%s/a.c", project_dir);
+    write_test_file(path, "int main(void) { return 0; }\n");
+    snprintf(path, sizeof(path), "%s/b.c", project_dir);
+    write_test_file(path, "int b(void) { int unused; return 2; }\n");
+
+    int ok = 1;
+    build_stats stats;
+    if (!build_driver_compile(project_dir, 0, NULL, &stats) || stats.compiled != 2 || stats.cached != 0) {
+        fprintf(stderr, "Cold build compiled %d and restored %d\n", stats.compiled, stats.cached);
+        ok = 0;
     }
 
-    char* response = process_command("create c module auto_mod_test");
-    if (!response) {
-        fprintf(stderr, "process_command(create c module) returned NULL\n");
-        ok = 0;
-    } else {
-        if (strstr(response, "updated Makefile") == NULL) {
-            fprintf(stderr, "Expected Makefile update message, got: %s\n", response);
+    /* A clean build of unchanged code comes back from the cache, warnings included */
+    char command[PATH_MAX + 32];
+    snprintf(command, sizeof(command), "rm -rf '%s/obj'", project_dir);
+    if (system(command) != 0) ok = 0;
+    diag_summary* diagnostics = malloc(sizeof(diag_summary));
+    if (diagnostics) {
+        diagnostics_init(diagnostics);
+        snprintf(path, sizeof(path), "%s/obj/b.d", project_dir);
+        if (!build_driver_compile(project_dir, 0, diagnostics, &stats) || stats.compiled != 0 || stats.cached != 2 ||
+            diagnostics->warnings != 1 || access(path, F_OK) != 0) {
+            fprintf(stderr, "Clean build compiled %d, restored %d, %d warnings\n", stats.compiled, stats.cached,
+                    diagnostics->warnings);
             ok = 0;
         }
-        free(response);
+        free(diagnostics);
     }
-
-    if (access(header_path, F_OK) != 0) {
-        fprintf(stderr, "Expected scaffold header missing: %s\n", header_path);
+    if (!build_driver_compile(project_dir, 0, NULL, &stats) || stats.stale != 0) {
+        fprintf(stderr, "Restored objects were stale again (%d)\n", stats.stale);
         ok = 0;
     }
 
-    if (access(source_path, F_OK) != 0) {
-        fprintf(stderr, "Expected scaffold source missing: %s\n", source_path);
+    compile_cache_stats cache;
+    if (!compile_cache_get_stats(&cache) || cache.hits != 2 || cache.misses != 2 || cache.stored != 2 || cache.size <= 0) {
+        fprintf(stderr, "Cache stats: %llu hits, %llu misses, %llu stored\n", cache.hits, cache.misses, cache.stored);
         ok = 0;
     }
 
-    if (!file_contains(makefile_path, "$(SRC_DIR)/auto_mod_test.c")) {
-        fprintf(stderr, "Makefile missing source update for module\n");
+    /* Over the size limit, least recently used entries go */
+    setenv("JARVIS_COMPILE_CACHE_SIZE", "1K", 1);
+    snprintf(path, sizeof(path), "%s/a.c", project_dir);
+    write_test_file(path, "int main(void) { return 1; }\n");
+    build_driver_compile(project_dir, 0, NULL, &stats);
+    if (!compile_cache_get_stats(&cache) || cache.evicted == 0 || cache.size > 1024) {
+        fprintf(stderr, "Eviction left %lld bytes (%llu evicted)\n", cache.size, cache.evicted);
         ok = 0;
     }
+    unsetenv("JARVIS_COMPILE_CACHE_SIZE");
+    unsetenv("JARVIS_COMPILE_CACHE");
 
-    if (!file_contains(makefile_path, "$(BUILD_DIR)/auto_mod_test.o")) {
-        fprintf(stderr, "Makefile missing object update for module\n");
-        ok = 0;
+    snprintf(command, sizeof(command), "rm -rf '%s'", temp_dir);
+    if (system(command) != 0) ok = 0;
+    return ok;
+}
+
+static int test_git_status_reads_repository_natively(void) {
+    if (system("git --version >/dev/null 2>&1") != 0) return 1;   /* nothing to build the repository with */
+    char template[] = "/tmp/jarvis_git_status_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
     }
 
-cleanup:
-    if (chdir(original_cwd) != 0) {
-        perror("chdir original_cwd");
+    char path[PATH_MAX], command[PATH_MAX + 256];
+    snprintf(path, sizeof(path), "%s/src", temp_dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/a.txt", temp_dir);
+    write_test_file(path, "one\n");
+    snprintf(path, sizeof(path), "%s/src/b.c", temp_dir);
+    write_test_file(path, "int b;\n");
+    snprintf(path, sizeof(path), "%s/.gitignore", temp_dir);
+    write_test_file(path, "*.log\n");
+    /* gc packs the objects, so HEAD is read from a pack */
+    snprintf(command, sizeof(command),
+             "cd '%s' && git init -q -b main && git add . && "
+             "git -c user.name=t -c user.email=t@t commit -qm 'Initial import' && git gc -q", temp_dir);
+    int ok = system(command) == 0;
+
+    snprintf(path, sizeof(path), "%s/a.txt", temp_dir);
+    write_test_file(path, "one\ntwo\n");
+    snprintf(path, sizeof(path), "%s/src/b.c", temp_dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/src/new.c", temp_dir);
+    write_test_file(path, "int n;\n");
+    snprintf(path, sizeof(path), "%s/notes.txt", temp_dir);
+    write_test_file(path, "todo\n");
+    snprintf(path, sizeof(path), "%s/debug.log", temp_dir);
+    write_test_file(path, "ignored\n");
+    snprintf(command, sizeof(command), "cd '%s' && git add src/new.c", temp_dir);
+    if (system(command) != 0) ok = 0;
+
+    static const char* const expected[] = { " M a.txt", " D src/b.c", "A  src/new.c", "?? notes.txt" };
+    git_status* status = malloc(sizeof(git_status));
+    if (!status || git_status_read(temp_dir, 0, status) != 1) {
+        fprintf(stderr, "git_status_read fell back to git\n");
         ok = 0;
+    } else {
+        if (strcmp(status->branch, "main") != 0 || strcmp(status->subject, "Initial import") != 0 ||
+            status->staged != 1 || status->modified != 1 || status->deleted != 1 || status->untracked != 1 ||
+            status->listed != 4) {
+            fprintf(stderr, "Status: branch %s, subject %s, %d staged, %d modified, %d deleted, %d untracked\n",
+                    status->branch, status->subject, status->staged, status->modified, status->deleted,
+                    status->untracked);
+            ok = 0;
+        }
+        for (int i = 0; ok && i < 4; i++) {
+            char line[300];
+            snprintf(line, sizeof(line), "%c%c %s", status->entries[i].index, status->entries[i].worktree,
+                     status->entries[i].path);
+            if (strcmp(line, expected[i]) != 0) {
+                fprintf(stderr, "Entry %d: '%s', expected '%s'\n", i, line, expected[i]);
+                ok = 0;
+            }
+        }
     }
+    free(status);
 
-    remove(header_path);
-    remove(source_path);
-    remove(makefile_path);
-    rmdir(include_dir);
-    rmdir(src_dir);
-    rmdir(temp_dir);
+    char original_cwd[PATH_MAX];
+    if (getcwd(original_cwd, sizeof(original_cwd)) && chdir(temp_dir) == 0) {
+        char* response = process_command("daily status");
+        if (!response || !strstr(response, "Changes: 1 staged, 1 modified, 1 deleted, 1 untracked") ||
+            !strstr(response, "Initial import")) {
+            fprintf(stderr, "Unexpected daily status response: %s\n", response ? response : "(null)");
+            ok = 0;
+        }
+        free(response);
+        if (chdir(original_cwd) != 0) ok = 0;
+    }
 
+    snprintf(command, sizeof(command), "rm -rf '%s'", temp_dir);
+    if (system(command) != 0) ok = 0;
     return ok;
 }
 
-static int test_daily_status_non_git_dir(void) {
-    char original_cwd[PATH_MAX];
-    if (!getcwd(original_cwd, sizeof(original_cwd))) {
-        perror("getcwd");
-        return 0;
-    }
-
-    char template[] = "/tmp/jarvis_daily_status_test_XXXXXX";
+static int test_project_status_ranks_repositories(void) {
+    if (system("git --version >/dev/null 2>&1") != 0) return 1;
+    char template[] = "/tmp/jarvis_project_status_test_XXXXXX";
     char* temp_dir = mkdtemp(template);
     if (!temp_dir) {
         perror("mkdtemp");
         return 0;
     }
 
-    int ok = 1;
-    if (chdir(temp_dir) != 0) {
-        perror("chdir temp_dir");
-        ok = 0;
-        goto cleanup;
-    }
-
-    char* response = process_command("daily status");
-    if (!response) {
-        fprintf(stderr, "process_command(daily status) returned NULL\n");
+    /* clean and dirty sit at the root, ahead is a clone one level down, notes is no repository */
+    char path[PATH_MAX], command[PATH_MAX * 2 + 256];
+    snprintf(path, sizeof(path), "%s/notes", temp_dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/group", temp_dir);
+    mkdir(path, 0755);
+    snprintf(command, sizeof(command),
+             "cd '%s' && for r in clean dirty; do git init -q -b main $r && echo one > $r/a.txt && "
+             "git -C $r add . && git -C $r -c user.name=t -c user.email=t@t commit -qm init || exit 1; done && "
+             "git clone -q clean group/ahead && echo two > group/ahead/b.txt && git -C group/ahead add . && "
+             "git -C group/ahead -c user.name=t -c user.email=t@t commit -qm local && echo two >> dirty/a.txt",
+             temp_dir);
+    int ok = system(command) == 0;
+
+    const char* roots[] = { temp_dir };
+    project_report report;
+    if (!ok || !project_status_scan(roots, 1, 2, &report)) {
+        fprintf(stderr, "Could not set up or scan the repositories\n");
         ok = 0;
     } else {
-        if (strstr(response, "Not a git repository.") == NULL) {
-            fprintf(stderr, "Unexpected daily status response: %s\n", response);
+        static const char* const order[] = { "dirty", "ahead", "clean" };
+        if (report.count != 3 || report.needing_attention != 2) {
+            fprintf(stderr, "Found %d repositories, %d needing attention\n", report.count, report.needing_attention);
             ok = 0;
         }
-        free(response);
+        for (int i = 0; ok && i < 3; i++) {
+            if (strcmp(report.repos[i].name, order[i]) != 0) {
+                fprintf(stderr, "Rank %d: %s, expected %s\n", i + 1, report.repos[i].name, order[i]);
+                ok = 0;
+            }
+        }
+        if (ok && (report.repos[0].status.modified != 1 || report.repos[1].status.ahead != 1 ||
+                   report.repos[2].attention != 0)) {
+            fprintf(stderr, "Unexpected repository states\n");
+            ok = 0;
+        }
+        project_status_free(&report);
     }
 
-cleanup:
-    if (chdir(original_cwd) != 0) {
-        perror("chdir original_cwd");
+    setenv("JARVIS_PROJECT_ROOTS", temp_dir, 1);
+    char* response = process_command("status of all projects");
+    if (!response || !strstr(response, "3 repositories scanned") || !strstr(response, "1. dirty (main): 1 modified") ||
+        !strstr(response, "2. ahead (main): 1 ahead")) {
+        fprintf(stderr, "Unexpected dashboard response: %s\n", response ? response : "(null)");
         ok = 0;
     }
-    rmdir(temp_dir);
+    free(response);
+    unsetenv("JARVIS_PROJECT_ROOTS");
 
+    snprintf(command, sizeof(command), "rm -rf '%s'", temp_dir);
+    if (system(command) != 0) ok = 0;
     return ok;
 }
 
-static int test_find_function_path(void) {
-    char* response = process_command("find function process_command");
-    if (!response) {
-        fprintf(stderr, "process_command(find function) returned NULL\n");
+/* Routine steps for the scheduler test: "sleep <ms>" succeeds after a delay, "fail" fails */
+static int run_test_step(const char* command, char** output, void* context) {
+    (void)context;
+    *output = strdup(command);
+    if (strncmp(command, "sleep ", 6) != 0) return 0;
+    usleep((useconds_t)atoi(command + 6) * 1000);
+    return 1;
+}
+
+static int test_routine_runs_steps_by_dependency(void) {
+    static const char definitions[] =
+        "[other]\n"
+        "x: sleep 1\n"
+        "[Demo]\n"
+        "# a and b run together; c waits for both\n"
+        "a: sleep 200\n"
+        "b: sleep 200\n"
+        "c (after a, b): sleep 50\n"
+        "d (after c): fail\n"
+        "e (after d): sleep 10\n"
+        "f: sleep 10\n"
+        "[loop]\n"
+        "x (after y): sleep 1\n"
+        "y (after x): sleep 1\n";
+
+    routine* demo = malloc(sizeof(routine));
+    char error[256];
+    int ok = demo && routine_parse(definitions, "demo", demo, error, sizeof(error)) == 1 && demo->step_count == 6;
+    if (!ok) {
+        fprintf(stderr, "Could not parse the demo routine: %s\n", error);
+        free(demo);
         return 0;
     }
 
-    int ok = 1;
-    if (strstr(response, "process_command") == NULL) {
-        fprintf(stderr, "Expected function search to mention process_command, got: %s\n", response);
+    if (routine_run(demo, 0, run_test_step, NULL)) {
+        fprintf(stderr, "routine_run succeeded despite a failing step\n");
         ok = 0;
     }
-    if (strstr(response, "No matches found for") != NULL) {
-        fprintf(stderr, "Expected at least one function match, got: %s\n", response);
+    static const routine_step_state expected[] = {
+        ROUTINE_OK, ROUTINE_OK, ROUTINE_OK, ROUTINE_FAILED, ROUTINE_SKIPPED, ROUTINE_OK
+    };
+    for (int i = 0; i < 6; i++) {
+        if (demo->steps[i].state != expected[i]) {
+            fprintf(stderr, "Step %s ended in state %d, expected %d\n", demo->steps[i].name, demo->steps[i].state, expected[i]);
+            ok = 0;
+        }
+    }
+    /* Serially the steps take 470 ms; in parallel the critical path a, c, d takes 250 ms */
+    if (demo->steps[2].start_us < demo->steps[0].elapsed_us || demo->elapsed_us > 400000 ||
+        demo->critical_us < 250000 || demo->skipped != 1 || demo->failed != 1) {
+        fprintf(stderr, "Run took %lld us (critical path %lld us), c started at %lld us\n",
+                demo->elapsed_us, demo->critical_us, demo->steps[2].start_us);
         ok = 0;
     }
+    char report[1024];
+    routine_format_report(demo, report, sizeof(report));
+    if (!strstr(report, "4 of 6 steps succeeded, 1 failed, 1 skipped") || !strstr(report, "e: skipped")) {
+        fprintf(stderr, "Unexpected report: %s\n", report);
+        ok = 0;
+    }
+    routine_release(demo);
 
-    free(response);
-    return ok;
-}
-
-static int test_warning_check_flow(void) {
-    char original_cwd[PATH_MAX];
-    if (!getcwd(original_cwd, sizeof(original_cwd))) {
-        perror("getcwd");
-        return 0;
+    if (routine_parse(definitions, "loop", demo, error, sizeof(error)) != -1 || !strstr(error, "cycle")) {
+        fprintf(stderr, "Cycle not rejected: %s\n", error);
+        ok = 0;
     }
+    free(demo);
 
-    char template[] = "/tmp/jarvis_warning_test_XXXXXX";
+    char template[] = "/tmp/jarvis_routine_test_XXXXXX";
     char* temp_dir = mkdtemp(template);
     if (!temp_dir) {
         perror("mkdtemp");
         return 0;
     }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/routines", temp_dir);
+    write_test_file(path, "[check]\nclock: what time is it\ngreet (after clock): hello\n");
+    setenv("JARVIS_ROUTINES", path, 1);
+    char* response = process_command("run routine check");
+    if (!response || !strstr(response, "Routine check: 2 steps succeeded") || !strstr(response, "greet: ok")) {
+        fprintf(stderr, "Unexpected routine response: %s\n", response ? response : "(null)");
+        ok = 0;
+    }
+    free(response);
+    response = process_command("run routine missing");
+    if (!response || !strstr(response, "I don't know a routine named missing")) {
+        fprintf(stderr, "Unexpected response for an unknown routine: %s\n", response ? response : "(null)");
+        ok = 0;
+    }
+    free(response);
+
+    /* Identifiers and questions that merely contain "routine" are not routine commands */
+    const char* not_routines[] = { "find function routine_run", "what is a routine" };
+    for (int i = 0; i < 2; i++) {
+        command_result result = { "error", 0 };
+        response = process_command_ex(not_routines[i], &result);
+        if (!response || strcmp(result.intent, "routine") == 0 ||
+            (i == 0 && strcmp(result.intent, "code_navigation") != 0)) {
+            fprintf(stderr, "\"%s\" routed to %s: %s\n", not_routines[i], result.intent, response ? response : "(null)");
+            ok = 0;
+        }
+        free(response);
+    }
+    unsetenv("JARVIS_ROUTINES");
+    unlink(path);
+    rmdir(temp_dir);
+    return ok;
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    int             cycles;
+    int             slow_started;   /* a "slow" cycle is under way */
+    char            only[256];      /* "*" when every test ran */
+} WatchProbe;
+
+/* Stands in for build + tests: red while src/widget.c says "broken", 300 ms long while it says "slow" */
+static int run_test_watch_cycle(const char* dir, const char* only, char* summary, size_t summary_size, void* context) {
+    WatchProbe* probe = context;
+    char path[PATH_MAX], text[256] = "";
+    snprintf(path, sizeof(path), "%s/src/widget.c", dir);
+    FILE* file = fopen(path, "r");
+    if (file) {
+        size_t n = fread(text, 1, sizeof(text) - 1, file);
+        text[n] = '\0';
+        fclose(file);
+    }
+    int green = strstr(text, "broken") == NULL;
+    snprintf(summary, summary_size, green ? "1/1 tests passed" : "widget.c:1: error: broken");
+    if (strstr(text, "slow")) {
+        pthread_mutex_lock(&probe->lock);
+        probe->slow_started = 1;
+        pthread_mutex_unlock(&probe->lock);
+        usleep(300000);
+    }
+
+    pthread_mutex_lock(&probe->lock);
+    probe->cycles++;
+    snprintf(probe->only, sizeof(probe->only), "%s", only ? only : "*");
+    pthread_mutex_unlock(&probe->lock);
+    return green;
+}
+
+static int watch_probe_cycles(WatchProbe* probe, int at_least, int timeout_ms) {
+    int cycles = 0;
+    for (int waited = 0; waited <= timeout_ms; waited += 10) {
+        pthread_mutex_lock(&probe->lock);
+        cycles = probe->cycles;
+        pthread_mutex_unlock(&probe->lock);
+        if (cycles >= at_least) break;
+        usleep(10000);
+    }
+    return cycles;
+}
+
+static int watch_announcement(char* out, size_t out_size, int timeout_ms) {
+    for (int waited = 0; waited <= timeout_ms; waited += 10) {
+        if (project_watch_take_announcement(out, out_size)) return 1;
+        usleep(10000);
+    }
+    out[0] = '\0';
+    return 0;
+}
 
+static int exercise_project_watch(const char* dir, const char* backend) {
+    static WatchProbe probe = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    char path[PATH_MAX], message[512], status[512];
     int ok = 1;
-    char makefile_path[PATH_MAX];
-    snprintf(makefile_path, sizeof(makefile_path), "%s/Makefile", temp_dir);
+    pthread_mutex_lock(&probe.lock);
+    probe.cycles = 0;
+    probe.slow_started = 0;
+    probe.only[0] = '\0';
+    pthread_mutex_unlock(&probe.lock);
+    while (project_watch_take_announcement(message, sizeof(message))) {}
+
+    if (project_watch_start(dir, run_test_watch_cycle, &probe) != 1) {
+        fprintf(stderr, "[%s] project_watch_start failed\n", backend);
+        return 0;
+    }
+    if (project_watch_start(dir, run_test_watch_cycle, &probe) != -1) {
+        fprintf(stderr, "[%s] A second watch was allowed\n", backend);
+        ok = 0;
+    }
+    /* The green baseline is not announced and runs every test */
+    if (watch_probe_cycles(&probe, 1, 2000) != 1 || strcmp(probe.only, "*") != 0 ||
+        watch_announcement(message, sizeof(message), 100)) {
+        fprintf(stderr, "[%s] Unexpected baseline: %d cycles, only=%s, announced '%s'\n", backend, probe.cycles,
+                probe.only, message);
+        ok = 0;
+    }
 
-    FILE* makefile = fopen(makefile_path, "w");
-    if (!makefile) {
-        perror("fopen Makefile");
+    /* A burst of saves is one cycle, running only the tests that mention widget */
+    snprintf(path, sizeof(path), "%s/src/widget.c", dir);
+    write_test_file(path, "int widget_run(void) { return 1; }\n");
+    usleep(10000);
+    write_test_file(path, "int widget_run(void) { return 2; }\n");
+    if (watch_probe_cycles(&probe, 2, 3000) != 2 || watch_probe_cycles(&probe, 3, 400) != 2 ||
+        strcmp(probe.only, "test_widget_works") != 0) {
+        fprintf(stderr, "[%s] Burst ran %d cycles with only=%s\n", backend, probe.cycles, probe.only);
         ok = 0;
-        goto cleanup;
     }
 
-    fprintf(makefile,
-            "all:\n"
-            "\t@echo \"warning: synthetic warning from test\"\n\n"
-            "clean:\n"
-            "\t@echo \"clean\"\n");
-    fclose(makefile);
+    write_test_file(path, "int widget_run(void) { return broken; }\n");
+    if (!watch_announcement(message, sizeof(message), 3000) || !strstr(message, "Build is red: widget.c:1")) {
+        fprintf(stderr, "[%s] Expected a red announcement, got '%s'\n", backend, message);
+        ok = 0;
+    }
+    write_test_file(path, "int widget_run(void) { return 3; }\n");
+    if (!watch_announcement(message, sizeof(message), 3000) || !strstr(message, "Back to green: 1/1 tests passed")) {
+        fprintf(stderr, "[%s] Expected a green announcement, got '%s'\n", backend, message);
+        ok = 0;
+    }
 
-    if (chdir(temp_dir) != 0) {
-        perror("chdir temp_dir");
+    /* Files that are not sources do not trigger a cycle */
+    int cycles = watch_probe_cycles(&probe, 0, 0);
+    snprintf(path, sizeof(path), "%s/notes.txt", dir);
+    write_test_file(path, "remember the milk\n");
+    if (watch_probe_cycles(&probe, cycles + 1, 400) != cycles) {
+        fprintf(stderr, "[%s] notes.txt triggered a cycle\n", backend);
         ok = 0;
-        goto cleanup;
     }
+    unlink(path);
 
-    char* response = process_command("check warnings");
-    if (!response) {
-        fprintf(stderr, "process_command(check warnings) returned NULL\n");
+    if (!project_watch_status(status, sizeof(status)) || !strstr(status, backend) || !strstr(status, "green")) {
+        fprintf(stderr, "[%s] Unexpected status: %s\n", backend, status);
+        ok = 0;
+    }
+    /* Stopped mid-build, the watch stays busy until that build is over */
+    snprintf(path, sizeof(path), "%s/src/widget.c", dir);
+    write_test_file(path, "int widget_run(void) { return slow; }\n");
+    int started = 0;
+    for (int waited = 0; waited <= 3000 && !started; waited += 10) {
+        pthread_mutex_lock(&probe.lock);
+        started = probe.slow_started;
+        pthread_mutex_unlock(&probe.lock);
+        if (!started) usleep(10000);
+    }
+    if (!started || !project_watch_stop() || project_watch_stop()) {
+        fprintf(stderr, "[%s] project_watch_stop did not stop exactly once during a cycle\n", backend);
+        ok = 0;
+    }
+    if (project_watch_start(dir, run_test_watch_cycle, &probe) != -1 ||
+        project_watch_status(status, sizeof(status)) || !strstr(status, "still finishing")) {
+        fprintf(stderr, "[%s] A new watch started while the stopped one was building: %s\n", backend, status);
+        ok = 0;
+    }
+    int released = 0;
+    for (int waited = 0; waited <= 3000 && !released; waited += 10) {
+        project_watch_status(status, sizeof(status));
+        released = strstr(status, "Not watching") != NULL;
+        if (!released) usleep(10000);
+    }
+    if (!released) {
+        fprintf(stderr, "[%s] The stopped watch never finished: %s\n", backend, status);
         ok = 0;
-    } else {
-        if (strstr(response, "Compiler warnings:") == NULL ||
-            strstr(response, "synthetic warning from test") == NULL) {
-            fprintf(stderr, "Unexpected warning-check response: %s\n", response);
-            ok = 0;
-        }
-        free(response);
     }
+    write_test_file(path, "int widget_run(void) { return 0; }\n");
+    return ok;
+}
 
-cleanup:
-    if (chdir(original_cwd) != 0) {
-        perror("chdir original_cwd");
+static int test_project_watch_runs_affected_tests(void) {
+    char template[] = "/tmp/jarvis_watch_test_XXXXXX";
+    char* temp_dir = mkdtemp(template);
+    if (!temp_dir) {
+        perror("mkdtemp");
+        return 0;
+    }
+    char path[PATH_MAX], only[256];
+    const char* dirs[] = { "src", "include", "tests" };
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", temp_dir, dirs[i]);
+        mkdir(path, 0700);
+    }
+    snprintf(path, sizeof(path), "%s/src/widget.c", temp_dir);
+    write_test_file(path, "int widget_run(void) { return 0; }\n");
+    snprintf(path, sizeof(path), "%s/tests/test_widget.c", temp_dir);
+    /* Split so the watcher does not mistake these for tests of this suite */
+    write_test_file(path, "static int " "test_widget_works(void) {\n    return widget_run() == 0;\n}\n\n"
+                          "static int " "test_other(void) {\n    return 1;\n}\n");
+
+    int ok = 1;
+    const char* widget[] = { "src/widget.c", "include/widget.h" };
+    const char* unmapped[] = { "src/widget.c", "src/gadget.c" };
+    const char* rule[] = { "Makefile" };
+    if (project_watch_affected_tests(temp_dir, widget, 2, only, sizeof(only)) != 1 ||
+        strcmp(only, "test_widget_works") != 0 ||
+        project_watch_affected_tests(temp_dir, unmapped, 2, only, sizeof(only)) != -1 ||
+        project_watch_affected_tests(temp_dir, rule, 1, only, sizeof(only)) != -1) {
+        fprintf(stderr, "Unexpected affected tests: %s\n", only);
         ok = 0;
     }
 
-    remove(makefile_path);
-    rmdir(temp_dir);
+    setenv("JARVIS_WATCH_DEBOUNCE_MS", "100", 1);
+    if (!exercise_project_watch(temp_dir, "inotify")) ok = 0;
+    setenv("JARVIS_WATCH_POLL", "1", 1);
+    setenv("JARVIS_WATCH_POLL_MS", "20", 1);
+    if (!exercise_project_watch(temp_dir, "polling")) ok = 0;
+    unsetenv("JARVIS_WATCH_POLL");
+    unsetenv("JARVIS_WATCH_POLL_MS");
+    unsetenv("JARVIS_WATCH_DEBOUNCE_MS");
+
+    char* response = process_command("stop watching");
+    if (!response || !strstr(response, "I'm not watching a project")) {
+        fprintf(stderr, "Unexpected stop response: %s\n", response ? response : "(null)");
+        ok = 0;
+    }
+    free(response);
 
+    /* Let the stopped watchers release the directory before it goes */
+    usleep(100000);
+    snprintf(path, sizeof(path), "rm -rf '%s'", temp_dir);
+    if (system(path) != 0) ok = 0;
     return ok;
 }
 
@@ -900,45 +3031,466 @@ cleanup:
     return ok;
 }
 
-int main(void) {
-    int total = 0;
-    int passed = 0;
+/* ── Runner ───────────────────────────────────────────────────────────────
+ * Every test runs in its own forked process (its own process group) with a
+ * private temporary working directory and HOME, so tests that chdir, write
+ * state files or leave children behind cannot affect each other and run in
+ * parallel. Output is captured per test and shown only for failures.
+ *
+ *   test_suite [-j N] [--only a,b] [--timeout SEC] [--tap] [--junit FILE]
+ *              [--no-fork] [--list]
+ *
+ * -j defaults to JARVIS_TEST_JOBS or the number of CPUs, --timeout to
+ * JARVIS_TEST_TIMEOUT or 120 seconds. --only runs the tests whose names
+ * contain any of the comma-separated words. --no-fork runs the selected
+ * tests one by one in this process (for a debugger).
+ */
+
+typedef struct {
+    const char* name;
+    int (*run)(void);
+} TestCase;
+
+#define TEST_CASE(fn) { #fn, fn }
+
+static const TestCase g_tests[] = {
+    TEST_CASE(test_to_lowercase),
+    TEST_CASE(test_command_contains),
+    TEST_CASE(test_extract_search_query),
+    TEST_CASE(test_extract_search_query_hinglish),
+    TEST_CASE(test_process_help),
+    TEST_CASE(test_process_command_ex_reports_intent),
+    TEST_CASE(test_sessions_keep_separate_memory),
+    TEST_CASE(test_client_runs_commands_in_its_own_directory),
+    TEST_CASE(test_client_starts_the_daemon_on_first_use),
+    TEST_CASE(test_event_loop_dispatches_fds_timers_and_children),
+    TEST_CASE(test_performance_report_lists_intents),
+    TEST_CASE(test_batch_refuses_overlong_lines_whole),
+    TEST_CASE(test_trace_exports_chrome_json),
+    TEST_CASE(test_trace_dump_skips_slots_being_overwritten),
+    TEST_CASE(test_log_formats_rotates_and_flushes),
+    TEST_CASE(test_file_index_ranks_and_tracks_files),
+    TEST_CASE(test_file_meta_sorts_results),
+    TEST_CASE(test_dir_walk_filters_and_stops),
+    TEST_CASE(test_weather_answers_from_cache),
+    TEST_CASE(test_knowledge_answers_from_local_notes),
+    TEST_CASE(test_knowledge_rebuilds_corrupt_segment),
+    TEST_CASE(test_daily_status_non_git_dir),
+    TEST_CASE(test_symbol_index_finds_definitions_and_callers),
+    TEST_CASE(test_code_search_respects_gitignore_and_regex),
+    TEST_CASE(test_find_function_path),
+    TEST_CASE(test_warning_check_flow),
+    TEST_CASE(test_warning_cache_recompiles_only_changed_units),
+    TEST_CASE(test_diagnostics_summarize_build_log),
+    TEST_CASE(test_build_driver_rebuilds_only_stale_objects),
+    TEST_CASE(test_compile_cache_restores_clean_build),
+    TEST_CASE(test_git_status_reads_repository_natively),
+    TEST_CASE(test_project_status_ranks_repositories),
+    TEST_CASE(test_routine_runs_steps_by_dependency),
+    TEST_CASE(test_project_watch_runs_affected_tests),
+    TEST_CASE(test_open_vscode_command_path),
+    TEST_CASE(test_open_xcode_routes_correctly),
+    TEST_CASE(test_ai_project_bootstrap_python),
+    TEST_CASE(test_open_project_command_path),
+    TEST_CASE(test_open_last_project_command_path),
+    TEST_CASE(test_create_folder_command),
+    TEST_CASE(test_open_file_command_path),
+    TEST_CASE(test_set_mode_developer_persists_persona),
+    TEST_CASE(test_create_file_with_template),
+    TEST_CASE(test_generate_code_file_requires_prompt),
+    TEST_CASE(test_make_a_project_phrase_routes_to_project_creation),
+    TEST_CASE(test_create_module_updates_makefile),
+};
+
+#undef TEST_CASE
+
+#define TEST_COUNT ((int)(sizeof(g_tests) / sizeof(g_tests[0])))
+
+typedef enum { TEST_PENDING, TEST_RUNNING, TEST_PASSED, TEST_FAILED, TEST_TIMED_OUT, TEST_CRASHED } TestState;
+
+typedef struct {
+    const TestCase* test;
+    TestState       state;
+    int             signal;       /* for TEST_CRASHED */
+    pid_t           pid;
+    long long       started_us;
+    long long       elapsed_us;
+    char            dir[PATH_MAX - 32];   /* private working directory */
+    char            log[PATH_MAX];        /* captured stdout and stderr */
+    char*           output;
+} TestRun;
+
+static volatile sig_atomic_t g_interrupted = 0;
+
+static void on_interrupt(int sig) {
+    (void)sig;
+    g_interrupted = 1;
+}
+
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
 
-#define RUN_TEST(fn) \
-    do { \
-        total++; \
-        if (fn()) { \
-            passed++; \
-            printf("[PASS] %s\n", #fn); \
-        } else { \
-            printf("[FAIL] %s\n", #fn); \
-        } \
-    } while (0)
-
-    RUN_TEST(test_to_lowercase);
-    RUN_TEST(test_command_contains);
-    RUN_TEST(test_extract_search_query);
-    RUN_TEST(test_extract_search_query_hinglish);
-    RUN_TEST(test_process_help);
-    RUN_TEST(test_daily_status_non_git_dir);
-    RUN_TEST(test_find_function_path);
-    RUN_TEST(test_warning_check_flow);
-    RUN_TEST(test_open_vscode_command_path);
-    RUN_TEST(test_open_xcode_routes_correctly);
-    RUN_TEST(test_ai_project_bootstrap_python);
-    RUN_TEST(test_open_project_command_path);
-    RUN_TEST(test_open_last_project_command_path);
-    RUN_TEST(test_create_folder_command);
-    RUN_TEST(test_open_file_command_path);
-    RUN_TEST(test_set_mode_developer_persists_persona);
-    RUN_TEST(test_create_file_with_template);
-    RUN_TEST(test_generate_code_file_requires_prompt);
-    RUN_TEST(test_make_a_project_phrase_routes_to_project_creation);
-    RUN_TEST(test_create_module_updates_makefile);
-
-#undef RUN_TEST
-
-    printf("\n%d/%d tests passed\n", passed, total);
-
-    return (passed == total) ? 0 : 1;
+/* rm -rf without following symlinks */
+static void remove_tree(const char* path) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return;
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path);
+        if (dir) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+                char child[PATH_MAX];
+                int len = snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+                if (len > 0 && (size_t)len < sizeof(child)) remove_tree(child);
+            }
+            closedir(dir);
+        }
+        rmdir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+static char* read_log(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return NULL;
+    size_t cap = 4096, len = 0;
+    char* text = malloc(cap);
+    size_t got;
+    while (text && (got = fread(text + len, 1, cap - len - 1, file)) > 0) {
+        len += got;
+        if (len + 1 == cap) {
+            char* grown = realloc(text, cap * 2);
+            if (!grown) break;
+            text = grown;
+            cap *= 2;
+        }
+    }
+    fclose(file);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+static int test_selected(const char* name, const char* only) {
+    if (!only || !only[0]) return 1;
+    char words[1024];
+    snprintf(words, sizeof(words), "%s", only);
+    for (char* word = strtok(words, ", "); word; word = strtok(NULL, ", ")) {
+        if (strstr(name, word)) return 1;
+    }
+    return 0;
+}
+
+/* Private working directory and HOME for one test */
+static void enter_test(const TestRun* run) {
+    setenv("HOME", run->dir, 1);
+    unsetenv("XDG_CACHE_HOME");
+    if (chdir(run->dir) != 0) perror("chdir test dir");
+}
+
+static int start_test(TestRun* run) {
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        sigset_t blocked;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &blocked, NULL);
+        setpgid(0, 0);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        int log = open(run->log, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        int null_in = open("/dev/null", O_RDONLY);
+        if (log < 0) _exit(2);
+        if (null_in >= 0) dup2(null_in, STDIN_FILENO);
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        enter_test(run);
+        int ok = run->test->run();
+        fflush(NULL);
+        _exit(ok ? 0 : 1);
+    }
+    setpgid(pid, pid);   /* also here, so kill(-pid) works before the child gets to it */
+    run->pid = pid;
+    run->state = TEST_RUNNING;
+    run->started_us = now_us();
+    return 1;
+}
+
+static void finish_test(TestRun* run, int status) {
+    run->elapsed_us = now_us() - run->started_us;
+    run->pid = 0;
+    if (run->state != TEST_TIMED_OUT) {
+        if (WIFEXITED(status)) {
+            run->state = WEXITSTATUS(status) == 0 ? TEST_PASSED : TEST_FAILED;
+        } else {
+            run->state = TEST_CRASHED;
+            run->signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+        }
+    }
+    run->output = read_log(run->log);
+}
+
+static const char* state_label(const TestRun* run) {
+    switch (run->state) {
+        case TEST_PASSED:    return "PASS";
+        case TEST_TIMED_OUT: return "TIMEOUT";
+        case TEST_CRASHED:   return "CRASH";
+        default:             return "FAIL";
+    }
+}
+
+static void print_result(const TestRun* run, int tap) {
+    if (tap) return;
+    printf("[%s] %s (%lld ms)", state_label(run), run->test->name, run->elapsed_us / 1000);
+    if (run->state == TEST_CRASHED) printf(" signal %d", run->signal);
+    printf("\n");
+    if (run->state != TEST_PASSED && run->output && run->output[0]) {
+        for (const char* line = run->output; *line;) {
+            size_t len = strcspn(line, "\n");
+            printf("    %.*s\n", (int)len, line);
+            line += len + (line[len] == '\n');
+        }
+    }
+    fflush(stdout);
+}
+
+/* Keeps up to jobs tests running; a test that outlives the timeout has its
+   whole process group killed, and so does one that exits leaving children.
+   SIGCHLD stays blocked and is waited for with the nearest deadline as the
+   timeout, so a finished test is noticed at once. */
+static void run_forked(TestRun* runs, int count, int jobs, long long timeout_us, int tap) {
+    sigset_t child_exited;
+    sigemptyset(&child_exited);
+    sigaddset(&child_exited, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &child_exited, NULL);
+    int next = 0, running = 0;
+    while ((next < count || running > 0) && !g_interrupted) {
+        while (running < jobs && next < count) {
+            if (start_test(&runs[next])) {
+                running++;
+            } else {
+                runs[next].state = TEST_FAILED;
+                print_result(&runs[next], tap);
+            }
+            next++;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0) {
+            for (int i = 0; i < next; i++) {
+                if (runs[i].pid != pid) continue;
+                kill(-pid, SIGKILL);
+                finish_test(&runs[i], status);
+                print_result(&runs[i], tap);
+                running--;
+                break;
+            }
+            continue;
+        }
+
+        long long now = now_us(), wait_us = timeout_us;
+        for (int i = 0; i < next; i++) {
+            if (runs[i].state != TEST_RUNNING) continue;
+            long long left = runs[i].started_us + timeout_us - now;
+            if (left <= 0) {
+                runs[i].state = TEST_TIMED_OUT;
+                kill(-runs[i].pid, SIGKILL);
+            } else if (left < wait_us) {
+                wait_us = left;
+            }
+        }
+        struct timespec wait = { (time_t)(wait_us / 1000000), (long)(wait_us % 1000000) * 1000 };
+        sigtimedwait(&child_exited, NULL, &wait);
+    }
+
+    for (int i = 0; i < next; i++) {
+        if (runs[i].pid <= 0) continue;
+        kill(-runs[i].pid, SIGKILL);
+        waitpid(runs[i].pid, NULL, 0);
+        runs[i].pid = 0;
+        runs[i].state = TEST_PENDING;
+    }
+    sigprocmask(SIG_UNBLOCK, &child_exited, NULL);
+}
+
+/* One at a time in this process, e.g. under a debugger; no isolation */
+static void run_in_process(TestRun* runs, int count) {
+    char* home = getenv("HOME") ? strdup(getenv("HOME")) : NULL;
+    for (int i = 0; i < count && !g_interrupted; i++) {
+        enter_test(&runs[i]);
+        runs[i].started_us = now_us();
+        int ok = runs[i].test->run();
+        runs[i].elapsed_us = now_us() - runs[i].started_us;
+        runs[i].state = ok ? TEST_PASSED : TEST_FAILED;
+        if (chdir(g_source_dir) != 0) perror("chdir source dir");
+        print_result(&runs[i], 0);
+    }
+    if (home) setenv("HOME", home, 1);
+    free(home);
+}
+
+static void write_tap(const TestRun* runs, int count) {
+    printf("TAP version 13\n1..%d\n", count);
+    for (int i = 0; i < count; i++) {
+        const TestRun* run = &runs[i];
+        if (run->state == TEST_PENDING) {
+            printf("ok %d - %s # SKIP interrupted\n", i + 1, run->test->name);
+            continue;
+        }
+        printf("%s %d - %s # %lld ms\n", run->state == TEST_PASSED ? "ok" : "not ok", i + 1, run->test->name,
+               run->elapsed_us / 1000);
+        if (run->state == TEST_PASSED) continue;
+        printf("# %s\n", state_label(run));
+        for (const char* line = run->output ? run->output : ""; *line;) {
+            size_t len = strcspn(line, "\n");
+            printf("# %.*s\n", (int)len, line);
+            line += len + (line[len] == '\n');
+        }
+    }
+}
+
+static void xml_escape(FILE* out, const char* text) {
+    for (; text && *text; text++) {
+        switch (*text) {
+            case '<': fputs("&lt;", out); break;
+            case '>': fputs("&gt;", out); break;
+            case '&': fputs("&amp;", out); break;
+            case '"': fputs("&quot;", out); break;
+            default:
+                /* Control characters other than tab and newline are not valid XML */
+                if ((unsigned char)*text >= 0x20 || *text == '\n' || *text == '\t') fputc(*text, out);
+        }
+    }
+}
+
+static int write_junit(const char* path, const TestRun* runs, int count, long long elapsed_us) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return 0;
+    }
+    int failures = 0, skipped = 0;
+    for (int i = 0; i < count; i++) {
+        failures += runs[i].state != TEST_PASSED && runs[i].state != TEST_PENDING;
+        skipped += runs[i].state == TEST_PENDING;
+    }
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(out, "<testsuite name=\"jarvis\" tests=\"%d\" failures=\"%d\" errors=\"0\" skipped=\"%d\" time=\"%.3f\">\n",
+            count, failures, skipped, elapsed_us / 1e6);
+    for (int i = 0; i < count; i++) {
+        const TestRun* run = &runs[i];
+        fprintf(out, "  <testcase classname=\"test_suite\" name=\"%s\" time=\"%.3f\"", run->test->name, run->elapsed_us / 1e6);
+        if (run->state == TEST_PASSED) {
+            fprintf(out, "/>\n");
+        } else if (run->state == TEST_PENDING) {
+            fprintf(out, "><skipped message=\"interrupted\"/></testcase>\n");
+        } else {
+            fprintf(out, ">\n    <failure message=\"%s\">", state_label(run));
+            xml_escape(out, run->output);
+            fprintf(out, "</failure>\n  </testcase>\n");
+        }
+    }
+    fprintf(out, "</testsuite>\n");
+    return fclose(out) == 0;
+}
+
+int main(int argc, char** argv) {
+    const char* configured = getenv("JARVIS_TEST_JOBS");
+    int jobs = configured ? atoi(configured) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    configured = getenv("JARVIS_TEST_TIMEOUT");
+    double timeout = configured ? atof(configured) : 120;
+    const char* only = NULL;
+    const char* junit = NULL;
+    int tap = 0, fork_tests = 1;
+
+    if (!realpath(argv[0], g_self_path)) snprintf(g_self_path, sizeof(g_self_path), "%s", argv[0]);
+    /* test_client_starts_the_daemon_on_first_use: the client starts this binary as its daemon */
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0) return server_main(argv[2]);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2]) {
+            jobs = atoi(argv[i] + 2);
+        } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeout = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--junit") == 0 && i + 1 < argc) {
+            junit = argv[++i];
+        } else if (strcmp(argv[i], "--tap") == 0) {
+            tap = 1;
+        } else if (strcmp(argv[i], "--no-fork") == 0) {
+            fork_tests = 0;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (int t = 0; t < TEST_COUNT; t++) printf("%s\n", g_tests[t].name);
+            return 0;
+        } else {
+            printf("Usage: %s [-j N] [--only name,...] [--timeout SEC] [--tap] [--junit FILE] [--no-fork] [--list]\n",
+                   argv[0]);
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 2;
+        }
+    }
+    if (jobs < 1) jobs = 1;
+    if (timeout <= 0) timeout = 120;
+
+    if (!getcwd(g_source_dir, sizeof(g_source_dir))) {
+        perror("getcwd");
+        return 2;
+    }
+    char root_template[] = "/tmp/jarvis_tests_XXXXXX";
+    char* root = mkdtemp(root_template);
+    TestRun* runs = calloc(TEST_COUNT, sizeof(TestRun));
+    if (!root || !runs) {
+        perror("test setup");
+        return 2;
+    }
+    int count = 0;
+    for (int t = 0; t < TEST_COUNT; t++) {
+        if (!test_selected(g_tests[t].name, only)) continue;
+        TestRun* run = &runs[count++];
+        run->test = &g_tests[t];
+        snprintf(run->dir, sizeof(run->dir), "%s/%02d", root, t);
+        snprintf(run->log, sizeof(run->log), "%s.log", run->dir);
+        mkdir(run->dir, 0700);
+    }
+    if (count == 0) {
+        fprintf(stderr, "No tests match '%s'\n", only);
+        remove_tree(root);
+        free(runs);
+        return 2;
+    }
+    if (jobs > count) jobs = count;
+    if (!fork_tests) jobs = 1;
+
+    struct sigaction interrupt = { 0 };
+    interrupt.sa_handler = on_interrupt;
+    sigaction(SIGINT, &interrupt, NULL);
+    sigaction(SIGTERM, &interrupt, NULL);
+
+    long long started = now_us();
+    if (fork_tests) run_forked(runs, count, jobs, (long long)(timeout * 1e6), tap);
+    else run_in_process(runs, count);
+    long long elapsed = now_us() - started;
+
+    int passed = 0;
+    for (int i = 0; i < count; i++) passed += runs[i].state == TEST_PASSED;
+    if (tap) write_tap(runs, count);
+    int written = !junit || write_junit(junit, runs, count, elapsed);
+    if (!tap) {
+        printf("\n%d/%d tests passed (%.2f s, %d job%s%s)\n", passed, count, elapsed / 1e6, jobs, jobs == 1 ? "" : "s",
+               g_interrupted ? ", interrupted" : "");
+    }
+
+    for (int i = 0; i < count; i++) free(runs[i].output);
+    free(runs);
+    remove_tree(root);
+    if (g_interrupted) return 130;
+    return (passed == count && written) ? 0 : 1;
 }